@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <unistd.h>
+
+namespace ExGraf::Bench {
+
+// Resident set size of this process, in bytes (Linux only; 0 elsewhere).
+inline auto resident_set_bytes() -> std::size_t {
+	std::ifstream statm("/proc/self/statm");
+	std::size_t total_pages = 0, resident_pages = 0;
+	if (!(statm >> total_pages >> resident_pages))
+		return 0;
+	return resident_pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+inline auto to_mib(std::size_t bytes) -> double {
+	return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+} // namespace ExGraf::Bench
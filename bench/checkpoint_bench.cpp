@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/checkpoint.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+auto make_model(std::size_t hidden) -> Model<float> {
+	return Model<float>(784, hidden, 10,
+											std::make_unique<AdamOptimizer<float>>());
+}
+
+auto checkpoint_file(std::size_t hidden) -> std::filesystem::path {
+	return std::filesystem::temp_directory_path() /
+				 ("exgraf-bench-" + std::to_string(hidden) + ".exgrafck");
+}
+
+// A checkpoint with Adam state, as a training job leaves it.
+auto ensure_checkpoint(std::size_t hidden) -> std::filesystem::path {
+	const auto file = checkpoint_file(hidden);
+	arma::arma_rng::set_seed(1);
+	auto model = make_model(hidden);
+	const Tensor<float> x(arma::randu<arma::Mat<float>>(32, 784));
+	const arma::Col<std::size_t> labels(32, arma::fill::zeros);
+	model.compute_loss(model.forward(x), Model<float>::to_one_hot(labels, 10));
+	model.backward();
+	model.step();
+	Checkpoint::save(file, model);
+	return file;
+}
+
+} // namespace
+
+// Inference process startup: build the model, load its parameters and
+// answer one request. Arg 0 is the hidden width; arg 1 picks the loader:
+// 0 reads the whole file through a stream and copies it into the weights,
+// 1 maps it (Checkpoint::load without optimizer state).
+static void BM_InferenceStartup(benchmark::State &state) {
+	const auto hidden = static_cast<std::size_t>(state.range(0));
+	const auto file = ensure_checkpoint(hidden);
+	const Tensor<float> request(arma::randu<arma::Mat<float>>(1, 784));
+	const bool mapped = state.range(1) == 1;
+	for (auto _ : state) {
+		auto model = make_model(hidden);
+		if (mapped) {
+			Checkpoint::load(file, model, {.optimizer_state = false});
+		} else {
+			std::ifstream in(file, std::ios::binary);
+			std::vector<char> bytes(std::filesystem::file_size(file));
+			in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+			Checkpoint::CheckpointHeader header;
+			std::memcpy(&header, bytes.data(), sizeof(header));
+			const auto *source = reinterpret_cast<const float *>(
+					bytes.data() + header.parameter_offset);
+			for (auto &p : model.params()) {
+				auto &m = *p.get().data;
+				std::copy_n(source, m.n_elem, m.memptr());
+				source += m.n_elem;
+			}
+		}
+		benchmark::DoNotOptimize(model.predict(request).data->memptr());
+	}
+	state.SetBytesProcessed(state.iterations() *
+													std::filesystem::file_size(file));
+}
+BENCHMARK(BM_InferenceStartup)
+		->ArgsProduct({{256, 2048}, {0, 1}})
+		->Unit(benchmark::kMillisecond);
+
+// How long training is held up by a checkpoint. Arg 0 is the hidden width;
+// arg 1: 0 saves synchronously, 1 only pays for the snapshot (the write
+// finishes on its own thread and is awaited outside the timing).
+static void BM_CheckpointStall(benchmark::State &state) {
+	const auto hidden = static_cast<std::size_t>(state.range(0));
+	auto model = make_model(hidden);
+	const auto file = checkpoint_file(hidden);
+	const bool async = state.range(1) == 1;
+	for (auto _ : state) {
+		if (!async) {
+			Checkpoint::save(file, model);
+			continue;
+		}
+		auto pending = Checkpoint::save_async(file, model);
+		state.PauseTiming();
+		pending.get();
+		state.ResumeTiming();
+	}
+}
+BENCHMARK(BM_CheckpointStall)
+		->ArgsProduct({{256, 2048}, {0, 1}})
+		->Unit(benchmark::kMillisecond);
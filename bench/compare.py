@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Compare two ExGrafBench JSON files and flag regressions.
+
+    python3 bench/compare.py baseline.json candidate.json [--threshold 10]
+                             [--filter REGEX] [--metric real_time]
+
+Both files are Google Benchmark JSON (see the bench_json target). With
+repetitions the median aggregate is compared, otherwise the single run.
+Times are normalised to nanoseconds, so a change of a benchmark's unit
+between commits is harmless. Exits 1 when any benchmark matching --filter
+got slower by more than --threshold percent, so CI can gate on it.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+UNIT_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    with open(path) as f:
+        report = json.load(f)
+    runs, medians = {}, {}
+    for b in report.get("benchmarks", []):
+        if b.get("error_occurred"):
+            continue
+        value = float(b[metric]) * UNIT_NS[b.get("time_unit", "ns")]
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") == "median":
+                medians[b["run_name"]] = value
+        else:
+            runs.setdefault(b.get("run_name", b["name"]), value)
+    runs.update(medians)
+    return runs
+
+
+def format_ns(ns):
+    for unit in ("s", "ms", "us"):
+        if ns >= UNIT_NS[unit]:
+            return f"{ns / UNIT_NS[unit]:.3f} {unit}"
+    return f"{ns:.1f} ns"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default 10)")
+    parser.add_argument("--filter", default=".",
+                        help="only gate benchmarks whose name matches")
+    parser.add_argument("--metric", default="real_time",
+                        choices=("real_time", "cpu_time"))
+    args = parser.parse_args()
+
+    old = load(args.baseline, args.metric)
+    new = load(args.candidate, args.metric)
+    gate = re.compile(args.filter)
+    names = sorted(set(old) & set(new))
+    if not names:
+        print("no benchmarks in common", file=sys.stderr)
+        return 2
+
+    width = max(len("Benchmark"), *(len(n) for n in names))
+    print(f"{'Benchmark':<{width}}  {'Baseline':>12}  {'Candidate':>12}  "
+          f"{'Change':>8}")
+    regressions = []
+    for name in names:
+        change = 100.0 * (new[name] - old[name]) / old[name] if old[name] else 0.0
+        gated = gate.search(name) is not None
+        flag = ""
+        if gated and change > args.threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        print(f"{name:<{width}}  {format_ns(old[name]):>12}  "
+              f"{format_ns(new[name]):>12}  {change:>+7.1f}%{flag}")
+    for name in sorted(set(old) ^ set(new)):
+        side = "baseline" if name in old else "candidate"
+        print(f"{name:<{width}}  only in {side}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) more than "
+              f"{args.threshold:g}% slower", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/spatial_operation.hpp"
+
+#include <armadillo>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+using namespace ExGraf::Spatial;
+
+namespace {
+
+// The two convolutions of a small MNIST CNN: 1x28x28 -> 8 and, after a 2x2
+// pool, 8x14x14 -> 16, both 3x3 with same padding.
+auto mnist_geometry(int layer) -> Conv2DGeometry {
+	if (layer == 0)
+		return {1, 28, 28, 8, 3, 1, 1};
+	return {8, 14, 14, 16, 3, 1, 1};
+}
+
+// Ten classes of 28x28 images: class k is a bright vertical bar at column
+// 2k + 4 plus uniform noise, so both models can reach high accuracy.
+auto synthetic_digits(std::size_t n, arma::Mat<float> &x, arma::Mat<float> &y)
+		-> void {
+	x = arma::randu<arma::Mat<float>>(n, 784) * 0.3F;
+	y.zeros(n, 10);
+	for (std::size_t i = 0; i < n; ++i) {
+		const auto k = i % 10;
+		for (std::size_t row = 4; row < 24; ++row)
+			x(i, row * 28 + 2 * k + 4) += 0.7F;
+		y(i, k) = 1.0F;
+	}
+}
+
+auto accuracy(const arma::Mat<float> &output, const arma::Mat<float> &y)
+		-> double {
+	const arma::uvec predicted = arma::index_max(output, 1);
+	const arma::uvec expected = arma::index_max(y, 1);
+	return double(arma::accu(predicted == expected)) / double(y.n_rows);
+}
+
+} // namespace
+
+// Forward plus backward of one convolution on a 64-image batch.
+// Arg 0: layer (see mnist_geometry); arg 1: 0 im2col, 1 direct.
+static void BM_Conv2DStep(benchmark::State &state) {
+	constexpr std::size_t batch_size = 64;
+	const auto g = mnist_geometry(static_cast<int>(state.range(0)));
+	const auto algorithm =
+			state.range(1) == 0 ? ConvAlgorithm::Im2col : ConvAlgorithm::Direct;
+	arma::arma_rng::set_seed(1);
+	const Tensor<float> x(
+			arma::randu<arma::Mat<float>>(batch_size, g.in_features()));
+	const Tensor<float> b(arma::randn<arma::Mat<float>>(1, g.out_channels));
+	const Tensor<float> dy(
+			arma::randn<arma::Mat<float>>(batch_size, g.out_features()));
+	const Tensor<float> weights(
+			arma::randn<arma::Mat<float>>(g.patch(), g.out_channels));
+
+	Conv2DOp<float> op(g, algorithm);
+	std::vector<Tensor<float>> grads(3);
+	for (auto _ : state) {
+		auto out = op.forward({x, weights, b});
+		benchmark::DoNotOptimize(out.data->memptr());
+		op.backward(dy, grads);
+		benchmark::ClobberMemory();
+	}
+	state.counters["GFLOPS"] = benchmark::Counter(
+			3.0 * 2.0 * double(g.out_features() * g.patch() * batch_size) * 1e-9,
+			benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_Conv2DStep)
+		->ArgsProduct({{0, 1}, {0, 1}})
+		->Unit(benchmark::kMicrosecond);
+
+// Trains on synthetic digits until held-out accuracy reaches 95% (or 300
+// steps pass). Arg 0: MLP 784-128-10; arg 1: CNN conv8-pool-conv16-pool-10.
+// `steps` and `seconds` are the cost of getting there; `acc_per_second`
+// compares the two models per unit of accuracy.
+static void BM_TrainToAccuracy(benchmark::State &state) {
+	constexpr std::size_t batch_size = 64;
+	constexpr double target = 0.95;
+	arma::arma_rng::set_seed(2);
+	arma::Mat<float> x, y, test_x, test_y;
+	synthetic_digits(batch_size * 16, x, y);
+	synthetic_digits(500, test_x, test_y);
+	const Tensor<float> held_out(test_x);
+
+	double steps = 0.0, seconds = 0.0, reached = 0.0;
+	for (auto _ : state) {
+		arma::arma_rng::set_seed(3);
+		auto adam = std::make_unique<AdamOptimizer<float>>(0.002F);
+		auto net =
+				state.range(0) == 0
+						? Sequential<float>(784, std::move(adam), Linear<float>(128),
+																ReLU<float>(), Linear<float>(10),
+																Softmax<float>())
+						: Sequential<float>(
+									Shape{1, 28, 28}, std::move(adam),
+									Conv2D<float>(8, 3, 1, 1), ReLU<float>(),
+									MaxPool2D<float>(2), Conv2D<float>(16, 3, 1, 1),
+									ReLU<float>(), MaxPool2D<float>(2), Linear<float>(10),
+									Softmax<float>());
+		const auto start = std::chrono::steady_clock::now();
+		std::size_t step = 0;
+		double acc = 0.0;
+		while (step < 300 && acc < target) {
+			const auto first = (step * batch_size) % x.n_rows;
+			const Tensor<float> bx(x.rows(first, first + batch_size - 1));
+			const Tensor<float> by(y.rows(first, first + batch_size - 1));
+			auto output = net.forward(bx);
+			net.compute_loss(output, by);
+			net.backward();
+			net.step();
+			net.zero_grad();
+			if (++step % 10 == 0) {
+				net.set_training(false);
+				acc = accuracy(*net.forward(held_out).data, test_y);
+				net.reset_graph();
+				net.set_training(true);
+			}
+		}
+		seconds += std::chrono::duration<double>(
+									 std::chrono::steady_clock::now() - start)
+									 .count();
+		steps += double(step);
+		reached += acc;
+	}
+	const auto runs = double(state.iterations());
+	state.counters["steps"] = steps / runs;
+	state.counters["accuracy"] = reached / runs;
+	state.counters["seconds"] = seconds / runs;
+	state.counters["acc_per_second"] = reached / seconds;
+}
+BENCHMARK(BM_TrainToAccuracy)
+		->Arg(0)
+		->Arg(1)
+		->Iterations(1)
+		->Unit(benchmark::kMillisecond);
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/loaders/data_loader.hpp"
+
+using namespace ExGraf;
+
+namespace {
+
+auto mnist_shaped(std::size_t samples, std::size_t cols) -> Tensor<double> {
+	return Tensor<double>(
+			arma::Mat<double>(arma::randu<arma::Mat<double>>(samples, cols)));
+}
+
+} // namespace
+
+// Batch assembly as main.cpp used to do it: row by row into fresh matrices on
+// the training thread.
+static void BM_InlineRowGather(benchmark::State &state) {
+	constexpr std::size_t batch_size = 128;
+	auto images = mnist_shaped(60000, 784);
+	auto labels = mnist_shaped(60000, 10);
+	arma::uvec order = arma::shuffle(
+			arma::linspace<arma::uvec>(0, images.data->n_rows - 1,
+																 images.data->n_rows));
+	std::size_t next = 0;
+	for (auto _ : state) {
+		arma::Mat<double> x(batch_size, 784), y(batch_size, 10);
+		for (std::size_t i = 0; i < batch_size; ++i) {
+			auto idx = order((next + i) % order.n_elem);
+			x.row(i) = images.data->row(idx);
+			y.row(i) = labels.data->row(idx);
+		}
+		next += batch_size;
+		benchmark::DoNotOptimize(x.memptr());
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+													batch_size);
+}
+BENCHMARK(BM_InlineRowGather)->Unit(benchmark::kMicrosecond);
+
+// Time the training thread spends in DataLoader::next() per batch, for a
+// consumer that does no work of its own (the worst case for prefetching).
+// Arg: background workers.
+static void BM_DataLoaderNext(benchmark::State &state) {
+	constexpr std::size_t batch_size = 128;
+	DataLoader<double> loader(
+			mnist_shaped(60000, 784), mnist_shaped(60000, 10),
+			{.batch_size = batch_size,
+			 .prefetch = 4,
+			 .workers = static_cast<std::size_t>(state.range(0))});
+	for (auto _ : state) {
+		auto batch = loader.next();
+		if (!batch)
+			batch = loader.next();
+		benchmark::DoNotOptimize(batch->inputs.data->memptr());
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+													batch_size);
+}
+BENCHMARK(BM_DataLoaderNext)
+		->Arg(1)
+		->Arg(2)
+		->Arg(4)
+		->UseRealTime()
+		->Unit(benchmark::kMicrosecond);
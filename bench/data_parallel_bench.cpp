@@ -0,0 +1,41 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/data_parallel_trainer.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+
+#include <thread>
+
+using namespace ExGraf;
+
+// Samples per second of DataParallelTrainer on MNIST-shaped global batches
+// as the worker count grows. Wall time is measured since the work happens
+// on the executor's threads.
+static void BM_DataParallelScaling(benchmark::State &state) {
+	using T = double;
+	constexpr std::size_t batch_size = 512;
+	const auto workers = static_cast<std::size_t>(state.range(0));
+
+	arma::Mat<T> x = arma::randu<arma::Mat<T>>(batch_size, 784);
+	arma::Mat<T> y(batch_size, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < batch_size; ++i)
+		y(i, i % 10) = T(1);
+	Tensor<T> batch_x(x);
+	Tensor<T> batch_y(y);
+
+	Model<T> model(784, 256, 10, std::make_unique<AdamOptimizer<T>>(0.001));
+	DataParallelTrainer<T> trainer(model, workers);
+	trainer.step(batch_x, batch_y);
+	trainer.step(batch_x, batch_y);
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(trainer.step(batch_x, batch_y));
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+													batch_size);
+	state.counters["hardware_threads"] =
+			static_cast<double>(std::thread::hardware_concurrency());
+}
+BENCHMARK(BM_DataParallelScaling)
+		->RangeMultiplier(2)
+		->Range(1, 16)
+		->UseRealTime()
+		->Unit(benchmark::kMillisecond);
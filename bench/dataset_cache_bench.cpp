@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/loaders/dataset_cache.hpp"
+#include "exgraf/loaders/mnist_loader.hpp"
+
+#include <filesystem>
+
+using namespace ExGraf;
+
+namespace {
+
+constexpr std::size_t images = 60000;
+constexpr std::size_t pixels = 784;
+
+auto synthetic_idx() -> std::vector<unsigned char> {
+	std::vector<unsigned char> buffer(16 + images * pixels);
+	const auto put = [&](std::size_t at, std::uint32_t v) {
+		for (std::size_t i = 0; i < 4; ++i)
+			buffer[at + i] = static_cast<unsigned char>(v >> (24 - 8 * i));
+	};
+	put(0, 2051);
+	put(4, images);
+	put(8, 28);
+	put(12, 28);
+	for (std::size_t i = 16; i < buffer.size(); ++i)
+		buffer[i] = static_cast<unsigned char>(i * 31);
+	return buffer;
+}
+
+auto cache_file() -> std::filesystem::path {
+	return std::filesystem::temp_directory_path() / "exgraf-bench-images.exgraf";
+}
+
+} // namespace
+
+// What every start paid before the cache (after the download): decoding the
+// 60k training images from IDX bytes.
+static void BM_ParseIdxImages(benchmark::State &state) {
+	const auto buffer = synthetic_idx();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(MNIST::parse_idx_images(buffer).memptr());
+}
+BENCHMARK(BM_ParseIdxImages)->Unit(benchmark::kMillisecond);
+
+// Opening the cached tensor. Arg: rows of one batch read afterwards (0 maps
+// only), showing that cost follows the pages touched.
+static void BM_MapDatasetCache(benchmark::State &state) {
+	const auto file = cache_file();
+	if (!Cache::map_dataset<double>(file)) {
+		Tensor<double> decoded(MNIST::parse_idx_images(synthetic_idx()));
+		Cache::write_dataset(file, decoded);
+	}
+	const auto rows = static_cast<std::size_t>(state.range(0));
+	for (auto _ : state) {
+		auto tensor = Cache::map_dataset<double>(file);
+		double sum = 0;
+		for (std::size_t c = 0; c < pixels && rows > 0; ++c) {
+			for (std::size_t r = 0; r < rows; ++r)
+				sum += tensor->data->at(r, c);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+}
+BENCHMARK(BM_MapDatasetCache)->Arg(0)->Arg(128)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,156 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/loaders/decode_kernels.hpp"
+#include "exgraf/loaders/idx_stream.hpp"
+
+#include <armadillo>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace ExGraf;
+
+// Throughput is reported in bytes per second: IDX payload decoded for the
+// pixel benchmarks, one-hot output written for the label ones.
+
+namespace {
+
+constexpr std::size_t images = 10000;
+constexpr std::size_t pixels = 784;
+
+auto idx_payload() -> const std::vector<unsigned char> & {
+	static const auto buffer = [] {
+		std::vector<unsigned char> out(16 + images * pixels);
+		const auto put = [&](std::size_t at, std::uint32_t v) {
+			for (std::size_t i = 0; i < 4; ++i)
+				out[at + i] = static_cast<unsigned char>(v >> (24 - 8 * i));
+		};
+		put(0, 2051);
+		put(4, images);
+		put(8, 28);
+		put(12, 28);
+		for (std::size_t i = 16; i < out.size(); ++i)
+			out[i] = static_cast<unsigned char>(i * 31);
+		return out;
+	}();
+	return buffer;
+}
+
+auto labels() -> const std::vector<std::uint8_t> & {
+	static const auto out = [] {
+		std::vector<std::uint8_t> l(60000);
+		for (std::size_t i = 0; i < l.size(); ++i)
+			l[i] = static_cast<std::uint8_t>((i * 7) % 10);
+		return l;
+	}();
+	return out;
+}
+
+auto level(const benchmark::State &state) -> Isa {
+	return static_cast<Isa>(state.range(0));
+}
+
+auto skip_unsupported(benchmark::State &state) -> bool {
+	if (isa_supported(level(state)))
+		return false;
+	state.SkipWithError("instruction set not supported on this CPU");
+	return true;
+}
+
+auto per_level(benchmark::internal::Benchmark *bench) -> void {
+	for (auto isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2})
+		bench->Arg(static_cast<int>(isa))->ArgName(std::string(isa_name(isa)));
+}
+
+} // namespace
+
+// The loop `parse_idx_images` used: one strided store per byte into the
+// column-major matrix while walking the buffer row by row.
+template <typename T>
+static void BM_PixelDecodeBaseline(benchmark::State &state) {
+	const auto &buffer = idx_payload();
+	arma::Mat<T> data(images, pixels);
+	for (auto _ : state) {
+		std::size_t offset = 16;
+		for (std::size_t i = 0; i < images; i++)
+			for (std::size_t p = 0; p < pixels; p++)
+				data(i, p) = buffer[offset++] / 255.0;
+		benchmark::DoNotOptimize(data.memptr());
+	}
+	state.SetBytesProcessed(
+			static_cast<std::int64_t>(state.iterations() * images * pixels));
+}
+BENCHMARK_TEMPLATE(BM_PixelDecodeBaseline, float);
+BENCHMARK_TEMPLATE(BM_PixelDecodeBaseline, double);
+
+// The streaming parser, which stages images in a tile and normalizes one
+// contiguous column run at a time.
+template <typename T>
+static void BM_PixelDecodeParser(benchmark::State &state) {
+	if (skip_unsupported(state))
+		return;
+	const auto &buffer = idx_payload();
+	for (auto _ : state) {
+		MNIST::IdxImageParser<T> parser(level(state));
+		parser.consume(buffer);
+		benchmark::DoNotOptimize(parser.result().data->memptr());
+	}
+	state.SetBytesProcessed(
+			static_cast<std::int64_t>(state.iterations() * images * pixels));
+}
+BENCHMARK_TEMPLATE(BM_PixelDecodeParser, float)->Apply(per_level);
+BENCHMARK_TEMPLATE(BM_PixelDecodeParser, double)->Apply(per_level);
+
+// The normalization kernel alone on contiguous input: the ceiling for the
+// parser.
+template <typename T> static void BM_NormalizeKernel(benchmark::State &state) {
+	if (skip_unsupported(state))
+		return;
+	const auto &buffer = idx_payload();
+	std::vector<T> out(images * pixels);
+	for (auto _ : state) {
+		Kernels::normalize_u8(buffer.data() + 16, out.size(), out.data(),
+													level(state));
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetBytesProcessed(
+			static_cast<std::int64_t>(state.iterations() * out.size()));
+}
+BENCHMARK_TEMPLATE(BM_NormalizeKernel, float)->Apply(per_level);
+BENCHMARK_TEMPLATE(BM_NormalizeKernel, double)->Apply(per_level);
+
+// The scatter `Model::to_one_hot` used: zero the matrix, then one strided
+// store per label. Bytes are one-hot output written.
+template <typename T> static void BM_OneHotBaseline(benchmark::State &state) {
+	const auto &l = labels();
+	for (auto _ : state) {
+		arma::Mat<T> one_hot(l.size(), 10, arma::fill::zeros);
+		for (std::size_t i = 0; i < l.size(); ++i)
+			one_hot(i, l[i]) = T(1);
+		benchmark::DoNotOptimize(one_hot.memptr());
+	}
+	state.SetBytesProcessed(
+			static_cast<std::int64_t>(state.iterations() * l.size() * 10 *
+																sizeof(T)));
+}
+BENCHMARK_TEMPLATE(BM_OneHotBaseline, float);
+BENCHMARK_TEMPLATE(BM_OneHotBaseline, double);
+
+// Column-by-column encoding; bytes are one-hot output written, as above.
+template <typename T> static void BM_OneHotKernel(benchmark::State &state) {
+	if (skip_unsupported(state))
+		return;
+	const auto &l = labels();
+	for (auto _ : state) {
+		arma::Mat<T> one_hot(l.size(), 10);
+		Kernels::one_hot_u8(l.data(), l.size(), 10, one_hot.memptr(), l.size(),
+												level(state));
+		benchmark::DoNotOptimize(one_hot.memptr());
+	}
+	state.SetBytesProcessed(
+			static_cast<std::int64_t>(state.iterations() * l.size() * 10 *
+																sizeof(T)));
+}
+BENCHMARK_TEMPLATE(BM_OneHotKernel, float)->Apply(per_level);
+BENCHMARK_TEMPLATE(BM_OneHotKernel, double)->Apply(per_level);
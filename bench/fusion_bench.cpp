@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+
+using namespace ExGraf;
+
+// One training step on an MNIST-sized batch with the fusion pass off (0) or
+// on (1). `unshared_mib` sums every activation and gradient buffer the
+// steady-state step requests, a proxy for the memory traffic fusion removes.
+static void BM_TrainingStepFusion(benchmark::State &state) {
+	using T = double;
+	constexpr std::size_t batch_size = 128;
+	const auto fused = state.range(0) != 0;
+
+	arma::Mat<T> x = arma::randu<arma::Mat<T>>(batch_size, 784);
+	arma::Mat<T> y(batch_size, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < batch_size; ++i)
+		y(i, i % 10) = T(1);
+	Tensor<T> batch_x(x);
+	Tensor<T> batch_y(y);
+
+	Model<T> model(784, 256, 10, std::make_unique<SgdOptimizer<T>>(0.01));
+	model.enable_fusion(fused);
+	auto step = [&] {
+		auto output = model.forward(batch_x);
+		benchmark::DoNotOptimize(model.compute_loss(output, batch_y));
+		model.backward();
+		model.step();
+		model.zero_grad();
+	};
+	// Capture, then the first fused step, which is planned on its own.
+	step();
+	step();
+
+	for (auto _ : state)
+		step();
+	state.counters["fused_groups"] =
+			static_cast<double>(model.expression_graph().fused_groups());
+	state.counters["unshared_mib"] = Bench::to_mib(
+			model.expression_graph().memory_planner().unshared_bytes());
+}
+BENCHMARK(BM_TrainingStepFusion)
+		->Arg(0)
+		->Arg(1)
+		->Unit(benchmark::kMillisecond);
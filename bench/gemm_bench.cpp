@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/gemm.hpp"
+
+#include <armadillo>
+#include <memory>
+#include <string>
+#include <tuple>
+
+using namespace ExGraf;
+
+namespace {
+
+// Backends by the index given as an argument: Armadillo's BLAS, the blocked
+// kernel on the calling thread, and the blocked kernel on every hardware
+// thread.
+template <AllowedTypes T>
+auto make_backend(int index) -> std::unique_ptr<GemmBackend<T>> {
+	if (index == 0)
+		return std::make_unique<ArmadilloGemm<T>>();
+	return std::make_unique<BlockedGemm<T>>(index == 1 ? 1 : 0);
+}
+
+// (m, k, n): the MNIST MLP's forward products, a square one and a small one.
+// Transposes are MatMulOp's backward forms: 1 is dC * B^T, 2 is A^T * dC.
+auto gemm_shapes(benchmark::internal::Benchmark *bench) -> void {
+	for (auto [m, k, n] : {std::tuple{128, 784, 256}, std::tuple{128, 256, 10},
+												 std::tuple{512, 512, 512}, std::tuple{32, 64, 64}})
+		for (int transposes : {0, 1, 2})
+			for (int backend : {0, 1, 2})
+				bench->Args({m, k, n, transposes, backend});
+}
+
+} // namespace
+
+// Args: m, k, n, transposes, backend. C (m x n) = op(A) * op(B) with the
+// operands stored as the transposes say.
+template <AllowedTypes T> static void BM_Gemm(benchmark::State &state) {
+	const auto m = std::size_t(state.range(0)), k = std::size_t(state.range(1)),
+						 n = std::size_t(state.range(2));
+	const auto ta = state.range(3) == 2 ? Transpose::Yes : Transpose::No;
+	const auto tb = state.range(3) == 1 ? Transpose::Yes : Transpose::No;
+	arma::arma_rng::set_seed(1);
+	const arma::Mat<T> a = ta == Transpose::Yes
+														 ? arma::randu<arma::Mat<T>>(k, m)
+														 : arma::randu<arma::Mat<T>>(m, k);
+	const arma::Mat<T> b = tb == Transpose::Yes
+														 ? arma::randu<arma::Mat<T>>(n, k)
+														 : arma::randu<arma::Mat<T>>(k, n);
+	arma::Mat<T> c(m, n);
+	auto backend = make_backend<T>(int(state.range(4)));
+	for (auto _ : state) {
+		backend->gemm(a, ta, b, tb, c);
+		benchmark::DoNotOptimize(c.memptr());
+		benchmark::ClobberMemory();
+	}
+	state.counters["FLOPS"] =
+			benchmark::Counter(2.0 * double(m * k * n),
+												 benchmark::Counter::kIsIterationInvariantRate);
+	state.SetLabel(std::string(backend->name()) +
+								 (state.range(4) == 2 ? " threaded" : ""));
+}
+BENCHMARK_TEMPLATE(BM_Gemm, float)
+		->Apply(gemm_shapes)
+		->UseRealTime()
+		->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Gemm, double)
+		->Apply(gemm_shapes)
+		->UseRealTime()
+		->Unit(benchmark::kMicrosecond);
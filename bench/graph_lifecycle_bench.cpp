@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+
+using namespace ExGraf;
+
+// Trains on synthetic MNIST-shaped batches and reports resident memory after
+// the first and the last epoch. With the tape rewound on every step, both
+// numbers (and the recorded node count) must not depend on the epoch count.
+static void BM_TrainingRssAcrossEpochs(benchmark::State &state) {
+	using T = double;
+	const auto epochs = static_cast<std::size_t>(state.range(0));
+	constexpr std::size_t batches_per_epoch = 32;
+	constexpr std::size_t batch_size = 128;
+
+	arma::Mat<T> x = arma::randu<arma::Mat<T>>(batch_size, 784);
+	arma::Mat<T> y(batch_size, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < batch_size; ++i)
+		y(i, i % 10) = T(1);
+	Tensor<T> batch_x(x);
+	Tensor<T> batch_y(y);
+
+	for (auto _ : state) {
+		Model<T> model(784, 256, 10, std::make_unique<AdamOptimizer<T>>(0.001));
+		std::size_t rss_first = 0;
+		for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+			for (std::size_t b = 0; b < batches_per_epoch; ++b) {
+				auto output = model.forward(batch_x);
+				benchmark::DoNotOptimize(model.compute_loss(output, batch_y));
+				model.backward();
+				model.step();
+				model.zero_grad();
+			}
+			if (epoch == 0)
+				rss_first = Bench::resident_set_bytes();
+		}
+		state.counters["rss_first_epoch_mib"] = Bench::to_mib(rss_first);
+		state.counters["rss_last_epoch_mib"] =
+				Bench::to_mib(Bench::resident_set_bytes());
+		state.counters["graph_nodes"] =
+				static_cast<double>(model.expression_graph().capacity());
+	}
+}
+BENCHMARK(BM_TrainingRssAcrossEpochs)
+		->Arg(1)
+		->Arg(4)
+		->Arg(16)
+		->Unit(benchmark::kMillisecond)
+		->Iterations(1);
@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/half.hpp"
+#include "exgraf/loaders/data_loader.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+
+#include <armadillo>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+auto format(const benchmark::State &state) -> Storage {
+	return static_cast<Storage>(state.range(0));
+}
+
+auto isa(const benchmark::State &state) -> Isa {
+	return static_cast<Isa>(state.range(1));
+}
+
+auto formats_and_levels(benchmark::internal::Benchmark *bench) -> void {
+	for (auto f : {Storage::BF16, Storage::FP16})
+		for (auto level : {Isa::Scalar, Isa::AVX2})
+			bench->Args({static_cast<int>(f), static_cast<int>(level)});
+}
+
+} // namespace
+
+// float -> 16-bit; bytes are float input read.
+static void BM_PackHalf(benchmark::State &state) {
+	if (!isa_supported(isa(state))) {
+		state.SkipWithError("instruction set not supported on this CPU");
+		return;
+	}
+	std::vector<float> src(1 << 20);
+	for (std::size_t i = 0; i < src.size(); ++i)
+		src[i] = float(i % 255) / 255.0F;
+	std::vector<std::uint16_t> dst(src.size());
+	for (auto _ : state) {
+		Kernels::pack(src.data(), src.size(), dst.data(), format(state),
+									isa(state));
+		benchmark::DoNotOptimize(dst.data());
+	}
+	state.SetBytesProcessed(
+			static_cast<std::int64_t>(state.iterations() * src.size() * 4));
+}
+BENCHMARK(BM_PackHalf)->Apply(formats_and_levels);
+
+// 16-bit -> float; bytes are float output written.
+static void BM_UnpackHalf(benchmark::State &state) {
+	if (!isa_supported(isa(state))) {
+		state.SkipWithError("instruction set not supported on this CPU");
+		return;
+	}
+	std::vector<std::uint16_t> src(1 << 20, 0x3c00);
+	std::vector<float> dst(src.size());
+	for (auto _ : state) {
+		Kernels::unpack(src.data(), src.size(), dst.data(), format(state),
+										isa(state));
+		benchmark::DoNotOptimize(dst.data());
+	}
+	state.SetBytesProcessed(
+			static_cast<std::int64_t>(state.iterations() * dst.size() * 4));
+}
+BENCHMARK(BM_UnpackHalf)->Apply(formats_and_levels);
+
+// One shuffled epoch of 60k MNIST-shaped samples per iteration. Arg: the
+// loader's Storage. `dataset_MiB` is what the loader keeps resident.
+static void BM_LoaderEpochStorage(benchmark::State &state) {
+	constexpr std::size_t samples = 60000;
+	const arma::Mat<float> x = arma::randu<arma::Mat<float>>(samples, 784);
+	arma::Mat<float> y(samples, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < samples; ++i)
+		y(i, i % 10) = 1.0F;
+	const auto storage = format(state);
+	DataLoader<float> loader(Tensor<float>(x), Tensor<float>(y),
+													 {.batch_size = 128, .prefetch = 4,
+														.storage = storage});
+	for (auto _ : state) {
+		while (auto batch = loader.next())
+			benchmark::DoNotOptimize(batch->inputs.data->memptr());
+	}
+	const double element = storage == Storage::FP32 ? 4.0 : 2.0;
+	state.counters["dataset_MiB"] =
+			double(samples * (784 + 10)) * element / (1024.0 * 1024.0);
+	state.counters["stall_ms"] =
+			std::chrono::duration<double, std::milli>(loader.stall_time()).count();
+}
+BENCHMARK(BM_LoaderEpochStorage)
+		->Arg(static_cast<int>(Storage::FP32))
+		->Arg(static_cast<int>(Storage::BF16))
+		->Arg(static_cast<int>(Storage::FP16))
+		->Unit(benchmark::kMillisecond);
+
+// One MNIST-sized training step per iteration. Arg: the operand Storage;
+// FP32 is the plain step, the 16-bit formats train in mixed precision.
+static void BM_TrainStepPrecision(benchmark::State &state) {
+	constexpr std::size_t batch = 128;
+	const arma::Mat<float> x = arma::randu<arma::Mat<float>>(batch, 784);
+	arma::Mat<float> y(batch, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < batch; ++i)
+		y(i, i % 10) = 1.0F;
+	const Tensor<float> inputs(x), targets(y);
+	Model<float> model(784, 256, 10,
+										 std::make_unique<AdamOptimizer<float>>(0.001F));
+	if (format(state) != Storage::FP32)
+		model.set_mixed_precision(format(state));
+	for (auto _ : state) {
+		model.zero_grad();
+		benchmark::DoNotOptimize(
+				model.compute_loss(model.forward(inputs), targets));
+		model.backward();
+		model.step();
+	}
+}
+BENCHMARK(BM_TrainStepPrecision)
+		->Arg(static_cast<int>(Storage::FP32))
+		->Arg(static_cast<int>(Storage::BF16))
+		->Arg(static_cast<int>(Storage::FP16))
+		->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/loaders/idx_stream.hpp"
+#include "exgraf/loaders/mnist_loader.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <zlib.h>
+
+using namespace ExGraf;
+
+namespace {
+
+constexpr std::size_t images = 60000;
+constexpr std::size_t pixels = 784;
+
+// A gzipped IDX image file shaped like the MNIST training set.
+auto gzipped_idx() -> const std::vector<unsigned char> & {
+	static const auto compressed = [] {
+		std::vector<unsigned char> raw(16 + images * pixels);
+		const auto put = [&](std::size_t at, std::uint32_t v) {
+			for (std::size_t i = 0; i < 4; ++i)
+				raw[at + i] = static_cast<unsigned char>(v >> (24 - 8 * i));
+		};
+		put(0, 2051);
+		put(4, images);
+		put(8, 28);
+		put(12, 28);
+		for (std::size_t i = 16; i < raw.size(); ++i)
+			raw[i] = static_cast<unsigned char>((i % pixels) < 200 ? 0 : i * 31);
+		auto bound = compressBound(static_cast<uLong>(raw.size())) + 32;
+		std::vector<unsigned char> out(bound);
+		z_stream strm{};
+		deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+								 Z_DEFAULT_STRATEGY);
+		strm.next_in = raw.data();
+		strm.avail_in = static_cast<uInt>(raw.size());
+		strm.next_out = out.data();
+		strm.avail_out = static_cast<uInt>(out.size());
+		deflate(&strm, Z_FINISH);
+		out.resize(strm.total_out);
+		deflateEnd(&strm);
+		return out;
+	}();
+	return compressed;
+}
+
+} // namespace
+
+// The old path: inflate the whole body into a growing buffer, then parse it.
+static void BM_WholeBufferDecode(benchmark::State &state) {
+	const auto &compressed = gzipped_idx();
+	for (auto _ : state) {
+		const auto raw = MNIST::decompress_gzip(compressed);
+		benchmark::DoNotOptimize(MNIST::parse_idx_images(raw).memptr());
+	}
+}
+BENCHMARK(BM_WholeBufferDecode)->Unit(benchmark::kMillisecond);
+
+// Streaming decode, fed in chunks of Arg bytes as a download would deliver
+// them. Only the destination tensor and two fixed buffers are allocated.
+static void BM_StreamingDecode(benchmark::State &state) {
+	const auto &compressed = gzipped_idx();
+	const auto chunk = static_cast<std::size_t>(state.range(0));
+	for (auto _ : state) {
+		MNIST::GzipInflater inflater;
+		MNIST::IdxImageParser<double> parser;
+		for (std::size_t at = 0; at < compressed.size(); at += chunk) {
+			const auto n = std::min(chunk, compressed.size() - at);
+			inflater.feed(std::span(compressed).subspan(at, n),
+										[&](std::span<const unsigned char> bytes) {
+											parser.consume(bytes);
+										});
+		}
+		benchmark::DoNotOptimize(parser.result().data->memptr());
+	}
+}
+BENCHMARK(BM_StreamingDecode)
+		->Arg(16 * 1024)
+		->Arg(256 * 1024)
+		->Unit(benchmark::kMillisecond);
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/inference_mode.hpp"
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <armadillo>
+#include <memory>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+auto make_classifier() -> Sequential<float> {
+	return Sequential<float>(784, std::make_unique<AdamOptimizer<float>>(),
+													 Linear<float>(256), ReLU<float>(),
+													 Dropout<float>(0.1F), Linear<float>(10),
+													 Softmax<float>());
+}
+
+} // namespace
+
+// Latency of one request of `rows` samples. Arg 0 is the batch size; arg 1
+// picks the path: 0 records on the graph (training off) and rewinds it,
+// 1 runs under an InferenceMode guard.
+static void BM_Predict(benchmark::State &state) {
+	const auto rows = static_cast<std::size_t>(state.range(0));
+	arma::arma_rng::set_seed(1);
+	auto net = make_classifier();
+	const Tensor<float> x(arma::randu<arma::Mat<float>>(rows, 784));
+	net.set_training(false);
+	const bool guarded = state.range(1) == 1;
+	for (auto _ : state) {
+		if (guarded) {
+			InferenceMode guard;
+			benchmark::DoNotOptimize(net.forward(x).data->memptr());
+		} else {
+			benchmark::DoNotOptimize(net.forward(x).data->memptr());
+			net.reset_graph();
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Predict)
+		->ArgsProduct({{1, 64}, {0, 1}})
+		->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,96 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/serving/inference_server.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+auto make_classifier() -> Sequential<float> {
+	arma::arma_rng::set_seed(1);
+	return Sequential<float>(784, std::make_unique<AdamOptimizer<float>>(),
+													 Linear<float>(256), ReLU<float>(),
+													 Linear<float>(10), Softmax<float>());
+}
+
+// Closed-loop load: each client submits one sample, waits for its answer
+// and immediately sends the next. Returns every request's latency in
+// microseconds.
+auto generate_load(InferenceServer<float> &server,
+									 const arma::Mat<float> &samples, std::size_t clients,
+									 std::size_t per_client) -> std::vector<double> {
+	std::vector<std::vector<double>> latencies(clients);
+	{
+		std::vector<std::jthread> threads;
+		for (std::size_t c = 0; c < clients; ++c)
+			threads.emplace_back([&, c] {
+				latencies[c].reserve(per_client);
+				for (std::size_t i = 0; i < per_client; ++i) {
+					const auto row = (c * per_client + i) % samples.n_rows;
+					const auto start = Clock::now();
+					server.submit(samples.rows(row, row)).get();
+					latencies[c].push_back(
+							std::chrono::duration<double, std::micro>(Clock::now() - start)
+									.count());
+				}
+			});
+	}
+	std::vector<double> all;
+	for (auto &l : latencies)
+		all.insert(all.end(), l.begin(), l.end());
+	return all;
+}
+
+auto percentile(std::vector<double> &values, double p) -> double {
+	const auto k = static_cast<std::size_t>(p * double(values.size() - 1));
+	std::nth_element(values.begin(), values.begin() + k, values.end());
+	return values[k];
+}
+
+} // namespace
+
+// Arg 0: concurrent clients; arg 1: max_batch (1 disables coalescing).
+// Sweeping both traces the latency/throughput curve: `p50_us` and `p99_us`
+// per request, `requests_per_s` overall, `mean_batch` rows per GEMM.
+static void BM_InferenceServerLoad(benchmark::State &state) {
+	constexpr std::size_t per_client = 200;
+	const auto clients = static_cast<std::size_t>(state.range(0));
+	auto model = make_classifier();
+	const arma::Mat<float> samples = arma::randu<arma::Mat<float>>(256, 784);
+	InferenceServer<float> server(
+			model, {.max_batch = static_cast<std::size_t>(state.range(1)),
+							.max_latency = std::chrono::microseconds(500),
+							.workers = 2});
+
+	std::vector<double> latencies;
+	double seconds = 0.0;
+	for (auto _ : state) {
+		const auto start = Clock::now();
+		auto run = generate_load(server, samples, clients, per_client);
+		seconds += std::chrono::duration<double>(Clock::now() - start).count();
+		latencies.insert(latencies.end(), run.begin(), run.end());
+	}
+	const auto stats = server.stats();
+	state.counters["p50_us"] = percentile(latencies, 0.50);
+	state.counters["p99_us"] = percentile(latencies, 0.99);
+	state.counters["requests_per_s"] = double(latencies.size()) / seconds;
+	state.counters["mean_batch"] = double(stats.rows) / double(stats.batches);
+}
+BENCHMARK(BM_InferenceServerLoad)
+		->ArgsProduct({{1, 4, 16, 64}, {1, 32}})
+		->Iterations(3)
+		->UseRealTime()
+		->Unit(benchmark::kMillisecond);
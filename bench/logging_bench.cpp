@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/logger.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <spdlog/sinks/basic_file_sink.h>
+
+#include <armadillo>
+#include <memory>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+// Writes go to /dev/null so the numbers measure the logger, not a terminal.
+auto configure_null(LogLevel level, bool async) -> void {
+	Logger::configure(
+			{.level = level,
+			 .async = async,
+			 .sinks = {std::make_shared<spdlog::sinks::basic_file_sink_mt>(
+					 "/dev/null")}});
+}
+
+} // namespace
+
+// A trace call below the runtime level, as every op makes in forward and
+// backward: one level check, no formatting.
+static void BM_FilteredTrace(benchmark::State &state) {
+	configure_null(LogLevel::Info, false);
+	const std::size_t rows = 128, columns = 784;
+	for (auto _ : state)
+		trace("MatMul forward: {}x{}", rows, columns);
+	Logger::configure();
+}
+BENCHMARK(BM_FilteredTrace)->Unit(benchmark::kNanosecond);
+
+// The per-batch metric line main.cpp writes. Arg: 0 synchronous sink,
+// 1 async ring.
+static void BM_BatchMetricLog(benchmark::State &state) {
+	configure_null(LogLevel::Info, state.range(0) == 1);
+	std::size_t batch = 0;
+	for (auto _ : state)
+		info("[Batch {}/{}] Loss: {}", ++batch, 469, 0.25F);
+	Logger::configure();
+	state.SetLabel(state.range(0) == 1 ? "async" : "sync");
+}
+BENCHMARK(BM_BatchMetricLog)->Arg(0)->Arg(1)->Unit(benchmark::kNanosecond);
+
+// A 784-256-10 training step at batch 128. Arg: 0 runtime level trace, so
+// every op formats and writes its line; 1 the default debug level, where
+// the op traces cost only their level check (nothing at all in Release).
+static void BM_TrainStepLogging(benchmark::State &state) {
+	configure_null(state.range(0) == 0 ? LogLevel::Trace : LogLevel::Debug,
+								 false);
+	arma::arma_rng::set_seed(1);
+	Sequential<float> net(784, std::make_unique<AdamOptimizer<float>>(0.001F),
+												Linear<float>(256), ReLU<float>(),
+												Linear<float>(10), Softmax<float>());
+	const Tensor<float> x(arma::randu<arma::Mat<float>>(128, 784));
+	arma::Mat<float> labels(128, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < 128; ++i)
+		labels(i, i % 10) = 1.0F;
+	const Tensor<float> y(labels);
+	for (auto _ : state) {
+		net.zero_grad();
+		net.compute_loss(net.forward(x), y);
+		net.backward();
+		net.step();
+	}
+	Logger::configure();
+	state.SetLabel(state.range(0) == 0 ? "trace" : "debug");
+}
+BENCHMARK(BM_TrainStepLogging)
+		->Arg(0)
+		->Arg(1)
+		->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/data_parallel_trainer.hpp"
+#include "exgraf/loaders/data_loader.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <utility>
+
+using namespace ExGraf;
+
+namespace {
+
+constexpr std::size_t samples = 10000, pixels = 784, classes = 10;
+
+// The t10k set's shape without the download: 8-bit pixels scaled to [0, 1]
+// around one prototype per class, and balanced labels.
+auto synthetic_mnist() -> std::pair<Tensor<float>, Tensor<float>> {
+	arma::arma_rng::set_seed(1);
+	const arma::Mat<float> prototypes =
+			arma::randu<arma::Mat<float>>(classes, pixels);
+	arma::Mat<float> x = arma::randu<arma::Mat<float>>(samples, pixels);
+	arma::Mat<float> y(samples, classes, arma::fill::zeros);
+	for (std::size_t i = 0; i < samples; ++i) {
+		const auto label = (i * 7) % classes;
+		y(i, label) = 1.0F;
+		for (std::size_t p = 0; p < pixels; ++p) {
+			const float v = 0.7F * prototypes(label, p) + 0.3F * x(i, p);
+			x(i, p) = std::round(v * 255.0F) / 255.0F;
+		}
+	}
+	return {Tensor<float>(x), Tensor<float>(y)};
+}
+
+} // namespace
+
+// main.cpp's training loop on synthetic data: a prefetching FP16
+// DataLoader feeding DataParallelTrainer on the 784-256-10 Model, batch
+// 128. One iteration is one optimizer step, including the batch hand-off.
+// Arg: worker count, 0 for one per hardware thread.
+static void BM_MnistTrainStep(benchmark::State &state) {
+	const auto workers =
+			state.range(0) == 0
+					? std::max(1u, std::thread::hardware_concurrency())
+					: static_cast<unsigned>(state.range(0));
+	auto [x, y] = synthetic_mnist();
+	arma::arma_rng::set_seed(2);
+	Model<float> model(pixels, 256, classes,
+										 std::make_unique<AdamOptimizer<float>>(0.001F));
+	DataParallelTrainer<float> trainer(model, workers);
+	DataLoader<float> loader(std::move(x), std::move(y),
+													 {.batch_size = 128,
+														.prefetch = 4,
+														.storage = Storage::FP16});
+
+	float loss = 0.0F;
+	for (auto _ : state) {
+		auto batch = loader.next();
+		if (!batch)
+			batch = loader.next();
+		loss = trainer.step(batch->inputs, batch->targets);
+	}
+	state.SetItemsProcessed(state.iterations() * 128);
+	state.counters["loss"] = loss;
+	state.counters["workers"] = workers;
+}
+BENCHMARK(BM_MnistTrainStep)
+		->Arg(1)
+		->Arg(0)
+		->UseRealTime()
+		->Unit(benchmark::kMillisecond);
@@ -0,0 +1,189 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/binary_operation.hpp"
+#include "exgraf/tensor_allocator.hpp"
+#include "exgraf/unary_operation.hpp"
+
+#include <armadillo>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+// Microbenchmarks of single operations outside a graph. Outputs come from a
+// BufferCache rewound every iteration, as the memory planner serves them in
+// a training step, so the numbers are the kernels rather than malloc.
+// The last argument of every benchmark is the pass: 0 forward, 1 backward
+// (after one forward outside the timed loop).
+
+template <AllowedTypes T>
+auto random_tensor(std::size_t rows, std::size_t cols) -> Tensor<T> {
+	return Tensor<T>(arma::Mat<T>(arma::randu<arma::Mat<T>>(rows, cols)));
+}
+
+template <AllowedTypes T>
+auto run_pass(benchmark::State &state, Operation<T> &op,
+							const std::vector<std::reference_wrapper<const Tensor<T>>> &in,
+							const Tensor<T> &grad_output, bool backward) -> void {
+	BufferCache<T> cache;
+	op.bind_allocator(&cache);
+	std::vector<Tensor<T>> grads(in.size());
+	if (backward)
+		op.forward(in);
+	for (auto _ : state) {
+		cache.rewind();
+		if (backward) {
+			op.backward(grad_output, grads);
+			benchmark::DoNotOptimize(grads.front().data->memptr());
+		} else {
+			benchmark::DoNotOptimize(op.forward(in).data->memptr());
+		}
+	}
+	state.SetLabel(backward ? "backward" : "forward");
+}
+
+// (m, k, n) products: the MNIST MLP's two layers, a square one and a
+// small one, each forward and backward.
+auto matmul_shapes(benchmark::internal::Benchmark *bench) -> void {
+	for (auto [m, k, n] : {std::tuple{128, 784, 256}, std::tuple{128, 256, 10},
+												 std::tuple{512, 512, 512}, std::tuple{32, 64, 64}})
+		for (int pass : {0, 1})
+			bench->Args({m, k, n, pass});
+}
+
+auto elementwise_shapes(benchmark::internal::Benchmark *bench) -> void {
+	for (auto [rows, cols] :
+			 {std::pair{128, 10}, std::pair{128, 256}, std::pair{1024, 1024}})
+		for (int pass : {0, 1})
+			bench->Args({rows, cols, pass});
+}
+
+} // namespace
+
+// Args: m, k, n, pass. `FLOPS` counts 2mkn per forward and twice that per
+// backward (one product per input).
+template <AllowedTypes T> static void BM_MatMulOp(benchmark::State &state) {
+	const auto m = std::size_t(state.range(0)), k = std::size_t(state.range(1)),
+						 n = std::size_t(state.range(2));
+	arma::arma_rng::set_seed(1);
+	const auto a = random_tensor<T>(m, k), b = random_tensor<T>(k, n);
+	const auto grad = random_tensor<T>(m, n);
+	Binary::MatMulOp<T> op;
+	run_pass<T>(state, op, {a, b}, grad, state.range(3) == 1);
+	const double flops = 2.0 * double(m * k * n) * (state.range(3) + 1);
+	state.counters["FLOPS"] = benchmark::Counter(
+			flops, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(BM_MatMulOp, float)
+		->Apply(matmul_shapes)
+		->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MatMulOp, double)
+		->Apply(matmul_shapes)
+		->Unit(benchmark::kMicrosecond);
+
+// Accumulating MatMulOp's gradients into existing ones, as the graph does
+// when a tensor has several consumers. Args: m, k, n, mode: 0 backward into
+// new buffers then added, 1 backward_into with beta = 1.
+template <AllowedTypes T>
+static void BM_MatMulOpAccumulate(benchmark::State &state) {
+	const auto m = std::size_t(state.range(0)), k = std::size_t(state.range(1)),
+						 n = std::size_t(state.range(2));
+	arma::arma_rng::set_seed(1);
+	const auto a = random_tensor<T>(m, k), b = random_tensor<T>(k, n);
+	const auto grad = random_tensor<T>(m, n);
+	arma::Mat<T> da(m, k, arma::fill::zeros), db(k, n, arma::fill::zeros);
+	BufferCache<T> cache;
+	Binary::MatMulOp<T> op;
+	op.bind_allocator(&cache);
+	op.forward({a, b});
+	std::vector<Tensor<T>> grads(2);
+	const GradientTarget<T> targets[]{{&da, true}, {&db, true}};
+	for (auto _ : state) {
+		cache.rewind();
+		if (state.range(3) == 1) {
+			op.backward_into(grad, targets);
+		} else {
+			op.backward(grad, grads);
+			da += *grads[0].data;
+			db += *grads[1].data;
+		}
+		benchmark::DoNotOptimize(da.memptr());
+		benchmark::DoNotOptimize(db.memptr());
+	}
+	state.SetLabel(state.range(3) == 1 ? "in place" : "add");
+}
+BENCHMARK_TEMPLATE(BM_MatMulOpAccumulate, float)
+		->ArgsProduct({{128}, {784, 256}, {256}, {0, 1}})
+		->Unit(benchmark::kMicrosecond);
+
+// Args: rows, cols, pass.
+template <AllowedTypes T> static void BM_ReLUOp(benchmark::State &state) {
+	const auto rows = std::size_t(state.range(0)),
+						 cols = std::size_t(state.range(1));
+	arma::arma_rng::set_seed(2);
+	const Tensor<T> x(arma::Mat<T>(arma::randn<arma::Mat<T>>(rows, cols)));
+	const auto grad = random_tensor<T>(rows, cols);
+	Unary::ReLUOp<T> op;
+	run_pass<T>(state, op, {x}, grad, state.range(2) == 1);
+	state.SetItemsProcessed(state.iterations() * std::int64_t(rows * cols));
+}
+BENCHMARK_TEMPLATE(BM_ReLUOp, float)
+		->Apply(elementwise_shapes)
+		->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ReLUOp, double)
+		->Apply(elementwise_shapes)
+		->Unit(benchmark::kMicrosecond);
+
+// Args: rows, cols, pass.
+template <AllowedTypes T> static void BM_SoftmaxOp(benchmark::State &state) {
+	const auto rows = std::size_t(state.range(0)),
+						 cols = std::size_t(state.range(1));
+	arma::arma_rng::set_seed(3);
+	const auto x = random_tensor<T>(rows, cols);
+	const auto grad = random_tensor<T>(rows, cols);
+	Unary::SoftmaxOp<T> op;
+	run_pass<T>(state, op, {x}, grad, state.range(2) == 1);
+	state.SetItemsProcessed(state.iterations() * std::int64_t(rows * cols));
+}
+BENCHMARK_TEMPLATE(BM_SoftmaxOp, float)
+		->Apply(elementwise_shapes)
+		->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SoftmaxOp, double)
+		->Apply(elementwise_shapes)
+		->Unit(benchmark::kMicrosecond);
+
+// Cross entropy of row-normalized probabilities against one-hot targets.
+// Args: rows, cols, pass.
+template <AllowedTypes T>
+static void BM_CrossEntropyLoss(benchmark::State &state) {
+	const auto rows = std::size_t(state.range(0)),
+						 cols = std::size_t(state.range(1));
+	arma::arma_rng::set_seed(4);
+	arma::Mat<T> p = arma::randu<arma::Mat<T>>(rows, cols);
+	arma::Mat<T> y(rows, cols, arma::fill::zeros);
+	for (std::size_t i = 0; i < rows; ++i) {
+		T total = 0;
+		for (std::size_t c = 0; c < cols; ++c)
+			total += (p(i, c) += T(0.01));
+		for (std::size_t c = 0; c < cols; ++c)
+			p(i, c) /= total;
+		y(i, i % cols) = T(1);
+	}
+	const Tensor<T> probabilities(p), targets(y);
+	const Tensor<T> seed(arma::Mat<T>(1, 1, arma::fill::ones));
+	Binary::CrossEntropyLoss<T> op;
+	run_pass<T>(state, op, {probabilities, targets}, seed,
+							state.range(2) == 1);
+	state.SetItemsProcessed(state.iterations() * std::int64_t(rows * cols));
+}
+BENCHMARK_TEMPLATE(BM_CrossEntropyLoss, float)
+		->Apply(elementwise_shapes)
+		->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_CrossEntropyLoss, double)
+		->Apply(elementwise_shapes)
+		->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/flat_buffer.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+// About four million parameters over a handful of layer-sized matrices.
+const std::array<Shape, 4> layer_shapes{Shape{784, 2048}, Shape{2048, 1024},
+																				Shape{1024, 512}, Shape{512, 10}};
+
+struct Parameters {
+	FlatBuffer<float> values{layer_shapes};
+	FlatBuffer<float> gradients{layer_shapes};
+	std::vector<Tensor<float>> tensors;
+	std::vector<std::reference_wrapper<Tensor<float>>> refs;
+
+	Parameters() {
+		for (std::size_t i = 0; i < layer_shapes.size(); ++i) {
+			Tensor<float> p(values.view(i));
+			p.data->fill(0.5F);
+			p.grad = std::make_shared<Tensor<float>>(gradients.view(i));
+			p.grad->data->fill(0.01F);
+			tensors.push_back(std::move(p));
+		}
+		refs.assign(tensors.begin(), tensors.end());
+	}
+
+	auto elements() const -> std::int64_t {
+		return static_cast<std::int64_t>(values.size());
+	}
+};
+
+// The optimizer as it was: one Armadillo expression per tensor.
+struct ArmadilloAdam {
+	float lr{1e-4F}, beta1{0.9F}, beta2{0.999F}, epsilon{1e-8F};
+	std::size_t t{0};
+	std::unordered_map<const Tensor<float> *, std::array<arma::Mat<float>, 2>>
+			state;
+
+	auto step(std::vector<std::reference_wrapper<Tensor<float>>> &params)
+			-> void {
+		++t;
+		const float bc1 = 1.0F - std::pow(beta1, float(t));
+		const float bc2 = 1.0F - std::pow(beta2, float(t));
+		for (auto &ref : params) {
+			auto &p = ref.get();
+			auto &g = *p.grad->data;
+			auto [it, fresh] = state.try_emplace(&p);
+			auto &[m, v] = it->second;
+			if (fresh) {
+				m = arma::zeros<arma::Mat<float>>(g.n_rows, g.n_cols);
+				v = arma::zeros<arma::Mat<float>>(g.n_rows, g.n_cols);
+			}
+			m = beta1 * m + (1.0F - beta1) * g;
+			v = beta2 * v + (1.0F - beta2) * (g % g);
+			auto m_hat = m / bc1;
+			auto v_hat = v / bc2;
+			*p.data -= lr * m_hat / (arma::sqrt(v_hat) + epsilon);
+		}
+	}
+};
+
+// Adam streams p, g, m and v in and p, m, v out: 28 bytes per float.
+auto report(benchmark::State &state, const Parameters &params,
+						double bytes_per_element) -> void {
+	state.SetItemsProcessed(state.iterations() * params.elements());
+	state.SetBytesProcessed(static_cast<std::int64_t>(
+			double(state.iterations() * params.elements()) * bytes_per_element));
+}
+
+} // namespace
+
+static void BM_AdamArmadillo(benchmark::State &state) {
+	Parameters params;
+	ArmadilloAdam adam;
+	for (auto _ : state) {
+		adam.step(params.refs);
+		benchmark::DoNotOptimize(params.values.data());
+	}
+	report(state, params, 28.0);
+}
+BENCHMARK(BM_AdamArmadillo)->Unit(benchmark::kMillisecond);
+
+// Arg: worker threads; 0 runs the step on the calling thread.
+static void BM_AdamFused(benchmark::State &state) {
+	Parameters params;
+	AdamOptimizer<float> adam;
+	const auto threads = static_cast<std::size_t>(state.range(0));
+	tf::Executor executor(std::max<std::size_t>(threads, 1));
+	if (threads > 0)
+		adam.set_executor(&executor);
+	for (auto _ : state) {
+		adam.step(params.refs);
+		benchmark::DoNotOptimize(params.values.data());
+	}
+	report(state, params, 28.0);
+}
+BENCHMARK(BM_AdamFused)
+		->Arg(0)
+		->Arg(2)
+		->Arg(4)
+		->Arg(8)
+		->Unit(benchmark::kMillisecond)
+		->UseRealTime();
+
+static void BM_SgdMomentumFused(benchmark::State &state) {
+	Parameters params;
+	SgdOptimizer<float> sgd(1e-3F, 0.9F);
+	const auto threads = static_cast<std::size_t>(state.range(0));
+	tf::Executor executor(std::max<std::size_t>(threads, 1));
+	if (threads > 0)
+		sgd.set_executor(&executor);
+	for (auto _ : state) {
+		sgd.step(params.refs);
+		benchmark::DoNotOptimize(params.values.data());
+	}
+	report(state, params, 20.0);
+}
+BENCHMARK(BM_SgdMomentumFused)
+		->Arg(0)
+		->Arg(4)
+		->Unit(benchmark::kMillisecond)
+		->UseRealTime();
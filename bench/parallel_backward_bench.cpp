@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/expression_graph.hpp"
+#include "exgraf/fused_operation.hpp"
+
+#include <taskflow/taskflow.hpp>
+
+using namespace ExGraf;
+
+// A wide model: `branches` parallel MatMul -> ReLU towers over the same batch,
+// summed and fed into a softmax classifier. Arg 0 selects the serial walk (0)
+// or the Taskflow schedule (1), arg 1 the number of branches.
+static void BM_WideBackward(benchmark::State &state) {
+	using T = double;
+	constexpr std::size_t batch_size = 128;
+	constexpr std::size_t input_dim = 784;
+	constexpr std::size_t hidden_dim = 256;
+	constexpr std::size_t classes = 10;
+	const auto parallel = state.range(0) != 0;
+	const auto branches = static_cast<std::size_t>(state.range(1));
+
+	Tensor<T> x(arma::Mat<T>(arma::randu<arma::Mat<T>>(batch_size, input_dim)));
+	arma::Mat<T> labels(batch_size, classes, arma::fill::zeros);
+	for (std::size_t i = 0; i < batch_size; ++i)
+		labels(i, i % classes) = T(1);
+	Tensor<T> y(labels);
+	std::vector<Tensor<T>> towers;
+	for (std::size_t b = 0; b < branches; ++b) {
+		towers.emplace_back(arma::Mat<T>(
+				arma::randn<arma::Mat<T>>(input_dim, hidden_dim) * T(0.05)));
+		towers.back().zero_grad();
+	}
+	Tensor<T> head(
+			arma::Mat<T>(arma::randn<arma::Mat<T>>(hidden_dim, classes) * T(0.05)));
+	head.zero_grad();
+
+	tf::Executor executor;
+	ExpressionGraph<T> graph;
+	graph.set_fusion_patterns(Fused::default_patterns<T>());
+	if (parallel)
+		graph.set_executor(&executor);
+
+	auto step = [&] {
+		auto first = graph.add_operation<Binary::MatMulOp<T>>({x, towers[0]});
+		auto sum = graph.add_operation<Unary::ReLUOp<T>>({first});
+		for (std::size_t b = 1; b < branches; ++b) {
+			auto z = graph.add_operation<Binary::MatMulOp<T>>({x, towers[b]});
+			auto h = graph.add_operation<Unary::ReLUOp<T>>({z});
+			sum = graph.add_operation<Binary::AddOp<T>>({sum, h});
+		}
+		auto logits = graph.add_operation<Binary::MatMulOp<T>>({sum, head});
+		auto p = graph.add_operation<Unary::SoftmaxOp<T>>({logits});
+		auto loss =
+				graph.add_operation<Binary::CrossEntropyLoss<T>>({p, y});
+		graph.backward(loss);
+		graph.reset();
+	};
+	step();
+	step();
+
+	for (auto _ : state)
+		step();
+	state.counters["workers"] =
+			parallel ? static_cast<double>(executor.num_workers()) : 1.0;
+}
+BENCHMARK(BM_WideBackward)
+		->ArgsProduct({{0, 1}, {1, 4, 8}})
+		->Unit(benchmark::kMillisecond);
@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/loaders/data_loader.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+
+#include <armadillo>
+#include <memory>
+
+using namespace ExGraf;
+
+namespace {
+
+constexpr std::size_t input_dim = 784;
+constexpr std::size_t hidden_dim = 256;
+constexpr std::size_t classes = 10;
+constexpr std::size_t samples = 4096;
+constexpr std::size_t batch_size = 128;
+
+// MNIST-shaped data: one random prototype per class plus pixel noise, so a
+// short run reaches a meaningful accuracy.
+template <AllowedTypes T>
+auto synthetic(std::size_t rows, unsigned seed)
+		-> std::pair<Tensor<T>, arma::Col<std::size_t>> {
+	arma::arma_rng::set_seed(1);
+	const arma::Mat<T> prototypes = arma::randu<arma::Mat<T>>(classes, input_dim);
+	arma::arma_rng::set_seed(seed);
+	arma::Mat<T> x = arma::randu<arma::Mat<T>>(rows, input_dim);
+	arma::Col<std::size_t> labels(rows);
+	for (std::size_t i = 0; i < rows; ++i) {
+		labels(i) = (i * 7 + seed) % classes;
+		for (std::size_t p = 0; p < input_dim; ++p)
+			x(i, p) = T(0.7) * prototypes(labels(i), p) + T(0.3) * x(i, p);
+	}
+	return {Tensor<T>(x), labels};
+}
+
+template <AllowedTypes T>
+auto accuracy(Model<T> &model, const Tensor<T> &x,
+							const arma::Col<std::size_t> &labels) -> double {
+	const auto probabilities = model.forward(x);
+	const auto &p = *probabilities.data;
+	std::size_t correct = 0;
+	for (std::size_t i = 0; i < p.n_rows; ++i) {
+		std::size_t best = 0;
+		for (std::size_t c = 1; c < p.n_cols; ++c)
+			if (p(i, c) > p(i, best))
+				best = c;
+		correct += best == labels(i);
+	}
+	model.reset_graph();
+	return double(correct) / double(p.n_rows);
+}
+
+} // namespace
+
+// One iteration is one epoch of 32 Adam steps on a 784-256-10 model. The
+// iteration count is fixed so both precisions end on the same schedule and
+// the reported held-out accuracy is comparable.
+template <AllowedTypes T> static void BM_TrainEpoch(benchmark::State &state) {
+	auto [train_x, train_labels] = synthetic<T>(samples, 2);
+	auto [test_x, test_labels] = synthetic<T>(1024, 3);
+	arma::arma_rng::set_seed(7);
+	Model<T> model(input_dim, hidden_dim, classes,
+								 std::make_unique<AdamOptimizer<T>>(T(0.001)));
+	DataLoader<T> loader(train_x, Model<T>::to_one_hot(train_labels, classes),
+											 {.batch_size = batch_size, .seed = 4});
+
+	for (auto _ : state) {
+		while (auto batch = loader.next()) {
+			auto output = model.forward(batch->inputs);
+			benchmark::DoNotOptimize(model.compute_loss(output, batch->targets));
+			model.backward();
+			model.step();
+			model.zero_grad();
+		}
+	}
+	// Seconds per optimizer step (printed with an SI prefix, e.g. 4.2m).
+	state.counters["step_time"] = benchmark::Counter(
+			double(state.iterations() * loader.batches_per_epoch()),
+			benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["accuracy"] = accuracy(model, test_x, test_labels);
+	state.counters["bytes_per_param"] = double(sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_TrainEpoch, float)
+		->Iterations(5)
+		->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TrainEpoch, double)
+		->Iterations(5)
+		->Unit(benchmark::kMillisecond);
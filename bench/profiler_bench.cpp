@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/profiler.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <armadillo>
+#include <memory>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+// A 784-256-128-10 training step at batch 128. Arg: 0 unprofiled, 1 with a
+// Profiler attached (every node, accumulation and the optimizer recorded).
+// `spans` counts what one step records.
+static void BM_ProfiledTrainStep(benchmark::State &state) {
+	arma::arma_rng::set_seed(1);
+	Sequential<float> net(784, std::make_unique<AdamOptimizer<float>>(0.001F),
+												Linear<float>(256), ReLU<float>(),
+												Linear<float>(128), ReLU<float>(),
+												Linear<float>(10), Softmax<float>());
+	const Tensor<float> x(arma::randu<arma::Mat<float>>(128, 784));
+	arma::Mat<float> labels(128, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < 128; ++i)
+		labels(i, i % 10) = 1.0F;
+	const Tensor<float> y(labels);
+	Profiler profiler;
+	if (state.range(0) == 1)
+		net.set_profiler(&profiler);
+	for (auto _ : state) {
+		net.zero_grad();
+		net.compute_loss(net.forward(x), y);
+		net.backward();
+		net.step();
+	}
+	const auto spans = profiler.events().size() + profiler.dropped();
+	state.counters["spans"] = double(spans) / double(state.iterations());
+	state.SetLabel(state.range(0) == 1 ? "profiled" : "plain");
+}
+BENCHMARK(BM_ProfiledTrainStep)
+		->Arg(0)
+		->Arg(1)
+		->Unit(benchmark::kMicrosecond);
+
+// The cost of recording one span into the calling thread's ring.
+static void BM_ProfilerRecord(benchmark::State &state) {
+	Profiler profiler;
+	ProfileEvent event{.label = "span"};
+	for (auto _ : state) {
+		event.start_ns = profiler.now();
+		event.duration_ns = profiler.now() - event.start_ns;
+		profiler.record(event);
+	}
+	benchmark::DoNotOptimize(profiler.dropped());
+}
+BENCHMARK(BM_ProfilerRecord)->Unit(benchmark::kNanosecond);
@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/quantization/quantized_model.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <armadillo>
+#include <memory>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+// Ten classes of 28x28 images: class k is a bright vertical bar at column
+// 2k + 4 plus uniform noise (the conv benchmark's digits).
+auto synthetic_digits(std::size_t n, arma::Col<std::size_t> &labels)
+		-> Tensor<float> {
+	arma::Mat<float> x = arma::randu<arma::Mat<float>>(n, 784) * 0.3F;
+	labels.set_size(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		labels(i) = i % 10;
+		for (std::size_t row = 4; row < 24; ++row)
+			x(i, row * 28 + 2 * labels(i) + 4) += 0.7F;
+	}
+	return Tensor<float>(x);
+}
+
+auto make_classifier() -> Sequential<float> {
+	return Sequential<float>(784, std::make_unique<AdamOptimizer<float>>(0.002F),
+													 Linear<float>(256), ReLU<float>(),
+													 Linear<float>(128), ReLU<float>(),
+													 Linear<float>(10), Softmax<float>());
+}
+
+auto train(Sequential<float> &model, std::size_t steps) -> void {
+	arma::Col<std::size_t> labels;
+	const auto x = synthetic_digits(640, labels);
+	const auto y = Sequential<float>::to_one_hot(labels, 10);
+	for (std::size_t step = 0; step < steps; ++step) {
+		model.zero_grad();
+		model.compute_loss(model.forward(x), y);
+		model.backward();
+		model.step();
+	}
+}
+
+} // namespace
+
+// Inference on a batch of 64 through the 784-256-128-10 MLP. Arg 0: 0 is
+// the float predict(); 1, 2 and 3 the int8 model on the scalar, AVX2 and
+// AVX-VNNI dot kernels.
+static void BM_QuantizedPredict(benchmark::State &state) {
+	const auto path = state.range(0);
+	const auto kernel = static_cast<Kernels::DotKernel>(path - 1);
+	if (path > 0 && !Kernels::dot_kernel_supported(kernel)) {
+		state.SkipWithError("instruction set not supported on this CPU");
+		return;
+	}
+	arma::arma_rng::set_seed(1);
+	auto model = make_classifier();
+	arma::Col<std::size_t> labels;
+	const auto batch = synthetic_digits(64, labels);
+	auto quantized = QuantizedModel<float>::calibrate(model, batch);
+	for (auto _ : state) {
+		auto out = path == 0 ? model.predict(batch)
+												 : quantized.predict(batch, kernel);
+		benchmark::DoNotOptimize(out.data->memptr());
+	}
+	state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_QuantizedPredict)
+		->DenseRange(0, 3)
+		->Unit(benchmark::kMicrosecond);
+
+// The accuracy-delta report: trains the MLP briefly, calibrates on 256
+// samples and compares both models on 1000 held-out ones. The counters are
+// QuantizationReport's fields.
+static void BM_QuantizationAccuracy(benchmark::State &state) {
+	arma::arma_rng::set_seed(2);
+	auto model = make_classifier();
+	train(model, 60);
+	arma::Col<std::size_t> calibration_labels, test_labels;
+	const auto calibration = synthetic_digits(256, calibration_labels);
+	const auto test = synthetic_digits(1000, test_labels);
+	QuantizationReport report;
+	for (auto _ : state) {
+		auto quantized = QuantizedModel<float>::calibrate(model, calibration);
+		report = accuracy_report(model, quantized, test, test_labels);
+	}
+	state.counters["float_accuracy"] = report.float_accuracy;
+	state.counters["int8_accuracy"] = report.int8_accuracy;
+	state.counters["accuracy_delta"] =
+			report.int8_accuracy - report.float_accuracy;
+	state.counters["agreement"] = report.agreement;
+	state.counters["max_abs_delta"] = report.max_abs_delta;
+	state.counters["size_ratio"] =
+			double(report.float_bytes) / double(report.int8_bytes);
+	state.SetLabel(report.to_string());
+}
+BENCHMARK(BM_QuantizationAccuracy)
+		->Iterations(1)
+		->Unit(benchmark::kMillisecond);
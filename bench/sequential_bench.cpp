@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <armadillo>
+#include <memory>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+// Arg 0: a deep stack of narrow layers; arg 1: a shallow, wide one.
+auto make_network(int shape) -> Sequential<float> {
+	auto adam = std::make_unique<AdamOptimizer<float>>(0.001F);
+	if (shape == 0)
+		return Sequential<float>(784, std::move(adam), Linear<float>(256),
+														 ReLU<float>(), Linear<float>(256), ReLU<float>(),
+														 Linear<float>(256), ReLU<float>(),
+														 Linear<float>(256), ReLU<float>(),
+														 Linear<float>(10), Softmax<float>());
+	return Sequential<float>(784, std::move(adam), Linear<float>(2048),
+													 ReLU<float>(), Dropout<float>(0.1F),
+													 Linear<float>(10), Softmax<float>());
+}
+
+} // namespace
+
+// One training step on a 128-row batch. `GFLOPS` is forward FLOPs from
+// the model summary times three (forward plus the two backward products)
+// per second, the usual estimate for dense layers.
+static void BM_SequentialTrainStep(benchmark::State &state) {
+	constexpr std::size_t batch_size = 128;
+	arma::arma_rng::set_seed(1);
+	const arma::Mat<float> x = arma::randu<arma::Mat<float>>(batch_size, 784);
+	arma::Mat<float> y(batch_size, 10, arma::fill::zeros);
+	for (std::size_t i = 0; i < batch_size; ++i)
+		y(i, i % 10) = 1.0F;
+	const Tensor<float> batch_x(x), batch_y(y);
+
+	auto net = make_network(static_cast<int>(state.range(0)));
+	auto step = [&] {
+		auto output = net.forward(batch_x);
+		benchmark::DoNotOptimize(net.compute_loss(output, batch_y));
+		net.backward();
+		net.step();
+		net.zero_grad();
+	};
+	step();
+	step();
+	for (auto _ : state)
+		step();
+
+	const auto summary = net.summary();
+	state.counters["params"] = static_cast<double>(summary.parameters());
+	state.counters["GFLOPS"] = benchmark::Counter(
+			3.0 * double(summary.flops() * batch_size) * 1e-9,
+			benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_SequentialTrainStep)
+		->Arg(0)
+		->Arg(1)
+		->Unit(benchmark::kMillisecond);
@@ -0,0 +1,105 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/static_graph.hpp"
+
+#include <armadillo>
+#include <memory>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+// The small fixed MLP both APIs run: 64 -> 32 -> ReLU -> 10 -> Softmax.
+constexpr std::size_t in_features = 64, hidden = 32, classes = 10;
+
+template <std::size_t Batch>
+using StaticNet =
+		Static::Network<float, Batch, in_features, Static::Linear<hidden>,
+										Static::ReLU, Static::Linear<classes>, Static::Softmax>;
+
+auto one_hot_rows(std::size_t batch) -> arma::Col<std::size_t> {
+	arma::Col<std::size_t> labels(batch);
+	for (std::size_t i = 0; i < batch; ++i)
+		labels(i) = i % classes;
+	return labels;
+}
+
+} // namespace
+
+// One SGD training step (forward, loss, backward, update) through the
+// dynamic graph. Arg: batch size.
+static void BM_DynamicTrainStep(benchmark::State &state) {
+	const auto batch = static_cast<std::size_t>(state.range(0));
+	arma::arma_rng::set_seed(1);
+	Sequential<float> net(in_features,
+												std::make_unique<SgdOptimizer<float>>(0.01F),
+												Layers::Linear<float>(hidden), Layers::ReLU<float>(),
+												Layers::Linear<float>(classes),
+												Layers::Softmax<float>());
+	const Tensor<float> x(arma::randu<arma::Mat<float>>(batch, in_features));
+	const auto y = Sequential<float>::to_one_hot(one_hot_rows(batch), classes);
+	for (auto _ : state) {
+		net.zero_grad();
+		net.compute_loss(net.forward(x), y);
+		net.backward();
+		net.step();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DynamicTrainStep)
+		->Arg(1)
+		->Arg(8)
+		->Arg(32)
+		->Unit(benchmark::kMicrosecond);
+
+// The same step through Static::Network, whose batch size is part of its
+// type.
+template <std::size_t Batch>
+static void BM_StaticTrainStep(benchmark::State &state) {
+	auto net = std::make_unique<StaticNet<Batch>>(1);
+	std::vector<float> xs(Batch * in_features), ys(Batch * classes, 0.0F);
+	for (std::size_t i = 0; i < xs.size(); ++i)
+		xs[i] = float(i % 17) / 17.0F;
+	for (std::size_t n = 0; n < Batch; ++n)
+		ys[n * classes + n % classes] = 1.0F;
+	const typename StaticNet<Batch>::Input x(xs);
+	const typename StaticNet<Batch>::Output y(ys);
+	for (auto _ : state) {
+		net->forward(x);
+		benchmark::DoNotOptimize(net->loss(y));
+		net->backward(y);
+		net->sgd_step(0.01F);
+	}
+	state.SetItemsProcessed(state.iterations() * Batch);
+}
+BENCHMARK_TEMPLATE(BM_StaticTrainStep, 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_StaticTrainStep, 8)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_StaticTrainStep, 32)->Unit(benchmark::kMicrosecond);
+
+// Inference latency of a single sample: predict() versus a static forward.
+// Arg: 0 dynamic, 1 static.
+static void BM_SingleSampleForward(benchmark::State &state) {
+	arma::arma_rng::set_seed(2);
+	Sequential<float> dynamic(in_features,
+														std::make_unique<SgdOptimizer<float>>(0.01F),
+														Layers::Linear<float>(hidden),
+														Layers::ReLU<float>(),
+														Layers::Linear<float>(classes),
+														Layers::Softmax<float>());
+	auto fixed = std::make_unique<StaticNet<1>>();
+	fixed->import_parameters(dynamic.parameter_values());
+	const arma::Mat<float> sample = arma::randu<arma::Mat<float>>(1, in_features);
+	const Tensor<float> x(sample);
+	const StaticNet<1>::Input row(sample.memptr(), in_features);
+	for (auto _ : state) {
+		if (state.range(0) == 0)
+			benchmark::DoNotOptimize(dynamic.predict(x).data->memptr());
+		else
+			benchmark::DoNotOptimize(fixed->forward(row).data());
+	}
+}
+BENCHMARK(BM_SingleSampleForward)->Arg(0)->Arg(1)->Unit(benchmark::kNanosecond);
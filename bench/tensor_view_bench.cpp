@@ -0,0 +1,60 @@
+#include <benchmark/benchmark.h>
+
+#include "exgraf/tensor_view.hpp"
+
+#include <armadillo>
+
+using namespace ExGraf;
+
+namespace {
+
+// The shape of Linear's dW = x^T * dy for a 784 -> 256 layer, batch 128.
+struct Operands {
+	Tensor<float> x, dy;
+	Operands()
+			: x(arma::randu<arma::Mat<float>>(128, 784)),
+				dy(arma::randu<arma::Mat<float>>(128, 256)) {}
+};
+
+} // namespace
+
+// Transposes and column-slices x (features 100..611), then multiplies.
+// Arg 0: copy the operand into a fresh matrix first; arg 1: hand the view
+// to GEMM as a transposed operand.
+static void BM_TransposedSliceMatmul(benchmark::State &state) {
+	arma::arma_rng::set_seed(1);
+	const Operands in;
+	const auto x = TensorView<float>(in.x).slice(1, 100, 612).transpose();
+	const TensorView<float> dy(in.dy);
+	arma::Mat<float> out;
+	for (auto _ : state) {
+		if (state.range(0) == 0)
+			matmul(TensorView<float>(x.materialize()), dy, out);
+		else
+			matmul(x, dy, out);
+		benchmark::DoNotOptimize(out.memptr());
+	}
+	state.SetBytesProcessed(state.iterations() * 512 * 128 * sizeof(float));
+}
+BENCHMARK(BM_TransposedSliceMatmul)->Arg(0)->Arg(1);
+
+// A data-parallel shard's forward product: rows 32..95 of x times W.
+// Arg 0: copy the rows out first, as the trainer used to; arg 1: pass them
+// to GEMM as a row window with the batch's column stride.
+static void BM_RowShardMatmul(benchmark::State &state) {
+	arma::arma_rng::set_seed(2);
+	const Operands in;
+	const Tensor<float> w(arma::randu<arma::Mat<float>>(784, 256));
+	const auto shard = Tensor<float>::rows_of(in.x, 32, 64);
+	arma::Mat<float> out;
+	for (auto _ : state) {
+		if (state.range(0) == 0)
+			matmul(TensorView<float>(Tensor<float>(in.x.data->rows(32, 95))),
+						 TensorView<float>(w), out);
+		else
+			matmul(TensorView<float>(shard), TensorView<float>(w), out);
+		benchmark::DoNotOptimize(out.memptr());
+	}
+	state.SetItemsProcessed(state.iterations() * 2 * 64 * 784 * 256);
+}
+BENCHMARK(BM_RowShardMatmul)->Arg(0)->Arg(1);
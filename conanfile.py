@@ -14,6 +14,8 @@ class ExGrafConan(ConanFile):
         self.requires("cpr/1.11.1")
         self.requires("doctest/2.4.11")
         self.requires("taskflow/3.9.0")
+        self.requires("benchmark/1.9.1")
+        self.requires("zlib/1.3.1")
 
     def layout(self) -> None:
         cmake_layout(self)
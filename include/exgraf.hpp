@@ -2,16 +2,45 @@
 
 #include "exgraf/allowed_types.hpp"
 #include "exgraf/binary_operation.hpp"
+#include "exgraf/checkpoint.hpp"
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/data_parallel_trainer.hpp"
 #include "exgraf/expression_graph.hpp"
+#include "exgraf/flat_buffer.hpp"
+#include "exgraf/fused_operation.hpp"
+#include "exgraf/fusion.hpp"
+#include "exgraf/gemm.hpp"
+#include "exgraf/gemm_kernels.hpp"
+#include "exgraf/half.hpp"
+#include "exgraf/inference_mode.hpp"
+#include "exgraf/layer.hpp"
+#include "exgraf/layers.hpp"
 #include "exgraf/logger.hpp"
+#include "exgraf/memory_planner.hpp"
 #include "exgraf/model.hpp"
 #include "exgraf/optimizer.hpp"
+#include "exgraf/profiler.hpp"
+#include "exgraf/sequential.hpp"
 #include "exgraf/shape.hpp"
+#include "exgraf/spatial_kernels.hpp"
+#include "exgraf/spatial_operation.hpp"
+#include "exgraf/static_graph.hpp"
 #include "exgraf/tensor.hpp"
+#include "exgraf/tensor_allocator.hpp"
+#include "exgraf/tensor_view.hpp"
 #include "exgraf/unary_operation.hpp"
 
 #include "exgraf/http/client.hpp"
+#include "exgraf/loaders/data_loader.hpp"
 #include "exgraf/loaders/mnist_loader.hpp"
 
 #include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/optimizers/flat_state.hpp"
 #include "exgraf/optimizers/sgd_optimizer.hpp"
+#include "exgraf/optimizers/update_kernels.hpp"
+
+#include "exgraf/serving/inference_server.hpp"
+#include "exgraf/serving/mpsc_queue.hpp"
+
+#include "exgraf/quantization/int8_kernels.hpp"
+#include "exgraf/quantization/quantized_model.hpp"
@@ -1,13 +1,28 @@
 #pragma once
 
 #include "exgraf/allowed_types.hpp"
+#include "exgraf/gemm.hpp"
 #include "exgraf/logger.hpp"
 #include "exgraf/operation.hpp"
+#include "exgraf/tensor_view.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <utility>
 
 namespace ExGraf::Binary {
 
+/// A * B. With a 16-bit operand storage (Operation::set_operand_storage)
+/// the inputs are kept as 16-bit copies rather than referenced, and every
+/// product reads those.
 template <AllowedTypes T> class MatMulOp : public Operation<T> {
 	Tensor<T> last_input1, last_input2;
+	// 16-bit copies of the inputs, kept instead of them under a 16-bit
+	// operand storage.
+	std::array<PackedMatrix<T>, 2> packed;
+	bool mixed{false};
 
 public:
 	auto
@@ -15,22 +30,113 @@ public:
 			-> Tensor<T> override {
 		auto &A = inputs[0].get();
 		auto &B = inputs[1].get();
-		trace("[MatMulOp forward] A: {}x{}, B: {}x{}", A.data->n_rows,
-					A.data->n_cols, B.data->n_rows, B.data->n_cols);
-		last_input1 = A;
-		last_input2 = B;
-		arma::Mat<T> result = (*A.data) * (*B.data);
-		trace("[MatMulOp forward] result: {}x{}", result.n_rows, result.n_cols);
-		return Tensor<T>(result);
+		trace("[MatMulOp forward] A: {}x{}, B: {}x{}", A.n_rows(), A.data->n_cols,
+					B.n_rows(), B.data->n_cols);
+		const auto format = this->operand_storage();
+		mixed = format != Storage::FP32;
+		auto result = this->allocate(A.n_rows(), B.data->n_cols);
+		if (mixed) {
+			pack_operand(A, packed[0], format);
+			pack_operand(B, packed[1], format);
+			last_input1 = {};
+			last_input2 = {};
+			gemm(packed[0], Transpose::No, packed[1], Transpose::No, *result.data);
+		} else {
+			packed = {};
+			last_input1 = A;
+			last_input2 = B;
+			matmul(TensorView<T>::matrix_of(A), TensorView<T>::matrix_of(B),
+						 *result.data);
+		}
+		trace("[MatMulOp forward] result: {}x{}", result.data->n_rows,
+					result.data->n_cols);
+		return result;
 	}
 
-	auto
-	backward(const Tensor<T> &grad_output) -> std::vector<Tensor<T>> override {
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		for (std::size_t i = 0; i < 2; ++i) {
+			const auto [rows, cols] = input_size(i);
+			grad_inputs[i] = this->allocate(rows, cols);
+		}
+		const GradientTarget<T> targets[]{{grad_inputs[0].data.get()},
+																			{grad_inputs[1].data.get()}};
+		backward_into(grad_output, targets);
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
 		trace("[MatMulOp backward] grad_output: {}x{}", grad_output.data->n_rows,
 					grad_output.data->n_cols);
-		arma::Mat<T> grad_A = (*grad_output.data) * last_input2.data->t();
-		arma::Mat<T> grad_B = last_input1.data->t() * (*grad_output.data);
-		return {Tensor<T>(grad_A), Tensor<T>(grad_B)};
+		if (!mixed) {
+			gradient(0, grad_output, targets[0]);
+			gradient(1, grad_output, targets[1]);
+			return;
+		}
+		// dA = dC * B^T and dB = A^T * dC from one 16-bit copy of dC.
+		auto &dc = gradient_scratch<T>();
+		pack_operand(grad_output, dc, packed[0].storage());
+		const auto beta = [](const GradientTarget<T> &t) {
+			return t.accumulate ? T(1) : T(0);
+		};
+		if (targets[0].into)
+			gemm(dc, Transpose::No, packed[1], Transpose::Yes, *targets[0].into,
+					 T(1), beta(targets[0]));
+		if (targets[1].into)
+			gemm(packed[0], Transpose::Yes, dc, Transpose::No, *targets[1].into,
+					 T(1), beta(targets[1]));
+	}
+
+	/// Not in mixed precision, where both gradients read one packed copy of
+	/// the incoming gradient.
+	auto separable() const -> bool override { return !mixed; }
+	/// Both operands go to GEMM through their strides.
+	auto reads_windows(std::size_t) const -> bool override { return true; }
+
+	auto
+	flops(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			const -> std::size_t override {
+		const auto &a = inputs[0].get();
+		return 2 * a.n_rows() * a.data->n_cols * inputs[1].get().data->n_cols;
+	}
+
+	auto backward_input(std::size_t input, const Tensor<T> &grad_output,
+											const GradientTarget<T> &target, TensorAllocator<T> &)
+			-> void override {
+		gradient(input, grad_output, target);
+	}
+
+	auto stashed_bytes() const -> std::size_t override {
+		return packed[0].bytes() + packed[1].bytes();
+	}
+	auto release_stash() -> void override { packed = {}; }
+
+private:
+	auto input_size(std::size_t i) const -> std::pair<std::size_t, std::size_t> {
+		if (mixed)
+			return {packed[i].n_rows(), packed[i].n_cols()};
+		const auto &input = i == 0 ? last_input1 : last_input2;
+		return {input.n_rows(), input.data->n_cols};
+	}
+
+	auto gradient(std::size_t input, const Tensor<T> &grad_output,
+								const GradientTarget<T> &target) -> void {
+		if (!target.into)
+			return;
+		// dA = dC * B^T and dB = A^T * dC, both read through the transpose
+		// flags rather than by forming B^T or A^T, and accumulated by the
+		// product itself (beta = 1) rather than through a temporary.
+		const T beta = target.accumulate ? T(1) : T(0);
+		const auto g = TensorView<T>::matrix_of(grad_output);
+		if (input == 0)
+			matmul(g, TensorView<T>::matrix_of(last_input2).transpose(),
+						 *target.into, T(1), beta);
+		else
+			matmul(TensorView<T>::matrix_of(last_input1).transpose(), g,
+						 *target.into, T(1), beta);
 	}
 };
 
@@ -51,22 +157,149 @@ public:
 					target.data->n_cols);
 		last_input = input;
 		last_target = target;
-		arma::Mat<T> safe_input = arma::clamp(*input.data, eps, T(1) - eps);
-		arma::Mat<T> loss = -(*target.data % arma::log(safe_input));
-		T total_loss = arma::accu(loss) / input.data->n_rows;
+		const T *p = input.data->memptr();
+		const T *y = target.origin();
+		T loss = T(0);
+		for (std::size_t i = 0; i < input.data->n_elem; ++i)
+			loss -= y[window_offset(target, i)] *
+							std::log(std::clamp(p[i], eps, T(1) - eps));
+		T total_loss = loss / input.data->n_rows;
 		trace("[CrossEntropyLoss forward] loss: {}", total_loss);
-		return Tensor<T>(
-				arma::Mat<T>(arma::SizeMat{1, 1}, arma::fill::value(total_loss)));
+		auto result = this->allocate(1, 1);
+		result.data->at(0) = total_loss;
+		return result;
 	}
 
-	auto
-	backward(const Tensor<T> &grad_output) -> std::vector<Tensor<T>> override {
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		grad_inputs[0] =
+				this->allocate(last_input.data->n_rows, last_input.data->n_cols);
+		// Targets are constants: grad_inputs[1] is left empty.
+		const GradientTarget<T> targets[]{{grad_inputs[0].data.get()}, {}};
+		backward_into(grad_output, targets);
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+	auto differentiable(std::size_t input) const -> bool override {
+		return input == 0;
+	}
+	/// Targets may be a window onto a larger batch.
+	auto reads_windows(std::size_t input) const -> bool override {
+		return input == 1;
+	}
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
 		trace("[CrossEntropyLoss backward] grad_output: {}x{}",
 					grad_output.data->n_rows, grad_output.data->n_cols);
-		T grad_scale = grad_output.data->at(0) / last_input.data->n_rows;
-		arma::Mat<T> grad_input =
-				(*last_input.data - *last_target.data) * grad_scale;
-		return {Tensor<T>(grad_input)};
+		if (!targets[0].into)
+			return;
+		// d/dp of -sum(y log p) / n. Composed with SoftmaxOp's backward this is
+		// the familiar (p - y) / n; Fused::SoftmaxCrossEntropyOp computes that
+		// directly.
+		const T grad_scale = grad_output.data->at(0) / last_input.data->n_rows;
+		const T *p = last_input.data->memptr();
+		const T *y = last_target.origin();
+		store_gradient(targets[0], [&](std::size_t i) {
+			return -grad_scale * y[window_offset(last_target, i)] /
+						 std::clamp(p[i], eps, T(1) - eps);
+		});
+	}
+};
+
+/// Element-wise sum of two equally shaped inputs.
+template <AllowedTypes T> class AddOp : public Operation<T> {
+public:
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &a = inputs[0].get();
+		auto &b = inputs[1].get();
+		trace("[AddOp forward] a: {}x{}, b: {}x{}", a.data->n_rows, a.data->n_cols,
+					b.data->n_rows, b.data->n_cols);
+		auto result = this->allocate(a.data->n_rows, a.data->n_cols);
+		*result.data = *a.data + *b.data;
+		return result;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		for (std::size_t i = 0; i < 2; ++i) {
+			grad_inputs[i] =
+					this->allocate(grad_output.data->n_rows, grad_output.data->n_cols);
+			*grad_inputs[i].data = *grad_output.data;
+		}
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
+		for (const auto &target : targets)
+			pass_through(grad_output, target);
+	}
+
+	auto separable() const -> bool override { return true; }
+
+	auto backward_input(std::size_t, const Tensor<T> &grad_output,
+											const GradientTarget<T> &target, TensorAllocator<T> &)
+			-> void override {
+		pass_through(grad_output, target);
+	}
+
+private:
+	static auto pass_through(const Tensor<T> &grad_output,
+													 const GradientTarget<T> &target) -> void {
+		if (!target.into)
+			return;
+		const T *g = grad_output.data->memptr();
+		store_gradient(target, [g](std::size_t i) { return g[i]; });
+	}
+};
+
+/// Adds a 1xN bias row to every row of the input.
+template <AllowedTypes T> class AddBiasOp : public Operation<T> {
+public:
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &input = inputs[0].get();
+		auto &bias = inputs[1].get();
+		trace("[AddBiasOp forward] input: {}x{}, bias: {}x{}", input.data->n_rows,
+					input.data->n_cols, bias.data->n_rows, bias.data->n_cols);
+		auto result = this->allocate(input.data->n_rows, input.data->n_cols);
+		*result.data = *input.data;
+		result.data->each_row() += *bias.data;
+		return result;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		grad_inputs[0] =
+				this->allocate(grad_output.data->n_rows, grad_output.data->n_cols);
+		grad_inputs[1] = this->allocate(1, grad_output.data->n_cols);
+		const GradientTarget<T> targets[]{{grad_inputs[0].data.get()},
+																			{grad_inputs[1].data.get()}};
+		backward_into(grad_output, targets);
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
+		trace("[AddBiasOp backward] grad_output: {}x{}", grad_output.data->n_rows,
+					grad_output.data->n_cols);
+		const auto &g = *grad_output.data;
+		if (targets[0].into) {
+			const T *gp = g.memptr();
+			store_gradient(targets[0], [gp](std::size_t i) { return gp[i]; });
+		}
+		if (targets[1].into)
+			store_gradient(targets[1],
+										 [&g](std::size_t c) { return column_sum(g, c); });
 	}
 };
 
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/loaders/dataset_cache.hpp"
+#include "exgraf/optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/shape.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ExGraf::Checkpoint {
+
+/// On-disk layout: this header, one (rows, cols) pair of uint64 per
+/// parameter tensor, zero padding up to `parameter_offset`, the parameters
+/// back to back as Sequential lays them out, padding up to
+/// `optimizer_offset`, then the optimizer's state arrays. Both offsets are
+/// multiples of 64, so a mapped file can back the parameters in place.
+struct CheckpointHeader {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	std::uint32_t element_size;
+	std::uint32_t parameter_crc32;
+	std::uint32_t optimizer_crc32;
+	std::uint64_t tensors;
+	std::uint64_t parameters;
+	std::uint64_t optimizer_step;
+	std::uint64_t optimizer_values;
+	std::uint64_t parameter_offset;
+	std::uint64_t optimizer_offset;
+};
+
+inline constexpr std::array<char, 8> checkpoint_magic{'E', 'X', 'G', 'R',
+																											'A', 'F', 'C', 'K'};
+inline constexpr std::uint32_t checkpoint_version = 1;
+inline constexpr std::size_t checkpoint_alignment = 64;
+
+/// A copy of everything a checkpoint stores, detached from the model so it
+/// can be written while training goes on.
+template <AllowedTypes T> struct Snapshot {
+	std::vector<Shape> shapes;
+	std::vector<T> parameters;
+	std::size_t optimizer_step{0};
+	std::vector<T> optimizer_values;
+};
+
+template <AllowedTypes T>
+auto snapshot(const Sequential<T> &model) -> Snapshot<T> {
+	const auto values = model.parameter_values();
+	const auto state = model.optimizer_state();
+	return {model.parameter_shapes(),
+					{values.begin(), values.end()},
+					state.step,
+					{state.values.begin(), state.values.end()}};
+}
+
+namespace Detail {
+
+inline auto align_up(std::size_t bytes) -> std::size_t {
+	return (bytes + checkpoint_alignment - 1) / checkpoint_alignment *
+				 checkpoint_alignment;
+}
+
+inline auto shape_table_bytes(std::size_t tensors) -> std::size_t {
+	return tensors * 2 * sizeof(std::uint64_t);
+}
+
+} // namespace Detail
+
+/// Writes `saved` to `path` through a temporary file renamed into place, so
+/// a reader (or a crash mid-write) never leaves a partial checkpoint.
+template <AllowedTypes T>
+auto write(const std::filesystem::path &path, const Snapshot<T> &saved)
+		-> void {
+	CheckpointHeader header{};
+	header.magic = checkpoint_magic;
+	header.version = checkpoint_version;
+	header.element_size = sizeof(T);
+	header.parameter_crc32 = Cache::payload_crc32(
+			saved.parameters.data(), saved.parameters.size() * sizeof(T));
+	header.optimizer_crc32 =
+			Cache::payload_crc32(saved.optimizer_values.data(),
+													 saved.optimizer_values.size() * sizeof(T));
+	header.tensors = saved.shapes.size();
+	header.parameters = saved.parameters.size();
+	header.optimizer_step = saved.optimizer_step;
+	header.optimizer_values = saved.optimizer_values.size();
+	header.parameter_offset = Detail::align_up(
+			sizeof(CheckpointHeader) + Detail::shape_table_bytes(header.tensors));
+	header.optimizer_offset = Detail::align_up(header.parameter_offset +
+																						 header.parameters * sizeof(T));
+
+	std::vector<std::uint64_t> table;
+	table.reserve(2 * saved.shapes.size());
+	for (const auto &s : saved.shapes) {
+		table.push_back(s.rows());
+		table.push_back(s.cols());
+	}
+
+	if (path.has_parent_path())
+		std::filesystem::create_directories(path.parent_path());
+	auto staging = path;
+	staging += ".tmp";
+	{
+		std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+		const std::array<char, checkpoint_alignment> padding{};
+		const auto pad_to = [&](std::uint64_t offset) {
+			out.write(padding.data(),
+								static_cast<std::streamsize>(
+										offset - static_cast<std::uint64_t>(out.tellp())));
+		};
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char *>(table.data()),
+							static_cast<std::streamsize>(table.size() * sizeof(table[0])));
+		pad_to(header.parameter_offset);
+		out.write(reinterpret_cast<const char *>(saved.parameters.data()),
+							static_cast<std::streamsize>(header.parameters * sizeof(T)));
+		pad_to(header.optimizer_offset);
+		out.write(reinterpret_cast<const char *>(saved.optimizer_values.data()),
+							static_cast<std::streamsize>(header.optimizer_values *
+																					 sizeof(T)));
+		if (!out)
+			throw std::runtime_error("Failed to write checkpoint: " +
+															 staging.string());
+	}
+	std::filesystem::rename(staging, path);
+}
+
+template <AllowedTypes T>
+auto save(const std::filesystem::path &path, const Sequential<T> &model)
+		-> void {
+	write(path, snapshot(model));
+}
+
+/// Copies the parameters and optimizer state on the calling thread (one
+/// memcpy each), then writes them on another, so training can take its next
+/// step at once. The future rethrows write errors.
+template <AllowedTypes T>
+auto save_async(const std::filesystem::path &path, const Sequential<T> &model)
+		-> std::future<void> {
+	return std::async(std::launch::async,
+										[path, saved = snapshot(model)] { write(path, saved); });
+}
+
+struct LoadOptions {
+	/// Copy the optimizer state in as well; inference processes skip it and
+	/// never touch those pages.
+	bool optimizer_state{true};
+	/// Check both payload checksums, which reads the whole file.
+	bool verify{false};
+};
+
+/// Maps a checkpoint written for `model`'s architecture and moves the
+/// model's parameters onto the mapping: nothing is read until a page is
+/// touched, so startup cost does not grow with the model. The mapping is
+/// private, so further training never reaches the file; it is released with
+/// the model.
+///
+/// Throws std::runtime_error if the file cannot be mapped, is damaged, was
+/// written for another element type or does not match the model's
+/// parameter shapes, and std::invalid_argument if the saved optimizer state
+/// does not fit the model's optimizer. The model is unchanged on failure.
+template <AllowedTypes T>
+auto load(const std::filesystem::path &path, Sequential<T> &model,
+					LoadOptions options = {}) -> void {
+	const auto fail = [&](const std::string &why) {
+		throw std::runtime_error("Checkpoint::load: " + why + ": " +
+														 path.string());
+	};
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		fail("cannot open");
+	struct stat info{};
+	if (::fstat(fd, &info) != 0 ||
+			static_cast<std::size_t>(info.st_size) < sizeof(CheckpointHeader)) {
+		::close(fd);
+		fail("truncated header");
+	}
+	const auto file_bytes = static_cast<std::size_t>(info.st_size);
+	void *mapping = ::mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE,
+												 MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		fail("cannot map");
+	// Owns the mapping until the parameters take it over.
+	std::shared_ptr<T[]> keep(
+			reinterpret_cast<T *>(mapping),
+			[file_bytes](T *p) { ::munmap(p, file_bytes); });
+	const auto *bytes = static_cast<const char *>(mapping);
+
+	CheckpointHeader header;
+	std::memcpy(&header, bytes, sizeof(header));
+	if (header.magic != checkpoint_magic ||
+			header.version != checkpoint_version ||
+			header.element_size != sizeof(T))
+		fail("not a checkpoint for this element type");
+	const auto table_end =
+			sizeof(CheckpointHeader) + Detail::shape_table_bytes(header.tensors);
+	const bool sized =
+			header.parameter_offset % checkpoint_alignment == 0 &&
+			header.optimizer_offset % checkpoint_alignment == 0 &&
+			header.parameter_offset >= table_end &&
+			header.optimizer_offset >=
+					header.parameter_offset + header.parameters * sizeof(T) &&
+			file_bytes == header.optimizer_offset +
+												header.optimizer_values * sizeof(T);
+	if (!sized)
+		fail("header does not match the file size");
+
+	const auto &shapes = model.parameter_shapes();
+	bool matches = header.tensors == shapes.size() &&
+								 header.parameters == model.parameter_values().size();
+	for (std::size_t i = 0; matches && i < shapes.size(); ++i) {
+		std::array<std::uint64_t, 2> dims;
+		std::memcpy(dims.data(),
+								bytes + sizeof(CheckpointHeader) +
+										Detail::shape_table_bytes(i),
+								sizeof(dims));
+		matches = dims[0] == shapes[i].rows() && dims[1] == shapes[i].cols();
+	}
+	if (!matches)
+		fail("parameter shapes do not match the model");
+
+	auto *parameters =
+			reinterpret_cast<T *>(static_cast<char *>(mapping) +
+														header.parameter_offset);
+	const std::span<const T> optimizer_values(
+			reinterpret_cast<const T *>(bytes + header.optimizer_offset),
+			header.optimizer_values);
+	if (options.verify &&
+			(Cache::payload_crc32(parameters, header.parameters * sizeof(T)) !=
+					 header.parameter_crc32 ||
+			 Cache::payload_crc32(optimizer_values.data(),
+														optimizer_values.size_bytes()) !=
+					 header.optimizer_crc32))
+		fail("checksum mismatch");
+
+	if (options.optimizer_state)
+		model.restore_optimizer_state(
+				{static_cast<std::size_t>(header.optimizer_step), optimizer_values});
+	model.adopt_parameters(std::shared_ptr<T[]>(keep, parameters));
+}
+
+} // namespace ExGraf::Checkpoint
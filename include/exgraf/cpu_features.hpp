@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EXGRAF_X86 1
+#else
+#define EXGRAF_X86 0
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace ExGraf {
+
+/// Instruction set levels the hand-written kernels are built for, in
+/// increasing order. Kernels are compiled per level with function target
+/// attributes, so the binary runs anywhere and picks a level at runtime.
+/// AVX2 means the x86-64-v3 set: AVX2 together with FMA and F16C.
+enum class Isa : std::uint8_t { Scalar, SSE2, AVX2 };
+
+inline auto isa_supported(Isa isa) -> bool {
+	switch (isa) {
+	case Isa::Scalar:
+		return true;
+#if EXGRAF_X86
+	case Isa::SSE2:
+		return __builtin_cpu_supports("sse2");
+	case Isa::AVX2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+					 __builtin_cpu_supports("f16c");
+#endif
+	default:
+		return false;
+	}
+}
+
+/// The best level this CPU supports, detected once.
+inline auto detect_isa() -> Isa {
+	static const Isa best = [] {
+		for (auto isa : {Isa::AVX2, Isa::SSE2})
+			if (isa_supported(isa))
+				return isa;
+		return Isa::Scalar;
+	}();
+	return best;
+}
+
+/// AVX-VNNI: 8-bit dot products accumulated into 32 bits in one
+/// instruction (vpdpbusd) on 256-bit registers. An extension used next to
+/// AVX2 by the int8 kernels, not a level of its own.
+inline auto vnni_supported() -> bool {
+#if EXGRAF_X86
+	static const bool supported =
+			isa_supported(Isa::AVX2) && __builtin_cpu_supports("avxvnni");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/// Physical cores this process may run on: the logical CPUs in its
+/// affinity mask, with SMT siblings counted once. Compute-bound workers
+/// gain little from a core's second hardware thread and contend for its
+/// caches, so this is the count to scale them to. Falls back to
+/// std::thread::hardware_concurrency() where the topology cannot be read.
+/// Detected once.
+inline auto physical_core_count() -> std::size_t {
+	static const std::size_t cores = [] {
+		std::size_t count = 0;
+#if defined(__linux__)
+		cpu_set_t allowed;
+		if (::sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+			std::set<std::pair<long, long>> seen;
+			for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+				if (!CPU_ISSET(cpu, &allowed))
+					continue;
+				const auto topology = "/sys/devices/system/cpu/cpu" +
+															std::to_string(cpu) + "/topology/";
+				long package = -1, core = -1;
+				std::ifstream(topology + "physical_package_id") >> package;
+				std::ifstream(topology + "core_id") >> core;
+				if (core < 0) {
+					seen.clear();
+					break;
+				}
+				seen.emplace(package, core);
+			}
+			count = seen.size();
+		}
+#endif
+		if (count == 0)
+			count = std::max(1u, std::thread::hardware_concurrency());
+		return count;
+	}();
+	return cores;
+}
+
+inline auto isa_name(Isa isa) -> std::string_view {
+	switch (isa) {
+	case Isa::Scalar:
+		return "scalar";
+	case Isa::SSE2:
+		return "sse2";
+	case Isa::AVX2:
+		return "avx2";
+	}
+	return "unknown";
+}
+
+} // namespace ExGraf
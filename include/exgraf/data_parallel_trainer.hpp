@@ -0,0 +1,137 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <taskflow/taskflow.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace ExGraf {
+
+/// Trains a Sequential model on several threads by splitting every global
+/// batch into one row shard per worker. Shards are row windows onto the
+/// batch (Tensor::rows_of), read in place rather than copied.
+///
+/// Worker 0 runs the model itself; the others run replicas sharing its
+/// parameter storage, each with its own graph and gradients. A worker scales
+/// its gradients by its share of the batch (the loss is a per-shard mean), and
+/// a tree all-reduce then sums them into the model's gradients in
+/// ceil(log2(workers)) rounds, each round's pairs running concurrently. One
+/// optimizer step follows. Up to summation order this equals a single
+/// `Sequential::step` on the whole batch.
+template <AllowedTypes T> class DataParallelTrainer {
+	struct Worker {
+		Sequential<T> *model;
+		Tensor<T> inputs, targets;
+		std::size_t begin{0}, end{0};
+		T loss{0};
+	};
+
+	Sequential<T> &model;
+	std::vector<std::unique_ptr<Sequential<T>>> replicas;
+	std::vector<Worker> workers;
+	const Tensor<T> *batch_inputs{nullptr};
+	const Tensor<T> *batch_targets{nullptr};
+	tf::Executor executor;
+	tf::Taskflow taskflow;
+
+public:
+	DataParallelTrainer(Sequential<T> &m, std::size_t worker_count)
+			: model(m), executor(std::max<std::size_t>(worker_count, 1)) {
+		if (worker_count == 0)
+			throw std::invalid_argument(
+					"DataParallelTrainer: at least one worker is required.");
+		workers.resize(worker_count);
+		workers[0].model = &model;
+		for (std::size_t k = 1; k < worker_count; ++k) {
+			replicas.push_back(model.replicate(k));
+			workers[k].model = replicas.back().get();
+		}
+		build_taskflow();
+		// The step runs after the shards finish, so the workers are idle.
+		model.set_optimizer_executor(&executor);
+	}
+
+	~DataParallelTrainer() { model.set_optimizer_executor(nullptr); }
+
+	/// One optimizer step on the global batch. Returns the batch mean loss.
+	auto step(const Tensor<T> &inputs, const Tensor<T> &targets) -> T {
+		const auto rows = inputs.n_rows();
+		if (rows == 0 || targets.n_rows() != rows)
+			throw std::invalid_argument(
+					"DataParallelTrainer::step: inputs and targets need matching, "
+					"non-empty row counts.");
+		const auto count = workers.size();
+		for (std::size_t k = 0; k < count; ++k) {
+			workers[k].begin = rows * k / count;
+			workers[k].end = rows * (k + 1) / count;
+		}
+		batch_inputs = &inputs;
+		batch_targets = &targets;
+		executor.run(taskflow).wait();
+		model.step();
+
+		T loss = T(0);
+		for (const auto &worker : workers)
+			loss += worker.loss;
+		return loss;
+	}
+
+	auto worker_count() const -> std::size_t { return workers.size(); }
+
+private:
+	auto run_shard(Worker &worker) -> void {
+		auto &replica = *worker.model;
+		replica.zero_grad();
+		worker.loss = T(0);
+		const auto rows = worker.end - worker.begin;
+		if (rows == 0) {
+			replica.settle_grads();
+			return;
+		}
+		worker.inputs = Tensor<T>::rows_of(*batch_inputs, worker.begin, rows);
+		worker.targets = Tensor<T>::rows_of(*batch_targets, worker.begin, rows);
+
+		auto output = replica.forward(worker.inputs);
+		const T share = T(rows) / T(batch_inputs->n_rows());
+		worker.loss = replica.compute_loss(output, worker.targets) * share;
+		replica.backward();
+		replica.settle_grads();
+		for (auto &p : replica.params())
+			*p.get().grad->data *= share;
+		// The model's own graph is rewound by `Sequential::step`.
+		if (&replica != &model)
+			replica.reset_graph();
+	}
+
+	auto reduce_into(Worker &into, Worker &from) -> void {
+		auto &to_params = into.model->params();
+		auto &from_params = from.model->params();
+		for (std::size_t j = 0; j < to_params.size(); ++j)
+			*to_params[j].get().grad->data += *from_params[j].get().grad->data;
+	}
+
+	auto build_taskflow() -> void {
+		const auto count = workers.size();
+		std::vector<tf::Task> last(count);
+		for (std::size_t k = 0; k < count; ++k)
+			last[k] = taskflow.emplace([this, k] { run_shard(workers[k]); });
+		for (std::size_t stride = 1; stride < count; stride *= 2) {
+			for (std::size_t k = 0; k + stride < count; k += 2 * stride) {
+				auto reduce = taskflow.emplace([this, k, stride] {
+					reduce_into(workers[k], workers[k + stride]);
+				});
+				reduce.succeed(last[k], last[k + stride]);
+				last[k] = reduce;
+			}
+		}
+	}
+};
+
+} // namespace ExGraf
@@ -1,62 +1,689 @@
 #pragma once
 
 #include "exgraf/allowed_types.hpp"
+#include "exgraf/fusion.hpp"
+#include "exgraf/memory_planner.hpp"
 #include "exgraf/operation.hpp"
+#include "exgraf/profiler.hpp"
 #include "exgraf/tensor.hpp"
+#include "exgraf/tensor_allocator.hpp"
+#include "exgraf/tensor_view.hpp"
+
+#include <taskflow/taskflow.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
 
 namespace ExGraf {
 
+/// Records operations as they execute and replays their gradients backwards.
+///
+/// The graph is a tape with a cursor: `reset()` rewinds the cursor instead of
+/// dropping the recorded nodes, so the next step overwrites them slot by slot.
+/// When a step records the same sequence of operation types as the previous
+/// one (the usual training loop), the operation objects are reused and only
+/// their inputs are rebound. Memory and backward cost therefore scale with the
+/// size of one step's graph, not with the number of steps seen.
+///
+/// Backward hands operations that accumulate in place (see
+/// Operation::backward_into) the gradient buffers of their inputs directly,
+/// so a contribution costs no buffer of its own and no separate add.
+///
+/// Outputs and gradients are served by a MemoryPlanner. Tensors returned by
+/// `add_operation` are valid until the same slot is recorded again in a later
+/// step; copy them if they must outlive that.
+///
+/// With fusion patterns set, the tape captured by a step is scanned when it
+/// is reset and matching chains become fused groups for the following steps.
+/// Replaying a group runs the fused operation at its last slot; members of a
+/// deferred group return an empty placeholder that is filled in only if an
+/// operation outside the group reads it before that slot runs (or the group
+/// is cut short); reading one after that is an error, since the inputs it
+/// would be computed from are no longer kept. A step that no longer matches
+/// a group drops all groups and runs unfused; its tape is scanned again at
+/// the next reset.
+///
+/// With an executor set, backward runs as a Taskflow graph built from the
+/// node/input edges (and rebuilt only when those change): a node's gradient
+/// tasks start once every consumer has contributed, separable operations get
+/// one task per input, and tasks accumulating into the same gradient are
+/// chained in the order the serial walk uses, so results are identical and
+/// race free. Each task draws scratch buffers from its own BufferCache rather
+/// than the shared planner.
+///
+/// With a profiler set, every node's forward and backward, and every
+/// gradient accumulation, is recorded as a span (see Profiler).
 template <AllowedTypes T> class ExpressionGraph {
+	static constexpr auto leaf = std::numeric_limits<std::size_t>::max();
+	static constexpr auto no_group = leaf;
+	using TensorRef = std::reference_wrapper<const Tensor<T>>;
+
 	struct Node {
 		std::shared_ptr<Operation<T>> op;
+		// Only dereferenced for leaf inputs (parameters, batches), which must
+		// outlive the step. Intermediate inputs are tracked via `producers`.
 		std::vector<const Tensor<T> *> inputs;
+		std::vector<std::size_t> producers;
 		Tensor<T> output;
+		Tensor<T> grad;
+		bool has_grad{false};
+		std::vector<GradientTarget<T>> targets;
+		std::vector<Tensor<T>> grad_inputs;
+		// Copies of row windows the operation cannot read, by input; they
+		// stand in for the windows as leaves and are reused between steps.
+		std::vector<std::unique_ptr<Tensor<T>>> gathered;
+
+		// Fusion state. `fused` is set on the last member of a group only.
+		std::shared_ptr<Operation<T>> fused;
+		std::size_t group_head{no_group};
+		std::size_t group_tail{no_group};
+		bool defer{false};
+		bool deferred{false};
+		std::vector<Tensor<T>> held;
+		std::shared_ptr<arma::Mat<T>> placeholder;
+
+		// Parallel backward buffers: one cache per task (the last serves a
+		// whole-node task) plus the node's gradient accumulator.
+		std::vector<BufferCache<T>> scratch;
+		BufferCache<T> accumulator;
+
+		// Forward FLOPs of the last forward, kept for the backward span.
+		std::uint64_t flops{0};
 	};
 	std::vector<Node> nodes;
-	std::unordered_map<const Tensor<T> *, std::size_t> tensor_to_node_idx;
+	std::size_t recorded{0};
+	std::vector<TensorRef> forward_inputs;
+	MemoryPlanner<T> planner;
+
+	std::vector<FusionPattern<T>> patterns;
+	bool fusion_scanned{false};
+	std::vector<TensorRef> fused_inputs;
+	std::vector<const Tensor<T> *> fused_pointers;
+	std::vector<std::size_t> fused_producers;
+
+	static constexpr auto all_inputs = leaf;
+	tf::Executor *executor{nullptr};
+	std::unique_ptr<tf::Taskflow> schedule;
+	std::vector<std::uintptr_t> schedule_key;
+	std::vector<std::uintptr_t> candidate_key;
+	std::vector<bool> needs_grad;
+
+	Profiler *profiler{nullptr};
+	Storage operands{Storage::FP32};
 
 public:
-	auto add_operation(
-			std::shared_ptr<Operation<T>> op,
-			const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
-			-> Tensor<T> {
-		std::vector<const Tensor<T> *> ptrs;
-		for (auto &inp : inputs)
-			ptrs.push_back(&inp.get());
-		Node node{op, ptrs, op->forward(inputs)};
-		nodes.push_back(node);
-		tensor_to_node_idx[&nodes.back().output] = nodes.size() - 1;
-		return nodes.back().output;
-	}
-
-	auto backward(Tensor<T> &start_tensor) -> void {
-		for (auto &node : nodes)
-			node.output.zero_grad();
-		start_tensor.zero_grad();
-		start_tensor.grad->data->ones();
-		const auto count = static_cast<std::int32_t>(nodes.size()) - 1;
-		for (std::int32_t i = count; i >= 0; --i) {
+	auto add_operation(std::shared_ptr<Operation<T>> op,
+										 std::span<const TensorRef> inputs) -> Tensor<T> {
+		const auto slot = recorded;
+		if (slot < nodes.size() && nodes[slot].group_head != no_group &&
+				!replays_group_member(slot, *op, inputs))
+			unfuse();
+		auto &node = slot < nodes.size() ? nodes[slot] : nodes.emplace_back();
+		node.op = std::move(op);
+		node.op->bind_allocator(&planner);
+		node.op->set_operand_storage(operands);
+		if (node.fused)
+			node.fused->set_operand_storage(operands);
+		node.deferred = false;
+		node.inputs.clear();
+		node.producers.clear();
+		forward_inputs.clear();
+		const auto grouped = node.group_head != no_group;
+		for (std::size_t j = 0; j < inputs.size(); ++j) {
+			auto producer = producer_of(inputs[j].get());
+			if (inputs[j].get().window && producer != leaf)
+				throw std::invalid_argument(
+						"ExpressionGraph: row windows must be leaf inputs.");
+			const auto &inp = readable(node, j, inputs[j].get());
+			// The chained input of a group member is the one read it may skip.
+			const auto chained = grouped && j == 0 && producer + 1 == slot &&
+													 slot != node.group_head;
+			if (producer != leaf && nodes[producer].deferred && !chained)
+				materialize(producer);
+			node.inputs.push_back(&inp);
+			node.producers.push_back(producer);
+			forward_inputs.push_back(inp);
+		}
+		planner.enter(slot, Phase::Forward);
+		if (grouped && !node.fused) {
+			node.held.assign(forward_inputs.begin(), forward_inputs.end());
+			if (node.defer) {
+				if (!node.placeholder)
+					node.placeholder = std::make_shared<arma::Mat<T>>();
+				node.output = Tensor<T>(node.placeholder);
+				node.deferred = true;
+				return nodes[recorded++].output;
+			}
+		}
+		const auto span = profile_begin(node);
+		node.output =
+				node.fused ? run_fused(slot) : node.op->forward(forward_inputs);
+		planner.mark_output(node.output);
+		if (profiling())
+			profile_forward(slot, span, node.fused ? fused_inputs : forward_inputs,
+											node.output);
+		return nodes[recorded++].output;
+	}
+
+	auto add_operation(std::shared_ptr<Operation<T>> op,
+										 std::initializer_list<TensorRef> inputs) -> Tensor<T> {
+		return add_operation(std::move(op),
+												 std::span<const TensorRef>(inputs.begin(), inputs.size()));
+	}
+
+	/// Records an `Op`, reusing the operation object already in this slot when
+	/// the previous step recorded the same type there.
+	template <std::derived_from<Operation<T>> Op>
+	auto add_operation(std::initializer_list<TensorRef> inputs) -> Tensor<T> {
+		if (recorded < nodes.size() && nodes[recorded].op &&
+				typeid(*nodes[recorded].op) == typeid(Op))
+			return add_operation(nodes[recorded].op, inputs);
+		return add_operation(std::make_shared<Op>(), inputs);
+	}
+
+	/// Backpropagates from `start_tensor`, whose own gradient is `seed` in
+	/// every element (a loss scale; see LossScaler).
+	auto backward(const Tensor<T> &start_tensor, T seed = T(1)) -> void {
+		auto start = producer_of(start_tensor);
+		if (start == leaf)
+			throw std::invalid_argument(
+					"ExpressionGraph::backward: tensor was not recorded in this step.");
+		for (std::size_t i = 0; i < recorded; ++i) {
+			nodes[i].has_grad = false;
+			// A group cut short by the end of the step still owes its outputs.
+			if (nodes[i].deferred && nodes[i].group_tail >= recorded)
+				materialize(i);
+		}
+		if (executor) {
+			parallel_backward(start, seed);
+			return;
+		}
+		for (auto i = static_cast<std::int64_t>(start); i >= 0; --i) {
 			auto &node = nodes[i];
-			auto grad_outputs = node.op->backward(*node.output.grad);
-			update_gradients(node, grad_outputs);
+			planner.enter(i, Phase::Backward);
+			if (static_cast<std::size_t>(i) == start) {
+				node.grad = planner.allocate_until(node.output.data->n_rows,
+																					 node.output.data->n_cols, start);
+				node.grad.data->fill(seed);
+				node.has_grad = true;
+			}
+			if (!node.has_grad)
+				continue;
+			executing(node).bind_allocator(&planner);
+			run_backward(i);
+		}
+	}
+
+	/// Runs backward on `e` from now on; nullptr restores the serial walk.
+	auto set_executor(tf::Executor *e) -> void {
+		executor = e;
+		schedule.reset();
+		schedule_key.clear();
+	}
+
+	/// Records spans into `p` from now on; nullptr stops recording.
+	auto set_profiler(Profiler *p) -> void { profiler = p; }
+
+	/// The operand storage (Operation::set_operand_storage) of every
+	/// operation recorded from now on.
+	auto set_operand_storage(Storage s) -> void { operands = s; }
+
+	/// Rewinds the tape. Node storage and operation objects are kept for the
+	/// next step.
+	auto reset() -> void {
+		if (!patterns.empty() && !fusion_scanned)
+			fuse();
+		recorded = 0;
+		planner.finish_step();
+	}
+
+	/// Chains to fuse from the next captured step on; empty disables fusion.
+	auto set_fusion_patterns(std::vector<FusionPattern<T>> p) -> void {
+		unfuse();
+		patterns = std::move(p);
+	}
+
+	auto size() const -> std::size_t { return recorded; }
+	auto capacity() const -> std::size_t { return nodes.size(); }
+	auto memory_planner() const -> const MemoryPlanner<T> & { return planner; }
+	/// Bytes of 16-bit operand copies the operations keep for backward (see
+	/// set_operand_storage), held outside the planner's arena.
+	auto stashed_bytes() const -> std::size_t {
+		std::size_t total = 0;
+		for (const auto &node : nodes) {
+			total += node.op ? node.op->stashed_bytes() : 0;
+			total += node.fused ? node.fused->stashed_bytes() : 0;
 		}
+		return total;
+	}
+	auto fused_groups() const -> std::size_t {
+		return std::ranges::count_if(
+				nodes, [](const Node &n) { return n.fused != nullptr; });
 	}
 
 private:
-	auto update_gradients(Node &node, const std::vector<Tensor<T>> &grad_outputs)
-			-> void {
-		const auto size = node.inputs.size();
-		for (std::size_t j = 0; j < size; ++j) {
-			auto *inp = node.inputs[j];
-			auto it = tensor_to_node_idx.find(inp);
-
-			if (it != tensor_to_node_idx.end()) {
-				auto &inp_node = nodes[it->second];
-				if (!inp_node.output.grad) {
-					inp_node.output.grad =
-							std::make_shared<Tensor<T>>(inp_node.output.shape);
+	auto replays_group_member(std::size_t slot, const Operation<T> &op,
+														std::span<const TensorRef> inputs) const -> bool {
+		const auto &node = nodes[slot];
+		if (typeid(op) != typeid(*node.op))
+			return false;
+		if (slot == node.group_head)
+			return true;
+		return !inputs.empty() &&
+					 inputs.front().get().data == nodes[slot - 1].output.data;
+	}
+
+	// Scans the tape just captured for pattern chains, first match wins.
+	auto fuse() -> void {
+		fusion_scanned = true;
+		std::vector<std::size_t> consumers(recorded, 0);
+		for (std::size_t i = 0; i < recorded; ++i) {
+			for (auto p : nodes[i].producers) {
+				if (p != leaf)
+					++consumers[p];
+			}
+		}
+		auto matches = [&](std::size_t head, const FusionPattern<T> &pattern) {
+			const auto length = pattern.chain.size();
+			if (length == 0 || head + length > recorded)
+				return false;
+			for (std::size_t k = 0; k < length; ++k) {
+				const auto &node = nodes[head + k];
+				if (std::type_index(typeid(*node.op)) != pattern.chain[k])
+					return false;
+				if (k > 0 && (node.producers.empty() ||
+											node.producers.front() != head + k - 1 ||
+											consumers[head + k - 1] != 1))
+					return false;
+			}
+			return true;
+		};
+		for (std::size_t i = 0; i < recorded;) {
+			auto pattern = std::ranges::find_if(
+					patterns, [&](const auto &p) { return matches(i, p); });
+			if (pattern == patterns.end()) {
+				++i;
+				continue;
+			}
+			const auto tail = i + pattern->chain.size() - 1;
+			for (auto k = i; k <= tail; ++k) {
+				nodes[k].group_head = i;
+				nodes[k].group_tail = tail;
+				nodes[k].defer = pattern->defer_members;
+			}
+			nodes[tail].fused = pattern->make();
+			nodes[tail].fused->bind_allocator(&planner);
+			// Only the fused operation runs backward from now on.
+			for (auto k = i; k < tail; ++k)
+				nodes[k].op->release_stash();
+			i = tail + 1;
+		}
+	}
+
+	// Drops every group, first computing outputs that were deferred this step.
+	auto unfuse() -> void {
+		for (std::size_t i = 0; i < recorded; ++i) {
+			if (nodes[i].deferred && !nodes[i].held.empty())
+				materialize(i);
+		}
+		for (auto &node : nodes) {
+			node.fused.reset();
+			node.group_head = no_group;
+			node.group_tail = no_group;
+			node.defer = false;
+			node.held.clear();
+		}
+		fusion_scanned = false;
+	}
+
+	// Runs a deferred member's own operation. The result is copied into the
+	// placeholder so tensors already handed out see it.
+	auto materialize(std::size_t index) -> void {
+		auto &node = nodes[index];
+		if (node.held.empty())
+			throw std::logic_error(
+					"ExpressionGraph: a deferred output of a fused group was read "
+					"after the group ran.");
+		fused_inputs.assign(node.held.begin(), node.held.end());
+		const auto span = profile_begin(node);
+		auto result = node.op->forward(fused_inputs);
+		if (profiling())
+			profile_forward(index, span, fused_inputs, result);
+		*node.placeholder = *result.data;
+		node.output = Tensor<T>(node.placeholder);
+		node.deferred = false;
+	}
+
+	// Executes a group's fused operation in place of its last member, rewiring
+	// that node's inputs to the fused operation's so backward routes to them.
+	auto run_fused(std::size_t tail) -> Tensor<T> {
+		auto &node = nodes[tail];
+		const auto head = node.group_head;
+		fused_inputs.clear();
+		fused_pointers.clear();
+		fused_producers.clear();
+		for (auto m = head; m < tail; ++m) {
+			const auto &member = nodes[m];
+			for (std::size_t j = m == head ? 0 : 1; j < member.held.size(); ++j) {
+				fused_inputs.push_back(member.held[j]);
+				fused_pointers.push_back(member.inputs[j]);
+				fused_producers.push_back(member.producers[j]);
+			}
+		}
+		for (std::size_t j = 1; j < forward_inputs.size(); ++j) {
+			fused_inputs.push_back(forward_inputs[j]);
+			fused_pointers.push_back(node.inputs[j]);
+			fused_producers.push_back(node.producers[j]);
+		}
+		if (!node.defer) {
+			for (auto m = head; m < tail; ++m) {
+				fused_inputs.push_back(nodes[m].output);
+				fused_pointers.push_back(&nodes[m].output);
+				fused_producers.push_back(m);
+			}
+		}
+		for (std::size_t k = 0; k < fused_inputs.size(); ++k)
+			if (fused_inputs[k].get().window && !node.fused->reads_windows(k))
+				throw std::logic_error(
+						"ExpressionGraph: a fused operation must read row windows "
+						"wherever its members do.");
+		node.inputs.assign(fused_pointers.begin(), fused_pointers.end());
+		node.producers.assign(fused_producers.begin(), fused_producers.end());
+		node.fused->bind_allocator(&planner);
+		auto output = node.fused->forward(fused_inputs);
+		// The members' inputs were held for this; held any longer they would
+		// keep the planner from reusing those buffers.
+		for (auto m = head; m < tail; ++m)
+			nodes[m].held.clear();
+		return output;
+	}
+
+	// Constant false when profiling is compiled out, so the hooks vanish.
+	auto profiling() const -> bool { return profiling_compiled && profiler; }
+
+	struct Span {
+		std::uint64_t start{0};
+		std::size_t allocated{0};
+	};
+
+	auto profile_begin(const Node &node) const -> Span {
+		if (!profiling())
+			return {};
+		return {profiler->now(), executing(node).allocated_bytes()};
+	}
+
+	auto profile_event(std::size_t index, ProfilePhase phase,
+										 const Span &span) const -> ProfileEvent {
+		auto &node = nodes[index];
+		ProfileEvent e;
+		e.op = &typeid(executing(node));
+		e.phase = phase;
+		e.node = static_cast<std::int32_t>(index);
+		e.start_ns = span.start;
+		e.duration_ns = profiler->now() - span.start;
+		e.bytes = executing(node).allocated_bytes() - span.allocated;
+		return e;
+	}
+
+	auto profile_forward(std::size_t index, const Span &span,
+											 const std::vector<TensorRef> &inputs,
+											 const Tensor<T> &output) -> void {
+		auto e = profile_event(index, ProfilePhase::Forward, span);
+		auto &node = nodes[index];
+		node.flops = executing(node).flops(inputs);
+		e.flops = node.flops;
+		e.rows = static_cast<std::uint32_t>(output.data->n_rows);
+		e.cols = static_cast<std::uint32_t>(output.data->n_cols);
+		profiler->record(e);
+	}
+
+	// Backward costs about two forwards (one product per input) for the
+	// dense operations that dominate; a single input's task about one.
+	auto profile_backward(std::size_t index, const Span &span,
+												std::size_t input) -> void {
+		auto e = profile_event(index, ProfilePhase::Backward, span);
+		const auto &node = nodes[index];
+		e.flops = input == all_inputs ? 2 * node.flops : node.flops;
+		e.rows = static_cast<std::uint32_t>(node.grad.data->n_rows);
+		e.cols = static_cast<std::uint32_t>(node.grad.data->n_cols);
+		profiler->record(e);
+	}
+
+	// A row window the node's operation cannot read is gathered into a
+	// buffer kept with the node, which takes its place as the leaf.
+	auto readable(Node &node, std::size_t j, const Tensor<T> &input)
+			-> const Tensor<T> & {
+		if (!input.window || node.op->reads_windows(j))
+			return input;
+		if (node.gathered.size() <= j)
+			node.gathered.resize(j + 1);
+		auto &copy = node.gathered[j];
+		if (!copy)
+			copy = std::make_unique<Tensor<T>>(arma::Mat<T>());
+		copy->data->set_size(input.n_rows(), input.data->n_cols);
+		TensorView<T>(input).copy_to(copy->data->memptr());
+		copy->shape = input.shape;
+		return *copy;
+	}
+
+	// Linear scan from the most recent node: inputs are nearly always produced
+	// a few nodes earlier, and unlike a hash map this never allocates.
+	auto producer_of(const Tensor<T> &tensor) const -> std::size_t {
+		for (auto i = recorded; i-- > 0;) {
+			if (nodes[i].output.data == tensor.data)
+				return i;
+		}
+		return leaf;
+	}
+
+	static auto executing(const Node &node) -> Operation<T> & {
+		return node.fused ? *node.fused : *node.op;
+	}
+
+	// Where input j's gradient goes. The first contribution to a recorded
+	// node's gradient claims its buffer and overwrites it; later ones add.
+	// Leaves opt into gradients by owning a grad tensor (batches and targets
+	// do not) and are added to, except that the first write after a lazy
+	// `Tensor::zero_grad` overwrites.
+	auto gradient_target(Node &node, std::size_t j) -> GradientTarget<T> {
+		if (!executing(node).differentiable(j))
+			return {};
+		const auto producer = node.producers[j];
+		if (producer == leaf) {
+			const auto &grad = node.inputs[j]->grad;
+			if (!grad)
+				return {};
+			return {grad->data.get(), !std::exchange(grad->cleared, false)};
+		}
+		auto &target = nodes[producer];
+		if (target.has_grad)
+			return {target.grad.data.get(), true};
+		const auto rows = target.output.data->n_rows;
+		const auto cols = target.output.data->n_cols;
+		target.grad = executor ? target.accumulator.allocate(rows, cols)
+													 : planner.allocate_until(rows, cols, producer);
+		target.has_grad = true;
+		return {target.grad.data.get(), false};
+	}
+
+	// One node's backward. Operations that accumulate in place write
+	// straight into the inputs' gradients; the others return new buffers
+	// that are added in afterwards.
+	auto run_backward(std::size_t index) -> void {
+		auto &node = nodes[index];
+		auto &op = executing(node);
+		const auto span = profile_begin(node);
+		if (op.accumulates_in_place()) {
+			node.targets.resize(node.inputs.size());
+			for (std::size_t j = 0; j < node.inputs.size(); ++j)
+				node.targets[j] = gradient_target(node, j);
+			op.backward_into(node.grad, node.targets);
+			if (profiling())
+				profile_backward(index, span, all_inputs);
+			return;
+		}
+		node.grad_inputs.resize(node.inputs.size());
+		op.backward(node.grad, node.grad_inputs);
+		if (profiling())
+			profile_backward(index, span, all_inputs);
+		for (std::size_t j = 0; j < node.inputs.size(); ++j)
+			update_gradient(node, j);
+	}
+
+	auto update_gradient(Node &node, std::size_t j) -> void {
+		auto &grad = node.grad_inputs[j];
+		if (!grad.data)
+			return;
+		const auto started = profiling() ? profiler->now() : 0;
+		const auto target = gradient_target(node, j);
+		if (target.into && target.accumulate)
+			*target.into += *grad.data;
+		else if (target.into)
+			*target.into = *grad.data;
+		if (profiling()) {
+			ProfileEvent e;
+			e.label = "update_gradient";
+			e.phase = ProfilePhase::Accumulate;
+			e.node = static_cast<std::int32_t>(&node - nodes.data());
+			e.start_ns = started;
+			e.duration_ns = profiler->now() - started;
+			e.flops = target.accumulate ? grad.data->n_elem : 0;
+			e.bytes = target.accumulate ? 0 : grad.data->n_elem * sizeof(T);
+			e.rows = static_cast<std::uint32_t>(grad.data->n_rows);
+			e.cols = static_cast<std::uint32_t>(grad.data->n_cols);
+			profiler->record(e);
+		}
+		grad = Tensor<T>{};
+	}
+
+	auto wants_gradient(const Node &node, std::size_t j) const -> bool {
+		return node.producers[j] != leaf || node.inputs[j]->grad != nullptr;
+	}
+
+	// One task per input for separable operations, one for the whole node
+	// otherwise.
+	auto task_split(Node &node) -> bool {
+		return node.inputs.size() > 1 && executing(node).separable();
+	}
+
+	auto backward_task(std::size_t index, std::size_t input) -> void {
+		auto &node = nodes[index];
+		if (!node.has_grad)
+			return;
+		if (input == all_inputs) {
+			run_backward(index);
+			return;
+		}
+		const auto span = profile_begin(node);
+		executing(node).backward_input(input, node.grad,
+																	 gradient_target(node, input),
+																	 node.scratch[input]);
+		if (profiling())
+			profile_backward(index, span, input);
+	}
+
+	auto parallel_backward(std::size_t start, T seed) -> void {
+		needs_grad.assign(start + 1, false);
+		needs_grad[start] = true;
+		candidate_key.clear();
+		candidate_key.push_back(start);
+		for (auto i = start + 1; i-- > 0;) {
+			auto &node = nodes[i];
+			candidate_key.push_back(needs_grad[i]);
+			if (!needs_grad[i])
+				continue;
+			candidate_key.push_back(task_split(node));
+			candidate_key.push_back(node.inputs.size());
+			for (std::size_t j = 0; j < node.inputs.size(); ++j) {
+				const auto producer = node.producers[j];
+				if (producer != leaf)
+					needs_grad[producer] = true;
+				candidate_key.push_back(producer);
+				candidate_key.push_back(
+						producer == leaf && wants_gradient(node, j)
+								? reinterpret_cast<std::uintptr_t>(node.inputs[j])
+								: 0);
+			}
+		}
+		if (!schedule || candidate_key != schedule_key)
+			build_schedule(start);
+
+		for (std::size_t i = 0; i <= start; ++i) {
+			if (!needs_grad[i])
+				continue;
+			auto &node = nodes[i];
+			node.scratch.resize(node.inputs.size() + 1);
+			for (auto &cache : node.scratch)
+				cache.rewind();
+			node.accumulator.rewind();
+			node.grad_inputs.resize(node.inputs.size());
+			executing(node).bind_allocator(&node.scratch.back());
+		}
+		auto &root = nodes[start];
+		root.grad = root.accumulator.allocate(root.output.data->n_rows,
+																					root.output.data->n_cols);
+		root.grad.data->fill(seed);
+		root.has_grad = true;
+		executor->run(*schedule).wait();
+	}
+
+	// Walks the nodes in serial backward order so that the chain of writers
+	// into each gradient follows that order too.
+	auto build_schedule(std::size_t start) -> void {
+		schedule_key = candidate_key;
+		schedule = std::make_unique<tf::Taskflow>();
+		std::map<std::size_t, tf::Task> node_writer;
+		std::map<const Tensor<T> *, tf::Task> leaf_writer;
+		auto chain = [](auto &writers, auto key, tf::Task task) {
+			auto [it, inserted] = writers.try_emplace(key, task);
+			if (!inserted) {
+				if (it->second != task)
+					it->second.precede(task);
+				it->second = task;
+			}
+		};
+		for (auto i = start + 1; i-- > 0;) {
+			if (!needs_grad[i])
+				continue;
+			auto &node = nodes[i];
+			std::vector<std::pair<tf::Task, std::size_t>> node_tasks;
+			if (task_split(node)) {
+				for (std::size_t j = 0; j < node.inputs.size(); ++j) {
+					if (!wants_gradient(node, j))
+						continue;
+					auto task = schedule->emplace([this, i, j] { backward_task(i, j); });
+					task.name(std::to_string(i) + ":" + std::to_string(j));
+					node_tasks.emplace_back(task, j);
+				}
+			} else {
+				auto task =
+						schedule->emplace([this, i] { backward_task(i, all_inputs); });
+				task.name(std::to_string(i));
+				node_tasks.emplace_back(task, all_inputs);
+			}
+			if (auto writer = node_writer.find(i); writer != node_writer.end()) {
+				for (auto &[task, _] : node_tasks)
+					writer->second.precede(task);
+			}
+			for (auto &[task, input] : node_tasks) {
+				for (std::size_t j = 0; j < node.inputs.size(); ++j) {
+					if ((input != all_inputs && input != j) || !wants_gradient(node, j))
+						continue;
+					if (node.producers[j] != leaf)
+						chain(node_writer, node.producers[j], task);
+					else
+						chain(leaf_writer, node.inputs[j], task);
 				}
-				*inp_node.output.grad->data += *grad_outputs[j].data;
 			}
 		}
 	}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/shape.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ExGraf {
+
+/// Several matrices stored back to back, without padding, in one 64-byte
+/// aligned allocation. Each is handed out as an Armadillo view that keeps
+/// the allocation alive, so code sweeping every element (an optimizer step)
+/// can treat them as one contiguous range.
+template <AllowedTypes T> class FlatBuffer {
+	static constexpr std::size_t alignment_bytes = 64;
+	std::shared_ptr<T[]> storage;
+	std::vector<std::shared_ptr<arma::Mat<T>>> views;
+	std::size_t elements{0};
+
+public:
+	FlatBuffer() = default;
+	explicit FlatBuffer(std::span<const Shape> shapes) {
+		for (const auto &s : shapes)
+			elements += s.total_elements();
+		storage = std::shared_ptr<T[]>(
+				new (std::align_val_t{alignment_bytes})
+						T[std::max<std::size_t>(elements, 1)](),
+				[](T *p) {
+					::operator delete[](p, std::align_val_t{alignment_bytes});
+				});
+		place(shapes);
+	}
+
+	/// Lays the matrices out over `external` instead of allocating, e.g. a
+	/// mapped checkpoint; it must hold the shapes' elements back to back and
+	/// is released with the last view.
+	FlatBuffer(std::span<const Shape> shapes, std::shared_ptr<T[]> external)
+			: storage(std::move(external)) {
+		for (const auto &s : shapes)
+			elements += s.total_elements();
+		place(shapes);
+	}
+
+	auto view(std::size_t i) const -> std::shared_ptr<arma::Mat<T>> {
+		return views[i];
+	}
+	auto data() -> T * { return storage.get(); }
+	auto data() const -> const T * { return storage.get(); }
+	auto size() const -> std::size_t { return elements; }
+
+private:
+	auto place(std::span<const Shape> shapes) -> void {
+		std::size_t offset = 0;
+		for (const auto &s : shapes) {
+			const auto rows = s.rows(), cols = s.cols();
+			views.emplace_back(
+					new arma::Mat<T>(storage.get() + offset, rows, cols, false, true),
+					[keep = storage](arma::Mat<T> *m) { delete m; });
+			offset += rows * cols;
+		}
+	}
+};
+
+} // namespace ExGraf
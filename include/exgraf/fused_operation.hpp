@@ -0,0 +1,236 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/binary_operation.hpp"
+#include "exgraf/fusion.hpp"
+#include "exgraf/logger.hpp"
+#include "exgraf/operation.hpp"
+#include "exgraf/unary_operation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ExGraf::Fused {
+
+/// relu(x * W [+ b]) with the bias and activation applied in one pass over
+/// the product, so the pre-activation is never stored separately.
+/// Inputs: x, W and optionally a 1xN bias b. Keeps 16-bit copies of x and W
+/// under a 16-bit operand storage, as MatMulOp does, and of the output only
+/// which elements were positive, one bit each.
+template <AllowedTypes T> class LinearReLUOp : public Operation<T> {
+	Tensor<T> last_input, last_weights;
+	PackedMatrix<T> packed_input, packed_weights;
+	std::vector<std::uint64_t> positive;
+	std::size_t out_rows{0}, out_cols{0};
+	bool has_bias{false};
+	bool mixed{false};
+
+public:
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &x = inputs[0].get();
+		auto &w = inputs[1].get();
+		trace("[LinearReLUOp forward] x: {}x{}, W: {}x{}", x.n_rows(),
+					x.data->n_cols, w.n_rows(), w.data->n_cols);
+		const auto format = this->operand_storage();
+		mixed = format != Storage::FP32;
+		has_bias = inputs.size() > 2;
+		auto result = this->allocate(x.n_rows(), w.data->n_cols);
+		auto &y = *result.data;
+		if (mixed) {
+			pack_operand(x, packed_input, format);
+			pack_operand(w, packed_weights, format);
+			last_input = {};
+			last_weights = {};
+			gemm(packed_input, Transpose::No, packed_weights, Transpose::No, y);
+		} else {
+			packed_input = {};
+			packed_weights = {};
+			last_input = x;
+			last_weights = w;
+			matmul(TensorView<T>::matrix_of(x), TensorView<T>::matrix_of(w), y);
+		}
+		out_rows = y.n_rows;
+		out_cols = y.n_cols;
+		positive.assign((y.n_elem + 63) / 64, 0);
+		for (std::size_t c = 0; c < y.n_cols; ++c) {
+			const T shift = has_bias ? inputs[2].get().data->at(c) : T(0);
+			T *column = y.colptr(c);
+			for (std::size_t r = 0; r < out_rows; ++r) {
+				const T v = column[r] + shift;
+				const auto i = c * out_rows + r;
+				positive[i / 64] |= std::uint64_t{v > T(0)} << (i % 64);
+				column[r] = v > T(0) ? v : T(0);
+			}
+		}
+		return result;
+	}
+
+	/// The product plus one bias add and one max per output.
+	auto
+	flops(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			const -> std::size_t override {
+		const auto &x = inputs[0].get();
+		const auto outputs = x.n_rows() * inputs[1].get().data->n_cols;
+		return outputs * (2 * x.data->n_cols + 2);
+	}
+
+	/// x and W, as MatMulOp reads them.
+	auto reads_windows(std::size_t input) const -> bool override {
+		return input < 2;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		grad_inputs[0] = this->allocate(out_rows, in_features());
+		grad_inputs[1] = this->allocate(in_features(), out_cols);
+		GradientTarget<T> targets[3]{{grad_inputs[0].data.get()},
+																 {grad_inputs[1].data.get()}};
+		if (has_bias) {
+			grad_inputs[2] = this->allocate(1, grad_output.data->n_cols);
+			targets[2].into = grad_inputs[2].data.get();
+		}
+		backward_into(grad_output, {targets, has_bias ? 3u : 2u});
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
+		trace("[LinearReLUOp backward] grad_output: {}x{}",
+					grad_output.data->n_rows, grad_output.data->n_cols);
+		auto &g = *grad_output.data;
+		auto masked = this->allocate(g.n_rows, g.n_cols);
+		const T *gp = g.memptr();
+		T *dz = masked.data->memptr();
+		for (std::size_t i = 0; i < g.n_elem; ++i)
+			dz[i] = positive[i / 64] >> (i % 64) & 1 ? gp[i] : T(0);
+
+		const auto beta = [](const GradientTarget<T> &t) {
+			return t.accumulate ? T(1) : T(0);
+		};
+		if (mixed) {
+			auto &dz_bits = gradient_scratch<T>();
+			pack_operand(masked, dz_bits, packed_input.storage());
+			if (targets[0].into)
+				gemm(dz_bits, Transpose::No, packed_weights, Transpose::Yes,
+						 *targets[0].into, T(1), beta(targets[0]));
+			if (targets[1].into)
+				gemm(packed_input, Transpose::Yes, dz_bits, Transpose::No,
+						 *targets[1].into, T(1), beta(targets[1]));
+		} else {
+			const auto dz_view = TensorView<T>::matrix_of(masked);
+			if (targets[0].into)
+				matmul(dz_view, TensorView<T>::matrix_of(last_weights).transpose(),
+							 *targets[0].into, T(1), beta(targets[0]));
+			if (targets[1].into)
+				matmul(TensorView<T>::matrix_of(last_input).transpose(), dz_view,
+							 *targets[1].into, T(1), beta(targets[1]));
+		}
+		if (has_bias && targets[2].into)
+			store_gradient(targets[2], [&masked](std::size_t c) {
+				return column_sum(*masked.data, c);
+			});
+	}
+
+	auto stashed_bytes() const -> std::size_t override {
+		return packed_input.bytes() + packed_weights.bytes();
+	}
+
+private:
+	auto in_features() const -> std::size_t {
+		return mixed ? packed_weights.n_rows() : last_weights.n_rows();
+	}
+};
+
+/// Cross entropy of softmax(z) against one-hot targets.
+///
+/// Inputs: logits z, targets y and the probabilities SoftmaxOp already
+/// computed for z. The gradient goes straight to the logits as (p - y) / n,
+/// so neither SoftmaxOp's nor CrossEntropyLoss's backward runs.
+template <AllowedTypes T> class SoftmaxCrossEntropyOp : public Operation<T> {
+	Tensor<T> last_probabilities, last_target;
+	T eps = T(1e-12);
+
+public:
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &target = inputs[1].get();
+		auto &probabilities = inputs[2].get();
+		trace("[SoftmaxCrossEntropyOp forward] probabilities: {}x{}",
+					probabilities.data->n_rows, probabilities.data->n_cols);
+		last_probabilities = probabilities;
+		last_target = target;
+		const T *p = probabilities.data->memptr();
+		const T *y = target.origin();
+		T loss = T(0);
+		for (std::size_t i = 0; i < probabilities.data->n_elem; ++i) {
+			const T yi = y[window_offset(target, i)];
+			if (yi != T(0))
+				loss -= yi * std::log(std::max(p[i], eps));
+		}
+		auto result = this->allocate(1, 1);
+		result.data->at(0) = loss / probabilities.data->n_rows;
+		return result;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		const auto &p = *last_probabilities.data;
+		grad_inputs[0] = this->allocate(p.n_rows, p.n_cols);
+		const GradientTarget<T> targets[]{{grad_inputs[0].data.get()}, {}, {}};
+		backward_into(grad_output, targets);
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+	/// Only the logits: targets are constants, and the probabilities' own
+	/// gradient is already folded into the logits'.
+	auto differentiable(std::size_t input) const -> bool override {
+		return input == 0;
+	}
+	/// Targets, as CrossEntropyLoss reads them.
+	auto reads_windows(std::size_t input) const -> bool override {
+		return input == 1;
+	}
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
+		if (!targets[0].into)
+			return;
+		const auto &p = *last_probabilities.data;
+		const T scale = grad_output.data->at(0) / p.n_rows;
+		const T *pp = p.memptr();
+		const T *y = last_target.origin();
+		store_gradient(targets[0], [&](std::size_t i) {
+			return (pp[i] - y[window_offset(last_target, i)]) * scale;
+		});
+	}
+};
+
+/// The patterns Model enables: Linear+ReLU with and without a bias, and
+/// Softmax+CrossEntropy. Longer chains come first so they win over their
+/// prefixes.
+template <AllowedTypes T>
+auto default_patterns() -> std::vector<FusionPattern<T>> {
+	auto linear_relu = [] { return std::make_shared<LinearReLUOp<T>>(); };
+	return {
+			{{typeid(Binary::MatMulOp<T>), typeid(Binary::AddBiasOp<T>),
+				typeid(Unary::ReLUOp<T>)},
+			 true,
+			 linear_relu},
+			{{typeid(Binary::MatMulOp<T>), typeid(Unary::ReLUOp<T>)},
+			 true,
+			 linear_relu},
+			{{typeid(Unary::SoftmaxOp<T>), typeid(Binary::CrossEntropyLoss<T>)},
+			 false,
+			 [] { return std::make_shared<SoftmaxCrossEntropyOp<T>>(); }},
+	};
+}
+
+} // namespace ExGraf::Fused
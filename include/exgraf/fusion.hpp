@@ -0,0 +1,31 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/operation.hpp"
+
+#include <functional>
+#include <memory>
+#include <typeindex>
+#include <vector>
+
+namespace ExGraf {
+
+/// A chain of operations that ExpressionGraph may replace with one fused
+/// operation once it has seen the chain recorded.
+///
+/// Member `k > 0` of the chain must take member `k - 1`'s output as its first
+/// input and be its only consumer. The fused operation receives the head's
+/// inputs followed by the remaining inputs of every later member, in order,
+/// and must produce gradients for exactly those.
+template <AllowedTypes T> struct FusionPattern {
+	std::vector<std::type_index> chain;
+	/// Deferred members do not run at all: their outputs are only computed if
+	/// something outside the chain reads them. Otherwise the members run as
+	/// recorded, their outputs are appended to the fused operation's inputs
+	/// (no gradient is expected for those), and fusion only shortcuts the
+	/// backward pass.
+	bool defer_members;
+	std::function<std::shared_ptr<Operation<T>>()> make;
+};
+
+} // namespace ExGraf
@@ -0,0 +1,350 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/gemm_kernels.hpp"
+#include "exgraf/half.hpp"
+
+#include <armadillo>
+#include <taskflow/taskflow.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ExGraf {
+
+enum class Transpose : bool { No, Yes };
+
+/// Computes c = alpha * op(a) * op(b) + beta * c, where op transposes its
+/// operand when the flag says so. Operands are read in place, so a
+/// transposed product never materializes a transpose. With beta zero, c is
+/// resized to the product and its old contents ignored; otherwise it must
+/// already have the product's shape. c must not share storage with a or b.
+template <AllowedTypes T> class GemmBackend {
+public:
+	virtual ~GemmBackend() = default;
+
+	virtual auto name() const -> std::string_view = 0;
+
+	auto gemm(const arma::Mat<T> &a, Transpose ta, const arma::Mat<T> &b,
+						Transpose tb, arma::Mat<T> &c, T alpha = T(1), T beta = T(0))
+			-> void {
+		const bool trans_a = ta == Transpose::Yes, trans_b = tb == Transpose::Yes;
+		const auto m = trans_a ? a.n_cols : a.n_rows;
+		const auto k = trans_a ? a.n_rows : a.n_cols;
+		const auto n = trans_b ? b.n_rows : b.n_cols;
+		if ((trans_b ? b.n_cols : b.n_rows) != k)
+			throw std::invalid_argument("gemm: operands are not conformant.");
+		if (beta == T(0))
+			c.set_size(m, n);
+		else if (c.n_rows != m || c.n_cols != n)
+			throw std::invalid_argument(
+					"gemm: accumulating into an output of the wrong shape.");
+		if (c.n_elem != 0 && (c.memptr() == a.memptr() || c.memptr() == b.memptr()))
+			throw std::invalid_argument("gemm: the output aliases an operand.");
+		run({.trans_a = trans_a,
+				 .trans_b = trans_b,
+				 .m = m,
+				 .n = n,
+				 .k = k,
+				 .alpha = alpha,
+				 .a = a.memptr(),
+				 .lda = a.n_rows,
+				 .b = b.memptr(),
+				 .ldb = b.n_rows,
+				 .beta = beta,
+				 .c = c.memptr(),
+				 .ldc = c.n_rows},
+				a, b, c);
+	}
+
+	/// The same product on storage described directly by `g`, so operands
+	/// with any column stride are read in place: rows [r0, r1) of an
+	/// m-row matrix are the operand at `memptr() + r0` with stride m. A and
+	/// B may be 16-bit (see GemmArgs). C must already have the product's
+	/// shape and must not share storage with A or B.
+	auto gemm(const Kernels::GemmArgs<T> &g) -> void {
+		const auto stored = [](bool trans, std::size_t rows, std::size_t cols) {
+			return std::max<std::size_t>(1, trans ? cols : rows);
+		};
+		if (g.lda < stored(g.trans_a, g.m, g.k) ||
+				g.ldb < stored(g.trans_b, g.k, g.n) || g.ldc < stored(false, g.m, g.n))
+			throw std::invalid_argument(
+					"gemm: a column stride is shorter than its column.");
+		if (g.m * g.n != 0 && (g.c == g.a || g.c == g.b))
+			throw std::invalid_argument("gemm: the output aliases an operand.");
+		run_strided(g);
+	}
+
+protected:
+	/// `g` describes the checked product on the matrices' storage; the
+	/// matrices themselves are passed along for backends that want them.
+	virtual auto run(const Kernels::GemmArgs<T> &g, const arma::Mat<T> &a,
+									 const arma::Mat<T> &b, arma::Mat<T> &c) -> void = 0;
+
+	/// Runs a product whose operands may be strided or 16-bit. By default
+	/// operands stored densely are wrapped as they are, and strided or
+	/// 16-bit ones are gathered into T for `run`, with a gathered C
+	/// scattered back afterwards.
+	virtual auto run_strided(const Kernels::GemmArgs<T> &g) -> void {
+		const auto wrap = [](const T *p, const std::uint16_t *bits,
+												 Storage storage, std::size_t rows, std::size_t cols,
+												 std::size_t ld, bool read) {
+			if (storage == Storage::FP32 && (ld == rows || cols <= 1))
+				return arma::Mat<T>(const_cast<T *>(p), rows, cols, false, true);
+			arma::Mat<T> gathered(rows, cols);
+			for (std::size_t c = 0; read && c < cols; ++c) {
+				if (storage == Storage::FP32)
+					std::copy_n(p + c * ld, rows, gathered.colptr(c));
+				else
+					Kernels::unpack(bits + c * ld, rows, gathered.colptr(c), storage);
+			}
+			return gathered;
+		};
+		const auto a = wrap(g.a, g.a_bits, g.a_storage, g.trans_a ? g.k : g.m,
+												g.trans_a ? g.m : g.k, g.lda, true);
+		const auto b = wrap(g.b, g.b_bits, g.b_storage, g.trans_b ? g.n : g.k,
+												g.trans_b ? g.k : g.n, g.ldb, true);
+		auto c = wrap(g.c, nullptr, Storage::FP32, g.m, g.n, g.ldc,
+									g.beta != T(0));
+		auto dense = g;
+		dense.a = a.memptr();
+		dense.lda = a.n_rows;
+		dense.b = b.memptr();
+		dense.ldb = b.n_rows;
+		dense.a_storage = dense.b_storage = Storage::FP32;
+		dense.a_bits = dense.b_bits = nullptr;
+		dense.c = c.memptr();
+		dense.ldc = c.n_rows;
+		run(dense, a, b, c);
+		if (c.memptr() != g.c)
+			for (std::size_t j = 0; j < g.n; ++j)
+				std::copy_n(c.colptr(j), g.m, g.c + j * g.ldc);
+	}
+};
+
+/// Armadillo's products, and so whatever BLAS it was linked against.
+template <AllowedTypes T> class ArmadilloGemm : public GemmBackend<T> {
+public:
+	auto name() const -> std::string_view override { return "armadillo"; }
+
+protected:
+	auto run(const Kernels::GemmArgs<T> &g, const arma::Mat<T> &a,
+					 const arma::Mat<T> &b, arma::Mat<T> &c) -> void override {
+		// Armadillo folds op(a) * op(b) into one BLAS call with the flags.
+		const auto apply = [&](const auto &product) {
+			if (g.beta == T(0)) {
+				c = product;
+				if (g.alpha != T(1))
+					c *= g.alpha;
+				return;
+			}
+			if (g.beta != T(1))
+				c *= g.beta;
+			if (g.alpha == T(1))
+				c += product;
+			else
+				c += g.alpha * product;
+		};
+		if (g.trans_a && g.trans_b)
+			apply(a.t() * b.t());
+		else if (g.trans_a)
+			apply(a.t() * b);
+		else if (g.trans_b)
+			apply(a * b.t());
+		else
+			apply(a * b);
+	}
+};
+
+/// The in-tree packed, cache-blocked kernel (Kernels::gemm_blocked).
+///
+/// Products of at least `parallel_flops` run on an executor of its own,
+/// split into one contiguous range of C's rows or columns per thread, cut
+/// on micro-tile boundaries. The executor is private so a product issued
+/// from inside a graph's or trainer's task cannot wait on its own pool.
+/// One product at a time uses it; a concurrent caller runs serially on its
+/// own thread rather than queueing.
+template <AllowedTypes T> class BlockedGemm : public GemmBackend<T> {
+public:
+	static constexpr std::size_t parallel_flops = std::size_t{1} << 22;
+
+	/// `thread_count` 0 uses one per hardware thread; 1 never spawns any.
+	explicit BlockedGemm(std::size_t thread_count = 0, Isa isa = detect_isa())
+			: isa(isa), threads(thread_count) {
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		if (!isa_supported(isa))
+			throw std::invalid_argument(
+					"BlockedGemm: the instruction set is not supported here.");
+		parts.resize(threads);
+	}
+
+	auto name() const -> std::string_view override { return "blocked"; }
+	auto thread_count() const -> std::size_t { return threads; }
+
+protected:
+	auto run(const Kernels::GemmArgs<T> &g, const arma::Mat<T> &,
+					 const arma::Mat<T> &, arma::Mat<T> &) -> void override {
+		multiply(g);
+	}
+
+	/// The packing reads any stride and widens 16-bit operands, so nothing
+	/// is gathered.
+	auto run_strided(const Kernels::GemmArgs<T> &g) -> void override {
+		multiply(g);
+	}
+
+private:
+	Isa isa;
+	std::size_t threads;
+	std::mutex busy;
+	std::unique_ptr<tf::Executor> executor;
+	std::unique_ptr<tf::Taskflow> schedule;
+	// The product in flight, one part per task, read by the cached tasks.
+	std::vector<Kernels::GemmArgs<T>> parts;
+	std::size_t active{0};
+
+	auto multiply(const Kernels::GemmArgs<T> &g) -> void {
+		if (threads < 2 || 2 * g.m * g.n * g.k < parallel_flops) {
+			Kernels::gemm_blocked(g, isa);
+			return;
+		}
+		std::unique_lock lock(busy, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			Kernels::gemm_blocked(g, isa);
+			return;
+		}
+		split(g);
+		if (!executor)
+			executor = std::make_unique<tf::Executor>(threads);
+		if (!schedule) {
+			schedule = std::make_unique<tf::Taskflow>();
+			for (std::size_t i = 0; i < threads; ++i)
+				schedule->emplace([this, i] {
+					if (i < active)
+						Kernels::gemm_blocked(parts[i], isa);
+				});
+		}
+		executor->run(*schedule).wait();
+	}
+
+	// Wide products split by columns, tall ones by rows, so every part
+	// still packs whole panels of the shared operand.
+	auto split(const Kernels::GemmArgs<T> &g) -> void {
+		const bool by_columns = g.n >= g.m;
+		const auto extent = by_columns ? g.n : g.m;
+		const auto unit = by_columns ? Kernels::gemm_nr : Kernels::gemm_mr<T>;
+		const auto units = (extent + unit - 1) / unit;
+		active = std::min(threads, units);
+		for (std::size_t i = 0; i < active; ++i) {
+			const auto first = std::min(extent, units * i / active * unit);
+			const auto last = std::min(extent, units * (i + 1) / active * unit);
+			parts[i] = by_columns ? g.columns(first, last) : g.rows(first, last);
+		}
+	}
+};
+
+namespace Detail {
+
+template <AllowedTypes T>
+auto default_gemm_backend() -> std::shared_ptr<GemmBackend<T>> {
+	if (const char *choice = std::getenv("EXGRAF_GEMM")) {
+		const std::string_view name(choice);
+		if (name == "blocked")
+			return std::make_shared<BlockedGemm<T>>();
+		if (name == "armadillo")
+			return std::make_shared<ArmadilloGemm<T>>();
+		if (!name.empty())
+			throw std::invalid_argument(
+					"EXGRAF_GEMM must be \"blocked\" or \"armadillo\", not \"" +
+					std::string(name) + "\".");
+	}
+	// The blocked kernel only beats a tuned BLAS with its SIMD micro-kernel.
+	if (detect_isa() == Isa::AVX2)
+		return std::make_shared<BlockedGemm<T>>();
+	return std::make_shared<ArmadilloGemm<T>>();
+}
+
+template <AllowedTypes T>
+auto gemm_backend_slot() -> std::shared_ptr<GemmBackend<T>> & {
+	static std::shared_ptr<GemmBackend<T>> backend = default_gemm_backend<T>();
+	return backend;
+}
+
+} // namespace Detail
+
+/// The backend every matrix product in the library goes through. Chosen on
+/// first use: the `EXGRAF_GEMM` environment variable ("blocked" or
+/// "armadillo") if set, otherwise the blocked kernel when the CPU has AVX2
+/// and FMA and Armadillo's BLAS when it does not.
+template <AllowedTypes T> auto gemm_backend() -> GemmBackend<T> & {
+	return *Detail::gemm_backend_slot<T>();
+}
+
+/// Replaces the backend; nullptr restores the default choice. Not safe
+/// while products are running on other threads.
+template <AllowedTypes T>
+auto set_gemm_backend(std::shared_ptr<GemmBackend<T>> backend) -> void {
+	Detail::gemm_backend_slot<T>() =
+			backend ? std::move(backend) : Detail::default_gemm_backend<T>();
+}
+
+/// c = alpha * op(a) * op(b) + beta * c on the current backend.
+template <AllowedTypes T>
+auto gemm(const arma::Mat<T> &a, Transpose ta, const arma::Mat<T> &b,
+					Transpose tb, arma::Mat<T> &c, T alpha = T(1), T beta = T(0))
+		-> void {
+	gemm_backend<T>().gemm(a, ta, b, tb, c, alpha, beta);
+}
+
+/// The strided product `g` on the current backend.
+template <AllowedTypes T> auto gemm(const Kernels::GemmArgs<T> &g) -> void {
+	gemm_backend<T>().gemm(g);
+}
+
+/// c = alpha * op(a) * op(b) + beta * c for 16-bit operands, widened to T
+/// as the backend reads them, so the sums accumulate in T. c is sized as
+/// in the arma::Mat overload.
+template <AllowedTypes T>
+auto gemm(const PackedMatrix<T> &a, Transpose ta, const PackedMatrix<T> &b,
+					Transpose tb, arma::Mat<T> &c, T alpha = T(1), T beta = T(0))
+		-> void {
+	const bool trans_a = ta == Transpose::Yes, trans_b = tb == Transpose::Yes;
+	const auto m = trans_a ? a.n_cols() : a.n_rows();
+	const auto k = trans_a ? a.n_rows() : a.n_cols();
+	const auto n = trans_b ? b.n_rows() : b.n_cols();
+	if ((trans_b ? b.n_cols() : b.n_rows()) != k)
+		throw std::invalid_argument("gemm: operands are not conformant.");
+	if (beta == T(0))
+		c.set_size(m, n);
+	else if (c.n_rows != m || c.n_cols != n)
+		throw std::invalid_argument(
+				"gemm: accumulating into an output of the wrong shape.");
+	gemm<T>({.trans_a = trans_a,
+					 .trans_b = trans_b,
+					 .m = m,
+					 .n = n,
+					 .k = k,
+					 .alpha = alpha,
+					 .lda = std::max<std::size_t>(a.n_rows(), 1),
+					 .ldb = std::max<std::size_t>(b.n_rows(), 1),
+					 .beta = beta,
+					 .c = c.memptr(),
+					 .ldc = std::max<std::size_t>(m, 1),
+					 .a_storage = a.storage(),
+					 .b_storage = b.storage(),
+					 .a_bits = a.data(),
+					 .b_bits = b.data()});
+}
+
+} // namespace ExGraf
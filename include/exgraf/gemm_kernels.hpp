@@ -0,0 +1,309 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/half.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if EXGRAF_X86
+#include <immintrin.h>
+#endif
+
+namespace ExGraf::Kernels {
+
+/// C = alpha * op(A) * op(B) + beta * C on column-major storage, BLAS
+/// style: C is m x n, op(A) is m x k and op(B) is k x n, where op transposes
+/// when the flag is set. `ld*` are the column strides. With beta zero C is
+/// never read, so it may hold garbage.
+///
+/// A or B may instead be 16-bit (`a_storage`/`b_storage` BF16 or FP16, read
+/// from `a_bits`/`b_bits` in the same layout): packing widens it to T, so
+/// the product still accumulates in T.
+template <AllowedTypes T> struct GemmArgs {
+	bool trans_a{false}, trans_b{false};
+	std::size_t m{0}, n{0}, k{0};
+	T alpha{1};
+	const T *a{nullptr};
+	std::size_t lda{0};
+	const T *b{nullptr};
+	std::size_t ldb{0};
+	T beta{0};
+	T *c{nullptr};
+	std::size_t ldc{0};
+	Storage a_storage{Storage::FP32}, b_storage{Storage::FP32};
+	const std::uint16_t *a_bits{nullptr}, *b_bits{nullptr};
+
+	/// The same product restricted to rows [first, last) of C.
+	auto rows(std::size_t first, std::size_t last) const -> GemmArgs {
+		auto part = *this;
+		part.m = last - first;
+		const auto offset = trans_a ? first * lda : first;
+		part.a = a ? a + offset : a;
+		part.a_bits = a_bits ? a_bits + offset : a_bits;
+		part.c = c + first;
+		return part;
+	}
+	/// The same product restricted to columns [first, last) of C.
+	auto columns(std::size_t first, std::size_t last) const -> GemmArgs {
+		auto part = *this;
+		part.n = last - first;
+		const auto offset = trans_b ? first : first * ldb;
+		part.b = b ? b + offset : b;
+		part.b_bits = b_bits ? b_bits + offset : b_bits;
+		part.c = c + first * ldc;
+		return part;
+	}
+};
+
+namespace Detail {
+
+// Cache blocking: a kc x nc slab of op(B) is packed once and reused by every
+// mc x kc block of op(A), which is sized to stay in L2; the micro-kernel
+// streams one MR-row sliver of A against one NR-column sliver of B (in L1)
+// into an MR x NR register tile.
+inline constexpr std::size_t gemm_kc = 256;
+inline constexpr std::size_t gemm_mc = 144;
+inline constexpr std::size_t gemm_nc_panels = 512;
+
+// n contiguous elements of an operand from `offset` on: read in place, or
+// widened into `scratch` when the operand is 16-bit.
+template <AllowedTypes T>
+auto source(const T *values, const std::uint16_t *bits, Storage storage,
+						std::size_t offset, std::size_t n, T *scratch) -> const T * {
+	if (storage == Storage::FP32)
+		return values + offset;
+	unpack(bits + offset, n, scratch, storage);
+	return scratch;
+}
+
+// Slivers of MR rows, each stored depth-major (MR values per depth step);
+// rows past the edge are zero so the micro-kernel never branches.
+template <std::size_t MR, AllowedTypes T>
+auto pack_a(const GemmArgs<T> &g, std::size_t ic, std::size_t mc,
+						std::size_t pc, std::size_t kc, T *out) -> void {
+	T scratch[gemm_kc];
+	for (std::size_t ir = 0; ir < mc; ir += MR) {
+		const auto rows = std::min(MR, mc - ir);
+		T *sliver = out + ir * kc;
+		if (!g.trans_a) {
+			for (std::size_t l = 0; l < kc; ++l) {
+				T *dst = sliver + l * MR;
+				const T *column = source(g.a, g.a_bits, g.a_storage,
+																 ic + ir + (pc + l) * g.lda, rows, dst);
+				if (column != dst)
+					for (std::size_t i = 0; i < rows; ++i)
+						dst[i] = column[i];
+				for (std::size_t i = rows; i < MR; ++i)
+					dst[i] = T(0);
+			}
+			continue;
+		}
+		for (std::size_t i = 0; i < MR; ++i) {
+			if (i >= rows) {
+				for (std::size_t l = 0; l < kc; ++l)
+					sliver[l * MR + i] = T(0);
+				continue;
+			}
+			const T *row = source(g.a, g.a_bits, g.a_storage,
+														pc + (ic + ir + i) * g.lda, kc, scratch);
+			for (std::size_t l = 0; l < kc; ++l)
+				sliver[l * MR + i] = row[l];
+		}
+	}
+}
+
+// Slivers of NR columns, each stored depth-major; zero past the edge.
+template <std::size_t NR, AllowedTypes T>
+auto pack_b(const GemmArgs<T> &g, std::size_t pc, std::size_t kc,
+						std::size_t jc, std::size_t nc, T *out) -> void {
+	T scratch[gemm_kc];
+	for (std::size_t jr = 0; jr < nc; jr += NR) {
+		const auto cols = std::min(NR, nc - jr);
+		T *sliver = out + jr * kc;
+		if (g.trans_b) {
+			for (std::size_t l = 0; l < kc; ++l) {
+				T *dst = sliver + l * NR;
+				const T *row = source(g.b, g.b_bits, g.b_storage,
+															jc + jr + (pc + l) * g.ldb, cols, dst);
+				if (row != dst)
+					for (std::size_t j = 0; j < cols; ++j)
+						dst[j] = row[j];
+				for (std::size_t j = cols; j < NR; ++j)
+					dst[j] = T(0);
+			}
+			continue;
+		}
+		for (std::size_t j = 0; j < NR; ++j) {
+			if (j >= cols) {
+				for (std::size_t l = 0; l < kc; ++l)
+					sliver[l * NR + j] = T(0);
+				continue;
+			}
+			const T *column = source(g.b, g.b_bits, g.b_storage,
+															 pc + (jc + jr + j) * g.ldb, kc, scratch);
+			for (std::size_t l = 0; l < kc; ++l)
+				sliver[l * NR + j] = column[l];
+		}
+	}
+}
+
+// The MR x NR tile (column-major) of one packed A sliver times one packed
+// B sliver.
+template <AllowedTypes T, std::size_t MR, std::size_t NR>
+auto micro_scalar(std::size_t kc, const T *a, const T *b, T *tile) -> void {
+	T acc[MR * NR] = {};
+	for (std::size_t l = 0; l < kc; ++l) {
+		const T *al = a + l * MR;
+		const T *bl = b + l * NR;
+		for (std::size_t j = 0; j < NR; ++j)
+			for (std::size_t i = 0; i < MR; ++i)
+				acc[j * MR + i] += al[i] * bl[j];
+	}
+	std::copy_n(acc, MR * NR, tile);
+}
+
+#if EXGRAF_X86
+// 16 x 6 floats: twelve accumulators, two A loads and one broadcast per
+// column, which fills the sixteen ymm registers.
+__attribute__((target("avx2,fma"))) inline auto
+micro_avx2(std::size_t kc, const float *a, const float *b, float *tile)
+		-> void {
+	__m256 c[6][2];
+#pragma GCC unroll 6
+	for (int j = 0; j < 6; ++j)
+		c[j][0] = c[j][1] = _mm256_setzero_ps();
+	for (std::size_t l = 0; l < kc; ++l) {
+		const __m256 a0 = _mm256_loadu_ps(a + l * 16);
+		const __m256 a1 = _mm256_loadu_ps(a + l * 16 + 8);
+#pragma GCC unroll 6
+		for (int j = 0; j < 6; ++j) {
+			const __m256 bj = _mm256_broadcast_ss(b + l * 6 + j);
+			c[j][0] = _mm256_fmadd_ps(a0, bj, c[j][0]);
+			c[j][1] = _mm256_fmadd_ps(a1, bj, c[j][1]);
+		}
+	}
+#pragma GCC unroll 6
+	for (int j = 0; j < 6; ++j) {
+		_mm256_storeu_ps(tile + j * 16, c[j][0]);
+		_mm256_storeu_ps(tile + j * 16 + 8, c[j][1]);
+	}
+}
+
+// 8 x 6 doubles, the same shape in 256-bit lanes of four.
+__attribute__((target("avx2,fma"))) inline auto
+micro_avx2(std::size_t kc, const double *a, const double *b, double *tile)
+		-> void {
+	__m256d c[6][2];
+#pragma GCC unroll 6
+	for (int j = 0; j < 6; ++j)
+		c[j][0] = c[j][1] = _mm256_setzero_pd();
+	for (std::size_t l = 0; l < kc; ++l) {
+		const __m256d a0 = _mm256_loadu_pd(a + l * 8);
+		const __m256d a1 = _mm256_loadu_pd(a + l * 8 + 4);
+#pragma GCC unroll 6
+		for (int j = 0; j < 6; ++j) {
+			const __m256d bj = _mm256_broadcast_sd(b + l * 6 + j);
+			c[j][0] = _mm256_fmadd_pd(a0, bj, c[j][0]);
+			c[j][1] = _mm256_fmadd_pd(a1, bj, c[j][1]);
+		}
+	}
+#pragma GCC unroll 6
+	for (int j = 0; j < 6; ++j) {
+		_mm256_storeu_pd(tile + j * 8, c[j][0]);
+		_mm256_storeu_pd(tile + j * 8 + 4, c[j][1]);
+	}
+}
+#endif
+
+template <AllowedTypes T>
+auto scale(const GemmArgs<T> &g, T factor) -> void {
+	for (std::size_t j = 0; j < g.n; ++j) {
+		T *column = g.c + j * g.ldc;
+		for (std::size_t i = 0; i < g.m; ++i)
+			column[i] = factor == T(0) ? T(0) : column[i] * factor;
+	}
+}
+
+template <AllowedTypes T, std::size_t MR, std::size_t NR, typename Micro>
+auto gemm_driver(const GemmArgs<T> &g, Micro micro) -> void {
+	constexpr std::size_t nc_max = NR * gemm_nc_panels;
+	static_assert(gemm_mc % MR == 0);
+	// Grown once per thread; a steady-state call does not allocate.
+	thread_local std::vector<T> packed_a, packed_b;
+	if (packed_a.size() < gemm_mc * gemm_kc)
+		packed_a.resize(gemm_mc * gemm_kc);
+	if (packed_b.size() < nc_max * gemm_kc)
+		packed_b.resize(nc_max * gemm_kc);
+
+	T tile[MR * NR];
+	for (std::size_t jc = 0; jc < g.n; jc += nc_max) {
+		const auto nc = std::min(nc_max, g.n - jc);
+		for (std::size_t pc = 0; pc < g.k; pc += gemm_kc) {
+			const auto kc = std::min(gemm_kc, g.k - pc);
+			// Later depth blocks add to what the first one wrote.
+			const T beta = pc == 0 ? g.beta : T(1);
+			pack_b<NR>(g, pc, kc, jc, nc, packed_b.data());
+			for (std::size_t ic = 0; ic < g.m; ic += gemm_mc) {
+				const auto mc = std::min(gemm_mc, g.m - ic);
+				pack_a<MR>(g, ic, mc, pc, kc, packed_a.data());
+				for (std::size_t jr = 0; jr < nc; jr += NR) {
+					const auto cols = std::min(NR, nc - jr);
+					for (std::size_t ir = 0; ir < mc; ir += MR) {
+						const auto rows = std::min(MR, mc - ir);
+						micro(kc, packed_a.data() + ir * kc, packed_b.data() + jr * kc,
+									tile);
+						T *c = g.c + (ic + ir) + (jc + jr) * g.ldc;
+						for (std::size_t j = 0; j < cols; ++j) {
+							T *column = c + j * g.ldc;
+							const T *t = tile + j * MR;
+							if (beta == T(0)) {
+								for (std::size_t i = 0; i < rows; ++i)
+									column[i] = g.alpha * t[i];
+							} else {
+								for (std::size_t i = 0; i < rows; ++i)
+									column[i] = beta * column[i] + g.alpha * t[i];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+} // namespace Detail
+
+/// Register tile of the micro-kernel `gemm_blocked` uses for T: 16 x 6
+/// floats or 8 x 6 doubles.
+template <AllowedTypes T>
+inline constexpr std::size_t gemm_mr = std::is_same_v<T, float> ? 16 : 8;
+inline constexpr std::size_t gemm_nr = 6;
+
+/// Single-threaded packed, cache-blocked GEMM (see GemmArgs).
+template <AllowedTypes T>
+auto gemm_blocked(const GemmArgs<T> &g, Isa isa = detect_isa()) -> void {
+	if (g.m == 0 || g.n == 0)
+		return;
+	if (g.k == 0 || g.alpha == T(0)) {
+		Detail::scale(g, g.beta);
+		return;
+	}
+	constexpr auto mr = gemm_mr<T>, nr = gemm_nr;
+#if EXGRAF_X86
+	if (isa == Isa::AVX2) {
+		Detail::gemm_driver<T, mr, nr>(
+				g, [](std::size_t kc, const T *a, const T *b, T *tile) {
+					Detail::micro_avx2(kc, a, b, tile);
+				});
+		return;
+	}
+#endif
+	Detail::gemm_driver<T, mr, nr>(g, Detail::micro_scalar<T, mr, nr>);
+}
+
+} // namespace ExGraf::Kernels
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/cpu_features.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if EXGRAF_X86
+#include <immintrin.h>
+#endif
+
+namespace ExGraf {
+
+/// Element format data is kept in. Compute always happens in the tensor's
+/// own type; the 16-bit formats are storage only, widened back to it where
+/// they are read (by GEMM packing, for mixed precision).
+enum class Storage : std::uint8_t { FP32, BF16, FP16 };
+
+/// Bit patterns of the two 16-bit formats. Neither does arithmetic: values
+/// are converted to float to be used.
+struct BFloat16 {
+	std::uint16_t bits;
+};
+struct Half {
+	std::uint16_t bits;
+};
+
+/// Round to nearest even; NaNs stay (quiet) NaNs.
+inline auto to_bfloat16(float value) -> BFloat16 {
+	const auto bits = std::bit_cast<std::uint32_t>(value);
+	if ((bits & 0x7fffffffU) > 0x7f800000U)
+		return {static_cast<std::uint16_t>((bits >> 16) | 0x40U)};
+	const auto rounding = 0x7fffU + ((bits >> 16) & 1U);
+	return {static_cast<std::uint16_t>((bits + rounding) >> 16)};
+}
+
+inline auto to_float(BFloat16 value) -> float {
+	return std::bit_cast<float>(std::uint32_t(value.bits) << 16);
+}
+
+/// Round to nearest even with subnormals, overflow to infinity and NaNs
+/// handled as F16C's vcvtps2ph does: quieted, keeping the sign and the top
+/// of the payload.
+inline auto to_half(float value) -> Half {
+	constexpr std::uint32_t f32_infinity = 255U << 23;
+	constexpr std::uint32_t f16_overflow = (127U + 16) << 23;
+	constexpr std::uint32_t denormal_magic = ((127U - 15) + (23 - 10) + 1)
+																					 << 23;
+	auto bits = std::bit_cast<std::uint32_t>(value);
+	const auto sign = bits & 0x80000000U;
+	bits ^= sign;
+	std::uint32_t out;
+	if (bits >= f16_overflow) {
+		out = bits > f32_infinity ? 0x7e00U | ((bits >> 13) & 0x3ffU) : 0x7c00U;
+	} else if (bits < (113U << 23)) {
+		// Adding the magic number lets the FPU round the subnormal for us.
+		const auto sum = std::bit_cast<float>(bits) +
+										 std::bit_cast<float>(denormal_magic);
+		out = std::bit_cast<std::uint32_t>(sum) - denormal_magic;
+	} else {
+		const auto odd = (bits >> 13) & 1U;
+		bits += (std::uint32_t(15 - 127) << 23) + 0xfffU + odd;
+		out = bits >> 13;
+	}
+	return {static_cast<std::uint16_t>(out | (sign >> 16))};
+}
+
+inline auto to_float(Half value) -> float {
+	constexpr std::uint32_t shifted_exponent = 0x7c00U << 13;
+	auto bits = (std::uint32_t(value.bits) & 0x7fffU) << 13;
+	const auto exponent = bits & shifted_exponent;
+	bits += (127U - 15) << 23;
+	if (exponent == shifted_exponent) {
+		bits += (128U - 16) << 23;
+	} else if (exponent == 0) {
+		bits += 1U << 23;
+		bits = std::bit_cast<std::uint32_t>(std::bit_cast<float>(bits) -
+																				std::bit_cast<float>(113U << 23));
+	}
+	return std::bit_cast<float>(bits | (std::uint32_t(value.bits) & 0x8000U)
+																				 << 16);
+}
+
+namespace Kernels {
+
+namespace Detail {
+
+template <AllowedTypes T>
+auto pack_scalar(const T *src, std::size_t n, std::uint16_t *dst,
+								 Storage format) -> void {
+	for (std::size_t i = 0; i < n; ++i) {
+		const auto v = static_cast<float>(src[i]);
+		dst[i] = format == Storage::BF16 ? to_bfloat16(v).bits : to_half(v).bits;
+	}
+}
+
+template <AllowedTypes T>
+auto unpack_scalar(const std::uint16_t *src, std::size_t n, T *dst,
+									 Storage format) -> void {
+	for (std::size_t i = 0; i < n; ++i)
+		dst[i] = static_cast<T>(format == Storage::BF16
+																? to_float(BFloat16{src[i]})
+																: to_float(Half{src[i]}));
+}
+
+#if EXGRAF_X86
+__attribute__((target("avx2,f16c"))) inline auto
+pack_avx2(const float *src, std::size_t n, std::uint16_t *dst, Storage format)
+		-> void {
+	const __m256i lsb = _mm256_set1_epi32(1);
+	const __m256i bias = _mm256_set1_epi32(0x7fff);
+	const __m256i quiet = _mm256_set1_epi32(0x40);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256 v = _mm256_loadu_ps(src + i);
+		__m128i packed;
+		if (format == Storage::FP16) {
+			packed = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+		} else {
+			const __m256i bits = _mm256_castps_si256(v);
+			const __m256i odd =
+					_mm256_and_si256(_mm256_srli_epi32(bits, 16), lsb);
+			__m256i rounded = _mm256_srli_epi32(
+					_mm256_add_epi32(bits, _mm256_add_epi32(bias, odd)), 16);
+			// NaNs keep their sign and payload, as in to_bfloat16.
+			const __m256 nan = _mm256_cmp_ps(v, v, _CMP_UNORD_Q);
+			const __m256i nan_bits =
+					_mm256_or_si256(_mm256_srli_epi32(bits, 16), quiet);
+			rounded =
+					_mm256_blendv_epi8(rounded, nan_bits, _mm256_castps_si256(nan));
+			// packus works per 128-bit lane; gather the two halves' words.
+			const __m256i words = _mm256_permute4x64_epi64(
+					_mm256_packus_epi32(rounded, rounded), 0b1000);
+			packed = _mm256_castsi256_si128(words);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+	}
+	pack_scalar(src + i, n - i, dst + i, format);
+}
+
+__attribute__((target("avx2,f16c"))) inline auto
+unpack_avx2(const std::uint16_t *src, std::size_t n, float *dst,
+						Storage format) -> void {
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i words =
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		const __m256 v =
+				format == Storage::FP16
+						? _mm256_cvtph_ps(words)
+						: _mm256_castsi256_ps(
+									_mm256_slli_epi32(_mm256_cvtepu16_epi32(words), 16));
+		_mm256_storeu_ps(dst + i, v);
+	}
+	unpack_scalar(src + i, n - i, dst + i, format);
+}
+#endif
+
+} // namespace Detail
+
+/// Converts n values to 16-bit `format` (BF16 or FP16).
+template <AllowedTypes T>
+auto pack(const T *src, std::size_t n, std::uint16_t *dst, Storage format,
+					Isa isa = detect_isa()) -> void {
+#if EXGRAF_X86
+	if constexpr (std::is_same_v<T, float>) {
+		if (isa == Isa::AVX2)
+			return Detail::pack_avx2(src, n, dst, format);
+	}
+#endif
+	Detail::pack_scalar(src, n, dst, format);
+}
+
+/// Widens n 16-bit values of `format` back to T.
+template <AllowedTypes T>
+auto unpack(const std::uint16_t *src, std::size_t n, T *dst, Storage format,
+						Isa isa = detect_isa()) -> void {
+#if EXGRAF_X86
+	if constexpr (std::is_same_v<T, float>) {
+		if (isa == Isa::AVX2)
+			return Detail::unpack_avx2(src, n, dst, format);
+	}
+#endif
+	Detail::unpack_scalar(src, n, dst, format);
+}
+
+/// Writes n values to `dst` rounded to `format`'s precision but kept as T,
+/// the value the format would widen back to. `dst` may be `src`.
+template <AllowedTypes T>
+auto round_to(const T *src, std::size_t n, T *dst, Storage format) -> void {
+	if (format == Storage::FP32) {
+		std::copy_n(src, n, dst);
+		return;
+	}
+	constexpr std::size_t block = 256;
+	std::uint16_t bits[block];
+	for (std::size_t done = 0; done < n; done += block) {
+		const auto count = std::min(block, n - done);
+		pack(src + done, count, bits, format);
+		unpack(bits, count, dst + done, format);
+	}
+}
+
+} // namespace Kernels
+
+/// A column-major matrix held in 16-bit storage: half the footprint of the
+/// float original, widened back to T on the way out.
+template <AllowedTypes T> class PackedMatrix {
+	std::vector<std::uint16_t> bits;
+	std::size_t rows{0}, cols{0};
+	Storage format{Storage::BF16};
+
+public:
+	auto store(const arma::Mat<T> &m, Storage storage) -> void {
+		store(m.memptr(), m.n_rows, m.n_cols, m.n_rows, storage);
+	}
+
+	/// Packs a `r` x `c` matrix whose columns start `ld` elements apart,
+	/// such as a row window. The buffer is reused when it is large enough.
+	auto store(const T *origin, std::size_t r, std::size_t c, std::size_t ld,
+						 Storage storage) -> void {
+		if (storage == Storage::FP32)
+			throw std::invalid_argument(
+					"PackedMatrix: FP32 is not a 16-bit format.");
+		format = storage;
+		rows = r;
+		cols = c;
+		bits.resize(r * c);
+		if (ld == r || c <= 1) {
+			Kernels::pack(origin, bits.size(), bits.data(), format);
+			return;
+		}
+		for (std::size_t j = 0; j < c; ++j)
+			Kernels::pack(origin + j * ld, r, bits.data() + j * r, format);
+	}
+
+	auto load(arma::Mat<T> &into) const -> void {
+		into.set_size(rows, cols);
+		Kernels::unpack(bits.data(), bits.size(), into.memptr(), format);
+	}
+
+	auto colptr(std::size_t c) const -> const std::uint16_t * {
+		return bits.data() + c * rows;
+	}
+	auto data() const -> const std::uint16_t * { return bits.data(); }
+	auto storage() const -> Storage { return format; }
+	auto n_rows() const -> std::size_t { return rows; }
+	auto n_cols() const -> std::size_t { return cols; }
+	auto bytes() const -> std::size_t { return bits.size() * sizeof(bits[0]); }
+};
+
+} // namespace ExGraf
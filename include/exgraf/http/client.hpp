@@ -2,7 +2,9 @@
 
 #include "exgraf/http/response.hpp"
 
+#include <functional>
 #include <string>
+#include <string_view>
 
 namespace ExGraf::Http {
 
@@ -11,6 +13,12 @@ public:
 	explicit HttpClient(const std::string &base_url = "") : base_url(base_url) {}
 
 	auto get(const std::string &endpoint) const -> HttpResponse;
+	/// Like `get`, but hands the body to `on_chunk` as it arrives instead of
+	/// collecting it; the response body stays empty. Returning false from
+	/// `on_chunk` aborts the transfer.
+	auto get_stream(const std::string &endpoint,
+									const std::function<bool(std::string_view)> &on_chunk) const
+			-> HttpResponse;
 	auto post(const std::string &endpoint, const std::string &payload) const
 			-> HttpResponse;
 	auto put(const std::string &endpoint, const std::string &payload) const
@@ -0,0 +1,26 @@
+#pragma once
+
+namespace ExGraf {
+
+/// While an InferenceMode is alive, `Sequential::forward` on the same thread
+/// runs the inference path (`Sequential::predict`) instead of recording
+/// onto the graph: no nodes, no backward caches, and the result cannot be
+/// differentiated. Guards nest.
+///
+///   {
+///     InferenceMode guard;
+///     auto probabilities = model.forward(batch);
+///   }
+class InferenceMode {
+	static inline thread_local int depth = 0;
+
+public:
+	InferenceMode() { ++depth; }
+	~InferenceMode() { --depth; }
+	InferenceMode(const InferenceMode &) = delete;
+	auto operator=(const InferenceMode &) -> InferenceMode & = delete;
+
+	static auto active() -> bool { return depth > 0; }
+};
+
+} // namespace ExGraf
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/expression_graph.hpp"
+#include "exgraf/shape.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <armadillo>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ExGraf {
+
+/// One stage of a Sequential model. A layer records its operations on the
+/// model's graph; it owns no parameter storage itself.
+///
+/// Layers describe samples by a per-sample Shape without the batch
+/// dimension: {features} for flat rows, {C, H, W} for images. Sequential
+/// asks each layer for its parameter shapes given the incoming sample shape,
+/// allocates them in its flat buffers and hands them back through `bind`.
+/// Only the model that owns the values calls `initialize`; replicas bind
+/// tensors sharing those values.
+template <AllowedTypes T> class Layer {
+public:
+	virtual ~Layer() = default;
+
+	virtual auto name() const -> std::string = 0;
+	/// Per-sample shape coming out, given `in` going in.
+	virtual auto output_shape(const Shape &in) const -> Shape { return in; }
+	/// Parameter shapes for samples of shape `in`, in the order `bind` passes
+	/// them.
+	virtual auto parameter_shapes(const Shape &) const -> std::vector<Shape> {
+		return {};
+	}
+	/// Forward floating point operations per sample; a multiply-add counts as
+	/// two.
+	virtual auto flops(const Shape &in) const -> std::size_t = 0;
+
+	/// Fixes the layer's input to samples of shape `in`. `parameters` stays
+	/// valid for the layer's lifetime.
+	virtual auto bind(const Shape &, std::span<Tensor<T>>) -> void {}
+	virtual auto initialize() -> void {}
+	virtual auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input,
+											 bool training) -> Tensor<T> = 0;
+	/// Inference without the graph: writes the output for the batch `in` to
+	/// `out`, which is already sized (rows x output features) and may be the
+	/// same matrix as `in` when `in_place()` is true. Nothing is kept for
+	/// backward.
+	virtual auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void = 0;
+	/// True for element-wise layers that can overwrite their input.
+	virtual auto in_place() const -> bool { return false; }
+	/// An unbound layer with the same configuration.
+	virtual auto clone() const -> std::unique_ptr<Layer<T>> = 0;
+	/// `clone()` for replica `index` of a model (0 is the primary). Layers
+	/// with random state override it so replicas draw different streams.
+	virtual auto replica(std::size_t) const -> std::unique_ptr<Layer<T>> {
+		return clone();
+	}
+};
+
+} // namespace ExGraf
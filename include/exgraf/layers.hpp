@@ -0,0 +1,381 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/binary_operation.hpp"
+#include "exgraf/layer.hpp"
+#include "exgraf/spatial_operation.hpp"
+#include "exgraf/unary_operation.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ExGraf::Layers {
+
+/// x * W (+ b) over the flattened sample, so it follows image layers
+/// directly: the batch layout is already one row per sample. W is
+/// He-initialized for the ReLU that usually follows; the bias starts at
+/// zero. Followed by ReLU this records the chain the default fusion patterns
+/// turn into Fused::LinearReLUOp.
+template <AllowedTypes T> class Linear : public Layer<T> {
+	std::size_t features;
+	bool has_bias;
+	std::span<Tensor<T>> parameters;
+
+public:
+	explicit Linear(std::size_t out_features, bool bias = true)
+			: features(out_features), has_bias(bias) {
+		if (out_features == 0)
+			throw std::invalid_argument("Linear: out_features must be positive.");
+	}
+
+	auto name() const -> std::string override { return "Linear"; }
+	/// The bound parameters; the bias is nullptr without one.
+	auto weights() const -> const arma::Mat<T> & { return *parameters[0].data; }
+	auto bias() const -> const arma::Mat<T> * {
+		return has_bias ? parameters[1].data.get() : nullptr;
+	}
+	auto output_shape(const Shape &) const -> Shape override {
+		return Shape{features};
+	}
+	auto parameter_shapes(const Shape &in) const -> std::vector<Shape> override {
+		if (has_bias)
+			return {Shape{in.total_elements(), features}, Shape{1, features}};
+		return {Shape{in.total_elements(), features}};
+	}
+	auto flops(const Shape &in) const -> std::size_t override {
+		return 2 * in.total_elements() * features + (has_bias ? features : 0);
+	}
+
+	auto bind(const Shape &, std::span<Tensor<T>> p) -> void override {
+		parameters = p;
+	}
+	auto initialize() -> void override {
+		auto &w = *parameters[0].data;
+		w = arma::randn<arma::Mat<T>>(w.n_rows, w.n_cols) *
+				std::sqrt(T(2) / w.n_rows);
+		if (has_bias)
+			parameters[1].data->zeros();
+	}
+
+	auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input, bool)
+			-> Tensor<T> override {
+		auto product = graph.template add_operation<Binary::MatMulOp<T>>(
+				{input, parameters[0]});
+		if (!has_bias)
+			return product;
+		return graph.template add_operation<Binary::AddBiasOp<T>>(
+				{product, parameters[1]});
+	}
+	auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void override {
+		gemm(in, Transpose::No, *parameters[0].data, Transpose::No, out);
+		if (has_bias)
+			out.each_row() += *parameters[1].data;
+	}
+
+	auto clone() const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<Linear>(features, has_bias);
+	}
+};
+
+template <AllowedTypes T> class ReLU : public Layer<T> {
+public:
+	auto name() const -> std::string override { return "ReLU"; }
+	auto flops(const Shape &in) const -> std::size_t override {
+		return in.total_elements();
+	}
+	auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input, bool)
+			-> Tensor<T> override {
+		return graph.template add_operation<Unary::ReLUOp<T>>({input});
+	}
+	auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void override {
+		const T *x = in.memptr();
+		T *y = out.memptr();
+		for (std::size_t i = 0; i < in.n_elem; ++i)
+			y[i] = x[i] > T(0) ? x[i] : T(0);
+	}
+	auto in_place() const -> bool override { return true; }
+	auto clone() const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<ReLU>();
+	}
+};
+
+template <AllowedTypes T> class Tanh : public Layer<T> {
+public:
+	auto name() const -> std::string override { return "Tanh"; }
+	auto flops(const Shape &in) const -> std::size_t override {
+		return in.total_elements();
+	}
+	auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input, bool)
+			-> Tensor<T> override {
+		return graph.template add_operation<Unary::TanhOp<T>>({input});
+	}
+	auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void override {
+		const T *x = in.memptr();
+		T *y = out.memptr();
+		for (std::size_t i = 0; i < in.n_elem; ++i)
+			y[i] = std::tanh(x[i]);
+	}
+	auto in_place() const -> bool override { return true; }
+	auto clone() const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<Tanh>();
+	}
+};
+
+/// Row-wise softmax. Counted as three operations per element: the
+/// exponential, the sum and the division.
+template <AllowedTypes T> class Softmax : public Layer<T> {
+	// Per-row maximum, then sum; reused across calls.
+	std::vector<T> row_stats;
+
+public:
+	auto name() const -> std::string override { return "Softmax"; }
+	auto flops(const Shape &in) const -> std::size_t override {
+		return 3 * in.total_elements();
+	}
+	auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input, bool)
+			-> Tensor<T> override {
+		return graph.template add_operation<Unary::SoftmaxOp<T>>({input});
+	}
+	/// Column by column, so every pass over the batch is sequential.
+	auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void override {
+		const auto rows = in.n_rows;
+		row_stats.resize(rows);
+		T *stat = row_stats.data();
+		std::copy_n(in.colptr(0), rows, stat);
+		for (std::size_t c = 1; c < in.n_cols; ++c) {
+			const T *x = in.colptr(c);
+			for (std::size_t r = 0; r < rows; ++r)
+				stat[r] = std::max(stat[r], x[r]);
+		}
+		for (std::size_t c = 0; c < in.n_cols; ++c) {
+			const T *x = in.colptr(c);
+			T *y = out.colptr(c);
+			for (std::size_t r = 0; r < rows; ++r)
+				y[r] = std::exp(x[r] - stat[r]);
+		}
+		std::fill_n(stat, rows, T(0));
+		for (std::size_t c = 0; c < out.n_cols; ++c) {
+			const T *y = out.colptr(c);
+			for (std::size_t r = 0; r < rows; ++r)
+				stat[r] += y[r];
+		}
+		for (std::size_t r = 0; r < rows; ++r)
+			stat[r] = T(1) / stat[r];
+		for (std::size_t c = 0; c < out.n_cols; ++c) {
+			T *y = out.colptr(c);
+			for (std::size_t r = 0; r < rows; ++r)
+				y[r] *= stat[r];
+		}
+	}
+	auto in_place() const -> bool override { return true; }
+	auto clone() const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<Softmax>();
+	}
+};
+
+/// Dropout while training, the identity otherwise (nothing is recorded).
+template <AllowedTypes T> class Dropout : public Layer<T> {
+	T rate;
+	std::uint64_t seed;
+	std::shared_ptr<Unary::DropoutOp<T>> op;
+
+public:
+	explicit Dropout(T r, std::uint64_t s = 0)
+			: rate(r), seed(s), op(std::make_shared<Unary::DropoutOp<T>>(r, s)) {
+		if (!(r >= T(0) && r < T(1)))
+			throw std::invalid_argument("Dropout: rate must be in [0, 1).");
+	}
+
+	auto name() const -> std::string override { return "Dropout"; }
+	auto flops(const Shape &in) const -> std::size_t override {
+		return in.total_elements();
+	}
+	auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input,
+							 bool training) -> Tensor<T> override {
+		if (!training || rate == T(0))
+			return input;
+		return graph.add_operation(op, {input});
+	}
+	/// The identity: inference never drops.
+	auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void override {
+		if (&in != &out)
+			out = in;
+	}
+	auto in_place() const -> bool override { return true; }
+	auto clone() const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<Dropout>(rate, seed);
+	}
+	/// Replicas of a data-parallel model see different shards, so equal seeds
+	/// would drop the same positions in each shard.
+	auto replica(std::size_t index) const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<Dropout>(rate,
+																		 seed + index * 0x9e3779b97f4a7c15ULL);
+	}
+};
+
+namespace Detail {
+
+inline auto image(const Shape &in, const std::string &layer) -> Shape {
+	if (in.size() != 3)
+		throw std::invalid_argument(layer +
+																": expects {channels, height, width} samples.");
+	return in;
+}
+
+} // namespace Detail
+
+/// 2-D convolution over {C, H, W} samples with square kernels. Weights are
+/// (C*K*K) x OC, He-initialized; the bias starts at zero. The algorithm
+/// defaults to autotuned selection between im2col and direct kernels.
+template <AllowedTypes T> class Conv2D : public Layer<T> {
+	std::size_t channels, kernel, stride, padding;
+	bool has_bias;
+	Spatial::ConvAlgorithm algorithm;
+	std::span<Tensor<T>> parameters;
+	std::shared_ptr<Spatial::Conv2DOp<T>> op;
+	Conv2DGeometry bound{};
+	// The im2col patch matrix for inference, grown to the largest batch.
+	std::vector<T> scratch;
+
+	auto geometry(const Shape &in) const -> Conv2DGeometry {
+		const auto s = Detail::image(in, "Conv2D");
+		Conv2DGeometry g{s[0], s[1], s[2], channels, kernel, stride, padding};
+		g.validate();
+		return g;
+	}
+
+public:
+	Conv2D(std::size_t out_channels, std::size_t kernel_size,
+				 std::size_t stride_ = 1, std::size_t padding_ = 0, bool bias = true,
+				 Spatial::ConvAlgorithm algo = Spatial::ConvAlgorithm::Auto)
+			: channels(out_channels), kernel(kernel_size), stride(stride_),
+				padding(padding_), has_bias(bias), algorithm(algo) {}
+
+	auto name() const -> std::string override { return "Conv2D"; }
+	auto output_shape(const Shape &in) const -> Shape override {
+		const auto g = geometry(in);
+		return Shape{channels, g.out_height(), g.out_width()};
+	}
+	auto parameter_shapes(const Shape &in) const -> std::vector<Shape> override {
+		const auto g = geometry(in);
+		if (has_bias)
+			return {Shape{g.patch(), channels}, Shape{1, channels}};
+		return {Shape{g.patch(), channels}};
+	}
+	auto flops(const Shape &in) const -> std::size_t override {
+		const auto g = geometry(in);
+		return g.out_features() * (2 * g.patch() + (has_bias ? 1 : 0));
+	}
+
+	auto bind(const Shape &in, std::span<Tensor<T>> p) -> void override {
+		parameters = p;
+		bound = geometry(in);
+		op = std::make_shared<Spatial::Conv2DOp<T>>(bound, algorithm);
+	}
+	auto initialize() -> void override {
+		auto &w = *parameters[0].data;
+		w = arma::randn<arma::Mat<T>>(w.n_rows, w.n_cols) *
+				std::sqrt(T(2) / w.n_rows);
+		if (has_bias)
+			parameters[1].data->zeros();
+	}
+
+	auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input, bool)
+			-> Tensor<T> override {
+		if (has_bias)
+			return graph.add_operation(op, {input, parameters[0], parameters[1]});
+		return graph.add_operation(op, {input, parameters[0]});
+	}
+	auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void override {
+		const auto &g = bound;
+		const auto n = in.n_rows;
+		const auto &w = *parameters[0].data;
+		const T *bias = has_bias ? parameters[1].data->memptr() : nullptr;
+		const auto chosen = algorithm == Spatial::ConvAlgorithm::Auto
+														? Spatial::tuned_algorithm<T>(g, n)
+														: algorithm;
+		if (chosen == Spatial::ConvAlgorithm::Direct) {
+			Kernels::conv2d_direct(in.memptr(), w.memptr(), bias, n, g,
+														 out.memptr());
+			return;
+		}
+		const auto rows = g.positions() * n;
+		scratch.resize(std::max<std::size_t>(scratch.size(), rows * g.patch()));
+		arma::Mat<T> cols(scratch.data(), rows, g.patch(), false, true);
+		Kernels::im2col(in.memptr(), n, g, cols.memptr());
+		arma::Mat<T> view(out.memptr(), rows, g.out_channels, false, true);
+		view = cols * w;
+		if (has_bias)
+			view.each_row() += *parameters[1].data;
+	}
+
+	auto clone() const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<Conv2D>(channels, kernel, stride, padding,
+																		has_bias, algorithm);
+	}
+};
+
+/// Max or average pooling over {C, H, W} samples; the stride defaults to the
+/// window size.
+template <AllowedTypes T, typename Op> class Pool2D : public Layer<T> {
+	std::size_t kernel, stride;
+	std::shared_ptr<Op> op;
+	Pool2DGeometry bound{};
+
+	auto geometry(const Shape &in) const -> Pool2DGeometry {
+		const auto s = Detail::image(in, name());
+		Pool2DGeometry g{s[0], s[1], s[2], kernel, stride};
+		g.validate();
+		return g;
+	}
+
+public:
+	explicit Pool2D(std::size_t kernel_size, std::size_t stride_ = 0)
+			: kernel(kernel_size), stride(stride_ ? stride_ : kernel_size) {}
+
+	auto name() const -> std::string override {
+		return std::is_same_v<Op, Spatial::MaxPool2DOp<T>> ? "MaxPool2D"
+																											 : "AvgPool2D";
+	}
+	auto output_shape(const Shape &in) const -> Shape override {
+		const auto g = geometry(in);
+		return Shape{g.channels, g.out_height(), g.out_width()};
+	}
+	/// One comparison or addition per window element.
+	auto flops(const Shape &in) const -> std::size_t override {
+		return geometry(in).out_features() * kernel * kernel;
+	}
+
+	auto bind(const Shape &in, std::span<Tensor<T>>) -> void override {
+		bound = geometry(in);
+		op = std::make_shared<Op>(bound);
+	}
+	auto forward(ExpressionGraph<T> &graph, const Tensor<T> &input, bool)
+			-> Tensor<T> override {
+		return graph.add_operation(op, {input});
+	}
+	auto infer(const arma::Mat<T> &in, arma::Mat<T> &out) -> void override {
+		if constexpr (std::is_same_v<Op, Spatial::MaxPool2DOp<T>>)
+			Kernels::max_pool2d(in.memptr(), in.n_rows, bound, out.memptr(),
+													static_cast<std::uint32_t *>(nullptr));
+		else
+			Kernels::avg_pool2d(in.memptr(), in.n_rows, bound, out.memptr());
+	}
+	auto clone() const -> std::unique_ptr<Layer<T>> override {
+		return std::make_unique<Pool2D>(kernel, stride);
+	}
+};
+
+template <AllowedTypes T>
+using MaxPool2D = Pool2D<T, Spatial::MaxPool2DOp<T>>;
+template <AllowedTypes T>
+using AvgPool2D = Pool2D<T, Spatial::AvgPool2DOp<T>>;
+
+} // namespace ExGraf::Layers
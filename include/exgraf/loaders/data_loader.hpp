@@ -0,0 +1,284 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/half.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ExGraf {
+
+struct DataLoaderOptions {
+	std::size_t batch_size{128};
+	/// Batches kept ready ahead of the consumer (ring slots).
+	std::size_t prefetch{2};
+	/// Background threads assembling batches.
+	std::size_t workers{1};
+	bool shuffle{true};
+	/// Skip the last batch of an epoch when it would be smaller.
+	bool drop_last{false};
+	std::uint64_t seed{0};
+	/// Format the loader keeps the dataset in. BF16/FP16 pack it once at
+	/// construction, halving its footprint and the bytes each gather reads;
+	/// batches are widened back to T.
+	Storage storage{Storage::FP32};
+};
+
+/// Hands out shuffled mini-batches of a row-per-sample dataset, assembled
+/// ahead of time on background threads.
+///
+/// Batches live in a ring of `prefetch` preallocated slots. Workers claim
+/// batches in order, gather their rows into a free slot and publish it; the
+/// consumer only waits when the next batch in order is not ready yet. A batch
+/// returned by `next()` stays valid until the following call, which hands its
+/// slot back to the workers. Workers run ahead across epoch boundaries, with
+/// every epoch's order derived from the seed, so a run is reproducible no
+/// matter how many workers there are.
+///
+/// With 16-bit storage the loader drops its reference to the source tensors
+/// once they are packed, so their memory is released as soon as the caller
+/// lets go of its copies too.
+template <AllowedTypes T> class DataLoader {
+public:
+	struct Batch {
+		Tensor<T> inputs;
+		Tensor<T> targets;
+		std::size_t epoch;
+	};
+
+	DataLoader(Tensor<T> inputs, Tensor<T> targets, DataLoaderOptions opts)
+			: source_inputs(std::move(inputs)), source_targets(std::move(targets)),
+				options(opts) {
+		samples = source_inputs.data->n_rows;
+		input_cols = source_inputs.data->n_cols;
+		target_cols = source_targets.data->n_cols;
+		if (options.batch_size == 0 || options.prefetch == 0 ||
+				options.workers == 0)
+			throw std::invalid_argument(
+					"DataLoader: batch size, prefetch and workers must be positive.");
+		if (source_targets.data->n_rows != samples)
+			throw std::invalid_argument(
+					"DataLoader: inputs and targets need one row per sample.");
+		full_batches = samples / options.batch_size;
+		tail_rows = options.drop_last ? 0 : samples % options.batch_size;
+		per_epoch = full_batches + (tail_rows > 0 ? 1 : 0);
+		if (per_epoch == 0)
+			throw std::invalid_argument("DataLoader: fewer samples than a batch.");
+		if (options.storage != Storage::FP32) {
+			packed_inputs.store(*source_inputs.data, options.storage);
+			packed_targets.store(*source_targets.data, options.storage);
+			source_inputs = Tensor<T>();
+			source_targets = Tensor<T>();
+		}
+
+		slots.resize(options.prefetch);
+		for (auto &slot : slots) {
+			slot.inputs = Tensor<T>(Shape{options.batch_size, input_cols});
+			slot.targets = Tensor<T>(Shape{options.batch_size, target_cols});
+		}
+		for (std::size_t w = 0; w < options.workers; ++w)
+			threads.emplace_back([this] { produce(); });
+	}
+
+	// `threads` is declared last, so the workers are joined before anything
+	// they use is destroyed.
+	~DataLoader() {
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		changed.notify_all();
+	}
+
+	DataLoader(const DataLoader &) = delete;
+	auto operator=(const DataLoader &) -> DataLoader & = delete;
+
+	/// The next batch of the current epoch, or nullopt once it is exhausted;
+	/// the call after that starts the next epoch.
+	auto next() -> std::optional<Batch> {
+		std::unique_lock lock(mutex);
+		if (handed_out) {
+			slots[consumed % slots.size()].state = SlotState::Free;
+			++consumed;
+			handed_out = false;
+			changed.notify_all();
+		}
+		if (epoch_done) {
+			epoch_done = false;
+			return std::nullopt;
+		}
+		auto &slot = slots[consumed % slots.size()];
+		const auto started = std::chrono::steady_clock::now();
+		changed.wait(lock, [&] {
+			return slot.state == SlotState::Ready && slot.sequence == consumed;
+		});
+		stalled += std::chrono::steady_clock::now() - started;
+		handed_out = true;
+		const auto epoch = consumed / per_epoch;
+		epoch_done = (consumed + 1) % per_epoch == 0;
+		const auto partial = consumed % per_epoch == full_batches;
+		return Batch{partial ? slot.tail_inputs : slot.inputs,
+								 partial ? slot.tail_targets : slot.targets, epoch};
+	}
+
+	auto batches_per_epoch() const -> std::size_t { return per_epoch; }
+
+	/// Total time `next()` spent waiting for a batch to be assembled.
+	auto stall_time() const -> std::chrono::steady_clock::duration {
+		std::lock_guard lock(mutex);
+		return stalled;
+	}
+
+private:
+	enum class SlotState : std::uint8_t { Free, Filling, Ready };
+	struct Slot {
+		Tensor<T> inputs, targets;
+		// Only used by the short last batch of an epoch.
+		Tensor<T> tail_inputs, tail_targets;
+		std::size_t sequence{0};
+		SlotState state{SlotState::Free};
+	};
+	struct EpochOrder {
+		std::size_t epoch;
+		std::vector<std::size_t> order;
+	};
+
+	Tensor<T> source_inputs, source_targets;
+	PackedMatrix<T> packed_inputs, packed_targets;
+	DataLoaderOptions options;
+	std::size_t samples{0}, input_cols{0}, target_cols{0};
+	std::size_t full_batches{0}, tail_rows{0}, per_epoch{0};
+
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<Slot> slots;
+	std::deque<EpochOrder> orders;
+	std::size_t claimed{0};
+	std::size_t consumed{0};
+	bool handed_out{false};
+	bool epoch_done{false};
+	bool stopping{false};
+	std::chrono::steady_clock::duration stalled{};
+	std::vector<std::jthread> threads;
+
+	auto produce() -> void {
+		std::vector<std::size_t> rows;
+		std::vector<std::uint16_t> staging;
+		while (true) {
+			std::size_t sequence;
+			Slot *slot;
+			const std::vector<std::size_t> *order;
+			{
+				std::unique_lock lock(mutex);
+				sequence = claimed++;
+				slot = &slots[sequence % slots.size()];
+				// The slot is free once the consumer has released the batch
+				// `prefetch` places earlier.
+				changed.wait(lock, [&] {
+					return stopping || (slot->state == SlotState::Free &&
+															consumed + slots.size() > sequence);
+				});
+				if (stopping)
+					return;
+				slot->state = SlotState::Filling;
+				order = &order_for(sequence / per_epoch);
+			}
+
+			const auto batch = sequence % per_epoch;
+			const auto first = batch * options.batch_size;
+			const auto count = batch == full_batches ? tail_rows : options.batch_size;
+			rows.assign(order->begin() + first, order->begin() + first + count);
+			// Sample order inside a batch does not matter for a mean loss, and
+			// ascending rows turn the gather into forward scans of each column.
+			std::ranges::sort(rows);
+			const auto full = count == options.batch_size;
+			auto &inputs =
+					full ? slot->inputs : resized(slot->tail_inputs, count, input_cols);
+			auto &targets = full ? slot->targets
+													 : resized(slot->tail_targets, count, target_cols);
+			if (options.storage == Storage::FP32) {
+				gather(*source_inputs.data, rows, *inputs.data);
+				gather(*source_targets.data, rows, *targets.data);
+			} else {
+				gather(packed_inputs, rows, staging, *inputs.data);
+				gather(packed_targets, rows, staging, *targets.data);
+			}
+
+			{
+				std::lock_guard lock(mutex);
+				slot->sequence = sequence;
+				slot->state = SlotState::Ready;
+			}
+			changed.notify_all();
+		}
+	}
+
+	static auto resized(Tensor<T> &buffer, std::size_t rows, std::size_t cols)
+			-> Tensor<T> & {
+		if (!buffer.data || buffer.data->n_rows != rows)
+			buffer = Tensor<T>(Shape{rows, cols});
+		return buffer;
+	}
+
+	static auto gather(const arma::Mat<T> &source,
+										 const std::vector<std::size_t> &rows,
+										 arma::Mat<T> &destination) -> void {
+		const auto count = rows.size();
+		for (std::size_t c = 0; c < source.n_cols; ++c) {
+			const T *from = source.colptr(c);
+			T *to = destination.colptr(c);
+			for (std::size_t i = 0; i < count; ++i)
+				to[i] = from[rows[i]];
+		}
+	}
+
+	// Gathers each column's 16-bit values contiguously, then widens the run
+	// with the vector kernel.
+	static auto gather(const PackedMatrix<T> &source,
+										 const std::vector<std::size_t> &rows,
+										 std::vector<std::uint16_t> &staging,
+										 arma::Mat<T> &destination) -> void {
+		const auto count = rows.size();
+		staging.resize(count);
+		for (std::size_t c = 0; c < source.n_cols(); ++c) {
+			const std::uint16_t *from = source.colptr(c);
+			for (std::size_t i = 0; i < count; ++i)
+				staging[i] = from[rows[i]];
+			Kernels::unpack(staging.data(), count, destination.colptr(c),
+											source.storage());
+		}
+	}
+
+	// Called with the mutex held. Batches being filled are never older than
+	// the consumer's position, so earlier epochs' orders can be dropped.
+	auto order_for(std::size_t epoch) -> const std::vector<std::size_t> & {
+		for (auto &entry : orders) {
+			if (entry.epoch == epoch)
+				return entry.order;
+		}
+		while (!orders.empty() && orders.front().epoch < consumed / per_epoch)
+			orders.pop_front();
+		auto &entry = orders.emplace_back();
+		entry.epoch = epoch;
+		entry.order.resize(samples);
+		std::iota(entry.order.begin(), entry.order.end(), std::size_t{0});
+		if (options.shuffle) {
+			std::mt19937_64 rng(options.seed + epoch);
+			std::ranges::shuffle(entry.order, rng);
+		}
+		return entry.order;
+	}
+};
+
+} // namespace ExGraf
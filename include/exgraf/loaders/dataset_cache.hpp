@@ -0,0 +1,199 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <zlib.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ExGraf::Cache {
+
+/// On-disk layout of a cached tensor: this header, zero padding up to
+/// `data_offset` (a multiple of 64), then rows * cols elements in Armadillo's
+/// column-major order, so the payload can be used in place.
+struct DatasetHeader {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	std::uint32_t element_size;
+	std::uint32_t is_floating;
+	std::uint32_t crc32;
+	std::uint64_t rows;
+	std::uint64_t cols;
+	std::uint64_t data_offset;
+};
+
+inline constexpr std::array<char, 8> dataset_magic{'E', 'X', 'G', 'R',
+																									 'A', 'F', 'D', 'C'};
+inline constexpr std::uint32_t dataset_version = 1;
+inline constexpr std::size_t dataset_alignment = 64;
+
+/// When `map_dataset` checks the payload checksum. OnChange checks it once
+/// and records the file's size and modification time next to it in a
+/// `.verified` stamp; later maps skip the check until either changes.
+enum class Verify { Never, OnChange, Always };
+
+/// Contents of the `.verified` stamp OnChange writes.
+struct VerifiedStamp {
+	std::uint64_t size;
+	std::int64_t mtime_sec;
+	std::int64_t mtime_nsec;
+	std::uint32_t crc32;
+
+	auto operator==(const VerifiedStamp &) const -> bool = default;
+};
+
+inline auto stamp_path(const std::filesystem::path &path)
+		-> std::filesystem::path {
+	auto stamp = path;
+	stamp += ".verified";
+	return stamp;
+}
+
+inline auto payload_crc32(const void *data, std::size_t bytes)
+		-> std::uint32_t {
+	auto crc = crc32(0L, Z_NULL, 0);
+	auto *p = static_cast<const Bytef *>(data);
+	// zlib takes uInt lengths; feed large payloads in chunks.
+	constexpr std::size_t chunk = std::size_t{1} << 30;
+	for (std::size_t done = 0; done < bytes; done += chunk)
+		crc = crc32(crc, p + done,
+								static_cast<uInt>(std::min(chunk, bytes - done)));
+	return static_cast<std::uint32_t>(crc);
+}
+
+/// Writes `tensor` to `path` through a temporary file that is renamed into
+/// place, so readers never see a partial cache.
+template <AllowedTypes T>
+auto write_dataset(const std::filesystem::path &path, const Tensor<T> &tensor)
+		-> void {
+	const auto &m = *tensor.data;
+	const auto bytes = m.n_elem * sizeof(T);
+	DatasetHeader header{};
+	header.magic = dataset_magic;
+	header.version = dataset_version;
+	header.element_size = sizeof(T);
+	header.is_floating = std::is_floating_point_v<T>;
+	header.crc32 = payload_crc32(m.memptr(), bytes);
+	header.rows = m.n_rows;
+	header.cols = m.n_cols;
+	header.data_offset = (sizeof(DatasetHeader) + dataset_alignment - 1) /
+											 dataset_alignment * dataset_alignment;
+
+	if (path.has_parent_path())
+		std::filesystem::create_directories(path.parent_path());
+	auto staging = path;
+	staging += ".tmp";
+	{
+		std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+		const std::array<char, dataset_alignment> padding{};
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(padding.data(), static_cast<std::streamsize>(
+																	header.data_offset - sizeof(header)));
+		out.write(reinterpret_cast<const char *>(m.memptr()),
+							static_cast<std::streamsize>(bytes));
+		if (!out)
+			throw std::runtime_error("Failed to write dataset cache: " +
+															 staging.string());
+	}
+	std::filesystem::rename(staging, path);
+	std::error_code ignored;
+	std::filesystem::remove(stamp_path(path), ignored);
+}
+
+namespace Detail {
+
+inline auto read_stamp(const std::filesystem::path &path)
+		-> std::optional<VerifiedStamp> {
+	std::ifstream in(stamp_path(path), std::ios::binary);
+	VerifiedStamp stamp{};
+	if (!in.read(reinterpret_cast<char *>(&stamp), sizeof(stamp)))
+		return std::nullopt;
+	return stamp;
+}
+
+/// Best effort: without a stamp the next OnChange map verifies again.
+inline auto write_stamp(const std::filesystem::path &path,
+												const VerifiedStamp &stamp) -> void {
+	std::ofstream out(stamp_path(path), std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char *>(&stamp), sizeof(stamp));
+}
+
+} // namespace Detail
+
+/// Maps a cache written by `write_dataset` and returns a tensor viewing the
+/// mapping directly: nothing is read until a page is touched. The mapping is
+/// private, so writes through the tensor never reach the file, and it is
+/// released with the last copy of the tensor.
+///
+/// Returns nullopt if the file is missing, was written for another element
+/// type, or its header does not match its size. Checking the payload
+/// checksum as well reads the whole file, so callers opt in with `verify`.
+template <AllowedTypes T>
+auto map_dataset(const std::filesystem::path &path,
+								 Verify verify = Verify::Never) -> std::optional<Tensor<T>> {
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return std::nullopt;
+	struct stat info{};
+	if (::fstat(fd, &info) != 0 ||
+			static_cast<std::size_t>(info.st_size) < sizeof(DatasetHeader)) {
+		::close(fd);
+		return std::nullopt;
+	}
+	const auto file_bytes = static_cast<std::size_t>(info.st_size);
+	void *mapping = ::mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE,
+												 MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		return std::nullopt;
+
+	DatasetHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+	const auto elements = header.rows * header.cols;
+	const bool valid =
+			header.magic == dataset_magic && header.version == dataset_version &&
+			header.element_size == sizeof(T) &&
+			header.is_floating == std::is_floating_point_v<T> &&
+			header.data_offset % dataset_alignment == 0 &&
+			header.data_offset >= sizeof(DatasetHeader) &&
+			file_bytes == header.data_offset + elements * sizeof(T);
+	auto *payload = reinterpret_cast<T *>(static_cast<char *>(mapping) +
+																				header.data_offset);
+	const VerifiedStamp stamp{file_bytes, info.st_mtim.tv_sec,
+														info.st_mtim.tv_nsec, header.crc32};
+	const bool check =
+			verify == Verify::Always ||
+			(verify == Verify::OnChange && Detail::read_stamp(path) != stamp);
+	if (!valid ||
+			(check && payload_crc32(payload, elements * sizeof(T)) != header.crc32)) {
+		::munmap(mapping, file_bytes);
+		return std::nullopt;
+	}
+	if (check && verify == Verify::OnChange)
+		Detail::write_stamp(path, stamp);
+
+	std::shared_ptr<arma::Mat<T>> view(
+			new arma::Mat<T>(payload, header.rows, header.cols, false, true),
+			[mapping, file_bytes](arma::Mat<T> *m) {
+				delete m;
+				::munmap(mapping, file_bytes);
+			});
+	return Tensor<T>(std::move(view));
+}
+
+} // namespace ExGraf::Cache
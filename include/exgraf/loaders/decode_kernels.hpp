@@ -0,0 +1,223 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/cpu_features.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if EXGRAF_X86
+#include <immintrin.h>
+#endif
+
+namespace ExGraf::Kernels {
+
+namespace Detail {
+
+template <AllowedTypes T>
+auto normalize_scalar(const std::uint8_t *src, std::size_t n, T *dst)
+		-> void {
+	for (std::size_t i = 0; i < n; ++i)
+		dst[i] = T(src[i]) / T(255);
+}
+
+template <AllowedTypes T>
+auto one_hot_scalar(const std::uint8_t *labels, std::size_t n, std::size_t c,
+										T *column) -> void {
+	for (std::size_t i = 0; i < n; ++i)
+		column[i] = labels[i] == c ? T(1) : T(0);
+}
+
+#if EXGRAF_X86
+// The vector paths divide rather than multiply by 1/255 so every level
+// produces bit-identical results.
+
+__attribute__((target("sse2"))) inline auto
+normalize_sse2(const std::uint8_t *src, std::size_t n, float *dst) -> void {
+	const __m128 scale = _mm_set1_ps(255.0F);
+	const __m128i zero = _mm_setzero_si128();
+	std::size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m128i bytes =
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+		const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+		const __m128i words[4] = {
+				_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+				_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)};
+		for (int k = 0; k < 4; ++k)
+			_mm_storeu_ps(dst + i + 4 * k,
+										_mm_div_ps(_mm_cvtepi32_ps(words[k]), scale));
+	}
+	normalize_scalar(src + i, n - i, dst + i);
+}
+
+__attribute__((target("sse2"))) inline auto
+normalize_sse2(const std::uint8_t *src, std::size_t n, double *dst) -> void {
+	const __m128d scale = _mm_set1_pd(255.0);
+	const __m128i zero = _mm_setzero_si128();
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		std::int32_t packed;
+		std::memcpy(&packed, src + i, sizeof(packed));
+		const __m128i words = _mm_unpacklo_epi16(
+				_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		_mm_storeu_pd(dst + i, _mm_div_pd(_mm_cvtepi32_pd(words), scale));
+		_mm_storeu_pd(dst + i + 2,
+									_mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(words, 8)),
+														 scale));
+	}
+	normalize_scalar(src + i, n - i, dst + i);
+}
+
+__attribute__((target("avx2"))) inline auto
+normalize_avx2(const std::uint8_t *src, std::size_t n, float *dst) -> void {
+	const __m256 scale = _mm256_set1_ps(255.0F);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i bytes =
+				_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+		_mm256_storeu_ps(
+				dst + i,
+				_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), scale));
+	}
+	normalize_scalar(src + i, n - i, dst + i);
+}
+
+__attribute__((target("avx2"))) inline auto
+normalize_avx2(const std::uint8_t *src, std::size_t n, double *dst) -> void {
+	const __m256d scale = _mm256_set1_pd(255.0);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		std::int32_t packed;
+		std::memcpy(&packed, src + i, sizeof(packed));
+		const __m128i words = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+		_mm256_storeu_pd(dst + i,
+										 _mm256_div_pd(_mm256_cvtepi32_pd(words), scale));
+	}
+	normalize_scalar(src + i, n - i, dst + i);
+}
+
+__attribute__((target("sse2"))) inline auto
+one_hot_sse2(const std::uint8_t *labels, std::size_t n, std::size_t c,
+						 float *column) -> void {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i target = _mm_set1_epi32(static_cast<int>(c));
+	const __m128 one = _mm_set1_ps(1.0F);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		std::int32_t packed;
+		std::memcpy(&packed, labels + i, sizeof(packed));
+		const __m128i words = _mm_unpacklo_epi16(
+				_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		const __m128i hit = _mm_cmpeq_epi32(words, target);
+		_mm_storeu_ps(column + i, _mm_and_ps(_mm_castsi128_ps(hit), one));
+	}
+	one_hot_scalar(labels + i, n - i, c, column + i);
+}
+
+__attribute__((target("sse2"))) inline auto
+one_hot_sse2(const std::uint8_t *labels, std::size_t n, std::size_t c,
+						 double *column) -> void {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i target = _mm_set1_epi32(static_cast<int>(c));
+	const __m128d one = _mm_set1_pd(1.0);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		std::int32_t packed;
+		std::memcpy(&packed, labels + i, sizeof(packed));
+		const __m128i words = _mm_unpacklo_epi16(
+				_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		const __m128i hit = _mm_cmpeq_epi32(words, target);
+		// Widen each 32-bit mask to 64 bits for the double lanes.
+		_mm_storeu_pd(column + i,
+									_mm_and_pd(_mm_castsi128_pd(_mm_unpacklo_epi32(hit, hit)),
+														 one));
+		_mm_storeu_pd(column + i + 2,
+									_mm_and_pd(_mm_castsi128_pd(_mm_unpackhi_epi32(hit, hit)),
+														 one));
+	}
+	one_hot_scalar(labels + i, n - i, c, column + i);
+}
+
+__attribute__((target("avx2"))) inline auto
+one_hot_avx2(const std::uint8_t *labels, std::size_t n, std::size_t c,
+						 float *column) -> void {
+	const __m256i target = _mm256_set1_epi32(static_cast<int>(c));
+	const __m256 one = _mm256_set1_ps(1.0F);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i words = _mm256_cvtepu8_epi32(
+				_mm_loadl_epi64(reinterpret_cast<const __m128i *>(labels + i)));
+		const __m256i hit = _mm256_cmpeq_epi32(words, target);
+		_mm256_storeu_ps(column + i, _mm256_and_ps(_mm256_castsi256_ps(hit), one));
+	}
+	one_hot_scalar(labels + i, n - i, c, column + i);
+}
+
+__attribute__((target("avx2"))) inline auto
+one_hot_avx2(const std::uint8_t *labels, std::size_t n, std::size_t c,
+						 double *column) -> void {
+	const __m256i target = _mm256_set1_epi64x(static_cast<long long>(c));
+	const __m256d one = _mm256_set1_pd(1.0);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		std::int32_t packed;
+		std::memcpy(&packed, labels + i, sizeof(packed));
+		const __m256i words = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+		const __m256i hit = _mm256_cmpeq_epi64(words, target);
+		_mm256_storeu_pd(column + i, _mm256_and_pd(_mm256_castsi256_pd(hit), one));
+	}
+	one_hot_scalar(labels + i, n - i, c, column + i);
+}
+#endif
+
+} // namespace Detail
+
+/// dst[i] = src[i] / 255 for n bytes, on the given instruction set level
+/// (which must be supported; see `isa_supported`).
+template <AllowedTypes T>
+auto normalize_u8(const std::uint8_t *src, std::size_t n, T *dst,
+									Isa isa = detect_isa()) -> void {
+	switch (isa) {
+#if EXGRAF_X86
+	case Isa::AVX2:
+		return Detail::normalize_avx2(src, n, dst);
+	case Isa::SSE2:
+		return Detail::normalize_sse2(src, n, dst);
+#endif
+	default:
+		return Detail::normalize_scalar(src, n, dst);
+	}
+}
+
+/// Writes the one-hot encoding of n labels into a column-major n x classes
+/// block whose columns are `ld` elements apart. Every entry is written, so
+/// the destination need not be zeroed, and each column is filled front to
+/// back. Throws if a label is not below `classes`.
+template <AllowedTypes T>
+auto one_hot_u8(const std::uint8_t *labels, std::size_t n, std::size_t classes,
+								T *dst, std::size_t ld, Isa isa = detect_isa()) -> void {
+	if (n > 0 && *std::max_element(labels, labels + n) >= classes)
+		throw std::invalid_argument("one_hot: label out of range.");
+	for (std::size_t c = 0; c < classes; ++c) {
+		T *column = dst + c * ld;
+		switch (isa) {
+#if EXGRAF_X86
+		case Isa::AVX2:
+			Detail::one_hot_avx2(labels, n, c, column);
+			break;
+		case Isa::SSE2:
+			Detail::one_hot_sse2(labels, n, c, column);
+			break;
+#endif
+		default:
+			Detail::one_hot_scalar(labels, n, c, column);
+		}
+	}
+}
+
+} // namespace ExGraf::Kernels
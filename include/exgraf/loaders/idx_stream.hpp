@@ -0,0 +1,208 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/loaders/decode_kernels.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+namespace ExGraf::MNIST {
+
+/// Incremental gzip decoder: compressed bytes go in through `feed` in chunks
+/// of any size, and come out through `sink` in pieces of at most one fixed
+/// output buffer, so memory use does not grow with the stream.
+class GzipInflater {
+	static constexpr std::size_t buffer_size = 64 * 1024;
+	z_stream strm{};
+	std::array<unsigned char, buffer_size> out{};
+	bool finished{false};
+
+public:
+	GzipInflater() {
+		if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK)
+			throw std::runtime_error("Failed to init zlib for GZip.");
+	}
+	~GzipInflater() { inflateEnd(&strm); }
+	GzipInflater(const GzipInflater &) = delete;
+	auto operator=(const GzipInflater &) -> GzipInflater & = delete;
+
+	template <typename Sink>
+	auto feed(std::span<const unsigned char> input, Sink &&sink) -> void {
+		strm.next_in = const_cast<Bytef *>(input.data());
+		strm.avail_in = static_cast<uInt>(input.size());
+		while (!finished && strm.avail_in > 0) {
+			strm.next_out = out.data();
+			strm.avail_out = static_cast<uInt>(out.size());
+			const int ret = inflate(&strm, Z_NO_FLUSH);
+			if (ret != Z_OK && ret != Z_STREAM_END)
+				throw std::runtime_error("zlib error during inflate.");
+			sink(std::span<const unsigned char>(out.data(),
+																					out.size() - strm.avail_out));
+			finished = ret == Z_STREAM_END;
+		}
+	}
+
+	auto done() const -> bool { return finished; }
+};
+
+namespace Detail {
+
+inline auto read_be32(const unsigned char *p) -> std::uint32_t {
+	return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+				 (std::uint32_t(p[2]) << 8) | std::uint32_t(p[3]);
+}
+
+/// Collects a fixed-size header from a byte stream that may split it at any
+/// point. Returns how many bytes of `input` it consumed.
+template <std::size_t N> struct Header {
+	std::array<unsigned char, N> bytes{};
+	std::size_t filled{0};
+
+	auto take(std::span<const unsigned char> input) -> std::size_t {
+		const auto n = std::min(N - filled, input.size());
+		std::copy_n(input.begin(), n, bytes.begin() + filled);
+		filled += n;
+		return n;
+	}
+	auto complete() const -> bool { return filled == N; }
+};
+
+} // namespace Detail
+
+/// Parses an IDX image stream (magic 2051) as it arrives, scaling pixels to
+/// [0, 1] straight into an images x pixels tensor allocated once the header
+/// is known.
+///
+/// Images arrive row by row but the tensor is column-major, so pixels are
+/// staged in a small tile of whole images. Each pixel's bytes are gathered
+/// out of the tile (which stays in L1) and normalized by a vector kernel
+/// into one contiguous run of its column.
+template <AllowedTypes T> class IdxImageParser {
+	static constexpr std::size_t tile_images = 64;
+	Detail::Header<16> header;
+	Tensor<T> images;
+	std::size_t pixels{0}, total{0}, written{0};
+	std::vector<unsigned char> tile;
+	std::size_t tile_filled{0};
+	Isa isa;
+
+public:
+	explicit IdxImageParser(Isa level = detect_isa()) : isa(level) {}
+
+	auto consume(std::span<const unsigned char> input) -> void {
+		if (!header.complete()) {
+			input = input.subspan(header.take(input));
+			if (!header.complete())
+				return;
+			start();
+		}
+		if (input.size() > (total - written) * pixels - tile_filled)
+			throw std::runtime_error("IDX image stream is longer than declared.");
+		const auto capacity = tile_images * pixels;
+		while (!input.empty()) {
+			const auto n = std::min(input.size(), capacity - tile_filled);
+			std::copy_n(input.begin(), n, tile.begin() + tile_filled);
+			tile_filled += n;
+			input = input.subspan(n);
+			// Flush full tiles, and the last partial one once it is complete.
+			if (tile_filled == capacity ||
+					tile_filled == (total - written) * pixels)
+				flush();
+		}
+	}
+
+	auto complete() const -> bool {
+		return header.complete() && written == total;
+	}
+
+	/// The parsed images; throws if the stream ended early.
+	auto result() const -> Tensor<T> {
+		if (!complete())
+			throw std::runtime_error("Invalid IDX image file.");
+		return images;
+	}
+
+private:
+	auto start() -> void {
+		const auto *h = header.bytes.data();
+		if (Detail::read_be32(h) != 2051)
+			throw std::runtime_error("Not an IDX image file.");
+		total = Detail::read_be32(h + 4);
+		pixels = std::size_t(Detail::read_be32(h + 8)) * Detail::read_be32(h + 12);
+		images = Tensor<T>(Shape{total, pixels});
+		tile.resize(tile_images * pixels);
+	}
+
+	auto flush() -> void {
+		const auto count = tile_filled / pixels;
+		auto &m = *images.data;
+		std::array<std::uint8_t, tile_images> run;
+		for (std::size_t p = 0; p < pixels; ++p) {
+			for (std::size_t i = 0; i < count; ++i)
+				run[i] = tile[i * pixels + p];
+			Kernels::normalize_u8(run.data(), count, m.colptr(p) + written, isa);
+		}
+		written += count;
+		const auto rest = tile_filled - count * pixels;
+		std::copy_n(tile.begin() + count * pixels, rest, tile.begin());
+		tile_filled = rest;
+	}
+};
+
+/// Parses an IDX label stream (magic 2049) as it arrives into one-hot rows;
+/// each chunk is encoded column by column (see Kernels::one_hot_u8).
+template <AllowedTypes T> class IdxLabelParser {
+	Detail::Header<8> header;
+	Tensor<T> labels;
+	std::size_t classes, total{0}, written{0};
+	Isa isa;
+
+public:
+	explicit IdxLabelParser(std::size_t num_classes = 10,
+													Isa level = detect_isa())
+			: classes(num_classes), isa(level) {}
+
+	auto consume(std::span<const unsigned char> input) -> void {
+		if (!header.complete()) {
+			input = input.subspan(header.take(input));
+			if (!header.complete())
+				return;
+			start();
+		}
+		if (written + input.size() > total)
+			throw std::runtime_error("IDX label stream is longer than declared.");
+		auto &m = *labels.data;
+		if (!input.empty() && std::ranges::max(input) >= classes)
+			throw std::runtime_error("IDX label out of range.");
+		Kernels::one_hot_u8(input.data(), input.size(), classes,
+												m.memptr() + written, total, isa);
+		written += input.size();
+	}
+
+	auto complete() const -> bool {
+		return header.complete() && written == total;
+	}
+
+	auto result() const -> Tensor<T> {
+		if (!complete())
+			throw std::runtime_error("Invalid IDX label file.");
+		return labels;
+	}
+
+private:
+	auto start() -> void {
+		if (Detail::read_be32(header.bytes.data()) != 2049)
+			throw std::runtime_error("Not an IDX label file.");
+		total = Detail::read_be32(header.bytes.data() + 4);
+		labels = Tensor<T>(Shape{total, classes});
+	}
+};
+
+} // namespace ExGraf::MNIST
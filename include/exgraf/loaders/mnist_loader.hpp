@@ -1,11 +1,18 @@
 #pragma once
 
 #include <armadillo>
+#include <exception>
+#include <filesystem>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
-#include <zlib.h>
 
 #include "exgraf/http/client.hpp"
+#include "exgraf/loaders/dataset_cache.hpp"
+#include "exgraf/loaders/idx_stream.hpp"
 #include "exgraf/model.hpp"
 #include "exgraf/tensor.hpp"
 
@@ -13,130 +20,132 @@
 
 namespace ExGraf::MNIST {
 
+inline auto as_bytes(const std::vector<unsigned char> &buffer)
+		-> std::span<const unsigned char> {
+	return {buffer.data(), buffer.size()};
+}
+
+/// Whole-buffer inflate; `load_mnist` streams instead (see GzipInflater).
 inline auto decompress_gzip(const std::vector<unsigned char> &input)
 		-> std::vector<unsigned char> {
-	z_stream strm{};
-	strm.avail_in = static_cast<uInt>(input.size());
-	strm.next_in =
-			reinterpret_cast<Bytef *>(const_cast<unsigned char *>(input.data()));
-	if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
-		throw std::runtime_error("Failed to init zlib for GZip.");
-	}
-
+	GzipInflater inflater;
 	std::vector<unsigned char> output;
-	output.resize(10 * 1024 * 1024); // 10MB temp buffer; adjust as needed
-
-	int ret;
-	do {
-		strm.avail_out = static_cast<uInt>(output.size() - strm.total_out);
-		strm.next_out = reinterpret_cast<Bytef *>(output.data() + strm.total_out);
-		ret = inflate(&strm, Z_NO_FLUSH);
-		if (ret == Z_STREAM_END)
-			break;
-		if (ret == Z_OK && strm.avail_out == 0) {
-			// Increase buffer and continue
-			output.resize(output.size() * 2);
-		} else if (ret != Z_OK) {
-			inflateEnd(&strm);
-			throw std::runtime_error("zlib error during inflate.");
-		}
-	} while (true);
-
-	inflateEnd(&strm);
-	output.resize(strm.total_out);
+	inflater.feed(as_bytes(input), [&](std::span<const unsigned char> chunk) {
+		output.insert(output.end(), chunk.begin(), chunk.end());
+	});
+	if (!inflater.done())
+		throw std::runtime_error("Truncated GZip stream.");
 	return output;
 }
 
-inline auto parse_idx_images(const std::vector<unsigned char> &buffer)
-		-> arma::Mat<double> {
-	if (buffer.size() < 16)
-		throw std::runtime_error("Invalid IDX image file.");
-	int magic =
-			(buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
-	int num_images =
-			(buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7];
-	int num_rows =
-			(buffer[8] << 24) | (buffer[9] << 16) | (buffer[10] << 8) | buffer[11];
-	int num_cols =
-			(buffer[12] << 24) | (buffer[13] << 16) | (buffer[14] << 8) | buffer[15];
-
-	if (magic != 2051)
-		throw std::runtime_error("Not an IDX image file.");
-
-	arma::Mat<double> data(num_images, num_rows * num_cols, arma::fill::zeros);
-	std::size_t offset = 16;
-	for (int i = 0; i < num_images; i++) {
-		for (int p = 0; p < num_rows * num_cols; p++) {
-			data(i, p) = buffer[offset++] / 255.0; // Scale [0..1]
-		}
-	}
-	return data;
+template <AllowedTypes T = double>
+auto parse_idx_images(const std::vector<unsigned char> &buffer)
+		-> arma::Mat<T> {
+	IdxImageParser<T> parser;
+	parser.consume(as_bytes(buffer));
+	return std::move(*parser.result().data);
 }
 
 inline auto parse_idx_labels(const std::vector<unsigned char> &buffer)
 		-> arma::Col<std::size_t> {
 	if (buffer.size() < 8)
 		throw std::runtime_error("Invalid IDX label file.");
-	int magic =
-			(buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
-	int num_items =
-			(buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7];
-
-	if (magic != 2049)
+	if (Detail::read_be32(buffer.data()) != 2049)
 		throw std::runtime_error("Not an IDX label file.");
+	const auto num_items = Detail::read_be32(buffer.data() + 4);
+	if (buffer.size() < 8 + std::size_t(num_items))
+		throw std::runtime_error("Invalid IDX label file.");
 
 	arma::Col<std::size_t> labels(num_items);
-	std::size_t offset = 8;
-	for (int i = 0; i < num_items; i++) {
-		labels(i) = static_cast<std::size_t>(buffer[offset++]);
-	}
+	for (std::size_t i = 0; i < num_items; i++)
+		labels(i) = static_cast<std::size_t>(buffer[8 + i]);
 	return labels;
 }
 
-inline auto load_mnist(const std::string &images_url,
-											 const std::string &labels_url)
-		-> std::pair<ExGraf::Tensor<double>, ExGraf::Tensor<double>> {
-	ExGraf::Http::HttpClient client;
-	tf::Taskflow taskflow;
-	tf::Executor executor;
-
-	std::vector<unsigned char> img_bytes, lbl_bytes;
-	std::vector<unsigned char> img_decompressed, lbl_decompressed;
-	ExGraf::Tensor<double> img_tensor, lbl_tensor;
-
-	auto fetch_images = taskflow.emplace([&] {
-		auto res = client.get(images_url);
-		img_bytes.assign(res.body.begin(), res.body.end());
-	});
-	auto fetch_labels = taskflow.emplace([&] {
-		auto res = client.get(labels_url);
-		lbl_bytes.assign(res.body.begin(), res.body.end());
-	});
-	auto decompress_images =
-			taskflow.emplace([&] { img_decompressed = decompress_gzip(img_bytes); });
-	auto decompress_labels =
-			taskflow.emplace([&] { lbl_decompressed = decompress_gzip(lbl_bytes); });
-	auto parse_images = taskflow.emplace([&] {
-		auto parsed = parse_idx_images(img_decompressed);
-		img_tensor = Tensor<double>(parsed);
-	});
-	auto parse_labels = taskflow.emplace([&] {
-		auto parsed = parse_idx_labels(lbl_decompressed);
-		lbl_tensor = Model<double>::to_one_hot(parsed, 10);
+/// Downloads `url` and feeds each received chunk through `inflater` into
+/// `parser`, so decoding keeps pace with the transfer and the compressed and
+/// inflated files are never held in memory.
+template <typename Parser>
+auto stream_idx(const Http::HttpClient &client, const std::string &url,
+								Parser &parser) -> void {
+	GzipInflater inflater;
+	std::exception_ptr failure;
+	const auto response = client.get_stream(url, [&](std::string_view data) {
+		try {
+			inflater.feed(
+					{reinterpret_cast<const unsigned char *>(data.data()), data.size()},
+					[&](std::span<const unsigned char> chunk) {
+						parser.consume(chunk);
+					});
+			return true;
+		} catch (...) {
+			failure = std::current_exception();
+			return false;
+		}
 	});
+	// Check the status first: an error page is not gzip, and the inflater's
+	// complaint about it would hide why the download failed.
+	if (!response.success)
+		throw std::runtime_error(
+				"Failed to download " + url + ": " +
+				(response.status_code != 0
+						 ? "HTTP " + std::to_string(response.status_code)
+						 : response.error_message));
+	if (failure)
+		std::rethrow_exception(failure);
+	if (!inflater.done() || !parser.complete())
+		throw std::runtime_error("Truncated IDX download: " + url);
+}
 
-	fetch_images.precede(decompress_images);
-	fetch_labels.precede(decompress_labels);
-	decompress_images.precede(parse_images);
-	decompress_labels.precede(parse_labels);
+/// `<cache_dir>/<file name of url without .gz>.<f32|f64>.exgraf`; float and
+/// double runs keep separate caches rather than evicting each other.
+template <AllowedTypes T = double>
+auto cache_path(const std::filesystem::path &cache_dir, const std::string &url)
+		-> std::filesystem::path {
+	auto name = std::filesystem::path(url).filename();
+	if (name.extension() == ".gz")
+		name.replace_extension();
+	name += std::is_same_v<T, float> ? ".f32.exgraf" : ".f64.exgraf";
+	return cache_dir / name;
+}
 
-	static bool first = true;
-	if (first) {
-		taskflow.dump(std::cout);
-		first = false;
+/// Downloads and decodes the MNIST images and one-hot labels. With a
+/// `cache_dir`, decoded tensors are written there on first use and later
+/// loads map them instead of downloading (see Cache::map_dataset). A cache
+/// whose checksum does not match is downloaded again; by default it is
+/// checked whenever the file's size or modification time changes. Pixels are
+/// decoded straight into T, so a float pipeline never touches doubles.
+template <AllowedTypes T = double>
+auto load_mnist(const std::string &images_url, const std::string &labels_url,
+								const std::filesystem::path &cache_dir = {},
+								Cache::Verify verify = Cache::Verify::OnChange)
+		-> std::pair<ExGraf::Tensor<T>, ExGraf::Tensor<T>> {
+	const auto images_cache = cache_path<T>(cache_dir, images_url);
+	const auto labels_cache = cache_path<T>(cache_dir, labels_url);
+	if (!cache_dir.empty()) {
+		auto images = Cache::map_dataset<T>(images_cache, verify);
+		auto labels = Cache::map_dataset<T>(labels_cache, verify);
+		if (images && labels)
+			return {*images, *labels};
 	}
 
-	executor.run(taskflow).wait();
+	ExGraf::Http::HttpClient client;
+	tf::Taskflow taskflow;
+	tf::Executor executor;
+
+	IdxImageParser<T> images;
+	IdxLabelParser<T> labels;
+	taskflow.emplace([&] { stream_idx(client, images_url, images); });
+	taskflow.emplace([&] { stream_idx(client, labels_url, labels); });
+
+	// `get` rethrows the first exception a download task raised.
+	executor.run(taskflow).get();
+	auto img_tensor = images.result();
+	auto lbl_tensor = labels.result();
+	if (!cache_dir.empty()) {
+		Cache::write_dataset(images_cache, img_tensor);
+		Cache::write_dataset(labels_cache, lbl_tensor);
+	}
 	return {img_tensor, lbl_tensor};
 }
 
@@ -1,54 +1,198 @@
 #pragma once
 
 #include <fmt/format.h>
+#include <iterator>
 #include <memory>
+#include <string_view>
+#include <vector>
 
+#include <spdlog/async.h>
+#include <spdlog/async_logger.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
+// The lowest level compiled into the binary: 0 trace, 1 debug, 2 info,
+// 3 warn, 4 error, 5 off. Calls below it are discarded at compile time, so
+// their arguments are never formatted and their level never checked.
+#ifndef EXGRAF_LOG_LEVEL
+#ifdef NDEBUG
+#define EXGRAF_LOG_LEVEL 1
+#else
+#define EXGRAF_LOG_LEVEL 0
+#endif
+#endif
+
 namespace ExGraf {
 
+enum class LogLevel : int { Trace, Debug, Info, Warn, Error, Off };
+
+inline constexpr auto compiled_log_level =
+		static_cast<LogLevel>(EXGRAF_LOG_LEVEL);
+
+struct LogOptions {
+	LogLevel level{LogLevel::Debug};
+	/// Format on the calling thread, write on a background one. Messages wait
+	/// in a ring of `queue_size` entries; when it is full the oldest is
+	/// dropped, so a slow sink never stalls the caller.
+	bool async{false};
+	std::size_t queue_size{8192};
+	/// Where messages go; empty means coloured stdout.
+	std::vector<spdlog::sink_ptr> sinks{};
+};
+
 class Logger {
 public:
-	static auto instance() -> auto & {
-		static std::shared_ptr<spdlog::logger> logger = [] {
-			auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-			auto log = std::make_shared<spdlog::logger>("app_logger", sink);
-			spdlog::register_logger(log);
-			log->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [thread %t] %v");
-			log->set_level(spdlog::level::debug);
-			return log;
+	static auto instance() -> spdlog::logger & { return *state().logger; }
+
+	/// Replaces the logger. Messages still queued by a previous async logger
+	/// are written before this returns. Not safe while other threads log.
+	static auto configure(LogOptions options = {}) -> void {
+		install(state(), std::move(options));
+	}
+
+	static auto set_level(LogLevel level) -> void {
+		instance().set_level(to_spdlog(level));
+	}
+
+	/// Messages the async ring has overwritten since it was configured.
+	static auto dropped_messages() -> std::size_t {
+		const auto &pool = state().pool;
+		return pool ? pool->overrun_counter() : 0;
+	}
+
+	static constexpr auto to_spdlog(LogLevel level)
+			-> spdlog::level::level_enum {
+		switch (level) {
+		case LogLevel::Trace:
+			return spdlog::level::trace;
+		case LogLevel::Debug:
+			return spdlog::level::debug;
+		case LogLevel::Info:
+			return spdlog::level::info;
+		case LogLevel::Warn:
+			return spdlog::level::warn;
+		case LogLevel::Error:
+			return spdlog::level::err;
+		case LogLevel::Off:
+			break;
+		}
+		return spdlog::level::off;
+	}
+
+private:
+	struct State {
+		std::shared_ptr<spdlog::details::thread_pool> pool;
+		std::shared_ptr<spdlog::logger> logger;
+	};
+
+	static auto state() -> State & {
+		static State current = [] {
+			State s;
+			install(s, {});
+			return s;
 		}();
-		return *logger;
+		return current;
+	}
+
+	static auto install(State &s, LogOptions options) -> void {
+		static constexpr auto name = "app_logger";
+		auto &sinks = options.sinks;
+		if (sinks.empty())
+			sinks.push_back(
+					std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+
+		std::shared_ptr<spdlog::details::thread_pool> pool;
+		std::shared_ptr<spdlog::logger> log;
+		if (options.async) {
+			pool = std::make_shared<spdlog::details::thread_pool>(
+					options.queue_size, 1);
+			log = std::make_shared<spdlog::async_logger>(
+					name, sinks.begin(), sinks.end(), pool,
+					spdlog::async_overflow_policy::overrun_oldest);
+		} else {
+			log = std::make_shared<spdlog::logger>(name, sinks.begin(),
+																						 sinks.end());
+		}
+		log->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [thread %t] %v");
+		log->set_level(to_spdlog(options.level));
+		spdlog::drop(name);
+		spdlog::register_logger(log);
+
+		// The old pool's destructor drains its queue before joining.
+		s.logger = std::move(log);
+		s.pool = std::move(pool);
 	}
 };
 
+/// Whether a message at L would be written: false at compile time below
+/// EXGRAF_LOG_LEVEL, otherwise the logger's runtime level decides. Guard
+/// arguments that are expensive to compute with it.
+template <LogLevel L> auto log_enabled() -> bool {
+	static_assert(L != LogLevel::Off);
+	if constexpr (L < compiled_log_level)
+		return false;
+	else
+		return Logger::instance().should_log(Logger::to_spdlog(L));
+}
+
+namespace Detail {
+
+constexpr auto log_tag(LogLevel level) -> std::string_view {
+	constexpr std::string_view tags[] = {"[TRACE] ", "[DEBUG] ", "[INFO] ",
+																			 "[WARN] ", "[ERROR] "};
+	return tags[static_cast<int>(level)];
+}
+
+// Checks the level, then formats the tag and message into one stack buffer.
+template <LogLevel L, typename... Args>
+auto log_message(const fmt::format_string<Args...> &fmt, Args &&...args)
+		-> void {
+	static_assert(L != LogLevel::Off);
+	if constexpr (L >= compiled_log_level) {
+		auto &logger = Logger::instance();
+		constexpr auto level = Logger::to_spdlog(L);
+		if (!logger.should_log(level))
+			return;
+		fmt::memory_buffer message;
+		const auto tag = log_tag(L);
+		message.append(tag.data(), tag.data() + tag.size());
+		fmt::format_to(std::back_inserter(message), fmt,
+									 std::forward<Args>(args)...);
+		logger.log(level,
+							 spdlog::string_view_t(message.data(), message.size()));
+	}
+}
+
+} // namespace Detail
+
 template <typename... Args>
 static auto info(const fmt::format_string<Args...> &fmt,
 								 Args &&...args) -> void {
-	Logger::instance().info("[INFO] {}",
-													fmt::format(fmt, std::forward<Args>(args)...));
+	Detail::log_message<LogLevel::Info>(fmt, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+static auto warn(const fmt::format_string<Args...> &fmt,
+								 Args &&...args) -> void {
+	Detail::log_message<LogLevel::Warn>(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 static auto error(const fmt::format_string<Args...> &fmt,
 									Args &&...args) -> void {
-	Logger::instance().error("[ERROR] {}",
-													 fmt::format(fmt, std::forward<Args>(args)...));
+	Detail::log_message<LogLevel::Error>(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 static auto debug(const fmt::format_string<Args...> &fmt,
 									Args &&...args) -> void {
-	Logger::instance().debug("[DEBUG] {}",
-													 fmt::format(fmt, std::forward<Args>(args)...));
+	Detail::log_message<LogLevel::Debug>(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 static auto trace(const fmt::format_string<Args...> &fmt,
 									Args &&...args) -> void {
-	Logger::instance().trace("[TRACE] {}",
-													 fmt::format(fmt, std::forward<Args>(args)...));
+	Detail::log_message<LogLevel::Trace>(fmt, std::forward<Args>(args)...);
 }
 
 } // namespace ExGraf
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+
+namespace ExGraf {
+
+/// Dynamic loss scaling for mixed-precision training.
+///
+/// Backward starts from `scale()` instead of one, so gradients small enough
+/// to flush to zero in a 16-bit format stay representable. Before the
+/// optimizer step `unscale` divides the scale back out. An infinite or NaN
+/// gradient means the scale overflowed somewhere: the step is skipped and
+/// the scale multiplied by `backoff`. After `interval` finite steps in a row
+/// it grows by `growth` again.
+template <AllowedTypes T> class LossScaler {
+public:
+	struct Options {
+		T initial{T(65536)};
+		T growth{T(2)};
+		T backoff{T(0.5)};
+		std::size_t interval{2000};
+	};
+
+	explicit LossScaler(const Options &o = {}) : options(o), factor(o.initial) {}
+
+	auto scale() const -> T { return factor; }
+	/// Steps skipped so far because a gradient was not finite.
+	auto skipped_steps() const -> std::size_t { return skipped; }
+
+	/// Divides every gradient by the scale and returns true when they are
+	/// all finite; otherwise backs the scale off and returns false, leaving
+	/// the gradients unusable. One pass either way.
+	auto unscale(std::span<T> gradients) -> bool {
+		const T inverse = T(1) / factor;
+		// Zero for finite values, NaN for infinities and NaNs.
+		T check = T(0);
+		for (auto &g : gradients) {
+			check += g * T(0);
+			g *= inverse;
+		}
+		if (check != check) {
+			factor *= options.backoff;
+			good_steps = 0;
+			++skipped;
+			return false;
+		}
+		if (++good_steps == options.interval) {
+			factor = std::min(factor * options.growth,
+												std::numeric_limits<T>::max());
+			good_steps = 0;
+		}
+		return true;
+	}
+
+private:
+	Options options;
+	T factor;
+	std::size_t good_steps{0};
+	std::size_t skipped{0};
+};
+
+} // namespace ExGraf
@@ -0,0 +1,305 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/tensor.hpp"
+#include "exgraf/tensor_allocator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <vector>
+
+namespace ExGraf {
+
+enum class Phase : std::uint8_t { Forward, Backward };
+
+/// Hands out activation and gradient buffers from one preallocated arena per
+/// recorded step.
+///
+/// The first time a step is seen every buffer is heap allocated while the
+/// planner records the order of node events (`enter`) and buffer requests.
+/// When the step ends the recording becomes a plan: each request gets a
+/// lifetime in event ticks and an offset in a shared arena, with requests
+/// whose lifetimes do not overlap sharing storage. Later steps that replay
+/// the same events and requests receive views into that arena, so a steady
+/// state training step performs no heap allocations. A step that diverges
+/// from every cached plan falls back to the heap and is planned on its own.
+///
+/// Lifetimes:
+///  - requests made during a node's forward live until the first node event
+///    at which nothing but the graph's own bookkeeping (`mark_output`) still
+///    refers to them: no caller, no consumer and no operation keeping it for
+///    backward. Until then they may still be read, so a buffer whose last
+///    holder outlives the step lives until the step ends. A replayed step in
+///    which a buffer is still held past the tick its plan freed it at
+///    diverges before that storage is handed out again;
+///  - requests made during a node's backward are scratch and die once that
+///    node's gradients have been accumulated;
+///  - `allocate_until(owner)` requests (gradient accumulators) die after the
+///    owner node's backward.
+template <AllowedTypes T> class MemoryPlanner : public TensorAllocator<T> {
+	static constexpr auto forever = std::numeric_limits<std::size_t>::max();
+	static constexpr std::size_t alignment_bytes = 64;
+	static constexpr std::size_t alignment = alignment_bytes / sizeof(T);
+	static constexpr std::size_t max_plans = 4;
+
+	struct Event {
+		std::size_t node;
+		Phase phase;
+		auto operator==(const Event &) const -> bool = default;
+	};
+	struct Request {
+		std::size_t rows, cols;
+		std::size_t birth;
+		std::size_t owner;
+		bool scratch;
+		auto operator==(const Request &) const -> bool = default;
+	};
+	struct Plan {
+		std::vector<Event> events;
+		std::vector<Request> requests;
+		std::vector<std::size_t> released;
+		std::vector<std::shared_ptr<arma::Mat<T>>> views;
+		std::size_t arena_elements{0};
+	};
+
+	std::vector<Plan> plans;
+	Plan *active{nullptr};
+	bool diverged{false};
+	Phase phase{Phase::Forward};
+	Plan *outlived{nullptr};
+	std::vector<Event> events;
+	std::vector<Request> requests;
+	// Per request of this step: its buffer, the references to it that do not
+	// count as uses (the plan's view, the graph's copy of an output), and the
+	// last tick it was used at (`forever` while it still is).
+	std::vector<std::weak_ptr<arma::Mat<T>>> buffers;
+	std::vector<std::size_t> unowned;
+	std::vector<std::size_t> released;
+	std::size_t fallbacks{0};
+
+public:
+	/// Marks the start of a node's forward or backward; every buffer request
+	/// until the next call is attributed to it.
+	auto enter(std::size_t node, Phase p) -> void {
+		release_unused();
+		phase = p;
+		events.push_back({node, p});
+		if (active && (events.size() > active->events.size() ||
+									 active->events[events.size() - 1] != events.back()))
+			diverge();
+	}
+
+	auto allocate(std::size_t rows, std::size_t cols) -> Tensor<T> override {
+		return request(
+				{rows, cols, tick(), forever, phase == Phase::Backward});
+	}
+
+	/// A buffer that must survive until `owner`'s backward has run.
+	auto allocate_until(std::size_t rows, std::size_t cols, std::size_t owner)
+			-> Tensor<T> {
+		return request({rows, cols, tick(), owner, false});
+	}
+
+	/// `output` is kept by the graph for its shape and identity only: that
+	/// reference does not keep the buffer in use.
+	auto mark_output(const Tensor<T> &output) -> void {
+		for (auto i = requests.size(); i-- > 0;) {
+			if (buffers[i].lock() == output.data) {
+				++unowned[i];
+				return;
+			}
+		}
+	}
+
+	/// Ends the current step, planning it if no cached plan covered it.
+	auto finish_step() -> void {
+		if (outlived)
+			std::erase_if(plans, [&](const Plan &p) { return &p == outlived; });
+		if ((diverged || !active) && !requests.empty())
+			add_plan();
+		events.clear();
+		requests.clear();
+		buffers.clear();
+		unowned.clear();
+		released.clear();
+		active = nullptr;
+		outlived = nullptr;
+		diverged = false;
+		phase = Phase::Forward;
+	}
+
+	auto arena_bytes() const -> std::size_t {
+		std::size_t total = 0;
+		for (const auto &plan : plans)
+			total += plan.arena_elements * sizeof(T);
+		return total;
+	}
+	/// Arena bytes of the most recent plan alone.
+	auto plan_bytes() const -> std::size_t {
+		return plans.empty() ? 0 : plans.back().arena_elements * sizeof(T);
+	}
+	/// Bytes the most recent plan would need without any buffer sharing.
+	auto unshared_bytes() const -> std::size_t {
+		if (plans.empty())
+			return 0;
+		std::size_t total = 0;
+		for (const auto &r : plans.back().requests)
+			total += padded(r.rows * r.cols) * sizeof(T);
+		return total;
+	}
+	auto plan_count() const -> std::size_t { return plans.size(); }
+	/// Requests served from the heap because no plan covered them.
+	auto heap_fallbacks() const -> std::size_t { return fallbacks; }
+
+private:
+	auto tick() const -> std::size_t {
+		return events.empty() ? 0 : events.size() - 1;
+	}
+
+	static auto padded(std::size_t elements) -> std::size_t {
+		return (elements + alignment - 1) / alignment * alignment;
+	}
+
+	auto diverge() -> void {
+		active = nullptr;
+		diverged = true;
+	}
+
+	auto request(const Request &r) -> Tensor<T> {
+		requests.push_back(r);
+		const auto index = requests.size() - 1;
+		if (!diverged && !active && index == 0)
+			select_plan();
+		if (active && (index >= active->requests.size() ||
+									 active->requests[index] != r))
+			diverge();
+		auto result = active ? Tensor<T>(active->views[index])
+												 : Tensor<T>(Shape{r.rows, r.cols});
+		if (!active)
+			++fallbacks;
+		buffers.emplace_back(result.data);
+		unowned.push_back(active ? 1 : 0);
+		released.push_back(forever);
+		return result;
+	}
+
+	// Forward buffers only: backward ones already have fixed lifetimes.
+	auto in_use(std::size_t i) const -> bool {
+		const auto &r = requests[i];
+		return r.scratch || r.owner != forever ||
+					 static_cast<std::size_t>(buffers[i].use_count()) > unowned[i];
+	}
+
+	// Records the forward buffers no longer used before the event about to
+	// be entered. One still in use that the active plan already released
+	// may be read later, so the plan is abandoned before its storage is
+	// handed out again.
+	auto release_unused() -> void {
+		const auto now = events.size();
+		for (std::size_t i = 0; i < requests.size(); ++i) {
+			if (released[i] != forever)
+				continue;
+			if (!in_use(i)) {
+				released[i] = now - 1;
+				continue;
+			}
+			if (active && active->released[i] < now) {
+				outlived = active;
+				diverge();
+			}
+		}
+	}
+
+	auto select_plan() -> void {
+		for (auto &plan : plans) {
+			if (plan.requests.empty() || plan.requests.front() != requests.front() ||
+					plan.events.size() < events.size() ||
+					!std::equal(events.begin(), events.end(), plan.events.begin()))
+				continue;
+			active = &plan;
+			return;
+		}
+		diverged = true;
+	}
+
+	auto add_plan() -> void {
+		if (plans.size() == max_plans)
+			plans.erase(plans.begin());
+		auto &plan = plans.emplace_back();
+		plan.events = events;
+		plan.requests = requests;
+		plan.released = released;
+
+		std::vector<std::size_t> backward_tick;
+		for (std::size_t t = 0; t < events.size(); ++t) {
+			if (events[t].phase != Phase::Backward)
+				continue;
+			if (events[t].node >= backward_tick.size())
+				backward_tick.resize(events[t].node + 1, forever);
+			backward_tick[events[t].node] = t;
+		}
+		auto last_use = [&](std::size_t i) {
+			const auto &r = requests[i];
+			if (r.scratch)
+				return r.birth;
+			if (r.owner == forever)
+				return released[i];
+			if (r.owner < backward_tick.size())
+				return backward_tick[r.owner];
+			return forever;
+		};
+
+		// Greedy by size: place the largest buffers first, each at the lowest
+		// offset that does not collide with an already placed buffer whose
+		// lifetime overlaps.
+		const auto count = requests.size();
+		std::vector<std::size_t> order(count), offsets(count), sizes(count);
+		for (std::size_t i = 0; i < count; ++i)
+			sizes[i] = padded(requests[i].rows * requests[i].cols);
+		std::iota(order.begin(), order.end(), std::size_t{0});
+		std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+			return sizes[a] > sizes[b];
+		});
+		std::vector<std::size_t> placed;
+		for (auto i : order) {
+			const auto first = requests[i].birth;
+			const auto last = last_use(i);
+			std::vector<std::size_t> conflicts;
+			for (auto j : placed) {
+				if (requests[j].birth <= last && first <= last_use(j))
+					conflicts.push_back(j);
+			}
+			std::sort(conflicts.begin(), conflicts.end(),
+								[&](auto a, auto b) { return offsets[a] < offsets[b]; });
+			std::size_t offset = 0;
+			for (auto j : conflicts) {
+				if (offset + sizes[i] <= offsets[j])
+					break;
+				offset = std::max(offset, offsets[j] + sizes[j]);
+			}
+			offsets[i] = offset;
+			plan.arena_elements = std::max(plan.arena_elements, offset + sizes[i]);
+			placed.push_back(i);
+		}
+
+		// Views keep the arena alive, so tensors from a plan that has since
+		// been evicted stay valid.
+		std::shared_ptr<T[]> arena(
+				new (std::align_val_t{alignment_bytes}) T[std::max<std::size_t>(
+						plan.arena_elements, 1)],
+				[](T *p) { ::operator delete[](p, std::align_val_t{alignment_bytes}); });
+		plan.views.reserve(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			plan.views.emplace_back(
+					new arma::Mat<T>(arena.get() + offsets[i], requests[i].rows,
+													 requests[i].cols, false, true),
+					[arena](arma::Mat<T> *m) { delete m; });
+		}
+	}
+};
+
+} // namespace ExGraf
@@ -1,21 +1,159 @@
 #pragma once
 
 #include "exgraf/allowed_types.hpp"
+#include "exgraf/half.hpp"
 #include "exgraf/tensor.hpp"
+#include "exgraf/tensor_allocator.hpp"
 
 #include <functional>
+#include <span>
+#include <stdexcept>
 #include <vector>
 
 namespace ExGraf {
 
+/// Where `Operation::backward_into` puts one input's gradient. With
+/// `accumulate` the matrix already holds other contributions and the
+/// gradient is added to it (beta = 1 in GEMM terms); without, its contents
+/// are garbage and are overwritten. Null `into` means no gradient is wanted.
+/// Targets of an input passed twice alias, so they are written in order.
+template <AllowedTypes T> struct GradientTarget {
+	arma::Mat<T> *into{nullptr};
+	bool accumulate{false};
+};
+
+/// Overwrites or adds `value(i)` into every element of `target`.
+template <AllowedTypes T, typename F>
+auto store_gradient(const GradientTarget<T> &target, F &&value) -> void {
+	T *out = target.into->memptr();
+	const auto n = target.into->n_elem;
+	if (target.accumulate) {
+		for (std::size_t i = 0; i < n; ++i)
+			out[i] += value(i);
+	} else {
+		for (std::size_t i = 0; i < n; ++i)
+			out[i] = value(i);
+	}
+}
+
+/// Offset of element `i`, counted column-major over `t`'s own rows, from
+/// `t.origin()`: `i` itself unless `t` is a row window.
+template <AllowedTypes T>
+auto window_offset(const Tensor<T> &t, std::size_t i) -> std::size_t {
+	if (!t.window)
+		return i;
+	const auto rows = t.window->rows;
+	return i + i / rows * (t.data->n_rows - rows);
+}
+
+/// Packs `t`, a row window or not, into `into` in 16-bit `format`.
+template <AllowedTypes T>
+auto pack_operand(const Tensor<T> &t, PackedMatrix<T> &into, Storage format)
+		-> void {
+	into.store(t.origin(), t.n_rows(), t.data->n_cols, t.data->n_rows, format);
+}
+
+/// The calling thread's 16-bit copy of an incoming gradient: packed once at
+/// the start of a backward and read by all of its products, so operations
+/// keep no copy of their own between steps.
+template <AllowedTypes T> auto gradient_scratch() -> PackedMatrix<T> & {
+	thread_local PackedMatrix<T> scratch;
+	return scratch;
+}
+
+/// Sum of column `c`: one feature's bias gradient.
+template <AllowedTypes T>
+auto column_sum(const arma::Mat<T> &m, std::size_t c) -> T {
+	const T *column = m.colptr(c);
+	T sum = T(0);
+	for (std::size_t r = 0; r < m.n_rows; ++r)
+		sum += column[r];
+	return sum;
+}
+
 template <AllowedTypes T> class Operation {
 public:
 	virtual auto
 	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
 			-> Tensor<T> = 0;
-	virtual auto
-	backward(const Tensor<T> &grad_output) -> std::vector<Tensor<T>> = 0;
+	/// Writes one gradient per forward input into `grad_inputs`, in new
+	/// buffers. The graph uses it only for operations that do not accumulate
+	/// in place, then adds each result into the input's gradient itself.
+	virtual auto backward(const Tensor<T> &grad_output,
+												std::span<Tensor<T>> grad_inputs) -> void = 0;
 	virtual ~Operation() = default;
+
+	/// True when the operation implements `backward_into`.
+	virtual auto accumulates_in_place() const -> bool { return false; }
+	/// Writes or adds each input's gradient straight into `targets`, one per
+	/// forward input, so the graph needs no per-input buffer or separate
+	/// accumulation pass.
+	virtual auto backward_into(const Tensor<T> &,
+														 std::span<const GradientTarget<T>>) -> void {
+		throw std::logic_error("Operation::backward_into: not in place.");
+	}
+	/// False for inputs treated as constants (loss targets): they never get
+	/// a target, so nothing upstream of them runs backward.
+	virtual auto differentiable(std::size_t) const -> bool { return true; }
+	/// True when input `input` may be a row window (Tensor::rows_of), read
+	/// from `Tensor::origin` with columns `data->n_rows` apart. The graph
+	/// gathers windows into plain tensors for inputs that return false. A
+	/// fused operation must read windows wherever its members do.
+	virtual auto reads_windows(std::size_t) const -> bool { return false; }
+
+	/// True when each input's gradient can be computed on its own through
+	/// `backward_input`, letting the graph compute them concurrently.
+	/// Separable operations also accumulate in place.
+	virtual auto separable() const -> bool { return false; }
+	/// `backward_into` for one input, with scratch buffers taken from
+	/// `scratch` rather than the bound allocator. Only called when
+	/// `separable()` is true.
+	virtual auto backward_input(std::size_t, const Tensor<T> &,
+															const GradientTarget<T> &, TensorAllocator<T> &)
+			-> void {
+		throw std::logic_error("Operation::backward_input: not separable.");
+	}
+
+	/// Estimated FLOPs of one forward on `inputs`, for profiling. Defaults
+	/// to one per element of the first input.
+	virtual auto
+	flops(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			const -> std::size_t {
+		return inputs.empty() ? 0 : inputs.front().get().data->n_elem;
+	}
+
+	/// Buffers requested through `allocate` come from `alloc` (typically the
+	/// owning graph's memory planner); without one they are heap allocated.
+	auto bind_allocator(TensorAllocator<T> *alloc) -> void { allocator = alloc; }
+
+	/// Bytes requested through `allocate` so far.
+	auto allocated_bytes() const -> std::size_t { return allocated; }
+
+	/// The format matrix products keep their operands in. With BF16 or FP16
+	/// the GEMM-backed operations store their inputs, and in backward the
+	/// incoming gradient, in 16 bits and multiply those, accumulating in T;
+	/// the rest ignore it. The graph sets it on every operation it records
+	/// (see ExpressionGraph::set_operand_storage).
+	auto set_operand_storage(Storage s) -> void { operands = s; }
+	auto operand_storage() const -> Storage { return operands; }
+	/// Bytes of those 16-bit inputs kept from forward for backward.
+	virtual auto stashed_bytes() const -> std::size_t { return 0; }
+	/// Drops them; the graph calls it on the members of a fused group, whose
+	/// own backward no longer runs.
+	virtual auto release_stash() -> void {}
+
+protected:
+	auto allocate(std::size_t rows, std::size_t cols) -> Tensor<T> {
+		allocated += rows * cols * sizeof(T);
+		if (allocator)
+			return allocator->allocate(rows, cols);
+		return Tensor<T>(Shape{rows, cols});
+	}
+
+private:
+	TensorAllocator<T> *allocator{nullptr};
+	std::size_t allocated{0};
+	Storage operands{Storage::FP32};
 };
 
 } // namespace ExGraf
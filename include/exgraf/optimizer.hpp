@@ -1,19 +1,56 @@
 #pragma once
 
 #include "exgraf/allowed_types.hpp"
+#include "exgraf/half.hpp"
+#include "exgraf/profiler.hpp"
 #include "exgraf/tensor.hpp"
 
+#include <taskflow/taskflow.hpp>
+
 #include <functional>
+#include <span>
+#include <stdexcept>
 #include <vector>
 
 namespace ExGraf {
 
+/// What a checkpoint keeps of an optimizer: its step count and its state
+/// arrays back to back in FlatState layout. `values` is empty for stateless
+/// optimizers and before the first step.
+template <AllowedTypes T> struct OptimizerState {
+	std::size_t step{0};
+	std::span<const T> values{};
+};
+
 template <AllowedTypes T> class Optimizer {
 public:
 	virtual ~Optimizer() = default;
 	virtual auto register_tensor(const Tensor<T> &) -> void = 0;
 	virtual auto
 	step(std::vector<std::reference_wrapper<Tensor<T>>> &) -> void = 0;
+	/// Splits `step` across `executor`; nullptr keeps it on the caller.
+	virtual auto set_executor(tf::Executor *) -> void {}
+	/// Views the current state; valid until the next `step`.
+	virtual auto export_state() const -> OptimizerState<T> { return {}; }
+	/// Lays the state out for `parameters` and copies `state` in.
+	virtual auto import_state(std::vector<std::reference_wrapper<Tensor<T>>> &,
+														const OptimizerState<T> &state) -> void {
+		if (!state.values.empty())
+			throw std::invalid_argument(
+					"Optimizer::import_state: this optimizer keeps no state.");
+	}
+	/// Keeps T master weights and hands the parameters their values rounded
+	/// to `format` (see FlatState::keep_masters); FP32 stops.
+	virtual auto keep_master_weights(Storage format) -> void {
+		if (format != Storage::FP32)
+			throw std::logic_error(
+					"Optimizer::keep_master_weights: not supported by this optimizer.");
+	}
+	/// Records each `step` as a span into `p`; nullptr stops recording.
+	auto set_profiler(Profiler *p) -> void { profiler = p; }
+
+protected:
+	Profiler *profiler{nullptr};
 };
 
 } // namespace ExGraf
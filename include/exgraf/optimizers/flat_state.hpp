@@ -0,0 +1,205 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/half.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <taskflow/taskflow.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace ExGraf {
+
+/// Optimizer state laid out flat: `slots` arrays (m and v for Adam) holding
+/// one element per parameter element, parameters in the order they were
+/// passed.
+///
+/// Parameters whose values and gradients both sit back to back in memory
+/// (see FlatBuffer) merge into one range, and updates run over fixed-size
+/// chunks of the ranges, concurrently when an executor is set. The layout is
+/// rebuilt only when the parameter set changes, carrying over the state of
+/// parameters that remain.
+template <AllowedTypes T> class FlatState {
+public:
+	struct Range {
+		T *param;
+		const T *grad;
+		std::size_t offset;
+		std::size_t size;
+	};
+
+	explicit FlatState(std::size_t slot_count) : slots(slot_count) {}
+
+	/// Runs chunks on `e`; nullptr runs them on the calling thread.
+	auto set_executor(tf::Executor *e) -> void {
+		executor = e;
+		schedule.reset();
+	}
+
+	/// Keeps a T master copy of every parameter in one more slot, after the
+	/// optimizer's own. Updates then run on the masters, and each parameter
+	/// receives its master rounded to `format`, the precision the model
+	/// multiplies at, so steps too small for that precision still add up.
+	/// FP32 drops the masters. Masters start from the parameters, restart
+	/// from them when a parameter's storage moves, and are part of
+	/// `values()`.
+	auto keep_masters(Storage format) -> void {
+		const auto had = masters != Storage::FP32;
+		const auto has = format != Storage::FP32;
+		masters = format;
+		if (had == has)
+			return;
+		slots = has ? slots + 1 : slots - 1;
+		key.clear();
+	}
+
+	/// Start of state array `k`, indexed by `Range::offset`.
+	auto slot(std::size_t k) -> T * { return state.data() + k * total; }
+
+	auto size() const -> std::size_t { return total; }
+
+	/// Every slot array back to back, `slots * size()` elements.
+	auto values() const -> std::span<const T> { return state; }
+
+	/// Lays the state out for `parameters` and fills it from `saved`, as
+	/// returned by `values()` for the same parameter shapes.
+	auto restore(std::vector<std::reference_wrapper<Tensor<T>>> &parameters,
+							 std::span<const T> saved) -> void {
+		prepare(parameters);
+		if (saved.size() != state.size())
+			throw std::invalid_argument(
+					"FlatState::restore: saved state does not match the parameters.");
+		std::ranges::copy(saved, state.begin());
+	}
+
+	auto prepare(std::vector<std::reference_wrapper<Tensor<T>>> &parameters)
+			-> void {
+		candidate.clear();
+		for (auto &ref : parameters) {
+			auto &p = ref.get();
+			if (!p.grad)
+				continue;
+			candidate.push_back(reinterpret_cast<std::uintptr_t>(&p));
+			candidate.push_back(reinterpret_cast<std::uintptr_t>(p.data->memptr()));
+			candidate.push_back(
+					reinterpret_cast<std::uintptr_t>(p.grad->data->memptr()));
+			candidate.push_back(p.data->n_elem);
+		}
+		if (candidate != key)
+			rebuild(parameters);
+	}
+
+	/// Calls `update` once per chunk; chunks never overlap. Taking the
+	/// callable by template keeps a steady-state step allocation free. With
+	/// masters kept, `update` sees the masters as `Range::param`.
+	template <typename F> auto run(F &&update) -> void {
+		if (masters == Storage::FP32)
+			return dispatch(update);
+		T *master = slot(slots - 1);
+		const auto format = masters;
+		auto on_masters = [&](const Range &r) {
+			update(Range{master + r.offset, r.grad, r.offset, r.size});
+			Kernels::round_to(master + r.offset, r.size, r.param, format);
+		};
+		dispatch(on_masters);
+	}
+
+private:
+	static constexpr std::size_t chunk_elements = 16 * 1024;
+
+	std::size_t slots;
+	std::size_t built_slots{0};
+	Storage masters{Storage::FP32};
+	std::size_t total{0};
+	std::vector<T> state;
+	std::vector<std::uintptr_t> key, candidate;
+	std::unordered_map<const Tensor<T> *, Range> placed;
+	std::vector<Range> chunks;
+	tf::Executor *executor{nullptr};
+	std::unique_ptr<tf::Taskflow> schedule;
+	// The callable of the `run` in flight, read by the cached tasks.
+	void *context{nullptr};
+	void (*kernel)(void *, const Range &){nullptr};
+
+	template <typename F> auto dispatch(F &&update) -> void {
+		if (!executor || chunks.size() < 2) {
+			for (const auto &chunk : chunks)
+				update(chunk);
+			return;
+		}
+		context = const_cast<void *>(static_cast<const void *>(&update));
+		kernel = [](void *ctx, const Range &r) {
+			(*static_cast<std::remove_reference_t<F> *>(ctx))(r);
+		};
+		if (!schedule) {
+			schedule = std::make_unique<tf::Taskflow>();
+			for (std::size_t i = 0; i < chunks.size(); ++i)
+				schedule->emplace([this, i] { kernel(context, chunks[i]); });
+		}
+		executor->run(*schedule).wait();
+	}
+
+	auto rebuild(std::vector<std::reference_wrapper<Tensor<T>>> &parameters)
+			-> void {
+		std::unordered_map<const Tensor<T> *, Range> next;
+		std::vector<Range> ranges;
+		std::size_t offset = 0;
+		for (auto &ref : parameters) {
+			auto &p = ref.get();
+			if (!p.grad)
+				continue;
+			const Range range{p.data->memptr(), p.grad->data->memptr(), offset,
+												p.data->n_elem};
+			next.emplace(&p, range);
+			auto *last = ranges.empty() ? nullptr : &ranges.back();
+			if (last && last->param + last->size == range.param &&
+					last->grad + last->size == range.grad)
+				last->size += range.size;
+			else
+				ranges.push_back(range);
+			offset += range.size;
+		}
+
+		std::vector<T> fresh(slots * offset, T(0));
+		const auto carried = std::min(built_slots, slots);
+		const auto has_masters = masters != Storage::FP32;
+		for (const auto &[tensor, range] : next) {
+			auto old = placed.find(tensor);
+			const bool kept =
+					old != placed.end() && old->second.size == range.size;
+			for (std::size_t k = 0; kept && k < carried; ++k)
+				std::copy_n(state.begin() + k * total + old->second.offset, range.size,
+										fresh.begin() + k * offset + range.offset);
+			// Masters follow parameters that moved (to loaded values, say).
+			if (has_masters &&
+					!(kept && carried == slots && old->second.param == range.param))
+				std::copy_n(range.param, range.size,
+										fresh.begin() + (slots - 1) * offset + range.offset);
+		}
+		state = std::move(fresh);
+		total = offset;
+		built_slots = slots;
+		placed = std::move(next);
+		key = candidate;
+
+		chunks.clear();
+		for (const auto &range : ranges) {
+			for (std::size_t done = 0; done < range.size; done += chunk_elements) {
+				const auto n = std::min(chunk_elements, range.size - done);
+				chunks.push_back({range.param + done, range.grad + done,
+													range.offset + done, n});
+			}
+		}
+		schedule.reset();
+	}
+};
+
+} // namespace ExGraf
@@ -2,53 +2,65 @@
 
 #include "exgraf/allowed_types.hpp"
 #include "exgraf/optimizer.hpp"
-
-#include <armadillo>
-#include <unordered_map>
-#include <vector>
+#include "exgraf/optimizers/flat_state.hpp"
+#include "exgraf/optimizers/update_kernels.hpp"
 
 namespace ExGraf {
 
+/// SGD, optionally with heavy-ball momentum, as one fused pass per chunk.
+/// Velocity is only kept when momentum is non-zero.
 template <AllowedTypes T> class SgdOptimizer : public Optimizer<T> {
 	T learning_rate;
+	T momentum;
 	std::size_t t;
-	struct OptState {
-		arma::Mat<T> m{};
-		OptState() = default;
-		OptState(const arma::Mat<T> &param)
-				: m(arma::zeros<arma::Mat<T>>(param.n_rows, param.n_cols)) {}
-	};
-	std::unordered_map<const Tensor<T> *, OptState> state;
+	FlatState<T> state;
 
 public:
-	SgdOptimizer(T lr = 0.0001) : learning_rate(lr), t(0) {}
+	SgdOptimizer(T lr = 0.0001, T mu = T(0))
+			: learning_rate(lr), momentum(mu), t(0), state(mu != T(0) ? 1 : 0) {}
+
+	auto register_tensor(const Tensor<T> &) -> void {}
+
+	auto set_executor(tf::Executor *executor) -> void {
+		state.set_executor(executor);
+	}
+
+	auto keep_master_weights(Storage format) -> void {
+		state.keep_masters(format);
+	}
+
+	auto export_state() const -> OptimizerState<T> {
+		return {t, state.values()};
+	}
 
-	auto register_tensor(const Tensor<T> &tensor) -> void {
-		if (!state.contains(&tensor)) {
-			state.emplace(&tensor, OptState(*tensor.data));
-		}
+	auto import_state(std::vector<std::reference_wrapper<Tensor<T>>> &parameters,
+										const OptimizerState<T> &saved) -> void {
+		// Restore first: it throws on a size mismatch, leaving `t` alone.
+		if (!saved.values.empty())
+			state.restore(parameters, saved.values);
+		t = saved.step;
 	}
 
 	auto
 	step(std::vector<std::reference_wrapper<Tensor<T>>> &parameters) -> void {
+		ProfileScope span(this->profiler, "SgdOptimizer", ProfilePhase::Optimizer);
 		t++;
 		apply_linear(parameters);
+		span.set_flops((momentum != T(0) ? 4 : 2) * state.size());
 	}
 
 private:
 	auto apply_linear(std::vector<std::reference_wrapper<Tensor<T>>> &parameters)
 			-> void {
-		for (auto &param_ref : parameters) {
-			auto &param = param_ref.get();
-			if (!param.grad)
-				continue;
-			register_tensor(param);
-			auto &opt_state = state[&param];
-			auto &g = *param.grad->data;
-			opt_state.m = g;
-			param.data->operator-=(learning_rate * opt_state.m);
-		}
+		state.prepare(parameters);
+		T *velocity = momentum != T(0) ? state.slot(0) : nullptr;
+		const auto isa = detect_isa();
+		state.run([&](const typename FlatState<T>::Range &r) {
+			Kernels::sgd_update(r.param, r.grad,
+													velocity ? velocity + r.offset : nullptr, r.size,
+													learning_rate, momentum, isa);
+		});
 	}
 };
 
-} // namespace ExGraf
\ No newline at end of file
+} // namespace ExGraf
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/cpu_features.hpp"
+
+#include <cmath>
+#include <cstddef>
+
+#if EXGRAF_X86
+#include <immintrin.h>
+#endif
+
+namespace ExGraf::Kernels {
+
+/// Per-step constants of an Adam update, with the bias corrections folded
+/// in: p -= step_size * m / (sqrt(v * inv_correction2) + epsilon).
+template <AllowedTypes T> struct AdamStep {
+	T beta1, beta2;
+	T step_size;
+	T inv_correction2;
+	T epsilon;
+};
+
+namespace Detail {
+
+template <AllowedTypes T>
+auto adam_scalar(T *p, const T *g, T *m, T *v, std::size_t n,
+								 const AdamStep<T> &s) -> void {
+	const T decay1 = T(1) - s.beta1, decay2 = T(1) - s.beta2;
+	for (std::size_t i = 0; i < n; ++i) {
+		m[i] = s.beta1 * m[i] + decay1 * g[i];
+		v[i] = s.beta2 * v[i] + decay2 * g[i] * g[i];
+		p[i] -= s.step_size * m[i] / (std::sqrt(v[i] * s.inv_correction2) +
+																	s.epsilon);
+	}
+}
+
+template <AllowedTypes T>
+auto sgd_scalar(T *p, const T *g, T *velocity, std::size_t n, T lr,
+								T momentum) -> void {
+	if (!velocity) {
+		for (std::size_t i = 0; i < n; ++i)
+			p[i] -= lr * g[i];
+		return;
+	}
+	for (std::size_t i = 0; i < n; ++i) {
+		velocity[i] = momentum * velocity[i] + g[i];
+		p[i] -= lr * velocity[i];
+	}
+}
+
+#if EXGRAF_X86
+__attribute__((target("avx2,fma"))) inline auto
+adam_avx2(float *p, const float *g, float *m, float *v, std::size_t n,
+					const AdamStep<float> &s) -> void {
+	const __m256 b1 = _mm256_set1_ps(s.beta1), b2 = _mm256_set1_ps(s.beta2);
+	const __m256 d1 = _mm256_set1_ps(1.0F - s.beta1);
+	const __m256 d2 = _mm256_set1_ps(1.0F - s.beta2);
+	const __m256 step = _mm256_set1_ps(s.step_size);
+	const __m256 inv2 = _mm256_set1_ps(s.inv_correction2);
+	const __m256 eps = _mm256_set1_ps(s.epsilon);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256 gi = _mm256_loadu_ps(g + i);
+		const __m256 mi =
+				_mm256_fmadd_ps(b1, _mm256_loadu_ps(m + i), _mm256_mul_ps(d1, gi));
+		const __m256 vi = _mm256_fmadd_ps(b2, _mm256_loadu_ps(v + i),
+																			_mm256_mul_ps(d2, _mm256_mul_ps(gi, gi)));
+		const __m256 denom =
+				_mm256_add_ps(_mm256_sqrt_ps(_mm256_mul_ps(vi, inv2)), eps);
+		const __m256 update = _mm256_div_ps(_mm256_mul_ps(step, mi), denom);
+		_mm256_storeu_ps(m + i, mi);
+		_mm256_storeu_ps(v + i, vi);
+		_mm256_storeu_ps(p + i, _mm256_sub_ps(_mm256_loadu_ps(p + i), update));
+	}
+	adam_scalar(p + i, g + i, m + i, v + i, n - i, s);
+}
+
+__attribute__((target("avx2,fma"))) inline auto
+adam_avx2(double *p, const double *g, double *m, double *v, std::size_t n,
+					const AdamStep<double> &s) -> void {
+	const __m256d b1 = _mm256_set1_pd(s.beta1), b2 = _mm256_set1_pd(s.beta2);
+	const __m256d d1 = _mm256_set1_pd(1.0 - s.beta1);
+	const __m256d d2 = _mm256_set1_pd(1.0 - s.beta2);
+	const __m256d step = _mm256_set1_pd(s.step_size);
+	const __m256d inv2 = _mm256_set1_pd(s.inv_correction2);
+	const __m256d eps = _mm256_set1_pd(s.epsilon);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m256d gi = _mm256_loadu_pd(g + i);
+		const __m256d mi =
+				_mm256_fmadd_pd(b1, _mm256_loadu_pd(m + i), _mm256_mul_pd(d1, gi));
+		const __m256d vi =
+				_mm256_fmadd_pd(b2, _mm256_loadu_pd(v + i),
+												_mm256_mul_pd(d2, _mm256_mul_pd(gi, gi)));
+		const __m256d denom =
+				_mm256_add_pd(_mm256_sqrt_pd(_mm256_mul_pd(vi, inv2)), eps);
+		const __m256d update = _mm256_div_pd(_mm256_mul_pd(step, mi), denom);
+		_mm256_storeu_pd(m + i, mi);
+		_mm256_storeu_pd(v + i, vi);
+		_mm256_storeu_pd(p + i, _mm256_sub_pd(_mm256_loadu_pd(p + i), update));
+	}
+	adam_scalar(p + i, g + i, m + i, v + i, n - i, s);
+}
+
+__attribute__((target("avx2,fma"))) inline auto
+sgd_avx2(float *p, const float *g, float *velocity, std::size_t n, float lr,
+				 float momentum) -> void {
+	const __m256 rate = _mm256_set1_ps(-lr), mu = _mm256_set1_ps(momentum);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 step = _mm256_loadu_ps(g + i);
+		if (velocity) {
+			step = _mm256_fmadd_ps(mu, _mm256_loadu_ps(velocity + i), step);
+			_mm256_storeu_ps(velocity + i, step);
+		}
+		_mm256_storeu_ps(p + i,
+										 _mm256_fmadd_ps(rate, step, _mm256_loadu_ps(p + i)));
+	}
+	sgd_scalar(p + i, g + i, velocity ? velocity + i : nullptr, n - i, lr,
+						 momentum);
+}
+
+__attribute__((target("avx2,fma"))) inline auto
+sgd_avx2(double *p, const double *g, double *velocity, std::size_t n,
+				 double lr, double momentum) -> void {
+	const __m256d rate = _mm256_set1_pd(-lr), mu = _mm256_set1_pd(momentum);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d step = _mm256_loadu_pd(g + i);
+		if (velocity) {
+			step = _mm256_fmadd_pd(mu, _mm256_loadu_pd(velocity + i), step);
+			_mm256_storeu_pd(velocity + i, step);
+		}
+		_mm256_storeu_pd(p + i,
+										 _mm256_fmadd_pd(rate, step, _mm256_loadu_pd(p + i)));
+	}
+	sgd_scalar(p + i, g + i, velocity ? velocity + i : nullptr, n - i, lr,
+						 momentum);
+}
+#endif
+
+} // namespace Detail
+
+/// One Adam update of n parameters in a single pass over p, g, m and v.
+template <AllowedTypes T>
+auto adam_update(T *p, const T *g, T *m, T *v, std::size_t n,
+								 const AdamStep<T> &step, Isa isa = detect_isa()) -> void {
+#if EXGRAF_X86
+	if (isa == Isa::AVX2)
+		return Detail::adam_avx2(p, g, m, v, n, step);
+#endif
+	Detail::adam_scalar(p, g, m, v, n, step);
+}
+
+/// SGD with heavy-ball momentum: velocity = momentum * velocity + g, then
+/// p -= lr * velocity. Without a velocity buffer this is plain SGD.
+template <AllowedTypes T>
+auto sgd_update(T *p, const T *g, T *velocity, std::size_t n, T lr,
+								T momentum, Isa isa = detect_isa()) -> void {
+#if EXGRAF_X86
+	if (isa == Isa::AVX2)
+		return Detail::sgd_avx2(p, g, velocity, n, lr, momentum);
+#endif
+	Detail::sgd_scalar(p, g, velocity, n, lr, momentum);
+}
+
+} // namespace ExGraf::Kernels
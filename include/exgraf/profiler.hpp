@@ -0,0 +1,301 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+// 0 compiles the graph and optimizer hooks out entirely; a Profiler can
+// still be attached but records nothing.
+#ifndef EXGRAF_PROFILING
+#define EXGRAF_PROFILING 1
+#endif
+
+namespace ExGraf {
+
+inline constexpr bool profiling_compiled = EXGRAF_PROFILING != 0;
+
+enum class ProfilePhase : std::uint8_t {
+	Forward,
+	Backward,
+	Accumulate,
+	Optimizer
+};
+
+inline auto phase_name(ProfilePhase phase) -> const char * {
+	switch (phase) {
+	case ProfilePhase::Forward:
+		return "forward";
+	case ProfilePhase::Backward:
+		return "backward";
+	case ProfilePhase::Accumulate:
+		return "accumulate";
+	case ProfilePhase::Optimizer:
+		return "optimizer";
+	}
+	return "unknown";
+}
+
+/// One timed span. `op` names graph nodes by their operation type; other
+/// spans carry a static `label` instead. Trivially copyable so recording is
+/// a store into the thread's ring.
+struct ProfileEvent {
+	const std::type_info *op{nullptr};
+	const char *label{nullptr};
+	ProfilePhase phase{ProfilePhase::Forward};
+	/// The graph node, or -1 outside the graph.
+	std::int32_t node{-1};
+	std::uint32_t thread{0};
+	std::uint64_t start_ns{0};
+	std::uint64_t duration_ns{0};
+	/// Estimated floating-point operations.
+	std::uint64_t flops{0};
+	/// Bytes of the tensors the span requested from its allocator.
+	std::uint64_t bytes{0};
+	/// Shape of the span's result (the output, or the gradient produced).
+	std::uint32_t rows{0}, cols{0};
+
+	auto name() const -> std::string;
+};
+
+/// One row of Profiler::summary(): every span of one name and phase.
+struct OpProfile {
+	std::string name;
+	ProfilePhase phase;
+	std::size_t calls{0};
+	std::uint64_t total_ns{0};
+	std::uint64_t flops{0};
+	std::uint64_t bytes{0};
+
+	auto mean_us() const -> double {
+		return calls ? double(total_ns) / double(calls) / 1e3 : 0.0;
+	}
+	auto gflops() const -> double {
+		return total_ns ? double(flops) / double(total_ns) : 0.0;
+	}
+};
+
+/// Collects spans from ExpressionGraph and Optimizer (see their
+/// `set_profiler`) into one fixed ring per recording thread, so recording
+/// neither locks nor allocates after a thread's first span. A full ring
+/// overwrites its oldest spans.
+///
+/// Export with `write_chrome_trace` (chrome://tracing, Perfetto), as
+/// folded stacks for flamegraph.pl with `write_folded`, or as a per-op table
+/// with `summary()`. Reading is not synchronised with recording: read
+/// between steps, after any executor has finished.
+class Profiler {
+	struct Ring {
+		std::thread::id owner;
+		std::uint32_t index;
+		std::vector<ProfileEvent> events;
+		std::uint64_t written{0};
+	};
+
+	inline static std::atomic<std::uint64_t> next_id{1};
+	const std::uint64_t id{next_id++};
+	const std::size_t capacity;
+	const std::chrono::steady_clock::time_point epoch{
+			std::chrono::steady_clock::now()};
+	mutable std::mutex registration;
+	std::vector<std::unique_ptr<Ring>> rings;
+
+public:
+	/// `events_per_thread` is rounded up to a power of two.
+	explicit Profiler(std::size_t events_per_thread = 1 << 14)
+			: capacity(std::bit_ceil(std::max<std::size_t>(events_per_thread, 1))) {}
+	Profiler(const Profiler &) = delete;
+	auto operator=(const Profiler &) -> Profiler & = delete;
+
+	/// Nanoseconds since the profiler was created.
+	auto now() const -> std::uint64_t {
+		return static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - epoch)
+						.count());
+	}
+
+	auto record(const ProfileEvent &event) -> void {
+		auto &ring = local_ring();
+		ring.events[ring.written++ & (capacity - 1)] = event;
+	}
+
+	/// Forgets every recorded span; rings stay allocated.
+	auto clear() -> void {
+		std::scoped_lock lock(registration);
+		for (auto &ring : rings)
+			ring->written = 0;
+	}
+
+	/// Spans overwritten because a ring was full.
+	auto dropped() const -> std::size_t {
+		std::scoped_lock lock(registration);
+		std::size_t total = 0;
+		for (const auto &ring : rings)
+			total += ring->written > capacity ? ring->written - capacity : 0;
+		return total;
+	}
+
+	/// Every retained span, ordered by start time, with `thread` filled in.
+	auto events() const -> std::vector<ProfileEvent> {
+		std::scoped_lock lock(registration);
+		std::vector<ProfileEvent> out;
+		for (const auto &ring : rings) {
+			const auto kept = std::min<std::uint64_t>(ring->written, capacity);
+			for (auto i = ring->written - kept; i < ring->written; ++i) {
+				out.push_back(ring->events[i & (capacity - 1)]);
+				out.back().thread = ring->index;
+			}
+		}
+		std::ranges::stable_sort(out, {}, &ProfileEvent::start_ns);
+		return out;
+	}
+
+	/// Totals per name and phase, most expensive first.
+	auto summary() const -> std::vector<OpProfile> {
+		std::map<std::pair<std::string, ProfilePhase>, OpProfile> rows;
+		for (const auto &e : events()) {
+			auto key = std::pair{e.name(), e.phase};
+			auto &row = rows[key];
+			row.name = key.first;
+			row.phase = e.phase;
+			++row.calls;
+			row.total_ns += e.duration_ns;
+			row.flops += e.flops;
+			row.bytes += e.bytes;
+		}
+		std::vector<OpProfile> out;
+		for (auto &[_, row] : rows)
+			out.push_back(std::move(row));
+		std::ranges::stable_sort(out, std::greater{}, &OpProfile::total_ns);
+		return out;
+	}
+
+	/// `summary()` as a fixed-width table with each row's share of the total.
+	auto summary_table() const -> std::string {
+		const auto rows = summary();
+		std::uint64_t total = 0;
+		for (const auto &r : rows)
+			total += r.total_ns;
+		std::string out =
+				fmt::format("{:<24}{:<12}{:>8}{:>12}{:>10}{:>8}{:>10}{:>12}\n", "Op",
+										"Phase", "Calls", "Total ms", "Mean us", "Share",
+										"GFLOP/s", "MiB");
+		for (const auto &r : rows) {
+			const auto share =
+					total ? 100.0 * double(r.total_ns) / double(total) : 0.0;
+			out += fmt::format(
+					"{:<24}{:<12}{:>8}{:>12.3f}{:>10.2f}{:>7.1f}%{:>10.2f}{:>12.2f}\n",
+					r.name, phase_name(r.phase), r.calls, double(r.total_ns) / 1e6,
+					r.mean_us(), share, r.gflops(), double(r.bytes) / double(1 << 20));
+		}
+		out += fmt::format("{:<44}{:>12.3f}\n", "Total", double(total) / 1e6);
+		return out;
+	}
+
+	/// Chrome trace_event JSON: one complete ("X") event per span.
+	auto write_chrome_trace(std::ostream &out) const -> void {
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		for (const auto &e : events()) {
+			out << (first ? "\n" : ",\n");
+			first = false;
+			out << fmt::format(
+					"{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,"
+					"\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"node\":{},"
+					"\"flops\":{},\"bytes\":{},\"shape\":\"{}x{}\"}}}}",
+					e.name(), phase_name(e.phase), e.thread, double(e.start_ns) / 1e3,
+					double(e.duration_ns) / 1e3, e.node, e.flops, e.bytes, e.rows,
+					e.cols);
+		}
+		out << "\n]}\n";
+	}
+
+	/// Folded stacks ("phase;op microseconds" per line) for flamegraph.pl and
+	/// speedscope.
+	auto write_folded(std::ostream &out) const -> void {
+		for (const auto &r : summary())
+			out << phase_name(r.phase) << ';' << r.name << ' '
+					<< (r.total_ns + 500) / 1000 << '\n';
+	}
+
+private:
+	auto local_ring() -> Ring & {
+		struct Cached {
+			std::uint64_t profiler{0};
+			Ring *ring{nullptr};
+		};
+		thread_local Cached cached;
+		if (cached.profiler == id)
+			return *cached.ring;
+		std::scoped_lock lock(registration);
+		const auto self = std::this_thread::get_id();
+		auto found = std::ranges::find(rings, self, &Ring::owner);
+		if (found == rings.end()) {
+			rings.push_back(std::make_unique<Ring>(
+					Ring{self, static_cast<std::uint32_t>(rings.size()),
+							 std::vector<ProfileEvent>(capacity)}));
+			found = std::prev(rings.end());
+		}
+		cached = {id, found->get()};
+		return **found;
+	}
+};
+
+/// "ExGraf::Binary::MatMulOp<float>" becomes "MatMulOp".
+inline auto ProfileEvent::name() const -> std::string {
+	if (!op)
+		return label ? label : "";
+	int status = 0;
+	std::unique_ptr<char, decltype(&std::free)> demangled(
+			abi::__cxa_demangle(op->name(), nullptr, nullptr, &status), &std::free);
+	std::string full = status == 0 ? demangled.get() : op->name();
+	full = full.substr(0, full.find('<'));
+	const auto scope = full.rfind("::");
+	return scope == std::string::npos ? full : full.substr(scope + 2);
+}
+
+/// Times its own lifetime into `profiler` under `label`; does nothing when
+/// `profiler` is null or profiling is compiled out.
+class ProfileScope {
+	Profiler *profiler;
+	ProfileEvent event;
+
+public:
+	ProfileScope(Profiler *p, const char *label, ProfilePhase phase)
+			: profiler(profiling_compiled ? p : nullptr) {
+		if (profiler) {
+			event.label = label;
+			event.phase = phase;
+			event.start_ns = profiler->now();
+		}
+	}
+	ProfileScope(const ProfileScope &) = delete;
+	auto operator=(const ProfileScope &) -> ProfileScope & = delete;
+	~ProfileScope() {
+		if (profiler) {
+			event.duration_ns = profiler->now() - event.start_ns;
+			profiler->record(event);
+		}
+	}
+
+	auto set_flops(std::uint64_t flops) -> void { event.flops = flops; }
+};
+
+} // namespace ExGraf
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "exgraf/cpu_features.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if EXGRAF_X86
+#include <immintrin.h>
+#endif
+
+namespace ExGraf::Kernels {
+
+/// Maps reals to 8-bit codes: real = scale * (q - zero_point).
+struct QuantParams {
+	float scale{1.0F};
+	std::int32_t zero_point{0};
+};
+
+/// Unsigned 8-bit parameters covering [lo, hi]. The range is widened to
+/// contain 0 so that zero (ReLU output, padding) is represented exactly.
+inline auto affine_u8(float lo, float hi) -> QuantParams {
+	lo = std::min(lo, 0.0F);
+	hi = std::max(hi, 0.0F);
+	if (hi - lo <= 0.0F)
+		return {};
+	const float scale = (hi - lo) / 255.0F;
+	const auto zero = static_cast<std::int32_t>(std::lround(-lo / scale));
+	return {scale, std::clamp(zero, 0, 255)};
+}
+
+inline auto quantize_u8(float value, float inv_scale, std::int32_t zero)
+		-> std::uint8_t {
+	const auto q = static_cast<std::int32_t>(std::lrintf(value * inv_scale));
+	return static_cast<std::uint8_t>(std::clamp(q + zero, 0, 255));
+}
+
+/// Implementations of the u8 x s8 dot products behind the int8 GEMM.
+enum class DotKernel : std::uint8_t { Scalar, AVX2, VNNI };
+
+inline auto detect_dot_kernel() -> DotKernel {
+	if (vnni_supported())
+		return DotKernel::VNNI;
+	if (detect_isa() == Isa::AVX2)
+		return DotKernel::AVX2;
+	return DotKernel::Scalar;
+}
+
+inline auto dot_kernel_supported(DotKernel kernel) -> bool {
+	switch (kernel) {
+	case DotKernel::Scalar:
+		return true;
+	case DotKernel::AVX2:
+		return isa_supported(Isa::AVX2);
+	case DotKernel::VNNI:
+		return vnni_supported();
+	}
+	return false;
+}
+
+inline auto dot_kernel_name(DotKernel kernel) -> std::string_view {
+	switch (kernel) {
+	case DotKernel::Scalar:
+		return "scalar";
+	case DotKernel::AVX2:
+		return "avx2";
+	case DotKernel::VNNI:
+		return "avx-vnni";
+	}
+	return "unknown";
+}
+
+/// Depth (reduction length) and column count are padded to these, so every
+/// kernel runs whole vectors over whole column blocks.
+inline constexpr std::size_t int8_depth_multiple = 32;
+inline constexpr std::size_t int8_column_block = 4;
+
+inline auto int8_padded(std::size_t n, std::size_t multiple) -> std::size_t {
+	return (n + multiple - 1) / multiple * multiple;
+}
+
+namespace Detail {
+
+// acc[j] = sum_k a[k] * b[j * depth + k] for four adjacent columns of b.
+inline auto dot4_scalar(const std::uint8_t *a, const std::int8_t *b,
+												std::size_t depth, std::int32_t *acc) -> void {
+	for (std::size_t j = 0; j < 4; ++j) {
+		const std::int8_t *column = b + j * depth;
+		std::int32_t sum = 0;
+		for (std::size_t k = 0; k < depth; ++k)
+			sum += std::int32_t(a[k]) * std::int32_t(column[k]);
+		acc[j] = sum;
+	}
+}
+
+#if EXGRAF_X86
+// Four 8-lane accumulators to one int32 per column.
+__attribute__((target("avx2"))) inline auto
+reduce4(__m256i a0, __m256i a1, __m256i a2, __m256i a3, std::int32_t *acc)
+		-> void {
+	const __m256i s =
+			_mm256_hadd_epi32(_mm256_hadd_epi32(a0, a1), _mm256_hadd_epi32(a2, a3));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(acc),
+									 _mm_add_epi32(_mm256_castsi256_si128(s),
+																 _mm256_extracti128_si256(s, 1)));
+}
+
+// AVX2 has no u8 x s8 product that cannot saturate (vpmaddubsw sums pairs
+// into int16), so both sides are widened to int16 and multiplied with
+// vpmaddwd, which sums pairs into int32 exactly.
+__attribute__((target("avx2"))) inline auto
+dot4_avx2(const std::uint8_t *a, const std::int8_t *b, std::size_t depth,
+					std::int32_t *acc) -> void {
+	__m256i sums[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(),
+										 _mm256_setzero_si256(), _mm256_setzero_si256()};
+	for (std::size_t k = 0; k < depth; k += 16) {
+		const __m256i x = _mm256_cvtepu8_epi16(
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + k)));
+		for (std::size_t j = 0; j < 4; ++j) {
+			const __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128(
+					reinterpret_cast<const __m128i *>(b + j * depth + k)));
+			sums[j] = _mm256_add_epi32(sums[j], _mm256_madd_epi16(x, w));
+		}
+	}
+	reduce4(sums[0], sums[1], sums[2], sums[3], acc);
+}
+
+// vpdpbusd multiplies u8 by s8 and adds each group of four into an int32
+// lane without intermediate saturation: 32 products per instruction.
+__attribute__((target("avx2,avxvnni"))) inline auto
+dot4_vnni(const std::uint8_t *a, const std::int8_t *b, std::size_t depth,
+					std::int32_t *acc) -> void {
+	__m256i sums[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(),
+										 _mm256_setzero_si256(), _mm256_setzero_si256()};
+	for (std::size_t k = 0; k < depth; k += 32) {
+		const __m256i x =
+				_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + k));
+		for (std::size_t j = 0; j < 4; ++j)
+			sums[j] = _mm256_dpbusd_avx_epi32(
+					sums[j], x,
+					_mm256_loadu_si256(
+							reinterpret_cast<const __m256i *>(b + j * depth + k)));
+	}
+	reduce4(sums[0], sums[1], sums[2], sums[3], acc);
+}
+#endif
+
+} // namespace Detail
+
+/// Integer GEMM: for every row r of `a` (u8, row-major, `depth` per row) and
+/// column block of `b` (s8, one column of `depth` after another), calls
+/// `epilogue(r, j, acc)` with the int32 dot products of columns j..j+3.
+/// `depth` must be a multiple of int8_depth_multiple and `columns` of
+/// int8_column_block; pad both operands with zeros.
+///
+/// The epilogue sees each accumulator once, straight from the dot product,
+/// so scaling, bias, activation and requantization cost no extra pass over
+/// the output.
+template <typename Epilogue>
+auto gemm_u8s8(const std::uint8_t *a, std::size_t rows, const std::int8_t *b,
+							 std::size_t columns, std::size_t depth, Epilogue &&epilogue,
+							 DotKernel kernel = detect_dot_kernel()) -> void {
+	alignas(16) std::int32_t acc[4];
+	for (std::size_t r = 0; r < rows; ++r) {
+		const std::uint8_t *row = a + r * depth;
+		for (std::size_t j = 0; j < columns; j += 4) {
+			const std::int8_t *block = b + j * depth;
+#if EXGRAF_X86
+			if (kernel == DotKernel::VNNI)
+				Detail::dot4_vnni(row, block, depth, acc);
+			else if (kernel == DotKernel::AVX2)
+				Detail::dot4_avx2(row, block, depth, acc);
+			else
+#endif
+				Detail::dot4_scalar(row, block, depth, acc);
+			epilogue(r, j, acc);
+		}
+	}
+}
+
+} // namespace ExGraf::Kernels
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/layers.hpp"
+#include "exgraf/quantization/int8_kernels.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <armadillo>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ExGraf {
+
+/// Float versus int8 predictions on one labelled set; see accuracy_report.
+struct QuantizationReport {
+	std::size_t samples{0};
+	double float_accuracy{0.0};
+	double int8_accuracy{0.0};
+	/// Fraction of samples where both models pick the same class.
+	double agreement{0.0};
+	/// Absolute difference between the two models' outputs.
+	double max_abs_delta{0.0};
+	double mean_abs_delta{0.0};
+	std::size_t float_bytes{0};
+	std::size_t int8_bytes{0};
+
+	auto to_string() const -> std::string {
+		return fmt::format(
+				"{} samples: accuracy {:.4f} (float) vs {:.4f} (int8), delta "
+				"{:+.4f}; agreement {:.4f}; output delta max {:.5f} mean {:.5f}; "
+				"{} -> {} bytes ({:.2f}x smaller)\n",
+				samples, float_accuracy, int8_accuracy,
+				int8_accuracy - float_accuracy, agreement, max_abs_delta,
+				mean_abs_delta, float_bytes, int8_bytes,
+				double(float_bytes) / double(int8_bytes));
+	}
+};
+
+/// An int8 copy of a trained MLP for inference.
+///
+/// `calibrate` runs a sample batch through the float model to find the
+/// range of each Linear layer's input, then stores the layer with
+/// per-output-channel symmetric int8 weights. At inference, activations are
+/// unsigned 8-bit with a per-layer scale and zero point, each Linear is one
+/// u8 x s8 -> s32 GEMM (Kernels::gemm_u8s8), and its epilogue applies the
+/// scales, the bias, a following ReLU and the next layer's quantization in
+/// one step, so only int8 codes travel between layers. The last layer's
+/// output is produced in T, followed by Softmax if the model ends in one.
+///
+/// Supports stacks of Linear, ReLU, Dropout (the identity at inference) and
+/// a final Softmax; other layers throw std::invalid_argument.
+template <AllowedTypes T> class QuantizedModel {
+	struct Stage {
+		std::size_t inputs{0};
+		std::size_t outputs{0};
+		// Padded sizes, see int8_depth_multiple and int8_column_block.
+		std::size_t depth{0};
+		std::size_t columns{0};
+		Kernels::QuantParams input;
+		// `columns` runs of `depth` codes, one per output channel.
+		std::vector<std::int8_t> weights;
+		// y = scale * acc + offset: the input and channel scales multiplied,
+		// and the bias minus the input zero point's contribution.
+		std::vector<float> scale;
+		std::vector<float> offset;
+		bool relu{false};
+	};
+
+	std::vector<Stage> stages;
+	bool softmax{false};
+	Layers::Softmax<T> softmax_layer;
+	// Input codes of the current and the next stage.
+	std::array<std::vector<std::uint8_t>, 2> codes;
+
+	static auto make_stage(const arma::Mat<T> &w, const arma::Mat<T> *bias,
+												 const arma::Mat<T> &activations) -> Stage {
+		Stage stage;
+		stage.inputs = w.n_rows;
+		stage.outputs = w.n_cols;
+		stage.depth = Kernels::int8_padded(w.n_rows, Kernels::int8_depth_multiple);
+		stage.columns =
+				Kernels::int8_padded(w.n_cols, Kernels::int8_column_block);
+		stage.input = Kernels::affine_u8(float(activations.min()),
+																		 float(activations.max()));
+		stage.weights.assign(stage.columns * stage.depth, 0);
+		stage.scale.assign(stage.outputs, 0.0F);
+		stage.offset.assign(stage.outputs, 0.0F);
+		for (std::size_t j = 0; j < stage.outputs; ++j) {
+			const T *column = w.colptr(j);
+			T largest = T(0);
+			for (std::size_t k = 0; k < w.n_rows; ++k)
+				largest = std::max(largest, std::abs(column[k]));
+			const float channel = largest > T(0) ? float(largest) / 127.0F : 1.0F;
+			std::int32_t sum = 0;
+			for (std::size_t k = 0; k < w.n_rows; ++k) {
+				const auto q = std::clamp<long>(
+						std::lround(float(column[k]) / channel), -127, 127);
+				stage.weights[j * stage.depth + k] = static_cast<std::int8_t>(q);
+				sum += static_cast<std::int32_t>(q);
+			}
+			stage.scale[j] = stage.input.scale * channel;
+			stage.offset[j] = (bias ? float((*bias)(0, j)) : 0.0F) -
+												stage.scale[j] * float(stage.input.zero_point * sum);
+		}
+		return stage;
+	}
+
+	static auto apply_relu(arma::Mat<T> &m) -> void {
+		T *p = m.memptr();
+		for (std::size_t i = 0; i < m.n_elem; ++i)
+			p[i] = std::max(p[i], T(0));
+	}
+
+public:
+	/// Quantizes `model`, calibrating activation ranges on `calibration`
+	/// (a few hundred representative samples, one per row).
+	static auto calibrate(const Sequential<T> &model,
+												const Tensor<T> &calibration) -> QuantizedModel {
+		QuantizedModel result;
+		arma::Mat<T> activations = *calibration.data;
+		const auto unsupported = [](const std::string &why) {
+			throw std::invalid_argument("QuantizedModel: " + why);
+		};
+		for (const auto &layer : model.layers()) {
+			if (result.softmax)
+				unsupported("Softmax must be the last layer.");
+			if (const auto *linear =
+							dynamic_cast<const Layers::Linear<T> *>(layer.get())) {
+				result.stages.push_back(
+						make_stage(linear->weights(), linear->bias(), activations));
+				arma::Mat<T> next = activations * linear->weights();
+				if (linear->bias())
+					next.each_row() += *linear->bias();
+				activations = std::move(next);
+			} else if (dynamic_cast<const Layers::ReLU<T> *>(layer.get())) {
+				if (result.stages.empty())
+					unsupported("ReLU must follow a Linear layer.");
+				result.stages.back().relu = true;
+				apply_relu(activations);
+			} else if (dynamic_cast<const Layers::Softmax<T> *>(layer.get())) {
+				result.softmax = true;
+			} else if (!dynamic_cast<const Layers::Dropout<T> *>(layer.get())) {
+				unsupported(layer->name() + " layers cannot be quantized.");
+			}
+		}
+		if (result.stages.empty())
+			unsupported("the model has no Linear layer.");
+		return result;
+	}
+
+	auto input_features() const -> std::size_t { return stages.front().inputs; }
+
+	/// Bytes of the int8 weights plus the per-channel float scales and
+	/// offsets, excluding padding.
+	auto parameter_bytes() const -> std::size_t {
+		std::size_t total = 0;
+		for (const auto &s : stages)
+			total += s.inputs * s.outputs + 2 * s.outputs * sizeof(float);
+		return total;
+	}
+
+	/// Inference on `input`, one sample per row. Scratch code buffers are
+	/// kept between calls; only the returned output is allocated.
+	auto predict(const Tensor<T> &input,
+							 Kernels::DotKernel kernel = Kernels::detect_dot_kernel())
+			-> Tensor<T> {
+		const auto &x = *input.data;
+		if (x.n_cols != input_features())
+			throw std::invalid_argument(
+					"QuantizedModel::predict: input width does not match the model.");
+		const std::size_t n = x.n_rows;
+		const auto &first = stages.front();
+		codes[0].resize(n * first.depth);
+		const float inv_first = 1.0F / first.input.scale;
+		for (std::size_t c = 0; c < first.inputs; ++c) {
+			const T *column = x.colptr(c);
+			for (std::size_t r = 0; r < n; ++r)
+				codes[0][r * first.depth + c] = Kernels::quantize_u8(
+						float(column[r]), inv_first, first.input.zero_point);
+		}
+
+		Tensor<T> result(Shape{n, stages.back().outputs});
+		std::size_t side = 0;
+		for (std::size_t i = 0; i < stages.size(); ++i) {
+			const auto &stage = stages[i];
+			const auto output = [&](std::size_t j, std::int32_t acc) {
+				const float y = stage.scale[j] * float(acc) + stage.offset[j];
+				return stage.relu ? std::max(y, 0.0F) : y;
+			};
+			if (i + 1 == stages.size()) {
+				auto &out = *result.data;
+				Kernels::gemm_u8s8(
+						codes[side].data(), n, stage.weights.data(), stage.columns,
+						stage.depth,
+						[&](std::size_t r, std::size_t j, const std::int32_t *acc) {
+							const auto end = std::min(j + 4, stage.outputs);
+							for (std::size_t c = j; c < end; ++c)
+								out.colptr(c)[r] = T(output(c, acc[c - j]));
+						},
+						kernel);
+				break;
+			}
+			const auto &next = stages[i + 1];
+			auto &target = codes[side ^ 1];
+			target.resize(n * next.depth);
+			const float inv_next = 1.0F / next.input.scale;
+			Kernels::gemm_u8s8(
+					codes[side].data(), n, stage.weights.data(), stage.columns,
+					stage.depth,
+					[&](std::size_t r, std::size_t j, const std::int32_t *acc) {
+						const auto end = std::min(j + 4, stage.outputs);
+						for (std::size_t c = j; c < end; ++c)
+							target[r * next.depth + c] = Kernels::quantize_u8(
+									output(c, acc[c - j]), inv_next, next.input.zero_point);
+					},
+					kernel);
+			side ^= 1;
+		}
+		if (softmax)
+			softmax_layer.infer(*result.data, *result.data);
+		return result;
+	}
+};
+
+namespace Detail {
+
+template <AllowedTypes T>
+auto predicted_classes(const arma::Mat<T> &output) -> std::vector<std::size_t> {
+	std::vector<std::size_t> best(output.n_rows, 0);
+	for (std::size_t c = 1; c < output.n_cols; ++c)
+		for (std::size_t r = 0; r < output.n_rows; ++r)
+			if (output(r, c) > output(r, best[r]))
+				best[r] = c;
+	return best;
+}
+
+} // namespace Detail
+
+/// Runs `x` through both models and compares them against `labels`.
+template <AllowedTypes T>
+auto accuracy_report(Sequential<T> &model, QuantizedModel<T> &quantized,
+										 const Tensor<T> &x, const arma::Col<std::size_t> &labels)
+		-> QuantizationReport {
+	if (labels.n_elem != x.data->n_rows)
+		throw std::invalid_argument(
+				"accuracy_report: expected one label per sample.");
+	const auto reference = model.predict(x);
+	const auto approximate = quantized.predict(x);
+	const auto &a = *reference.data;
+	const auto &b = *approximate.data;
+	const auto expected = Detail::predicted_classes(a);
+	const auto actual = Detail::predicted_classes(b);
+
+	QuantizationReport report;
+	report.samples = labels.n_elem;
+	std::size_t float_correct = 0, int8_correct = 0, same = 0;
+	for (std::size_t r = 0; r < labels.n_elem; ++r) {
+		float_correct += expected[r] == labels(r);
+		int8_correct += actual[r] == labels(r);
+		same += expected[r] == actual[r];
+	}
+	const auto n = double(std::max<std::size_t>(report.samples, 1));
+	report.float_accuracy = double(float_correct) / n;
+	report.int8_accuracy = double(int8_correct) / n;
+	report.agreement = double(same) / n;
+	double total = 0.0;
+	for (std::size_t i = 0; i < a.n_elem; ++i) {
+		const double delta = std::abs(double(a(i)) - double(b(i)));
+		report.max_abs_delta = std::max(report.max_abs_delta, delta);
+		total += delta;
+	}
+	report.mean_abs_delta = total / double(std::max<std::size_t>(a.n_elem, 1));
+	report.float_bytes = model.summary().parameter_bytes(sizeof(T));
+	report.int8_bytes = quantized.parameter_bytes();
+	return report;
+}
+
+} // namespace ExGraf
@@ -0,0 +1,463 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/binary_operation.hpp"
+#include "exgraf/expression_graph.hpp"
+#include "exgraf/flat_buffer.hpp"
+#include "exgraf/fused_operation.hpp"
+#include "exgraf/inference_mode.hpp"
+#include "exgraf/layer.hpp"
+#include "exgraf/loaders/decode_kernels.hpp"
+#include "exgraf/loss_scaler.hpp"
+#include "exgraf/optimizer.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ExGraf {
+
+/// One row of Sequential::summary().
+struct LayerSummary {
+	std::string name;
+	/// Per-sample output shape.
+	Shape output;
+	std::size_t output_features;
+	std::size_t parameters;
+	/// Forward FLOPs per sample.
+	std::size_t flops;
+};
+
+struct ModelSummary {
+	Shape input;
+	std::vector<LayerSummary> layers;
+
+	auto parameters() const -> std::size_t {
+		std::size_t total = 0;
+		for (const auto &l : layers)
+			total += l.parameters;
+		return total;
+	}
+	auto flops() const -> std::size_t {
+		std::size_t total = 0;
+		for (const auto &l : layers)
+			total += l.flops;
+		return total;
+	}
+	/// Parameter bytes at `bytes_per_parameter` each (4 for float).
+	auto parameter_bytes(std::size_t bytes_per_parameter) const -> std::size_t {
+		return parameters() * bytes_per_parameter;
+	}
+	/// A fixed-width table, one line per layer plus a total.
+	auto to_string() const -> std::string {
+		std::string out = fmt::format("{:<4}{:<11}{:>14}{:>14}{:>16}\n", "#",
+																	"Layer", "Output", "Parameters",
+																	"FLOPs/sample");
+		for (std::size_t i = 0; i < layers.size(); ++i) {
+			const auto &l = layers[i];
+			const auto shape = fmt::format("{}", fmt::join(l.output.dims(), "x"));
+			out += fmt::format("{:<4}{:<11}{:>14}{:>14}{:>16}\n", i, l.name, shape,
+												 l.parameters, l.flops);
+		}
+		out += fmt::format("{:<15}{:>14}{:>14}{:>16}\n", "Total", "",
+											 parameters(), flops());
+		return out;
+	}
+};
+
+/// A feed-forward stack of layers trained as one model.
+///
+/// Construction infers every layer's input shape from the one before, then
+/// lays all parameters out back to back in one FlatBuffer (and their
+/// gradients in another), registers them with the optimizer and initializes
+/// them. `forward` records each layer on the model's ExpressionGraph in
+/// order.
+template <AllowedTypes T> class Sequential {
+	ExpressionGraph<T> graph;
+	std::vector<std::reference_wrapper<Tensor<T>>> parameters;
+	std::unique_ptr<Optimizer<T>> optimizer;
+	Shape input_shape;
+	std::vector<std::unique_ptr<Layer<T>>> stack;
+	std::vector<Shape> shapes;
+	FlatBuffer<T> weights;
+	FlatBuffer<T> gradients;
+	// Sized once; layers keep spans into it.
+	std::vector<Tensor<T>> tensors;
+	Tensor<T> loss;
+	bool fusion{true};
+	bool training{true};
+	// Inference: per-layer output features and the two buffers layers read
+	// from and write to in turn.
+	std::vector<std::size_t> widths;
+	std::array<std::vector<T>, 2> ping_pong;
+	// Matrix views onto ping_pong, re-seated for each layer's output.
+	std::array<std::optional<arma::Mat<T>>, 2> stage;
+	// Mixed precision: the operand format and, unless FP32, the loss scale.
+	// Replicas read their model's scale through `origin`.
+	Storage precision{Storage::FP32};
+	std::optional<LossScaler<T>> scaler;
+	const Sequential *origin{nullptr};
+
+	struct Replica {};
+	Sequential(const Sequential &primary, std::size_t index, Replica)
+			: input_shape(primary.input_shape), shapes(primary.shapes),
+				gradients(shapes), fusion(primary.fusion),
+				precision(primary.precision), origin(&primary) {
+		for (const auto &layer : primary.stack)
+			stack.push_back(layer->replica(index));
+		for (const auto &p : primary.tensors)
+			tensors.emplace_back(p.data);
+		bind_layers();
+		enable_fusion(fusion);
+		graph.set_operand_storage(precision);
+	}
+
+	auto bind_layers() -> void {
+		parameters.assign(tensors.begin(), tensors.end());
+		for (std::size_t i = 0; i < tensors.size(); ++i)
+			tensors[i].grad = std::make_shared<Tensor<T>>(gradients.view(i));
+		std::size_t first = 0;
+		Shape in = input_shape;
+		widths.clear();
+		for (auto &layer : stack) {
+			const auto count = layer->parameter_shapes(in).size();
+			layer->bind(in, std::span<Tensor<T>>(tensors).subspan(first, count));
+			first += count;
+			in = layer->output_shape(in);
+			widths.push_back(in.total_elements());
+		}
+	}
+
+	/// Runs rows [first, first + rows) of `x` through the stack without the
+	/// graph. Each layer writes into the buffer its input is not in, and
+	/// in-place layers overwrite their input, so the whole network touches
+	/// two buffers. The result views one of them.
+	auto infer_rows(const arma::Mat<T> &x, std::size_t first, std::size_t rows)
+			-> const arma::Mat<T> & {
+		auto widest = *std::ranges::max_element(widths);
+		if (rows != x.n_rows)
+			widest = std::max<std::size_t>(widest, x.n_cols);
+		for (auto &buffer : ping_pong)
+			if (buffer.size() < rows * widest)
+				buffer.resize(rows * widest);
+
+		const arma::Mat<T> *current = &x;
+		std::size_t side = 0;
+		if (rows != x.n_rows) {
+			auto &chunk = stage[0].emplace(ping_pong[0].data(), rows, x.n_cols,
+																		 false, true);
+			for (std::size_t c = 0; c < x.n_cols; ++c)
+				std::copy_n(x.colptr(c) + first, rows, chunk.colptr(c));
+			current = &chunk;
+			side = 1;
+		}
+		for (std::size_t i = 0; i < stack.size(); ++i) {
+			auto &layer = *stack[i];
+			if (layer.in_place() && current != &x) {
+				auto &own = *stage[side ^ 1];
+				layer.infer(own, own);
+				continue;
+			}
+			auto &next = stage[side].emplace(ping_pong[side].data(), rows,
+																			 widths[i], false, true);
+			layer.infer(*current, next);
+			current = &next;
+			side ^= 1;
+		}
+		return *current;
+	}
+
+public:
+	/// `sample` is one input sample's shape, e.g. {784} or {1, 28, 28}.
+	Sequential(const Shape &sample,
+						 std::vector<std::unique_ptr<Layer<T>>> layers,
+						 std::unique_ptr<Optimizer<T>> opt)
+			: optimizer(std::move(opt)), input_shape(sample),
+				stack(std::move(layers)) {
+		if (sample.size() == 0 || sample.total_elements() == 0 || stack.empty())
+			throw std::invalid_argument(
+					"Sequential: needs an input shape and at least one layer.");
+		Shape in = input_shape;
+		for (const auto &layer : stack) {
+			for (const auto &shape : layer->parameter_shapes(in))
+				shapes.push_back(shape);
+			in = layer->output_shape(in);
+		}
+		weights = FlatBuffer<T>(shapes);
+		gradients = FlatBuffer<T>(shapes);
+		tensors.reserve(shapes.size());
+		for (std::size_t i = 0; i < shapes.size(); ++i)
+			tensors.emplace_back(weights.view(i));
+		bind_layers();
+		for (auto &layer : stack)
+			layer->initialize();
+		for (auto &p : parameters)
+			optimizer->register_tensor(p);
+		enable_fusion(fusion);
+	}
+
+	/// Sequential(in, optimizer, Linear<T>(256), ReLU<T>(), ...).
+	template <std::derived_from<Layer<T>>... Ls>
+	Sequential(const Shape &sample, std::unique_ptr<Optimizer<T>> opt,
+						 Ls... layers)
+			: Sequential(sample, make_stack(std::move(layers)...), std::move(opt)) {
+	}
+
+	/// Flat samples of `in_features` values.
+	template <std::derived_from<Layer<T>>... Ls>
+	Sequential(std::size_t in_features, std::unique_ptr<Optimizer<T>> opt,
+						 Ls... layers)
+			: Sequential(Shape{in_features}, make_stack(std::move(layers)...),
+									 std::move(opt)) {}
+
+	/// A model sharing this one's parameter storage but recording its own
+	/// graph and gradients. Replicas have no optimizer and must not `step()`;
+	/// see DataParallelTrainer. `index` (1 and up; 0 is this model) gives
+	/// each replica's random layers a stream of their own.
+	auto replicate(std::size_t index) const -> std::unique_ptr<Sequential<T>> {
+		return std::unique_ptr<Sequential<T>>(
+				new Sequential(*this, index, Replica{}));
+	}
+
+	/// Records the stack on the graph, or runs `predict` under an
+	/// InferenceMode guard.
+	auto forward(const Tensor<T> &input) -> Tensor<T> {
+		if (InferenceMode::active())
+			return predict(input);
+		if (input.data->n_cols != input_shape.total_elements())
+			throw std::invalid_argument(
+					"Sequential::forward: input width does not match the model.");
+		// The graph keeps pointers to leaf inputs, so the first recorded layer
+		// must read the caller's tensor, not a local copy. Layers that return
+		// their input unchanged (Dropout at inference) leave it in place.
+		const Tensor<T> *x = &input;
+		Tensor<T> current;
+		for (auto &layer : stack) {
+			auto next = layer->forward(graph, *x, training);
+			if (next.data == x->data)
+				continue;
+			current = std::move(next);
+			x = &current;
+		}
+		return *x;
+	}
+
+	/// Inference on `input`, `batch_size` rows at a time (0: all at once).
+	/// Nothing is recorded and dropout is off; only the returned output is
+	/// allocated, the layers share two buffers kept between calls.
+	auto predict(const Tensor<T> &input, std::size_t batch_size = 0)
+			-> Tensor<T> {
+		const auto &x = *input.data;
+		if (x.n_cols != input_shape.total_elements())
+			throw std::invalid_argument(
+					"Sequential::predict: input width does not match the model.");
+		const std::size_t n = input.n_rows();
+		const std::size_t offset = input.window ? input.window->first : 0;
+		const auto chunk = batch_size == 0 ? n : std::min(batch_size, n);
+		Tensor<T> result(Shape{n, widths.back()});
+		if (n == 0)
+			return result;
+		for (std::size_t first = 0; first < n; first += chunk) {
+			const auto rows = std::min(chunk, n - first);
+			const auto &out = infer_rows(x, offset + first, rows);
+			for (std::size_t c = 0; c < out.n_cols; ++c)
+				std::copy_n(out.colptr(c), rows, result.data->colptr(c) + first);
+		}
+		return result;
+	}
+
+	auto compute_loss(const Tensor<T> &output, const Tensor<T> &target) -> T {
+		loss = graph.template add_operation<Binary::CrossEntropyLoss<T>>(
+				{output, target});
+		return loss.data->at(0);
+	}
+
+	/// Backpropagates the loss, scaled under mixed precision.
+	auto backward() -> void {
+		const auto *s = loss_scaler();
+		graph.backward(loss, s ? s->scale() : T(1));
+	}
+
+	/// Applies the optimizer and rewinds the graph for the next batch. Under
+	/// mixed precision the gradients are unscaled first, and a step whose
+	/// gradients are not finite is skipped (see LossScaler).
+	auto step() -> void {
+		settle_grads();
+		if (!scaler || scaler->unscale({gradients.data(), gradients.size()}))
+			optimizer->step(parameters);
+		reset_graph();
+	}
+
+	/// Mixed precision from the next step on: matrix products keep their
+	/// operands in `format` (BF16 or FP16) and accumulate in T, the
+	/// optimizer keeps T master weights while the parameters hold them
+	/// rounded to `format`, and the loss is scaled dynamically. FP32 turns
+	/// it off. Replicas share the loss scale; those made afterwards also
+	/// multiply in `format`.
+	auto set_mixed_precision(Storage format,
+													 typename LossScaler<T>::Options scaling = {})
+			-> void {
+		if (!optimizer)
+			throw std::logic_error(
+					"Sequential::set_mixed_precision: replicas follow their model.");
+		optimizer->keep_master_weights(format);
+		graph.set_operand_storage(format);
+		precision = format;
+		if (format == Storage::FP32)
+			scaler.reset();
+		else
+			scaler.emplace(scaling);
+	}
+
+	/// The loss scale in use; nullptr without mixed precision.
+	auto loss_scaler() const -> const LossScaler<T> * {
+		const auto &s = origin ? origin->scaler : scaler;
+		return s ? &*s : nullptr;
+	}
+
+	/// Rewinds the graph without touching the parameters.
+	auto reset_graph() -> void { graph.reset(); }
+
+	auto params() -> std::vector<std::reference_wrapper<Tensor<T>>> & {
+		return parameters;
+	}
+
+	/// Every parameter value back to back, in `parameter_shapes()` order.
+	auto parameter_values() const -> std::span<const T> {
+		return {weights.data(), weights.size()};
+	}
+
+	auto parameter_shapes() const -> const std::vector<Shape> & {
+		return shapes;
+	}
+
+	/// Moves the parameters onto `storage`, laid out as `parameter_values()`
+	/// and kept alive by the model. Replicas made before keep the old values.
+	auto adopt_parameters(std::shared_ptr<T[]> storage) -> void {
+		weights = FlatBuffer<T>(shapes, std::move(storage));
+		for (std::size_t i = 0; i < tensors.size(); ++i)
+			tensors[i].data = weights.view(i);
+	}
+
+	/// The optimizer's step count and state; empty for replicas.
+	auto optimizer_state() const -> OptimizerState<T> {
+		return optimizer ? optimizer->export_state() : OptimizerState<T>{};
+	}
+
+	auto restore_optimizer_state(const OptimizerState<T> &state) -> void {
+		if (!optimizer)
+			throw std::logic_error(
+					"Sequential::restore_optimizer_state: replicas have no optimizer.");
+		optimizer->import_state(parameters, state);
+	}
+
+	auto layers() const -> const std::vector<std::unique_ptr<Layer<T>>> & {
+		return stack;
+	}
+
+	/// Per-layer output shape, parameter count and forward FLOPs per sample.
+	auto summary() const -> ModelSummary {
+		ModelSummary result{input_shape, {}};
+		Shape in = input_shape;
+		for (const auto &layer : stack) {
+			std::size_t count = 0;
+			for (const auto &shape : layer->parameter_shapes(in))
+				count += shape.total_elements();
+			const auto out = layer->output_shape(in);
+			result.layers.push_back(
+					{layer->name(), out, out.total_elements(), count, layer->flops(in)});
+			in = out;
+		}
+		return result;
+	}
+
+	/// Training mode turns Dropout on; it is on by default.
+	auto set_training(bool enabled) -> void { training = enabled; }
+
+	/// Fuses Linear+ReLU and Softmax+CrossEntropy from the next step on.
+	auto enable_fusion(bool enabled) -> void {
+		fusion = enabled;
+		graph.set_fusion_patterns(enabled ? Fused::default_patterns<T>()
+																			: std::vector<FusionPattern<T>>{});
+	}
+
+	/// Schedules backward on `executor`; nullptr walks it on this thread.
+	auto set_executor(tf::Executor *executor) -> void {
+		graph.set_executor(executor);
+	}
+
+	/// Splits the optimizer step across `executor`; nullptr runs it inline.
+	auto set_optimizer_executor(tf::Executor *executor) -> void {
+		optimizer->set_executor(executor);
+	}
+
+	/// Records the graph's spans and the optimizer's steps into `p`; nullptr
+	/// stops recording.
+	auto set_profiler(Profiler *p) -> void {
+		graph.set_profiler(p);
+		if (optimizer)
+			optimizer->set_profiler(p);
+	}
+
+	auto expression_graph() const -> const ExpressionGraph<T> & {
+		return graph;
+	}
+
+	/// Clears every gradient lazily (see Tensor::zero_grad): the next
+	/// backward overwrites them rather than adding to zeroed buffers.
+	auto zero_grad() -> void {
+		for (auto &p : parameters)
+			p.get().zero_grad(true);
+	}
+
+	/// Zeroes the gradients of parameters the last backward did not reach,
+	/// so every gradient can be read. `step` does this itself.
+	auto settle_grads() -> void {
+		for (auto &p : parameters)
+			p.get().settle_grad();
+	}
+
+	static auto to_one_hot(const arma::Col<std::size_t> &labels,
+												 std::size_t classes) -> Tensor<T> {
+		Tensor<T> one_hot(Shape{labels.n_elem, classes});
+		auto &m = *one_hot.data;
+		if (classes <= 256) {
+			// Narrow once so the vector kernel can encode whole columns.
+			std::vector<std::uint8_t> narrow(labels.n_elem);
+			for (std::size_t i = 0; i < labels.n_elem; ++i) {
+				if (labels(i) >= classes)
+					throw std::invalid_argument("to_one_hot: label out of range.");
+				narrow[i] = static_cast<std::uint8_t>(labels(i));
+			}
+			Kernels::one_hot_u8(narrow.data(), narrow.size(), classes, m.memptr(),
+													m.n_rows);
+			return one_hot;
+		}
+		m.zeros();
+		for (std::size_t i = 0; i < labels.n_elem; ++i)
+			m(i, labels(i)) = T(1);
+		return one_hot;
+	}
+
+private:
+	template <typename... Ls>
+	static auto make_stack(Ls... layers)
+			-> std::vector<std::unique_ptr<Layer<T>>> {
+		std::vector<std::unique_ptr<Layer<T>>> result;
+		(result.push_back(std::make_unique<Ls>(std::move(layers))), ...);
+		return result;
+	}
+};
+
+} // namespace ExGraf
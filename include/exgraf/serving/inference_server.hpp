@@ -0,0 +1,237 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/serving/mpsc_queue.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ExGraf {
+
+struct InferenceServerOptions {
+	/// A batch closes once it holds this many rows. A request is never split,
+	/// so one arriving at a nearly full batch can push it past the limit.
+	std::size_t max_batch{32};
+	/// The longest the first request of a batch waits for others to join.
+	std::chrono::microseconds max_latency{1000};
+	/// Threads running batches, each on its own replica of the model.
+	std::size_t workers{1};
+};
+
+struct InferenceServerStats {
+	std::size_t requests{0};
+	std::size_t batches{0};
+	std::size_t rows{0};
+};
+
+/// Serves a model to concurrent callers, coalescing their requests into
+/// batches so single-sample traffic still feeds the GEMMs whole batches.
+///
+/// `submit` pushes onto a lock-free MPSC queue and signals a semaphore; it
+/// never blocks on the model. One batcher thread drains the queue: the first
+/// request opens a batch, which closes when it reaches `max_batch` rows or
+/// `max_latency` after that request arrived, whichever comes first. Closed
+/// batches go to `workers` threads, each running `Sequential::predict` on a
+/// replica sharing the model's parameters, and every request's future is
+/// completed with its rows of the output.
+///
+/// The replicas read the parameters unsynchronized: do not train the model
+/// while serving it. The destructor finishes every request already
+/// submitted; submitting concurrently with destruction is undefined.
+template <AllowedTypes T> class InferenceServer {
+	using Clock = std::chrono::steady_clock;
+
+	struct Request {
+		arma::Mat<T> samples;
+		std::promise<arma::Mat<T>> result;
+		Clock::time_point arrived;
+		bool stop{false};
+	};
+	struct Batch {
+		std::vector<Request> requests;
+		std::size_t rows{0};
+	};
+
+public:
+	InferenceServer(const Sequential<T> &model, InferenceServerOptions opts)
+			: options(opts), features(model.summary().input.total_elements()) {
+		if (options.max_batch == 0 || options.workers == 0)
+			throw std::invalid_argument(
+					"InferenceServer: max_batch and workers must be positive.");
+		for (std::size_t w = 0; w < options.workers; ++w)
+			replicas.push_back(model.replicate(w + 1));
+		threads.emplace_back([this] { coalesce(); });
+		for (std::size_t w = 0; w < options.workers; ++w)
+			threads.emplace_back([this, w] { serve(*replicas[w]); });
+	}
+
+	~InferenceServer() {
+		Request stop;
+		stop.stop = true;
+		queue.push(std::move(stop));
+		pending.release();
+		// The batcher first: it closes the hand-off once the queue is drained,
+		// which lets the workers finish.
+		for (auto &t : threads)
+			t.join();
+	}
+
+	InferenceServer(const InferenceServer &) = delete;
+	auto operator=(const InferenceServer &) -> InferenceServer & = delete;
+
+	/// Queues `samples` (one row per sample) and returns a future for the
+	/// model's output rows. Safe to call from any number of threads.
+	auto submit(arma::Mat<T> samples) -> std::future<arma::Mat<T>> {
+		if (samples.n_rows == 0 || samples.n_cols != features)
+			throw std::invalid_argument(
+					"InferenceServer::submit: samples do not match the model input.");
+		Request request;
+		request.samples = std::move(samples);
+		request.arrived = Clock::now();
+		auto future = request.result.get_future();
+		queue.push(std::move(request));
+		pending.release();
+		return future;
+	}
+
+	auto stats() const -> InferenceServerStats {
+		return {served_requests.load(std::memory_order_relaxed),
+						served_batches.load(std::memory_order_relaxed),
+						served_rows.load(std::memory_order_relaxed)};
+	}
+
+private:
+	InferenceServerOptions options;
+	std::size_t features;
+	MpscQueue<Request> queue;
+	// One count per pushed request; lets the batcher sleep with a deadline.
+	std::counting_semaphore<> pending{0};
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<Batch> closed_batches;
+	bool draining{false};
+
+	std::vector<std::unique_ptr<Sequential<T>>> replicas;
+	std::atomic<std::size_t> served_requests{0};
+	std::atomic<std::size_t> served_batches{0};
+	std::atomic<std::size_t> served_rows{0};
+	std::vector<std::thread> threads;
+
+	// A count taken from `pending` guarantees a pushed request, but the push
+	// may not be visible yet (see MpscQueue).
+	auto take() -> Request {
+		for (;;) {
+			if (auto request = queue.pop())
+				return std::move(*request);
+			std::this_thread::yield();
+		}
+	}
+
+	auto take_until(Clock::time_point deadline) -> std::optional<Request> {
+		if (!pending.try_acquire_until(deadline))
+			return std::nullopt;
+		return take();
+	}
+
+	auto coalesce() -> void {
+		bool stop = false;
+		while (!stop) {
+			pending.acquire();
+			auto first = take();
+			if (first.stop)
+				break;
+			Batch batch;
+			batch.rows = first.samples.n_rows;
+			const auto deadline = first.arrived + options.max_latency;
+			batch.requests.push_back(std::move(first));
+			while (batch.rows < options.max_batch) {
+				auto next = take_until(deadline);
+				if (!next)
+					break;
+				if (next->stop) {
+					stop = true;
+					break;
+				}
+				batch.rows += next->samples.n_rows;
+				batch.requests.push_back(std::move(*next));
+			}
+			{
+				std::lock_guard lock(mutex);
+				closed_batches.push_back(std::move(batch));
+			}
+			changed.notify_one();
+		}
+		{
+			std::lock_guard lock(mutex);
+			draining = true;
+		}
+		changed.notify_all();
+	}
+
+	auto serve(Sequential<T> &model) -> void {
+		Tensor<T> inputs;
+		for (;;) {
+			Batch batch;
+			{
+				std::unique_lock lock(mutex);
+				changed.wait(lock,
+										 [&] { return draining || !closed_batches.empty(); });
+				if (closed_batches.empty())
+					return;
+				batch = std::move(closed_batches.front());
+				closed_batches.pop_front();
+			}
+			run(model, batch, inputs);
+		}
+	}
+
+	auto run(Sequential<T> &model, Batch &batch, Tensor<T> &inputs) -> void {
+		if (!inputs.data || inputs.data->n_rows != batch.rows)
+			inputs = Tensor<T>(Shape{batch.rows, features});
+		std::size_t offset = 0;
+		for (const auto &request : batch.requests) {
+			const auto &x = request.samples;
+			for (std::size_t c = 0; c < features; ++c)
+				std::copy_n(x.colptr(c), x.n_rows, inputs.data->colptr(c) + offset);
+			offset += x.n_rows;
+		}
+		Tensor<T> output;
+		try {
+			output = model.predict(inputs);
+		} catch (...) {
+			for (auto &request : batch.requests)
+				request.result.set_exception(std::current_exception());
+			return;
+		}
+		// Counted before any future completes, so a caller holding every
+		// result sees them in `stats()`.
+		served_requests.fetch_add(batch.requests.size(),
+															std::memory_order_relaxed);
+		served_batches.fetch_add(1, std::memory_order_relaxed);
+		served_rows.fetch_add(batch.rows, std::memory_order_relaxed);
+		offset = 0;
+		for (auto &request : batch.requests) {
+			const auto rows = request.samples.n_rows;
+			request.result.set_value(output.data->rows(offset, offset + rows - 1));
+			offset += rows;
+		}
+	}
+};
+
+} // namespace ExGraf
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace ExGraf {
+
+/// Unbounded multi-producer, single-consumer queue (Vyukov's intrusive
+/// design). `push` is one atomic exchange and one store, wait free from any
+/// thread; `pop` must only be called from one thread at a time.
+///
+/// A push is visible to `pop` once its second store lands: between the two,
+/// `pop` reports the queue empty even though later pushes may have
+/// completed. Callers pairing the queue with a counter (as InferenceServer
+/// does with a semaphore) retry until the element shows up.
+template <typename T> class MpscQueue {
+	struct Node {
+		std::atomic<Node *> next{nullptr};
+		std::optional<T> value;
+	};
+	// Producers swing `head` to their node; the consumer owns `tail`, which
+	// always points at a node whose value has been taken (a stub at first).
+	alignas(64) std::atomic<Node *> head;
+	alignas(64) Node *tail;
+
+public:
+	MpscQueue() : head(new Node), tail(head.load(std::memory_order_relaxed)) {}
+	~MpscQueue() {
+		while (tail) {
+			auto *next = tail->next.load(std::memory_order_relaxed);
+			delete tail;
+			tail = next;
+		}
+	}
+	MpscQueue(const MpscQueue &) = delete;
+	auto operator=(const MpscQueue &) -> MpscQueue & = delete;
+
+	auto push(T value) -> void {
+		auto *node = new Node;
+		node->value.emplace(std::move(value));
+		auto *previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	auto pop() -> std::optional<T> {
+		auto *next = tail->next.load(std::memory_order_acquire);
+		if (!next)
+			return std::nullopt;
+		std::optional<T> result(std::move(next->value));
+		next->value.reset();
+		delete tail;
+		tail = next;
+		return result;
+	}
+};
+
+} // namespace ExGraf
@@ -1,26 +1,71 @@
 #pragma once
 
+#include <algorithm>
 #include <armadillo>
+#include <array>
+#include <cassert>
 #include <numeric>
+#include <span>
+#include <stdexcept>
 
 namespace ExGraf {
 
+/// Dimensions are stored inline so copying a Shape (and therefore a Tensor)
+/// never touches the heap.
+///
+/// Tensors of any rank are stored as a matrix: the leading dimension (the
+/// batch) indexes rows and the remaining ones are flattened, row-major, into
+/// columns. An image batch {N, C, H, W} is therefore an N x (C*H*W) matrix
+/// whose rows are the flattened images.
 class Shape {
 public:
+	static constexpr std::size_t max_rank = 4;
+
 	Shape() = default;
-	Shape(std::initializer_list<std::size_t> ds) : dimensions(ds) {}
-	Shape(const arma::SizeMat &size) : dimensions{size.n_rows, size.n_cols} {}
-	auto total_elements() -> std::size_t {
-		return std::accumulate(dimensions.begin(), dimensions.end(), std::size_t{1},
-													 std::multiplies<std::size_t>());
+	Shape(std::initializer_list<std::size_t> ds) : rank(checked_rank(ds.size())) {
+		std::copy(ds.begin(), ds.end(), dimensions.begin());
+	}
+	Shape(const arma::SizeMat &size) : Shape{size.n_rows, size.n_cols} {}
+	static auto from(std::span<const std::size_t> ds) -> Shape {
+		Shape s;
+		s.rank = checked_rank(ds.size());
+		std::copy(ds.begin(), ds.end(), s.dimensions.begin());
+		return s;
+	}
+	auto total_elements() const -> std::size_t {
+		return std::accumulate(dimensions.begin(), dimensions.begin() + rank,
+													 std::size_t{1}, std::multiplies<std::size_t>());
 	}
 	auto operator==(const Shape &other) const -> bool {
-		return dimensions == other.dimensions;
+		return std::ranges::equal(dims(), other.dims());
+	}
+	auto dims() const -> std::span<const std::size_t> {
+		return {dimensions.data(), rank};
+	}
+	auto size() const -> std::size_t { return rank; }
+	auto operator[](std::size_t i) const -> std::size_t {
+		assert(i < rank);
+		return dimensions[i];
+	}
+	/// Matrix rows: the leading dimension (1 for a scalar).
+	auto rows() const -> std::size_t { return rank == 0 ? 1 : dimensions[0]; }
+	/// Matrix columns: the product of every dimension after the first.
+	auto cols() const -> std::size_t {
+		if (rank == 0)
+			return 1;
+		return std::accumulate(dimensions.begin() + 1, dimensions.begin() + rank,
+													 std::size_t{1}, std::multiplies<std::size_t>());
 	}
-	auto dims() const -> const auto & { return dimensions; }
 
 private:
-	std::vector<std::size_t> dimensions{};
+	static auto checked_rank(std::size_t rank) -> std::size_t {
+		if (rank > max_rank)
+			throw std::invalid_argument("Shape: rank exceeds max_rank.");
+		return rank;
+	}
+
+	std::array<std::size_t, max_rank> dimensions{};
+	std::size_t rank{0};
 };
 
 } // namespace ExGraf
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace ExGraf {
+
+/// A 2-D convolution over C x H x W images with square kernels.
+struct Conv2DGeometry {
+	std::size_t channels, height, width;
+	std::size_t out_channels;
+	std::size_t kernel;
+	std::size_t stride{1};
+	std::size_t padding{0};
+
+	auto out_height() const -> std::size_t {
+		return (height + 2 * padding - kernel) / stride + 1;
+	}
+	auto out_width() const -> std::size_t {
+		return (width + 2 * padding - kernel) / stride + 1;
+	}
+	/// Output positions per channel.
+	auto positions() const -> std::size_t { return out_height() * out_width(); }
+	/// Inputs one output element reads: C * K * K.
+	auto patch() const -> std::size_t { return channels * kernel * kernel; }
+	auto in_features() const -> std::size_t { return channels * height * width; }
+	auto out_features() const -> std::size_t {
+		return out_channels * positions();
+	}
+	auto validate() const -> void {
+		if (channels == 0 || out_channels == 0 || kernel == 0 || stride == 0 ||
+				height + 2 * padding < kernel || width + 2 * padding < kernel)
+			throw std::invalid_argument("Conv2DGeometry: kernel does not fit.");
+	}
+	auto operator==(const Conv2DGeometry &) const -> bool = default;
+};
+
+/// Non-overlapping or strided pooling windows over C x H x W images.
+struct Pool2DGeometry {
+	std::size_t channels, height, width;
+	std::size_t kernel;
+	std::size_t stride;
+
+	auto out_height() const -> std::size_t {
+		return (height - kernel) / stride + 1;
+	}
+	auto out_width() const -> std::size_t {
+		return (width - kernel) / stride + 1;
+	}
+	auto in_features() const -> std::size_t { return channels * height * width; }
+	auto out_features() const -> std::size_t {
+		return channels * out_height() * out_width();
+	}
+	auto validate() const -> void {
+		if (channels == 0 || kernel == 0 || stride == 0 || height < kernel ||
+				width < kernel)
+			throw std::invalid_argument("Pool2DGeometry: window does not fit.");
+	}
+};
+
+/// Spatial kernels over batches in the Tensor layout: an N x features
+/// column-major matrix, so each feature (channel, row, column) is a run of N
+/// contiguous values, one per sample. Every inner loop walks such a run.
+namespace Kernels {
+
+/// Gathers the patches of `x` into `cols`, a (P * N) x (C * K * K) matrix
+/// whose row p * N + n is sample n's patch at output position p. With this
+/// row order `cols * W` is the output already in the Tensor layout.
+template <AllowedTypes T>
+auto im2col(const T *x, std::size_t n, const Conv2DGeometry &g, T *cols)
+		-> void {
+	const auto oh = g.out_height(), ow = g.out_width();
+	const auto rows = g.positions() * n;
+	std::size_t q = 0;
+	for (std::size_t c = 0; c < g.channels; ++c)
+		for (std::size_t kh = 0; kh < g.kernel; ++kh)
+			for (std::size_t kw = 0; kw < g.kernel; ++kw, ++q) {
+				T *column = cols + q * rows;
+				for (std::size_t y = 0; y < oh; ++y) {
+					const auto iy = std::ptrdiff_t(y * g.stride + kh) -
+													std::ptrdiff_t(g.padding);
+					for (std::size_t xo = 0; xo < ow; ++xo) {
+						T *dst = column + (y * ow + xo) * n;
+						const auto ix = std::ptrdiff_t(xo * g.stride + kw) -
+														std::ptrdiff_t(g.padding);
+						if (iy < 0 || ix < 0 || iy >= std::ptrdiff_t(g.height) ||
+								ix >= std::ptrdiff_t(g.width)) {
+							std::fill_n(dst, n, T(0));
+							continue;
+						}
+						const T *src =
+								x + ((c * g.height + std::size_t(iy)) * g.width +
+										 std::size_t(ix)) *
+												n;
+						std::copy_n(src, n, dst);
+					}
+				}
+			}
+}
+
+/// Scatter-adds patch gradients back onto `dx`, the inverse of im2col.
+/// `dx` must be zeroed by the caller.
+template <AllowedTypes T>
+auto col2im(const T *cols, std::size_t n, const Conv2DGeometry &g, T *dx)
+		-> void {
+	const auto oh = g.out_height(), ow = g.out_width();
+	const auto rows = g.positions() * n;
+	std::size_t q = 0;
+	for (std::size_t c = 0; c < g.channels; ++c)
+		for (std::size_t kh = 0; kh < g.kernel; ++kh)
+			for (std::size_t kw = 0; kw < g.kernel; ++kw, ++q) {
+				const T *column = cols + q * rows;
+				for (std::size_t y = 0; y < oh; ++y) {
+					const auto iy = std::ptrdiff_t(y * g.stride + kh) -
+													std::ptrdiff_t(g.padding);
+					if (iy < 0 || iy >= std::ptrdiff_t(g.height))
+						continue;
+					for (std::size_t xo = 0; xo < ow; ++xo) {
+						const auto ix = std::ptrdiff_t(xo * g.stride + kw) -
+														std::ptrdiff_t(g.padding);
+						if (ix < 0 || ix >= std::ptrdiff_t(g.width))
+							continue;
+						const T *src = column + (y * ow + xo) * n;
+						T *dst = dx + ((c * g.height + std::size_t(iy)) * g.width +
+													 std::size_t(ix)) *
+															n;
+						for (std::size_t i = 0; i < n; ++i)
+							dst[i] += src[i];
+					}
+				}
+			}
+}
+
+namespace Detail {
+
+// Output rows per tile, sized so a tile of one output channel (rows * OW * N
+// values) stays within about 32 KiB while every input tap is applied to it.
+template <AllowedTypes T>
+auto conv_tile_rows(const Conv2DGeometry &g, std::size_t n) -> std::size_t {
+	constexpr std::size_t tile_bytes = 32 * 1024;
+	const auto row_bytes = g.out_width() * n * sizeof(T);
+	const auto rows = tile_bytes / std::max<std::size_t>(row_bytes, 1);
+	return std::clamp<std::size_t>(rows, 1, g.out_height());
+}
+
+// Calls f(y, xo, input feature) for each valid tap (c, kh, kw) of the output
+// rows [y0, y1).
+template <typename F>
+auto for_each_tap(const Conv2DGeometry &g, std::size_t c, std::size_t kh,
+									std::size_t kw, std::size_t y0, std::size_t y1, F &&f)
+		-> void {
+	const auto ow = g.out_width();
+	for (auto y = y0; y < y1; ++y) {
+		const auto iy =
+				std::ptrdiff_t(y * g.stride + kh) - std::ptrdiff_t(g.padding);
+		if (iy < 0 || iy >= std::ptrdiff_t(g.height))
+			continue;
+		for (std::size_t xo = 0; xo < ow; ++xo) {
+			const auto ix =
+					std::ptrdiff_t(xo * g.stride + kw) - std::ptrdiff_t(g.padding);
+			if (ix < 0 || ix >= std::ptrdiff_t(g.width))
+				continue;
+			f(y, xo,
+				(c * g.height + std::size_t(iy)) * g.width + std::size_t(ix));
+		}
+	}
+}
+
+} // namespace Detail
+
+/// Direct convolution without a patch matrix. `w` is the (C * K * K) x OC
+/// weight matrix, `bias` may be null. For each output channel the output is
+/// processed in row tiles that stay cache resident while every tap adds
+/// into them.
+template <AllowedTypes T>
+auto conv2d_direct(const T *x, const T *w, const T *bias, std::size_t n,
+									 const Conv2DGeometry &g, T *out) -> void {
+	const auto p = g.positions(), ow = g.out_width(), patch = g.patch();
+	const auto tile = Detail::conv_tile_rows<T>(g, n);
+	for (std::size_t oc = 0; oc < g.out_channels; ++oc) {
+		T *plane = out + oc * p * n;
+		const T shift = bias ? bias[oc] : T(0);
+		for (std::size_t y0 = 0; y0 < g.out_height(); y0 += tile) {
+			const auto y1 = std::min(y0 + tile, g.out_height());
+			std::fill(plane + y0 * ow * n, plane + y1 * ow * n, shift);
+			std::size_t q = 0;
+			for (std::size_t c = 0; c < g.channels; ++c)
+				for (std::size_t kh = 0; kh < g.kernel; ++kh)
+					for (std::size_t kw = 0; kw < g.kernel; ++kw, ++q) {
+						const T weight = w[oc * patch + q];
+						Detail::for_each_tap(
+								g, c, kh, kw, y0, y1,
+								[&](std::size_t y, std::size_t xo, std::size_t feature) {
+									T *dst = plane + (y * ow + xo) * n;
+									const T *src = x + feature * n;
+									for (std::size_t i = 0; i < n; ++i)
+										dst[i] += weight * src[i];
+								});
+					}
+		}
+	}
+}
+
+/// Gradients of conv2d_direct. `dx`, `dw` and `db` (null without a bias) are
+/// overwritten.
+template <AllowedTypes T>
+auto conv2d_direct_backward(const T *x, const T *w, const T *grad,
+														std::size_t n, const Conv2DGeometry &g, T *dx,
+														T *dw, T *db) -> void {
+	const auto p = g.positions(), ow = g.out_width(), patch = g.patch();
+	const auto tile = Detail::conv_tile_rows<T>(g, n);
+	std::fill_n(dx, g.in_features() * n, T(0));
+	std::fill_n(dw, patch * g.out_channels, T(0));
+	for (std::size_t oc = 0; oc < g.out_channels; ++oc) {
+		const T *plane = grad + oc * p * n;
+		if (db) {
+			T sum = T(0);
+			for (std::size_t i = 0; i < p * n; ++i)
+				sum += plane[i];
+			db[oc] = sum;
+		}
+		for (std::size_t y0 = 0; y0 < g.out_height(); y0 += tile) {
+			const auto y1 = std::min(y0 + tile, g.out_height());
+			std::size_t q = 0;
+			for (std::size_t c = 0; c < g.channels; ++c)
+				for (std::size_t kh = 0; kh < g.kernel; ++kh)
+					for (std::size_t kw = 0; kw < g.kernel; ++kw, ++q) {
+						const T weight = w[oc * patch + q];
+						T acc = T(0);
+						Detail::for_each_tap(
+								g, c, kh, kw, y0, y1,
+								[&](std::size_t y, std::size_t xo, std::size_t feature) {
+									const T *gy = plane + (y * ow + xo) * n;
+									const T *src = x + feature * n;
+									T *dst = dx + feature * n;
+									for (std::size_t i = 0; i < n; ++i) {
+										acc += gy[i] * src[i];
+										dst[i] += weight * gy[i];
+									}
+								});
+						dw[oc * patch + q] += acc;
+					}
+		}
+	}
+}
+
+/// Max pooling. `argmax` receives, per output element, the input feature
+/// that won, for the backward pass; inference passes nullptr.
+template <AllowedTypes T>
+auto max_pool2d(const T *x, std::size_t n, const Pool2DGeometry &g, T *out,
+								std::uint32_t *argmax) -> void {
+	const auto oh = g.out_height(), ow = g.out_width();
+	std::size_t o = 0;
+	for (std::size_t c = 0; c < g.channels; ++c)
+		for (std::size_t y = 0; y < oh; ++y)
+			for (std::size_t xo = 0; xo < ow; ++xo, ++o) {
+				T *dst = out + o * n;
+				std::uint32_t *arg = argmax ? argmax + o * n : nullptr;
+				for (std::size_t kh = 0; kh < g.kernel; ++kh)
+					for (std::size_t kw = 0; kw < g.kernel; ++kw) {
+						const auto feature = static_cast<std::uint32_t>(
+								(c * g.height + y * g.stride + kh) * g.width + xo * g.stride +
+								kw);
+						const T *src = x + std::size_t(feature) * n;
+						if (kh == 0 && kw == 0) {
+							std::copy_n(src, n, dst);
+							if (arg)
+								std::fill_n(arg, n, feature);
+							continue;
+						}
+						if (!arg) {
+							for (std::size_t i = 0; i < n; ++i)
+								dst[i] = std::max(dst[i], src[i]);
+							continue;
+						}
+						for (std::size_t i = 0; i < n; ++i) {
+							if (src[i] > dst[i]) {
+								dst[i] = src[i];
+								arg[i] = feature;
+							}
+						}
+					}
+			}
+}
+
+/// Routes each output gradient to the input that won; `dx` is overwritten.
+template <AllowedTypes T>
+auto max_pool2d_backward(const T *grad, const std::uint32_t *argmax,
+												 std::size_t n, const Pool2DGeometry &g, T *dx)
+		-> void {
+	std::fill_n(dx, g.in_features() * n, T(0));
+	const auto outputs = g.out_features();
+	for (std::size_t o = 0; o < outputs; ++o)
+		for (std::size_t i = 0; i < n; ++i)
+			dx[std::size_t(argmax[o * n + i]) * n + i] += grad[o * n + i];
+}
+
+template <AllowedTypes T>
+auto avg_pool2d(const T *x, std::size_t n, const Pool2DGeometry &g, T *out)
+		-> void {
+	const auto oh = g.out_height(), ow = g.out_width();
+	const T scale = T(1) / T(g.kernel * g.kernel);
+	std::size_t o = 0;
+	for (std::size_t c = 0; c < g.channels; ++c)
+		for (std::size_t y = 0; y < oh; ++y)
+			for (std::size_t xo = 0; xo < ow; ++xo, ++o) {
+				T *dst = out + o * n;
+				std::fill_n(dst, n, T(0));
+				for (std::size_t kh = 0; kh < g.kernel; ++kh)
+					for (std::size_t kw = 0; kw < g.kernel; ++kw) {
+						const T *src = x + ((c * g.height + y * g.stride + kh) * g.width +
+																xo * g.stride + kw) *
+																	 n;
+						for (std::size_t i = 0; i < n; ++i)
+							dst[i] += src[i];
+					}
+				for (std::size_t i = 0; i < n; ++i)
+					dst[i] *= scale;
+			}
+}
+
+/// Spreads each output gradient evenly over its window; `dx` is overwritten.
+template <AllowedTypes T>
+auto avg_pool2d_backward(const T *grad, std::size_t n, const Pool2DGeometry &g,
+												 T *dx) -> void {
+	std::fill_n(dx, g.in_features() * n, T(0));
+	const auto oh = g.out_height(), ow = g.out_width();
+	const T scale = T(1) / T(g.kernel * g.kernel);
+	std::size_t o = 0;
+	for (std::size_t c = 0; c < g.channels; ++c)
+		for (std::size_t y = 0; y < oh; ++y)
+			for (std::size_t xo = 0; xo < ow; ++xo, ++o) {
+				const T *gy = grad + o * n;
+				for (std::size_t kh = 0; kh < g.kernel; ++kh)
+					for (std::size_t kw = 0; kw < g.kernel; ++kw) {
+						T *dst = dx + ((c * g.height + y * g.stride + kh) * g.width +
+													 xo * g.stride + kw) *
+															n;
+						for (std::size_t i = 0; i < n; ++i)
+							dst[i] += scale * gy[i];
+					}
+			}
+}
+
+} // namespace Kernels
+
+} // namespace ExGraf
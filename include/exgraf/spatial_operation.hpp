@@ -0,0 +1,263 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/logger.hpp"
+#include "exgraf/operation.hpp"
+#include "exgraf/spatial_kernels.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace ExGraf::Spatial {
+
+enum class ConvAlgorithm : std::uint8_t {
+	/// Time both on first use of a geometry and batch size; keep the faster.
+	Auto,
+	/// Patch matrix plus one GEMM: fastest when C * K * K is large enough to
+	/// feed the GEMM, at the cost of a (P * N) x (C * K * K) buffer.
+	Im2col,
+	/// Cache-blocked loops, no extra memory: wins for few input channels.
+	Direct,
+};
+
+/// Picks an algorithm for `g` at batch size `n` by timing both forward
+/// kernels on scratch data, once per process for each (geometry, batch,
+/// type); later calls return the cached choice.
+template <AllowedTypes T>
+auto tuned_algorithm(const Conv2DGeometry &g, std::size_t n)
+		-> ConvAlgorithm {
+	using Key = std::tuple<std::size_t, std::size_t, std::size_t, std::size_t,
+												 std::size_t, std::size_t, std::size_t, std::size_t>;
+	static std::mutex mutex;
+	static std::map<Key, ConvAlgorithm> choices;
+	const Key key{g.channels, g.height,	g.width,	 g.out_channels,
+								g.kernel,		g.stride, g.padding, n};
+	std::scoped_lock lock(mutex);
+	if (auto it = choices.find(key); it != choices.end())
+		return it->second;
+
+	const arma::Mat<T> x = arma::randu<arma::Mat<T>>(n, g.in_features());
+	const arma::Mat<T> w = arma::randu<arma::Mat<T>>(g.patch(), g.out_channels);
+	arma::Mat<T> out(n, g.out_features());
+	arma::Mat<T> cols(g.positions() * n, g.patch());
+	auto best = [](auto &&run) {
+		auto fastest = std::chrono::steady_clock::duration::max();
+		for (int rep = 0; rep < 3; ++rep) {
+			const auto start = std::chrono::steady_clock::now();
+			run();
+			fastest = std::min(fastest, std::chrono::steady_clock::now() - start);
+		}
+		return fastest;
+	};
+	const auto direct = best([&] {
+		const T *no_bias = nullptr;
+		Kernels::conv2d_direct(x.memptr(), w.memptr(), no_bias, n, g,
+													 out.memptr());
+	});
+	const auto im2col = best([&] {
+		Kernels::im2col(x.memptr(), n, g, cols.memptr());
+		arma::Mat<T> view(out.memptr(), g.positions() * n, g.out_channels, false,
+											true);
+		view = cols * w;
+	});
+	const auto choice =
+			im2col < direct ? ConvAlgorithm::Im2col : ConvAlgorithm::Direct;
+	debug("[Conv2D autotune] {}x{}x{} -> {} k{} s{} batch {}: {}", g.channels,
+				g.height, g.width, g.out_channels, g.kernel, g.stride, n,
+				choice == ConvAlgorithm::Im2col ? "im2col" : "direct");
+	choices.emplace(key, choice);
+	return choice;
+}
+
+/// 2-D convolution. Inputs: x (N x C*H*W), W ((C*K*K) x OC) and optionally
+/// a 1 x OC bias b. The output is N x OC*OH*OW, shaped {N, OC, OH, OW}.
+///
+/// Weights are laid out like Linear's, one column per output channel, so
+/// the im2col path is a single GEMM over the whole batch.
+template <AllowedTypes T> class Conv2DOp : public Operation<T> {
+	Conv2DGeometry geometry;
+	ConvAlgorithm requested, active{ConvAlgorithm::Direct};
+	Tensor<T> last_input, last_weights, cols;
+	bool has_bias{false};
+
+public:
+	explicit Conv2DOp(Conv2DGeometry g,
+										ConvAlgorithm algorithm = ConvAlgorithm::Auto)
+			: geometry(g), requested(algorithm) {
+		geometry.validate();
+	}
+
+	/// The algorithm the last forward used.
+	auto algorithm() const -> ConvAlgorithm { return active; }
+
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &x = inputs[0].get();
+		auto &w = inputs[1].get();
+		const auto &g = geometry;
+		const auto n = x.data->n_rows;
+		trace("[Conv2DOp forward] x: {}x{}, W: {}x{}", n, x.data->n_cols,
+					w.data->n_rows, w.data->n_cols);
+		if (x.data->n_cols != g.in_features() || w.data->n_rows != g.patch() ||
+				w.data->n_cols != g.out_channels)
+			throw std::invalid_argument("Conv2DOp: input or weights do not match "
+																	"the geometry.");
+		last_input = x;
+		last_weights = w;
+		has_bias = inputs.size() > 2;
+		const T *bias = has_bias ? inputs[2].get().data->memptr() : nullptr;
+		active = requested == ConvAlgorithm::Auto ? tuned_algorithm<T>(g, n)
+																							: requested;
+
+		auto result = this->allocate(n, g.out_features());
+		result.shape = Shape{n, g.out_channels, g.out_height(), g.out_width()};
+		if (active == ConvAlgorithm::Direct) {
+			Kernels::conv2d_direct(x.data->memptr(), w.data->memptr(), bias, n, g,
+														 result.data->memptr());
+			return result;
+		}
+		cols = this->allocate(g.positions() * n, g.patch());
+		Kernels::im2col(x.data->memptr(), n, g, cols.data->memptr());
+		arma::Mat<T> view(result.data->memptr(), g.positions() * n,
+											g.out_channels, false, true);
+		view = *cols.data * *w.data;
+		if (has_bias)
+			view.each_row() += *inputs[2].get().data;
+		return result;
+	}
+
+	auto
+	flops(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			const -> std::size_t override {
+		return inputs[0].get().data->n_rows * geometry.out_features() *
+					 (2 * geometry.patch() + (inputs.size() > 2 ? 1 : 0));
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		trace("[Conv2DOp backward] grad_output: {}x{}", grad_output.data->n_rows,
+					grad_output.data->n_cols);
+		const auto &g = geometry;
+		const auto n = last_input.data->n_rows;
+		grad_inputs[0] = this->allocate(n, g.in_features());
+		grad_inputs[0].shape = Shape{n, g.channels, g.height, g.width};
+		grad_inputs[1] = this->allocate(g.patch(), g.out_channels);
+		if (has_bias)
+			grad_inputs[2] = this->allocate(1, g.out_channels);
+		T *db = has_bias ? grad_inputs[2].data->memptr() : nullptr;
+
+		if (active == ConvAlgorithm::Direct) {
+			Kernels::conv2d_direct_backward(
+					last_input.data->memptr(), last_weights.data->memptr(),
+					grad_output.data->memptr(), n, g, grad_inputs[0].data->memptr(),
+					grad_inputs[1].data->memptr(), db);
+			return;
+		}
+		const arma::Mat<T> dy(const_cast<T *>(grad_output.data->memptr()),
+													g.positions() * n, g.out_channels, false, true);
+		*grad_inputs[1].data = cols.data->t() * dy;
+		if (has_bias)
+			*grad_inputs[2].data = arma::sum(dy, 0);
+		auto dcols = this->allocate(g.positions() * n, g.patch());
+		*dcols.data = dy * last_weights.data->t();
+		grad_inputs[0].data->zeros();
+		Kernels::col2im(dcols.data->memptr(), n, g, grad_inputs[0].data->memptr());
+	}
+};
+
+template <AllowedTypes T> class MaxPool2DOp : public Operation<T> {
+	Pool2DGeometry geometry;
+	std::vector<std::uint32_t> argmax;
+	std::size_t batch{0};
+
+public:
+	explicit MaxPool2DOp(Pool2DGeometry g) : geometry(g) { geometry.validate(); }
+
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &x = inputs[0].get();
+		const auto &g = geometry;
+		batch = x.data->n_rows;
+		trace("[MaxPool2DOp forward] x: {}x{}", batch, x.data->n_cols);
+		if (x.data->n_cols != g.in_features())
+			throw std::invalid_argument(
+					"MaxPool2DOp: input does not match the geometry.");
+		auto result = this->allocate(batch, g.out_features());
+		result.shape = Shape{batch, g.channels, g.out_height(), g.out_width()};
+		// Grows to the largest batch once; later steps reuse it.
+		argmax.resize(
+				std::max<std::size_t>(argmax.size(), result.data->n_elem));
+		Kernels::max_pool2d(x.data->memptr(), batch, g, result.data->memptr(),
+												argmax.data());
+		return result;
+	}
+
+	/// One comparison or addition per window element.
+	auto
+	flops(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			const -> std::size_t override {
+		return inputs[0].get().data->n_rows * geometry.out_features() *
+					 geometry.kernel * geometry.kernel;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		const auto &g = geometry;
+		grad_inputs[0] = this->allocate(batch, g.in_features());
+		grad_inputs[0].shape = Shape{batch, g.channels, g.height, g.width};
+		Kernels::max_pool2d_backward(grad_output.data->memptr(), argmax.data(),
+																 batch, g, grad_inputs[0].data->memptr());
+	}
+};
+
+template <AllowedTypes T> class AvgPool2DOp : public Operation<T> {
+	Pool2DGeometry geometry;
+	std::size_t batch{0};
+
+public:
+	explicit AvgPool2DOp(Pool2DGeometry g) : geometry(g) { geometry.validate(); }
+
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &x = inputs[0].get();
+		const auto &g = geometry;
+		batch = x.data->n_rows;
+		trace("[AvgPool2DOp forward] x: {}x{}", batch, x.data->n_cols);
+		if (x.data->n_cols != g.in_features())
+			throw std::invalid_argument(
+					"AvgPool2DOp: input does not match the geometry.");
+		auto result = this->allocate(batch, g.out_features());
+		result.shape = Shape{batch, g.channels, g.out_height(), g.out_width()};
+		Kernels::avg_pool2d(x.data->memptr(), batch, g, result.data->memptr());
+		return result;
+	}
+
+	/// One comparison or addition per window element.
+	auto
+	flops(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			const -> std::size_t override {
+		return inputs[0].get().data->n_rows * geometry.out_features() *
+					 geometry.kernel * geometry.kernel;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		const auto &g = geometry;
+		grad_inputs[0] = this->allocate(batch, g.in_features());
+		grad_inputs[0].shape = Shape{batch, g.channels, g.height, g.width};
+		Kernels::avg_pool2d_backward(grad_output.data->memptr(), batch, g,
+																 grad_inputs[0].data->memptr());
+	}
+};
+
+} // namespace ExGraf::Spatial
@@ -0,0 +1,360 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/optimizers/update_kernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/// A compile-time alternative to ExpressionGraph for small fixed networks.
+///
+/// A network is a type: Static::Network<float, 8, 64, Static::Linear<32>,
+/// Static::ReLU, Static::Linear<10>, Static::Softmax> has its batch size,
+/// every layer's width and every buffer size fixed at compile time. Layers
+/// live in a std::tuple and are walked with fold expressions, so forward and
+/// backward compile to one inlined chain of loops with constant bounds: no
+/// virtual calls, no Tensor or shared_ptr nodes, and no allocation after
+/// construction. All storage is in the object; allocate large networks once
+/// (std::make_unique), not on the stack.
+///
+/// Activations are row-major, one sample per row, and weights are stored
+/// In x Out row-major, so the inner loops stream along contiguous outputs
+/// and vectorize without reassociating sums. `import_parameters` and
+/// `export_parameters` convert from and to Sequential's layout, so both APIs
+/// can share trained values.
+namespace ExGraf::Static {
+
+/// x * W + b with `Features` outputs.
+template <std::size_t Features, bool Bias = true> struct Linear {
+	static_assert(Features > 0, "Linear needs at least one output.");
+
+	template <AllowedTypes T, std::size_t Batch, std::size_t In> struct Stage {
+		static constexpr std::size_t inputs = In;
+		static constexpr std::size_t outputs = Features;
+		static constexpr std::size_t parameter_count =
+				In * Features + (Bias ? Features : 0);
+
+		std::array<T, In * Features> w{};
+		std::array<T, Bias ? Features : 0> b{};
+		std::array<T, In * Features> dw{};
+		std::array<T, Bias ? Features : 0> db{};
+		std::array<T, Batch * Features> y{};
+
+		auto forward(const T *x) -> const T * {
+			for (std::size_t n = 0; n < Batch; ++n) {
+				T *row = y.data() + n * Features;
+				if constexpr (Bias)
+					std::copy_n(b.data(), Features, row);
+				else
+					std::fill_n(row, Features, T(0));
+				for (std::size_t k = 0; k < In; ++k) {
+					const T xk = x[n * In + k];
+					const T *wk = w.data() + k * Features;
+					for (std::size_t j = 0; j < Features; ++j)
+						row[j] += xk * wk[j];
+				}
+			}
+			return y.data();
+		}
+
+		// dx is nullptr for the first layer, whose input needs no gradient.
+		auto backward(const T *x, const T *dy, T *dx) -> void {
+			dw.fill(T(0));
+			for (std::size_t n = 0; n < Batch; ++n) {
+				const T *g = dy + n * Features;
+				for (std::size_t k = 0; k < In; ++k) {
+					const T xk = x[n * In + k];
+					T *dwk = dw.data() + k * Features;
+					for (std::size_t j = 0; j < Features; ++j)
+						dwk[j] += xk * g[j];
+				}
+			}
+			if constexpr (Bias) {
+				db.fill(T(0));
+				for (std::size_t n = 0; n < Batch; ++n)
+					for (std::size_t j = 0; j < Features; ++j)
+						db[j] += dy[n * Features + j];
+			}
+			if (!dx)
+				return;
+			for (std::size_t n = 0; n < Batch; ++n)
+				for (std::size_t k = 0; k < In; ++k) {
+					const T *wk = w.data() + k * Features;
+					const T *g = dy + n * Features;
+					T sum = T(0);
+					for (std::size_t j = 0; j < Features; ++j)
+						sum += g[j] * wk[j];
+					dx[n * In + k] = sum;
+				}
+		}
+
+		/// He-normal weights and zero bias, as Layers::Linear.
+		template <typename Rng> auto initialize(Rng &rng) -> void {
+			std::normal_distribution<T> normal(T(0), std::sqrt(T(2) / T(In)));
+			for (auto &v : w)
+				v = normal(rng);
+			b.fill(T(0));
+		}
+
+		template <typename F> auto for_each_parameter(F &&f) -> void {
+			f(std::span<T>(w), std::span<const T>(dw));
+			if constexpr (Bias)
+				f(std::span<T>(b), std::span<const T>(db));
+		}
+
+		// Sequential stores W column-major (In x Out) and b as 1 x Out.
+		auto import_parameters(const T *values) -> void {
+			for (std::size_t j = 0; j < Features; ++j)
+				for (std::size_t k = 0; k < In; ++k)
+					w[k * Features + j] = values[j * In + k];
+			if constexpr (Bias)
+				std::copy_n(values + In * Features, Features, b.data());
+		}
+		auto export_parameters(T *values) const -> void {
+			for (std::size_t j = 0; j < Features; ++j)
+				for (std::size_t k = 0; k < In; ++k)
+					values[j * In + k] = w[k * Features + j];
+			if constexpr (Bias)
+				std::copy_n(b.data(), Features, values + In * Features);
+		}
+	};
+};
+
+/// Elementwise max(x, 0).
+struct ReLU {
+	template <AllowedTypes T, std::size_t Batch, std::size_t In> struct Stage {
+		static constexpr std::size_t inputs = In;
+		static constexpr std::size_t outputs = In;
+		static constexpr std::size_t parameter_count = 0;
+
+		std::array<T, Batch * In> y{};
+
+		auto forward(const T *x) -> const T * {
+			for (std::size_t i = 0; i < Batch * In; ++i)
+				y[i] = x[i] > T(0) ? x[i] : T(0);
+			return y.data();
+		}
+		auto backward(const T *, const T *dy, T *dx) -> void {
+			if (!dx)
+				return;
+			for (std::size_t i = 0; i < Batch * In; ++i)
+				dx[i] = y[i] > T(0) ? dy[i] : T(0);
+		}
+		template <typename Rng> auto initialize(Rng &) -> void {}
+		template <typename F> auto for_each_parameter(F &&) -> void {}
+		auto import_parameters(const T *) -> void {}
+		auto export_parameters(T *) const -> void {}
+	};
+};
+
+/// Row-wise softmax. Only valid last, where `Network::backward` differentiates
+/// it together with the cross-entropy loss as (p - y) / Batch.
+struct Softmax {
+	template <AllowedTypes T, std::size_t Batch, std::size_t In> struct Stage {
+		static constexpr std::size_t inputs = In;
+		static constexpr std::size_t outputs = In;
+		static constexpr std::size_t parameter_count = 0;
+
+		std::array<T, Batch * In> y{};
+
+		auto forward(const T *x) -> const T * {
+			for (std::size_t n = 0; n < Batch; ++n) {
+				const T *in = x + n * In;
+				T *out = y.data() + n * In;
+				const T largest = *std::max_element(in, in + In);
+				T sum = T(0);
+				for (std::size_t j = 0; j < In; ++j)
+					sum += out[j] = std::exp(in[j] - largest);
+				const T inv = T(1) / sum;
+				for (std::size_t j = 0; j < In; ++j)
+					out[j] *= inv;
+			}
+			return y.data();
+		}
+		template <typename Rng> auto initialize(Rng &) -> void {}
+		template <typename F> auto for_each_parameter(F &&) -> void {}
+		auto import_parameters(const T *) -> void {}
+		auto export_parameters(T *) const -> void {}
+	};
+};
+
+namespace Detail {
+
+// Binds each layer type to its input width, threading widths left to right.
+template <AllowedTypes T, std::size_t Batch, std::size_t In, typename... Ls>
+struct Chain {
+	using type = std::tuple<>;
+	static constexpr std::size_t outputs = In;
+	static constexpr std::size_t widest = In;
+};
+
+template <AllowedTypes T, std::size_t Batch, std::size_t In, typename L,
+					typename... Rest>
+struct Chain<T, Batch, In, L, Rest...> {
+	using Head = typename L::template Stage<T, Batch, In>;
+	using Tail = Chain<T, Batch, Head::outputs, Rest...>;
+	using type = decltype(std::tuple_cat(std::declval<std::tuple<Head>>(),
+																			 std::declval<typename Tail::type>()));
+	static constexpr std::size_t outputs = Tail::outputs;
+	static constexpr std::size_t widest = std::max(In, Tail::widest);
+};
+
+template <typename... Ls> struct Last;
+template <typename L> struct Last<L> {
+	using type = L;
+};
+template <typename L, typename... Rest> struct Last<L, Rest...> {
+	using type = typename Last<Rest...>::type;
+};
+
+} // namespace Detail
+
+/// A fixed MLP over batches of exactly `Batch` samples of `In` features,
+/// ending in Softmax and trained with cross-entropy; see the namespace
+/// comment. Gradients are overwritten by each `backward`, so unlike the
+/// dynamic graph there is nothing to zero between steps.
+template <AllowedTypes T, std::size_t Batch, std::size_t In, typename... Ls>
+class Network {
+	static_assert(sizeof...(Ls) > 0, "Network needs at least one layer.");
+	static_assert(std::is_same_v<typename Detail::Last<Ls...>::type, Softmax>,
+								"Network trains with softmax cross-entropy: end in Softmax.");
+
+	using Chain = Detail::Chain<T, Batch, In, Ls...>;
+	using Stages = typename Chain::type;
+	static constexpr std::size_t depth = sizeof...(Ls);
+
+public:
+	static constexpr std::size_t batch_size = Batch;
+	static constexpr std::size_t input_features = In;
+	static constexpr std::size_t output_features = Chain::outputs;
+	static constexpr std::size_t parameter_count =
+			[]<std::size_t... I>(std::index_sequence<I...>) {
+				return (std::tuple_element_t<I, Stages>::parameter_count + ... + 0);
+			}(std::make_index_sequence<depth>{});
+
+	using Input = std::span<const T, Batch * In>;
+	using Output = std::span<const T, Batch * output_features>;
+
+	/// Initializes every layer as its dynamic counterpart would.
+	explicit Network(std::uint64_t seed = 0) {
+		std::mt19937_64 rng(seed);
+		each([&](auto &stage) { stage.initialize(rng); });
+	}
+
+	/// Probabilities for `x`, row-major; valid until the next `forward`.
+	auto forward(Input x) -> Output {
+		input = x.data();
+		const T *current = input;
+		each([&](auto &stage) { current = stage.forward(current); });
+		return Output(current, Batch * output_features);
+	}
+
+	/// Mean cross-entropy of the last `forward` against one-hot `target`,
+	/// clamped as Binary::CrossEntropyLoss.
+	auto loss(Output target) const -> T {
+		constexpr T eps = T(1e-12);
+		const auto &p = std::get<depth - 1>(stages).y;
+		T total = T(0);
+		for (std::size_t i = 0; i < p.size(); ++i)
+			total -= target[i] * std::log(std::clamp(p[i], eps, T(1) - eps));
+		return total / T(Batch);
+	}
+
+	/// Gradients of `loss(target)` for every parameter.
+	auto backward(Output target) -> void {
+		const auto &p = std::get<depth - 1>(stages).y;
+		T *seed = buffers[0].data();
+		for (std::size_t i = 0; i < p.size(); ++i)
+			seed[i] = (p[i] - target[i]) / T(Batch);
+		backward_from(std::make_index_sequence<depth - 1>{});
+	}
+
+	/// Plain SGD over every parameter, with the vector update kernel.
+	auto sgd_step(T learning_rate) -> void {
+		const auto isa = detect_isa();
+		for_each_parameter([&](std::span<T> value, std::span<const T> grad) {
+			Kernels::sgd_update(value.data(), grad.data(), static_cast<T *>(nullptr),
+													value.size(), learning_rate, T(0), isa);
+		});
+	}
+
+	/// Calls f(values, gradients) per parameter tensor, in layer order, for
+	/// custom optimizers.
+	template <typename F> auto for_each_parameter(F &&f) -> void {
+		each([&](auto &stage) { stage.for_each_parameter(f); });
+	}
+
+	/// Loads `parameter_count` values in Sequential::parameter_values() order.
+	auto import_parameters(std::span<const T> values) -> void {
+		if (values.size() != parameter_count)
+			throw std::invalid_argument(
+					"Static::Network: parameter count does not match.");
+		const T *at = values.data();
+		each([&](auto &stage) {
+			stage.import_parameters(at);
+			at += std::remove_reference_t<decltype(stage)>::parameter_count;
+		});
+	}
+
+	auto export_parameters(std::span<T> values) const -> void {
+		if (values.size() != parameter_count)
+			throw std::invalid_argument(
+					"Static::Network: parameter count does not match.");
+		T *at = values.data();
+		std::apply(
+				[&](const auto &...stage) {
+					((stage.export_parameters(at),
+						at += std::remove_cvref_t<decltype(stage)>::parameter_count),
+					 ...);
+				},
+				stages);
+	}
+
+	template <std::size_t I> auto layer() -> std::tuple_element_t<I, Stages> & {
+		return std::get<I>(stages);
+	}
+
+private:
+	Stages stages;
+	// The batch passed to the last `forward`, read by the first layer's
+	// backward.
+	const T *input{nullptr};
+	// Gradient with respect to the current layer's output and input in turn.
+	std::array<std::array<T, Batch * Chain::widest>, 2> buffers{};
+
+	template <typename F> auto each(F &&f) -> void {
+		std::apply([&](auto &...stage) { (f(stage), ...); }, stages);
+	}
+
+	template <std::size_t I> auto input_of() const -> const T * {
+		if constexpr (I == 0)
+			return input;
+		else
+			return std::get<I - 1>(stages).y.data();
+	}
+
+	// Walks layers depth-2 .. 0; the Softmax's gradient was seeded.
+	template <std::size_t... I>
+	auto backward_from(std::index_sequence<I...>) -> void {
+		std::size_t side = 0;
+		const auto step = [&]<std::size_t L>(
+													std::integral_constant<std::size_t, L>) {
+			T *dx = L == 0 ? nullptr : buffers[side ^ 1].data();
+			std::get<L>(stages).backward(input_of<L>(), buffers[side].data(), dx);
+			side ^= 1;
+		};
+		(step(std::integral_constant<std::size_t, depth - 2 - I>{}), ...);
+	}
+};
+
+} // namespace ExGraf::Static
@@ -4,25 +4,79 @@
 #include "exgraf/forward.hpp"
 #include "exgraf/shape.hpp"
 
+#include <algorithm>
 #include <armadillo>
+#include <array>
 #include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
 
 namespace ExGraf {
 
+/// Rows [first, first + rows) of a tensor's storage; see Tensor::rows_of.
+struct RowWindow {
+	std::size_t first{0};
+	std::size_t rows{0};
+};
+
 template <AllowedTypes T> class Tensor {
 public:
 	std::shared_ptr<arma::Mat<T>> data{};
 	Shape shape{};
 	std::shared_ptr<Operation<T>> grad_op{};
 	std::shared_ptr<Tensor<T>> grad{};
+	/// Set on a gradient cleared by a lazy `zero_grad`: its storage is stale
+	/// and stands for zero until backward overwrites it or `settle_grad`
+	/// zeroes it.
+	bool cleared{false};
+	/// Set on a row window: the tensor is `window->rows` rows of `data`
+	/// starting at `window->first`, sharing the storage rather than copying
+	/// it. Indexing and `data` still address the whole matrix; operations
+	/// are handed windows only where `Operation::reads_windows` allows, and
+	/// ExpressionGraph gathers them into plain tensors for the rest.
+	std::optional<RowWindow> window{};
 
 	Tensor() = default;
 	explicit Tensor(const Shape &s)
 			: shape(s),
-				data(std::make_shared<arma::Mat<T>>(s.dims()[0], s.dims()[1])) {}
+				data(std::make_shared<arma::Mat<T>>(s.rows(), s.cols())) {}
 	explicit Tensor(const arma::Mat<T> &matrix)
 			: shape({matrix.n_rows, matrix.n_cols}),
 				data(std::make_shared<arma::Mat<T>>(matrix)) {}
+	/// Wraps existing storage without copying it (e.g. a view into an arena).
+	explicit Tensor(std::shared_ptr<arma::Mat<T>> storage)
+			: data(std::move(storage)), shape({data->n_rows, data->n_cols}) {}
+
+	/// Rows [first, first + count) of `parent` as a window onto its storage.
+	static auto rows_of(const Tensor &parent, std::size_t first,
+											std::size_t count) -> Tensor {
+		if (first + count > parent.n_rows())
+			throw std::out_of_range("Tensor::rows_of: rows out of range.");
+		Tensor result;
+		result.data = parent.data;
+		const auto offset = parent.window ? parent.window->first : 0;
+		result.window = RowWindow{offset + first, count};
+		if (parent.shape.size() > 0 && parent.shape.rows() == parent.n_rows()) {
+			std::array<std::size_t, Shape::max_rank> dims{};
+			std::ranges::copy(parent.shape.dims(), dims.begin());
+			dims[0] = count;
+			result.shape = Shape::from(
+					std::span<const std::size_t>(dims.data(), parent.shape.size()));
+		} else {
+			result.shape = Shape{count, parent.data->n_cols};
+		}
+		return result;
+	}
+
+	/// Rows of the tensor, a window's own count for a window.
+	auto n_rows() const -> std::size_t {
+		return window ? window->rows : data->n_rows;
+	}
+	/// The first element; columns follow every `data->n_rows` elements.
+	auto origin() const -> T * {
+		return data->memptr() + (window ? window->first : 0);
+	}
 
 	auto operator[](std::size_t i) -> T & { return (*data)(i); }
 	auto operator[](std::size_t i) const -> const T & { return (*data)(i); }
@@ -32,10 +86,27 @@ public:
 		return (*data)(i, j);
 	}
 
-	auto zero_grad() -> void {
+	/// Zeroes the gradient, creating it on first use. A `lazy` clear of an
+	/// existing gradient only marks it `cleared`, so the next backward writes
+	/// it instead of adding to it and the buffer is never swept; call
+	/// `settle_grad` before reading it in case backward did not reach it.
+	auto zero_grad(bool lazy = false) -> void {
+		if (grad && lazy) {
+			grad->cleared = true;
+			return;
+		}
 		if (!grad)
 			grad = std::make_shared<Tensor<T>>(shape);
 		grad->data->zeros();
+		grad->cleared = false;
+	}
+
+	/// Zeroes a lazily cleared gradient that nothing has written since.
+	auto settle_grad() -> void {
+		if (grad && grad->cleared) {
+			grad->data->zeros();
+			grad->cleared = false;
+		}
 	}
 };
 
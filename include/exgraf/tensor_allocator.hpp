@@ -0,0 +1,39 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace ExGraf {
+
+/// Source of output and gradient buffers for operations. Buffers handed out
+/// may be uninitialised and must be fully overwritten by the caller.
+template <AllowedTypes T> class TensorAllocator {
+public:
+	virtual ~TensorAllocator() = default;
+	virtual auto allocate(std::size_t rows, std::size_t cols) -> Tensor<T> = 0;
+};
+
+/// Serves the n-th request after `rewind()` from the n-th buffer it handed
+/// out last time, reallocating only when the shape changed. Not thread-safe:
+/// each concurrent user needs its own cache.
+template <AllowedTypes T> class BufferCache : public TensorAllocator<T> {
+	std::vector<std::shared_ptr<arma::Mat<T>>> buffers;
+	std::size_t next{0};
+
+public:
+	auto allocate(std::size_t rows, std::size_t cols) -> Tensor<T> override {
+		if (next == buffers.size())
+			buffers.emplace_back();
+		auto &buffer = buffers[next++];
+		if (!buffer || buffer->n_rows != rows || buffer->n_cols != cols)
+			buffer = std::make_shared<arma::Mat<T>>(rows, cols);
+		return Tensor<T>(buffer);
+	}
+
+	auto rewind() -> void { next = 0; }
+};
+
+} // namespace ExGraf
@@ -0,0 +1,297 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/gemm.hpp"
+#include "exgraf/shape.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace ExGraf {
+
+/// An N-D window onto a tensor's storage: an origin, a shape and one stride
+/// per dimension, in elements. Slicing, transposing, reshaping and
+/// broadcasting only rewrite those, so none of them copy; the view keeps the
+/// storage alive.
+///
+/// A tensor's own layout is the "canonical" one for its shape (see Shape):
+/// dimension 0 has stride 1, and the trailing dimensions are flattened
+/// row-major into columns of height shape[0]. A row window (Tensor::rows_of)
+/// is the same with taller columns. Any 2-D view with a unit stride along
+/// one dimension, such as a row slice or the transpose of either, can be
+/// handed to GEMM as it is (`matmul`); anything else is gathered by
+/// `materialize`.
+template <AllowedTypes T> class TensorView {
+public:
+	using Strides = std::array<std::ptrdiff_t, Shape::max_rank>;
+
+	TensorView() = default;
+	explicit TensorView(const Tensor<T> &t)
+			: storage(t.data), origin(t.origin()),
+				extent(t.shape.rows() == t.n_rows() &&
+											 t.shape.cols() == t.data->n_cols
+									 ? t.shape
+									 : Shape{t.n_rows(), t.data->n_cols}),
+				steps(canonical_strides(extent, t.data->n_rows)) {}
+
+	/// `t` as the 2-D matrix it is stored as, whatever its shape: rows by
+	/// flattened columns, as the GEMM-backed operations read it.
+	static auto matrix_of(const Tensor<T> &t) -> TensorView {
+		TensorView result(t);
+		result.extent = Shape{t.n_rows(), t.data->n_cols};
+		result.steps = canonical_strides(result.extent, t.data->n_rows);
+		return result;
+	}
+
+	auto shape() const -> const Shape & { return extent; }
+	auto strides() const -> const Strides & { return steps; }
+	auto data() const -> T * { return origin; }
+
+	/// Dimension 0 has stride 1 and the rest follow the flattened layout,
+	/// with columns `column_stride` apart (0: `s.rows()`, packed).
+	static auto canonical_strides(const Shape &s, std::size_t column_stride = 0)
+			-> Strides {
+		Strides result{};
+		const auto rank = s.size();
+		std::ptrdiff_t step = static_cast<std::ptrdiff_t>(
+				column_stride != 0 ? column_stride : s.rows());
+		for (std::size_t d = rank; d-- > 1;) {
+			result[d] = step;
+			step *= static_cast<std::ptrdiff_t>(s[d]);
+		}
+		if (rank > 0)
+			result[0] = 1;
+		return result;
+	}
+
+	/// True when the view is laid out exactly like a tensor of its shape.
+	/// Strides of size-1 dimensions never matter.
+	auto is_canonical() const -> bool {
+		const auto expected = canonical_strides(extent);
+		for (std::size_t d = 0; d < extent.size(); ++d)
+			if (extent[d] != 1 && steps[d] != expected[d])
+				return false;
+		return true;
+	}
+
+	auto at(std::initializer_list<std::size_t> index) const -> T & {
+		if (index.size() != extent.size())
+			throw std::invalid_argument("TensorView::at: wrong number of indices.");
+		std::ptrdiff_t offset = 0;
+		std::size_t d = 0;
+		for (auto i : index) {
+			if (i >= extent[d])
+				throw std::out_of_range("TensorView::at: index out of range.");
+			offset += static_cast<std::ptrdiff_t>(i) * steps[d++];
+		}
+		return origin[offset];
+	}
+
+	/// Elements [begin, end) of dimension `dim`, every `step`-th one.
+	auto slice(std::size_t dim, std::size_t begin, std::size_t end,
+						 std::size_t step = 1) const -> TensorView {
+		if (dim >= extent.size() || begin > end || end > extent[dim] || step == 0)
+			throw std::invalid_argument("TensorView::slice: bad range.");
+		auto result = *this;
+		result.origin += static_cast<std::ptrdiff_t>(begin) * steps[dim];
+		result.extent = with_dim(extent, dim, (end - begin + step - 1) / step);
+		result.steps[dim] *= static_cast<std::ptrdiff_t>(step);
+		return result;
+	}
+
+	/// Swaps two dimensions; the default is the matrix transpose.
+	auto transpose(std::size_t a = 0, std::size_t b = 1) const -> TensorView {
+		if (a >= extent.size() || b >= extent.size())
+			throw std::invalid_argument("TensorView::transpose: bad dimension.");
+		auto result = *this;
+		result.extent = with_dim(with_dim(extent, a, extent[b]), b, extent[a]);
+		std::swap(result.steps[a], result.steps[b]);
+		return result;
+	}
+
+	/// The same elements under another shape. Only layouts that agree in
+	/// memory order can be reshaped without a copy: canonical views keeping
+	/// the leading dimension (regrouping the flattened columns), or vectors.
+	/// Anything else throws; `materialize()` first.
+	auto reshape(const Shape &s) const -> TensorView {
+		if (s.total_elements() != extent.total_elements())
+			throw std::invalid_argument("TensorView::reshape: size mismatch.");
+		const auto vector = [](const Shape &x) {
+			return x.rows() == 1 || x.cols() == 1;
+		};
+		if (!is_canonical() ||
+				!(s.rows() == extent.rows() || (vector(s) && vector(extent))))
+			throw std::invalid_argument(
+					"TensorView::reshape: layout needs a copy; materialize first.");
+		auto result = *this;
+		result.extent = s;
+		result.steps = canonical_strides(s);
+		return result;
+	}
+
+	/// Repeats size-1 (or missing leading) dimensions up to `s` with a zero
+	/// stride, NumPy style.
+	auto broadcast_to(const Shape &s) const -> TensorView {
+		const auto rank = extent.size();
+		if (s.size() < rank)
+			throw std::invalid_argument("TensorView::broadcast_to: rank too small.");
+		auto result = *this;
+		result.extent = s;
+		result.steps = {};
+		const auto lead = s.size() - rank;
+		for (std::size_t d = 0; d < rank; ++d) {
+			if (extent[d] == s[lead + d])
+				result.steps[lead + d] = steps[d];
+			else if (extent[d] != 1)
+				throw std::invalid_argument(
+						"TensorView::broadcast_to: incompatible dimension.");
+		}
+		return result;
+	}
+
+	/// A 2-D canonical view as an Armadillo matrix sharing the storage.
+	auto matrix() const -> const arma::Mat<T> {
+		if (extent.size() > 2 || !is_canonical())
+			throw std::invalid_argument("TensorView::matrix: not a plain matrix.");
+		return arma::Mat<T>(origin, extent.rows(), extent.cols(), false, true);
+	}
+
+	/// True for a 2-D view that is the transpose of a canonical matrix.
+	auto is_transposed_matrix() const -> bool {
+		return extent.size() == 2 && transpose().is_canonical();
+	}
+
+	/// Gathers the elements into a new tensor of the view's shape.
+	auto materialize() const -> Tensor<T> {
+		Tensor<T> result(extent);
+		copy_to(result.data->memptr());
+		return result;
+	}
+
+	/// Writes the elements in canonical order to `out`.
+	auto copy_to(T *out) const -> void {
+		// Pad to four dimensions; dimension 0 stays innermost so the writes
+		// are sequential.
+		std::array<std::size_t, Shape::max_rank> n{1, 1, 1, 1};
+		Strides in{}, to{};
+		const auto dst = canonical_strides(extent);
+		for (std::size_t d = 0; d < extent.size(); ++d) {
+			n[d] = extent[d];
+			in[d] = steps[d];
+			to[d] = dst[d];
+		}
+		for (std::size_t i3 = 0; i3 < n[3]; ++i3)
+			for (std::size_t i2 = 0; i2 < n[2]; ++i2)
+				for (std::size_t i1 = 0; i1 < n[1]; ++i1) {
+					const auto offset = std::ptrdiff_t(i1) * in[1] +
+															std::ptrdiff_t(i2) * in[2] +
+															std::ptrdiff_t(i3) * in[3];
+					const T *src = origin + offset;
+					T *row = out + std::ptrdiff_t(i1) * to[1] +
+									 std::ptrdiff_t(i2) * to[2] + std::ptrdiff_t(i3) * to[3];
+					if (in[0] == 1)
+						std::copy(src, src + n[0], row);
+					else
+						for (std::size_t i0 = 0; i0 < n[0]; ++i0)
+							row[i0] = src[std::ptrdiff_t(i0) * in[0]];
+				}
+	}
+
+private:
+	std::shared_ptr<arma::Mat<T>> storage;
+	T *origin{nullptr};
+	Shape extent;
+	Strides steps{};
+
+	static auto with_dim(const Shape &s, std::size_t dim, std::size_t value)
+			-> Shape {
+		std::array<std::size_t, Shape::max_rank> dims{};
+		std::copy(s.dims().begin(), s.dims().end(), dims.begin());
+		dims[dim] = value;
+		return Shape::from(std::span<const std::size_t>(dims.data(), s.size()));
+	}
+};
+
+namespace Detail {
+
+/// A 2-D view as a GEMM operand read in place: stored as is or as the
+/// transpose of a column-major matrix, with its column stride.
+template <AllowedTypes T> struct GemmOperand {
+	const T *data;
+	bool trans;
+	std::size_t ld;
+};
+
+/// Empty when neither dimension has a unit stride (or the other one is not
+/// a valid column stride), as for broadcast or every-other-row views.
+template <AllowedTypes T>
+auto gemm_operand(const TensorView<T> &v) -> std::optional<GemmOperand<T>> {
+	const auto rows = v.shape()[0], cols = v.shape()[1];
+	const auto fits = [](std::size_t inner, std::ptrdiff_t unit,
+											 std::size_t outer, std::ptrdiff_t ld) {
+		const auto column = std::ptrdiff_t(std::max<std::size_t>(inner, 1));
+		return (inner <= 1 || unit == 1) && (outer <= 1 || ld >= column);
+	};
+	const auto stride = [](std::size_t inner, std::size_t outer,
+												 std::ptrdiff_t ld) {
+		return outer <= 1 ? std::max<std::size_t>(inner, 1) : std::size_t(ld);
+	};
+	const auto &s = v.strides();
+	if (fits(rows, s[0], cols, s[1]))
+		return GemmOperand<T>{v.data(), false, stride(rows, cols, s[1])};
+	if (fits(cols, s[1], rows, s[0]))
+		return GemmOperand<T>{v.data(), true, stride(cols, rows, s[0])};
+	return std::nullopt;
+}
+
+} // namespace Detail
+
+/// out = alpha * a * b + beta * out for 2-D views. Operands with a unit
+/// stride along either dimension, row windows and slices included, go to
+/// GEMM in place through their strides; only views fitting neither layout
+/// are gathered first. With beta zero, out is resized to the product.
+template <AllowedTypes T>
+auto matmul(const TensorView<T> &a, const TensorView<T> &b, arma::Mat<T> &out,
+						T alpha = T(1), T beta = T(0)) -> void {
+	if (a.shape().size() != 2 || b.shape().size() != 2 ||
+			a.shape()[1] != b.shape()[0])
+		throw std::invalid_argument("matmul: operands are not conformant.");
+	const auto operand = [](const TensorView<T> &v) {
+		if (auto o = Detail::gemm_operand(v))
+			return std::pair{v, *o};
+		TensorView<T> dense(v.materialize());
+		return std::pair{dense, *Detail::gemm_operand(dense)};
+	};
+	// The views keep gathered copies alive for the product.
+	const auto [va, oa] = operand(a);
+	const auto [vb, ob] = operand(b);
+	const auto m = a.shape()[0], k = a.shape()[1], n = b.shape()[1];
+	if (beta == T(0))
+		out.set_size(m, n);
+	else if (out.n_rows != m || out.n_cols != n)
+		throw std::invalid_argument(
+				"matmul: accumulating into an output of the wrong shape.");
+	gemm<T>({.trans_a = oa.trans,
+					 .trans_b = ob.trans,
+					 .m = m,
+					 .n = n,
+					 .k = k,
+					 .alpha = alpha,
+					 .a = oa.data,
+					 .lda = oa.ld,
+					 .b = ob.data,
+					 .ldb = ob.ld,
+					 .beta = beta,
+					 .c = out.memptr(),
+					 .ldc = std::max<std::size_t>(m, 1)});
+}
+
+} // namespace ExGraf
@@ -5,10 +5,15 @@
 #include "exgraf/operation.hpp"
 #include "exgraf/tensor.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
 namespace ExGraf::Unary {
 
 template <AllowedTypes T> class ReLUOp : public Operation<T> {
-	arma::Mat<T> mask;
+	Tensor<T> last_output;
 
 public:
 	auto
@@ -17,19 +22,40 @@ public:
 		auto &input = inputs[0].get();
 		trace("[ReLUOp forward] input: {}x{}", input.data->n_rows,
 					input.data->n_cols);
-		mask = arma::ones<arma::Mat<T>>(input.data->n_rows, input.data->n_cols);
-		mask.elem(arma::find(*input.data < T(0))).zeros();
-		arma::Mat<T> result = (*input.data) % mask;
-		trace("[ReLUOp forward] result: {}x{}", result.n_rows, result.n_cols);
-		return Tensor<T>(result);
+		auto result = this->allocate(input.data->n_rows, input.data->n_cols);
+		const T *x = input.data->memptr();
+		T *y = result.data->memptr();
+		for (std::size_t i = 0; i < input.data->n_elem; ++i)
+			y[i] = x[i] > T(0) ? x[i] : T(0);
+		last_output = result;
+		trace("[ReLUOp forward] result: {}x{}", result.data->n_rows,
+					result.data->n_cols);
+		return result;
 	}
 
-	auto
-	backward(const Tensor<T> &grad_output) -> std::vector<Tensor<T>> override {
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		grad_inputs[0] =
+				this->allocate(grad_output.data->n_rows, grad_output.data->n_cols);
+		const GradientTarget<T> target{grad_inputs[0].data.get()};
+		backward_into(grad_output, {&target, 1});
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
 		trace("[ReLUOp backward] grad_output: {}x{}", grad_output.data->n_rows,
 					grad_output.data->n_cols);
-		arma::Mat<T> dx = (*grad_output.data) % mask;
-		return {Tensor<T>(dx)};
+		if (!targets[0].into)
+			return;
+		// The output is positive exactly where the input was, so it doubles as
+		// the mask.
+		const T *g = grad_output.data->memptr();
+		const T *y = last_output.data->memptr();
+		store_gradient(targets[0],
+									 [&](std::size_t i) { return y[i] > T(0) ? g[i] : T(0); });
 	}
 };
 
@@ -43,27 +69,151 @@ public:
 		auto &input = inputs[0].get();
 		trace("[SoftmaxOp forward] input: {}x{}", input.data->n_rows,
 					input.data->n_cols);
-		arma::Mat<T> x = *input.data;
-		auto x_max = arma::max(x, 1);
-		x.each_col() -= x_max;
-		arma::Mat<T> exp_x = arma::exp(x);
-		auto sum_exp = arma::sum(exp_x, 1);
-		exp_x.each_col() /= sum_exp;
-		last_output = Tensor<T>(exp_x);
-		trace("[SoftmaxOp forward] output: {}x{}", exp_x.n_rows, exp_x.n_cols);
+		last_output = this->allocate(input.data->n_rows, input.data->n_cols);
+		auto row_stats = this->allocate(input.data->n_rows, 1);
+		auto &y = *last_output.data;
+		auto &stats = *row_stats.data;
+		stats = arma::max(*input.data, 1);
+		y = *input.data;
+		y.each_col() -= stats;
+		y = arma::exp(y);
+		stats = arma::sum(y, 1);
+		y.each_col() /= stats;
+		trace("[SoftmaxOp forward] output: {}x{}", y.n_rows, y.n_cols);
 		return last_output;
 	}
 
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		grad_inputs[0] =
+				this->allocate(grad_output.data->n_rows, grad_output.data->n_cols);
+		const GradientTarget<T> target{grad_inputs[0].data.get()};
+		backward_into(grad_output, {&target, 1});
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	/// dx = (g - rowsum(g % s)) % s for softmax output s.
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
+		const auto &target = targets[0];
+		if (!target.into)
+			return;
+		const auto rows = grad_output.data->n_rows;
+		const auto cols = grad_output.data->n_cols;
+		auto dot_sum = this->allocate(rows, 1);
+		const T *g = grad_output.data->memptr();
+		const T *s = last_output.data->memptr();
+		T *dot = dot_sum.data->memptr();
+		std::fill_n(dot, rows, T(0));
+		for (std::size_t c = 0; c < cols; ++c)
+			for (std::size_t r = 0; r < rows; ++r)
+				dot[r] += g[c * rows + r] * s[c * rows + r];
+		T *dx = target.into->memptr();
+		for (std::size_t c = 0; c < cols; ++c) {
+			for (std::size_t r = 0; r < rows; ++r) {
+				const auto i = c * rows + r;
+				const T v = (g[i] - dot[r]) * s[i];
+				dx[i] = target.accumulate ? dx[i] + v : v;
+			}
+		}
+	}
+};
+
+template <AllowedTypes T> class TanhOp : public Operation<T> {
+	Tensor<T> last_output;
+
+public:
 	auto
-	backward(const Tensor<T> &grad_output) -> std::vector<Tensor<T>> override {
-		arma::Mat<T> softmax = *last_output.data;
-		arma::Mat<T> grad = *grad_output.data;
-		arma::Mat<T> dot = grad % softmax;
-		arma::Col<T> dot_sum = arma::sum(dot, 1);
-		grad.each_col() -= dot_sum;
-		arma::Mat<T> grad_input = softmax % grad;
-		return {Tensor<T>(grad_input)};
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &input = inputs[0].get();
+		trace("[TanhOp forward] input: {}x{}", input.data->n_rows,
+					input.data->n_cols);
+		last_output = this->allocate(input.data->n_rows, input.data->n_cols);
+		const T *x = input.data->memptr();
+		T *y = last_output.data->memptr();
+		for (std::size_t i = 0; i < input.data->n_elem; ++i)
+			y[i] = std::tanh(x[i]);
+		return last_output;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		grad_inputs[0] =
+				this->allocate(grad_output.data->n_rows, grad_output.data->n_cols);
+		const GradientTarget<T> target{grad_inputs[0].data.get()};
+		backward_into(grad_output, {&target, 1});
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
+		if (!targets[0].into)
+			return;
+		const T *g = grad_output.data->memptr();
+		const T *y = last_output.data->memptr();
+		store_gradient(targets[0],
+									 [&](std::size_t i) { return g[i] * (T(1) - y[i] * y[i]); });
+	}
+};
+
+/// Inverted dropout: zeroes each element with probability `rate` and scales
+/// the survivors by 1 / (1 - rate), so inference needs no rescaling. The
+/// mask is drawn from the operation's own generator, making runs with the
+/// same seed repeatable.
+template <AllowedTypes T> class DropoutOp : public Operation<T> {
+	T rate;
+	std::mt19937_64 generator;
+	Tensor<T> mask;
+
+public:
+	explicit DropoutOp(T r = T(0.5), std::uint64_t seed = 0)
+			: rate(r), generator(seed) {}
+
+	auto
+	forward(const std::vector<std::reference_wrapper<const Tensor<T>>> &inputs)
+			-> Tensor<T> override {
+		auto &input = inputs[0].get();
+		trace("[DropoutOp forward] input: {}x{}", input.data->n_rows,
+					input.data->n_cols);
+		const auto n = input.data->n_elem;
+		mask = this->allocate(input.data->n_rows, input.data->n_cols);
+		auto result = this->allocate(input.data->n_rows, input.data->n_cols);
+		std::uniform_real_distribution<T> uniform(T(0), T(1));
+		const T keep = T(1) / (T(1) - rate);
+		const T *x = input.data->memptr();
+		T *m = mask.data->memptr();
+		T *y = result.data->memptr();
+		for (std::size_t i = 0; i < n; ++i) {
+			m[i] = uniform(generator) < rate ? T(0) : keep;
+			y[i] = x[i] * m[i];
+		}
+		return result;
+	}
+
+	auto backward(const Tensor<T> &grad_output,
+								std::span<Tensor<T>> grad_inputs) -> void override {
+		grad_inputs[0] =
+				this->allocate(grad_output.data->n_rows, grad_output.data->n_cols);
+		const GradientTarget<T> target{grad_inputs[0].data.get()};
+		backward_into(grad_output, {&target, 1});
+	}
+
+	auto accumulates_in_place() const -> bool override { return true; }
+
+	auto backward_into(const Tensor<T> &grad_output,
+										 std::span<const GradientTarget<T>> targets)
+			-> void override {
+		if (!targets[0].into)
+			return;
+		const T *g = grad_output.data->memptr();
+		const T *m = mask.data->memptr();
+		store_gradient(targets[0], [&](std::size_t i) { return g[i] * m[i]; });
 	}
 };
 
-} // namespace ExGraf::Unary
+} // namespace ExGraf::Unary
\ No newline at end of file
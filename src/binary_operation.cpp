@@ -4,7 +4,9 @@ namespace ExGraf::Binary {
 
 #define X(T)                                                                   \
 	template class MatMulOp<T>;                                                  \
-	template class CrossEntropyLoss<T>;
+	template class CrossEntropyLoss<T>;                                          \
+	template class AddOp<T>;                                                     \
+	template class AddBiasOp<T>;
 EXGRAF_ALLOWED_TYPES
 #undef X
 
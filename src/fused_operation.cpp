@@ -0,0 +1,11 @@
+#include "exgraf/fused_operation.hpp"
+
+namespace ExGraf::Fused {
+
+#define X(T)                                                                   \
+	template class LinearReLUOp<T>;                                              \
+	template class SoftmaxCrossEntropyOp<T>;
+EXGRAF_ALLOWED_TYPES
+#undef X
+
+} // namespace ExGraf::Fused
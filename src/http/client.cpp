@@ -20,6 +20,27 @@ auto HttpClient::get(const std::string &endpoint) const -> HttpResponse {
 	};
 }
 
+auto HttpClient::get_stream(
+		const std::string &endpoint,
+		const std::function<bool(std::string_view)> &on_chunk) const
+		-> HttpResponse {
+	auto r = cpr::Get(
+			cpr::Url{
+					base_url + endpoint,
+			},
+			cpr::WriteCallback{
+					[&on_chunk](std::string_view data, intptr_t) {
+						return on_chunk(data);
+					},
+			});
+	return HttpResponse{
+			to_int(r.status_code),
+			{},
+			r.status_code == 200,
+			r.error.message,
+	};
+}
+
 auto HttpClient::post(const std::string &endpoint,
 											const std::string &payload) const -> HttpResponse {
 	auto r = cpr::Post(
@@ -0,0 +1,19 @@
+#include "exgraf/layers.hpp"
+
+namespace ExGraf::Layers {
+
+#define X(T)                                                                   \
+	template class Linear<T>;                                                    \
+	template class ReLU<T>;                                                      \
+	template class Tanh<T>;                                                      \
+	template class Softmax<T>;                                                   \
+	template class Dropout<T>;                                                   \
+	template class Conv2D<T>;                                                    \
+	template class Pool2D<T, Spatial::MaxPool2DOp<T>>;                           \
+	template class Pool2D<T, Spatial::AvgPool2DOp<T>>;
+
+EXGRAF_ALLOWED_TYPES
+
+#undef X
+
+} // namespace ExGraf::Layers
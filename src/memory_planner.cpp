@@ -0,0 +1,9 @@
+#include "exgraf/memory_planner.hpp"
+
+namespace ExGraf {
+
+#define X(T) template class MemoryPlanner<T>;
+EXGRAF_ALLOWED_TYPES
+#undef X
+
+} // namespace ExGraf
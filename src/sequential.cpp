@@ -0,0 +1,9 @@
+#include "exgraf/sequential.hpp"
+
+namespace ExGraf {
+
+#define X(T) template class Sequential<T>;
+EXGRAF_ALLOWED_TYPES
+#undef X
+
+} // namespace ExGraf
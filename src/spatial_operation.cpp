@@ -0,0 +1,14 @@
+#include "exgraf/spatial_operation.hpp"
+
+namespace ExGraf::Spatial {
+
+#define X(T)                                                                   \
+	template class Conv2DOp<T>;                                                  \
+	template class MaxPool2DOp<T>;                                               \
+	template class AvgPool2DOp<T>;
+
+EXGRAF_ALLOWED_TYPES
+
+#undef X
+
+} // namespace ExGraf::Spatial
@@ -4,7 +4,9 @@ namespace ExGraf::Unary {
 
 #define X(T)                                                                   \
 	template class ReLUOp<T>;                                                    \
-	template class SoftmaxOp<T>;
+	template class SoftmaxOp<T>;                                                 \
+	template class TanhOp<T>;                                                    \
+	template class DropoutOp<T>;
 
 EXGRAF_ALLOWED_TYPES
 
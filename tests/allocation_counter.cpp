@@ -0,0 +1,87 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+auto checked_malloc(std::size_t bytes) -> void * {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (auto *p = std::malloc(bytes ? bytes : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+auto checked_aligned_malloc(std::size_t bytes, std::align_val_t align)
+		-> void * {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	const auto alignment = static_cast<std::size_t>(align);
+	const auto rounded = (bytes + alignment - 1) / alignment * alignment;
+	if (auto *p = std::aligned_alloc(alignment, rounded ? rounded : alignment))
+		return p;
+	throw std::bad_alloc();
+}
+
+} // namespace
+
+namespace ExGraf::Testing {
+
+auto counted_malloc(std::size_t bytes) -> void * {
+	return checked_malloc(bytes);
+}
+auto counted_free(void *ptr) -> void { std::free(ptr); }
+auto allocation_count() -> std::size_t {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace ExGraf::Testing
+
+auto operator new(std::size_t bytes) -> void * { return checked_malloc(bytes); }
+auto operator new[](std::size_t bytes) -> void * {
+	return checked_malloc(bytes);
+}
+auto operator new(std::size_t bytes, std::align_val_t align) -> void * {
+	return checked_aligned_malloc(bytes, align);
+}
+auto operator new[](std::size_t bytes, std::align_val_t align) -> void * {
+	return checked_aligned_malloc(bytes, align);
+}
+auto operator new(std::size_t bytes, const std::nothrow_t &) noexcept
+		-> void * {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(bytes ? bytes : 1);
+}
+auto operator new[](std::size_t bytes, const std::nothrow_t &) noexcept
+		-> void * {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(bytes ? bytes : 1);
+}
+auto operator delete(void *ptr) noexcept -> void { std::free(ptr); }
+auto operator delete[](void *ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void *ptr, std::size_t) noexcept -> void { std::free(ptr); }
+auto operator delete[](void *ptr, std::size_t) noexcept -> void {
+	std::free(ptr);
+}
+auto operator delete(void *ptr, const std::nothrow_t &) noexcept -> void {
+	std::free(ptr);
+}
+auto operator delete[](void *ptr, const std::nothrow_t &) noexcept -> void {
+	std::free(ptr);
+}
+auto operator delete(void *ptr, std::align_val_t) noexcept -> void {
+	std::free(ptr);
+}
+auto operator delete[](void *ptr, std::align_val_t) noexcept -> void {
+	std::free(ptr);
+}
+auto operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+		-> void {
+	std::free(ptr);
+}
+auto operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept
+		-> void {
+	std::free(ptr);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+// Force-included into every test translation unit so that Armadillo's
+// ARMA_ALIEN_MEM_* hooks can name these functions. Together with the
+// replaced global operator new they count every heap allocation made by the
+// test process.
+namespace ExGraf::Testing {
+
+auto counted_malloc(std::size_t bytes) -> void *;
+auto counted_free(void *ptr) -> void;
+auto allocation_count() -> std::size_t;
+
+} // namespace ExGraf::Testing
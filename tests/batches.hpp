@@ -0,0 +1,31 @@
+#pragma once
+
+#include "exgraf/allowed_types.hpp"
+#include "exgraf/tensor.hpp"
+
+#include <armadillo>
+#include <cstddef>
+#include <utility>
+
+// Classification batches shared by the training tests.
+namespace ExGraf::Testing {
+
+/// One-hot targets: row i belongs to class (i * stride) % classes.
+template <AllowedTypes T = double>
+auto one_hot(std::size_t rows, std::size_t classes, std::size_t stride = 1)
+		-> arma::Mat<T> {
+	arma::Mat<T> y(rows, classes, arma::fill::zeros);
+	for (std::size_t i = 0; i < rows; ++i)
+		y(i, (i * stride) % classes) = T(1);
+	return y;
+}
+
+/// Features uniform in [0, 1) and `one_hot` targets.
+template <AllowedTypes T = double>
+auto make_batch(std::size_t rows, std::size_t features, std::size_t classes,
+								std::size_t stride = 1) -> std::pair<Tensor<T>, Tensor<T>> {
+	const arma::Mat<T> x = arma::randu<arma::Mat<T>>(rows, features);
+	return {Tensor<T>(x), Tensor<T>(one_hot<T>(rows, classes, stride))};
+}
+
+} // namespace ExGraf::Testing
@@ -0,0 +1,147 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/checkpoint.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <unistd.h>
+
+using namespace ExGraf;
+
+namespace {
+
+struct TempDir {
+	std::filesystem::path path;
+	TempDir()
+			: path(std::filesystem::temp_directory_path() /
+						 ("exgraf-checkpoint-" + std::to_string(::getpid()))) {
+		std::filesystem::create_directories(path);
+	}
+	~TempDir() { std::filesystem::remove_all(path); }
+};
+
+auto make_model() -> Model<double> {
+	return Model<double>(6, 5, 3, std::make_unique<AdamOptimizer<double>>(0.01));
+}
+
+auto train(Model<double> &model, const Tensor<double> &x,
+					 const Tensor<double> &y, int steps) -> void {
+	for (int i = 0; i < steps; ++i) {
+		model.zero_grad();
+		model.compute_loss(model.forward(x), y);
+		model.backward();
+		model.step();
+	}
+}
+
+auto same_values(const Model<double> &a, const Model<double> &b) -> bool {
+	return std::ranges::equal(a.parameter_values(), b.parameter_values());
+}
+
+} // namespace
+
+TEST_CASE("a loaded checkpoint resumes training exactly") {
+	TempDir dir;
+	const auto file = dir.path / "model.exgrafck";
+	arma::arma_rng::set_seed(71);
+	const Tensor<double> x(arma::randn<arma::Mat<double>>(8, 6));
+	const auto y = Model<double>::to_one_hot({0, 1, 2, 0, 1, 2, 0, 1}, 3);
+
+	auto trained = make_model();
+	train(trained, x, y, 5);
+	Checkpoint::save(file, trained);
+
+	auto restored = make_model();
+	Checkpoint::load(file, restored, {.verify = true});
+	CHECK(same_values(trained, restored));
+	CHECK(restored.optimizer_state().step == 5);
+
+	// The parameters live in the mapping, 64-byte aligned.
+	const auto address =
+			reinterpret_cast<std::uintptr_t>(restored.parameter_values().data());
+	CHECK_EQ(address % Checkpoint::checkpoint_alignment, 0);
+
+	// Same Adam moments and step count: the next steps agree bit for bit.
+	train(trained, x, y, 3);
+	train(restored, x, y, 3);
+	CHECK(same_values(trained, restored));
+
+	// The mapping is private; training did not reach the file.
+	auto again = make_model();
+	Checkpoint::load(file, again, {.optimizer_state = false, .verify = true});
+	CHECK(again.optimizer_state().step == 0);
+	CHECK_FALSE(same_values(again, restored));
+}
+
+TEST_CASE("an async save captures the parameters at the call") {
+	TempDir dir;
+	const auto file = dir.path / "async.exgrafck";
+	arma::arma_rng::set_seed(72);
+	const Tensor<double> x(arma::randn<arma::Mat<double>>(4, 6));
+	const auto y = Model<double>::to_one_hot({2, 1, 0, 1}, 3);
+
+	auto model = make_model();
+	train(model, x, y, 2);
+	const auto at_save = Checkpoint::snapshot(model);
+	auto pending = Checkpoint::save_async(file, model);
+	train(model, x, y, 2);
+	pending.get();
+
+	auto restored = make_model();
+	Checkpoint::load(file, restored);
+	CHECK(std::ranges::equal(restored.parameter_values(), at_save.parameters));
+	CHECK(restored.optimizer_state().step == 2);
+}
+
+TEST_CASE("loading rejects damaged or mismatched checkpoints") {
+	TempDir dir;
+	const auto file = dir.path / "bad.exgrafck";
+	arma::arma_rng::set_seed(73);
+	auto model = make_model();
+	Checkpoint::save(file, model);
+
+	CHECK_THROWS_AS(Checkpoint::load(dir.path / "missing", model),
+									std::runtime_error);
+	Model<double> wider(6, 7, 3, std::make_unique<AdamOptimizer<double>>());
+	CHECK_THROWS_AS(Checkpoint::load(file, wider), std::runtime_error);
+	Model<float> narrower(6, 5, 3, std::make_unique<AdamOptimizer<float>>());
+	CHECK_THROWS_AS(Checkpoint::load(file, narrower), std::runtime_error);
+
+	// Flip a byte of the first parameter; only a verified load notices.
+	const std::vector<double> before(model.parameter_values().begin(),
+																	 model.parameter_values().end());
+	{
+		Checkpoint::CheckpointHeader header;
+		std::fstream io(file, std::ios::binary | std::ios::in | std::ios::out);
+		io.read(reinterpret_cast<char *>(&header), sizeof(header));
+		io.seekp(static_cast<std::streamoff>(header.parameter_offset) + 7);
+		io.put('\x5a');
+	}
+	auto target = make_model();
+	const std::vector<double> untouched(target.parameter_values().begin(),
+																			target.parameter_values().end());
+	CHECK_THROWS_AS(Checkpoint::load(file, target, {.verify = true}),
+									std::runtime_error);
+	CHECK(std::ranges::equal(target.parameter_values(), untouched));
+	Checkpoint::load(file, target);
+	CHECK_FALSE(std::ranges::equal(target.parameter_values(), before));
+
+	// Adam moments do not fit plain SGD.
+	train(model, Tensor<double>(arma::randn<arma::Mat<double>>(2, 6)),
+				Model<double>::to_one_hot({0, 1}, 3), 1);
+	Checkpoint::save(file, model);
+	Model<double> sgd(6, 5, 3, std::make_unique<SgdOptimizer<double>>());
+	REQUIRE(model.optimizer_state().step != sgd.optimizer_state().step);
+	const auto step = sgd.optimizer_state().step;
+	CHECK_THROWS_AS(Checkpoint::load(file, sgd), std::invalid_argument);
+	// The rejected state must not leave the saved step count behind.
+	CHECK(sgd.optimizer_state().step == step);
+	Checkpoint::load(file, sgd, {.optimizer_state = false});
+	CHECK(same_values(sgd, model));
+}
@@ -0,0 +1,76 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/loaders/data_loader.hpp"
+
+#include <set>
+
+using namespace ExGraf;
+
+namespace {
+
+// Every column of row i holds i, so batches identify the samples they carry.
+auto indexed(std::size_t samples, std::size_t cols) -> Tensor<double> {
+	arma::Mat<double> m(samples, cols);
+	for (std::size_t c = 0; c < cols; ++c) {
+		for (std::size_t i = 0; i < samples; ++i)
+			m(i, c) = static_cast<double>(i);
+	}
+	return Tensor<double>(m);
+}
+
+auto epoch_samples(DataLoader<double> &loader) -> std::vector<std::size_t> {
+	std::vector<std::size_t> samples;
+	while (auto batch = loader.next()) {
+		auto &x = *batch->inputs.data;
+		auto &y = *batch->targets.data;
+		REQUIRE_EQ(x.n_rows, y.n_rows);
+		for (std::size_t i = 0; i < x.n_rows; ++i) {
+			CHECK_EQ(x(i, 0), x(i, x.n_cols - 1));
+			CHECK_EQ(x(i, 0), y(i, 0));
+			samples.push_back(static_cast<std::size_t>(x(i, 0)));
+		}
+	}
+	return samples;
+}
+
+} // namespace
+
+TEST_CASE("data loader covers every sample once per epoch") {
+	DataLoader<double> loader(indexed(23, 5), indexed(23, 2),
+														{.batch_size = 4, .prefetch = 3, .workers = 2});
+	CHECK_EQ(loader.batches_per_epoch(), 6);
+	std::vector<std::size_t> previous;
+	for (int epoch = 0; epoch < 3; ++epoch) {
+		auto samples = epoch_samples(loader);
+		REQUIRE_EQ(samples.size(), 23);
+		CHECK_EQ(std::set(samples.begin(), samples.end()).size(), 23);
+		if (epoch > 0)
+			CHECK_NE(samples, previous);
+		previous = samples;
+	}
+}
+
+TEST_CASE("data loader order depends only on the seed") {
+	auto run = [](std::size_t workers) {
+		DataLoader<double> loader(
+				indexed(40, 3), indexed(40, 1),
+				{.batch_size = 8, .prefetch = 2, .workers = workers, .seed = 5});
+		auto first = epoch_samples(loader);
+		auto second = epoch_samples(loader);
+		first.insert(first.end(), second.begin(), second.end());
+		return first;
+	};
+	CHECK_EQ(run(1), run(3));
+}
+
+TEST_CASE("data loader without shuffling keeps dataset order") {
+	DataLoader<double> loader(indexed(10, 2), indexed(10, 1),
+														{.batch_size = 3,
+														 .prefetch = 2,
+														 .shuffle = false,
+														 .drop_last = true});
+	auto samples = epoch_samples(loader);
+	const std::vector<std::size_t> expected{0, 1, 2, 3, 4, 5, 6, 7, 8};
+	CHECK_EQ(samples, expected);
+}
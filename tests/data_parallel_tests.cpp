@@ -0,0 +1,65 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/data_parallel_trainer.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+
+#include "batches.hpp"
+
+#include <thread>
+
+using namespace ExGraf;
+using Testing::make_batch;
+
+namespace {
+
+auto make_model() -> Model<double> {
+	arma::arma_rng::set_seed(11);
+	return Model<double>(8, 16, 4, std::make_unique<SgdOptimizer<double>>(0.2));
+}
+
+} // namespace
+
+TEST_CASE("data parallel training matches the single threaded step") {
+	auto [x, y] = make_batch(10, 8, 4, 3);
+	auto reference = make_model();
+	std::vector<double> expected;
+	for (int step = 0; step < 4; ++step) {
+		auto output = reference.forward(x);
+		expected.push_back(reference.compute_loss(output, y));
+		reference.backward();
+		reference.step();
+		reference.zero_grad();
+	}
+
+	// Three workers split the 10 rows unevenly (3, 3, 4).
+	auto model = make_model();
+	DataParallelTrainer<double> trainer(model, 3);
+	for (int step = 0; step < 4; ++step)
+		CHECK_EQ(trainer.step(x, y),
+						 doctest::Approx(expected[step]).epsilon(1e-12));
+	for (std::size_t j = 0; j < model.params().size(); ++j)
+		CHECK(arma::approx_equal(*model.params()[j].get().data,
+														 *reference.params()[j].get().data, "absdiff",
+														 1e-12));
+}
+
+TEST_CASE("data parallel trainer tolerates more workers than rows") {
+	auto [x, y] = make_batch(3, 8, 4, 3);
+	auto model = make_model();
+	DataParallelTrainer<double> trainer(model, 5);
+	auto first = trainer.step(x, y);
+	double last = first;
+	for (int step = 0; step < 20; ++step)
+		last = trainer.step(x, y);
+	CHECK(std::isfinite(last));
+	CHECK_LT(last, first);
+}
+
+TEST_CASE("physical cores count SMT siblings once") {
+	const auto cores = physical_core_count();
+	CHECK(cores >= 1);
+	if (const auto threads = std::thread::hardware_concurrency(); threads > 0)
+		CHECK(cores <= threads);
+}
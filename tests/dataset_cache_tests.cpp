@@ -0,0 +1,107 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/loaders/dataset_cache.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace ExGraf;
+
+namespace {
+
+struct TempDir {
+	std::filesystem::path path;
+	TempDir()
+			: path(std::filesystem::temp_directory_path() /
+						 ("exgraf-cache-" + std::to_string(::getpid()))) {
+		std::filesystem::create_directories(path);
+	}
+	~TempDir() { std::filesystem::remove_all(path); }
+};
+
+auto flip_byte(const std::filesystem::path &file, std::streamoff offset)
+		-> void {
+	std::fstream io(file, std::ios::binary | std::ios::in | std::ios::out);
+	io.seekg(offset);
+	char c = 0;
+	io.read(&c, 1);
+	c = static_cast<char>(c ^ 0x5a);
+	io.seekp(offset);
+	io.write(&c, 1);
+}
+
+} // namespace
+
+TEST_CASE("dataset cache maps what it wrote without copying") {
+	TempDir dir;
+	const auto file = dir.path / "images.exgraf";
+	Tensor<double> original(
+			arma::Mat<double>(arma::randu<arma::Mat<double>>(37, 11)));
+	Cache::write_dataset(file, original);
+
+	auto mapped = Cache::map_dataset<double>(file, Cache::Verify::Always);
+	REQUIRE(mapped);
+	CHECK(arma::approx_equal(*mapped->data, *original.data, "absdiff", 0.0));
+	const auto address = reinterpret_cast<std::uintptr_t>(mapped->data->memptr());
+	CHECK_EQ(address % Cache::dataset_alignment, 0);
+
+	// Private mapping: writes through the view stay in memory.
+	mapped->data->at(0, 0) = -1.0;
+	auto again = Cache::map_dataset<double>(file, Cache::Verify::Always);
+	REQUIRE(again);
+	CHECK_EQ(again->data->at(0, 0), original.data->at(0, 0));
+}
+
+TEST_CASE("dataset cache rejects mismatched or damaged files") {
+	TempDir dir;
+	const auto file = dir.path / "labels.exgraf";
+	Tensor<double> original(arma::Mat<double>(8, 4, arma::fill::ones));
+	Cache::write_dataset(file, original);
+
+	CHECK_FALSE(Cache::map_dataset<double>(dir.path / "missing.exgraf"));
+	CHECK_FALSE(Cache::map_dataset<float>(file));
+
+	const auto payload = static_cast<std::streamoff>(
+			std::filesystem::file_size(file) - sizeof(double));
+	flip_byte(file, payload);
+	CHECK(Cache::map_dataset<double>(file));
+	CHECK_FALSE(Cache::map_dataset<double>(file, Cache::Verify::Always));
+
+	std::filesystem::resize_file(file, std::filesystem::file_size(file) - 1);
+	CHECK_FALSE(Cache::map_dataset<double>(file));
+
+	flip_byte(file, 0);
+	CHECK_FALSE(Cache::map_dataset<double>(file));
+}
+
+TEST_CASE("on-change verification checks a cache once per modification") {
+	TempDir dir;
+	const auto file = dir.path / "stamped.exgraf";
+	const auto stamp = Cache::stamp_path(file);
+	const Tensor<double> ones(arma::Mat<double>(6, 3, arma::fill::ones));
+	Cache::write_dataset(file, ones);
+	CHECK_FALSE(std::filesystem::exists(stamp));
+	REQUIRE(Cache::map_dataset<double>(file, Cache::Verify::OnChange));
+	CHECK(std::filesystem::exists(stamp));
+
+	// The stamp stands for the checked payload while size and time match.
+	const auto payload = static_cast<std::streamoff>(
+			std::filesystem::file_size(file) - sizeof(double));
+	const auto verified_at = std::filesystem::last_write_time(file);
+	flip_byte(file, payload);
+	std::filesystem::last_write_time(file, verified_at);
+	CHECK(Cache::map_dataset<double>(file, Cache::Verify::OnChange));
+
+	// A new modification time is verified again.
+	std::filesystem::last_write_time(file, verified_at + std::chrono::seconds(1));
+	CHECK_FALSE(Cache::map_dataset<double>(file, Cache::Verify::OnChange));
+
+	// Rewriting the cache drops the old stamp.
+	Cache::write_dataset(file, ones);
+	CHECK_FALSE(std::filesystem::exists(stamp));
+	CHECK(Cache::map_dataset<double>(file, Cache::Verify::OnChange));
+}
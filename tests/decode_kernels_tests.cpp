@@ -0,0 +1,93 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/loaders/decode_kernels.hpp"
+#include "exgraf/loaders/idx_stream.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+auto supported_levels() -> std::vector<Isa> {
+	std::vector<Isa> levels;
+	for (auto isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2})
+		if (isa_supported(isa))
+			levels.push_back(isa);
+	return levels;
+}
+
+auto bytes(std::size_t n, std::size_t modulo) -> std::vector<std::uint8_t> {
+	std::vector<std::uint8_t> out(n);
+	for (std::size_t i = 0; i < n; ++i)
+		out[i] = static_cast<std::uint8_t>((i * 73 + 11) % modulo);
+	return out;
+}
+
+} // namespace
+
+TEST_CASE_TEMPLATE("normalize_u8 is bit-identical on every level", T, float,
+									 double) {
+	// Odd lengths exercise the scalar tails after the vector loops.
+	for (std::size_t n : {0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 255, 1000}) {
+		const auto src = bytes(n, 256);
+		std::vector<T> expected(n);
+		Kernels::normalize_u8(src.data(), n, expected.data(), Isa::Scalar);
+		for (auto isa : supported_levels()) {
+			std::vector<T> got(n, T(-1));
+			Kernels::normalize_u8(src.data(), n, got.data(), isa);
+			CHECK(got == expected);
+		}
+	}
+}
+
+TEST_CASE_TEMPLATE("one_hot_u8 fills every entry on every level", T, float,
+									 double) {
+	constexpr std::size_t classes = 10;
+	for (std::size_t n : {0, 1, 5, 8, 13, 64, 101}) {
+		const auto labels = bytes(n, classes);
+		// A leading dimension past n checks that columns are addressed by `ld`
+		// and that the padding rows are left alone.
+		const std::size_t ld = n + 3;
+		for (auto isa : supported_levels()) {
+			std::vector<T> block(ld * classes, T(7));
+			Kernels::one_hot_u8(labels.data(), n, classes, block.data(), ld, isa);
+			for (std::size_t c = 0; c < classes; ++c) {
+				for (std::size_t i = 0; i < n; ++i)
+					CHECK(block[c * ld + i] == (labels[i] == c ? T(1) : T(0)));
+				for (std::size_t i = n; i < ld; ++i)
+					CHECK(block[c * ld + i] == T(7));
+			}
+		}
+	}
+}
+
+TEST_CASE("one_hot_u8 rejects labels outside the class range") {
+	const std::vector<std::uint8_t> labels{1, 2, 10};
+	std::vector<double> block(labels.size() * 10);
+	CHECK_THROWS_AS(Kernels::one_hot_u8(labels.data(), labels.size(), 10,
+																			block.data(), labels.size()),
+									std::invalid_argument);
+}
+
+TEST_CASE("IDX image parser agrees across levels") {
+	// 70 images of 3 x 5: a full 64-image tile and a partial one.
+	std::vector<unsigned char> raw{0, 0, 8, 3, 0, 0, 0, 70,
+																 0, 0, 0, 3, 0, 0, 0, 5};
+	const auto pixels = bytes(70 * 15, 256);
+	raw.insert(raw.end(), pixels.begin(), pixels.end());
+
+	MNIST::IdxImageParser<float> reference(Isa::Scalar);
+	reference.consume(raw);
+	const auto expected = reference.result();
+	for (auto isa : supported_levels()) {
+		MNIST::IdxImageParser<float> parser(isa);
+		parser.consume(raw);
+		CHECK(arma::approx_equal(*parser.result().data, *expected.data,
+														 "absdiff", 0.0F));
+	}
+}
@@ -0,0 +1,82 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+
+#include "batches.hpp"
+
+#include <cmath>
+
+using namespace ExGraf;
+using Testing::make_batch;
+
+TEST_CASE("graph size stays constant across training steps") {
+	Model<double> model(8, 16, 4, std::make_unique<SgdOptimizer<double>>(0.1));
+	auto [x, y] = make_batch(5, 8, 4);
+
+	std::size_t first_capacity = 0;
+	for (int step = 0; step < 10; ++step) {
+		auto output = model.forward(x);
+		model.compute_loss(output, y);
+		CHECK_EQ(model.expression_graph().size(), 5);
+		model.backward();
+		model.step();
+		model.zero_grad();
+		CHECK_EQ(model.expression_graph().size(), 0);
+		if (step == 0)
+			first_capacity = model.expression_graph().capacity();
+		CHECK_EQ(model.expression_graph().capacity(), first_capacity);
+	}
+}
+
+TEST_CASE("backward reaches the parameters and training lowers the loss") {
+	Model<double> model(8, 16, 4, std::make_unique<SgdOptimizer<double>>(0.5));
+	auto [x, y] = make_batch(12, 8, 4);
+
+	auto output = model.forward(x);
+	auto first_loss = model.compute_loss(output, y);
+	model.backward();
+	model.step();
+	model.zero_grad();
+
+	double last_loss = first_loss;
+	for (int step = 0; step < 50; ++step) {
+		auto out = model.forward(x);
+		last_loss = model.compute_loss(out, y);
+		model.backward();
+		model.step();
+		model.zero_grad();
+	}
+	CHECK_LT(last_loss, first_loss);
+}
+
+TEST_CASE("backward rejects tensors the graph did not record") {
+	ExpressionGraph<double> graph;
+	Tensor<double> outside(arma::Mat<double>(2, 2, arma::fill::ones));
+	CHECK_THROWS_AS(graph.backward(outside), std::invalid_argument);
+}
+
+TEST_CASE("row windows are read in place or gathered for the operation") {
+	arma::arma_rng::set_seed(5);
+	const Tensor<double> batch(arma::randn<arma::Mat<double>>(7, 3));
+	const Tensor<double> weights(arma::randn<arma::Mat<double>>(3, 2));
+	const auto window = Tensor<double>::rows_of(batch, 2, 4);
+	const arma::mat rows = batch.data->rows(2, 5);
+
+	ExpressionGraph<double> graph;
+	// MatMulOp reads the window through its strides; TanhOp cannot, so the
+	// graph hands it a copy of the rows.
+	const auto product =
+			graph.add_operation<Binary::MatMulOp<double>>({window, weights});
+	const auto squashed = graph.add_operation<Unary::TanhOp<double>>({window});
+	CHECK(arma::approx_equal(*product.data, rows * *weights.data, "absdiff",
+													 1e-12));
+	for (std::size_t i = 0; i < rows.n_elem; ++i)
+		CHECK(squashed[i] == doctest::Approx(std::tanh(rows(i))));
+	CHECK(batch.data->n_rows == 7);
+
+	const auto inner = Tensor<double>::rows_of(product, 0, 2);
+	CHECK_THROWS_AS(graph.add_operation<Unary::TanhOp<double>>({inner}),
+									std::invalid_argument);
+}
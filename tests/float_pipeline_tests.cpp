@@ -0,0 +1,68 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/data_parallel_trainer.hpp"
+#include "exgraf/loaders/data_loader.hpp"
+#include "exgraf/loaders/mnist_loader.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+// Images of 4 x 4 pixels whose brightest row encodes the label.
+auto idx_images(std::size_t count) -> std::vector<unsigned char> {
+	std::vector<unsigned char> out{0, 0, 8, 3, 0, 0, 0, 0,
+																 0, 0, 0, 4, 0, 0, 0, 4};
+	out[6] = static_cast<unsigned char>(count >> 8);
+	out[7] = static_cast<unsigned char>(count);
+	for (std::size_t i = 0; i < count; ++i)
+		for (std::size_t p = 0; p < 16; ++p)
+			out.push_back(p / 4 == i % 4 ? 200 : static_cast<unsigned char>(p * 3));
+	return out;
+}
+
+} // namespace
+
+TEST_CASE("float pipeline decodes and trains without double round-trips") {
+	constexpr std::size_t samples = 256;
+	const auto raw = idx_images(samples);
+	const arma::Mat<float> pixels = MNIST::parse_idx_images<float>(raw);
+	const arma::Mat<double> reference = MNIST::parse_idx_images<double>(raw);
+	REQUIRE(pixels.n_rows == samples);
+	for (std::size_t i = 0; i < pixels.n_elem; ++i)
+		CHECK(pixels(i) == static_cast<float>(reference(i)));
+
+	arma::Col<std::size_t> labels(samples);
+	for (std::size_t i = 0; i < samples; ++i)
+		labels(i) = i % 4;
+
+	arma::arma_rng::set_seed(5);
+	Model<float> model(16, 32, 4, std::make_unique<AdamOptimizer<float>>(0.01F));
+	DataParallelTrainer<float> trainer(model, 2);
+	DataLoader<float> loader(Tensor<float>(pixels),
+													 Model<float>::to_one_hot(labels, 4),
+													 {.batch_size = 32, .seed = 3});
+	float first = 0.0F, last = 0.0F;
+	for (int epoch = 0; epoch < 5; ++epoch) {
+		while (auto batch = loader.next()) {
+			last = trainer.step(batch->inputs, batch->targets);
+			if (first == 0.0F)
+				first = last;
+		}
+	}
+	CHECK(std::isfinite(last));
+	CHECK_LT(last, first * 0.5F);
+}
+
+TEST_CASE("float and double caches live in separate files") {
+	const auto url = "https://example.com/train-images-idx3-ubyte.gz";
+	const auto f32 = MNIST::cache_path<float>("cache", url);
+	const auto f64 = MNIST::cache_path<double>("cache", url);
+	CHECK(f32 != f64);
+	CHECK(f32.filename() == "train-images-idx3-ubyte.f32.exgraf");
+}
@@ -0,0 +1,148 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/expression_graph.hpp"
+#include "exgraf/fused_operation.hpp"
+
+#include "batches.hpp"
+
+using namespace ExGraf;
+
+namespace {
+
+constexpr double tolerance = 1e-9;
+
+auto random_tensor(std::size_t rows, std::size_t cols) -> Tensor<double> {
+	return Tensor<double>(
+			arma::Mat<double>(arma::randn<arma::Mat<double>>(rows, cols)));
+}
+
+auto close(const Tensor<double> &a, const Tensor<double> &b) -> bool {
+	return a.data->n_rows == b.data->n_rows && a.data->n_cols == b.data->n_cols &&
+				 arma::approx_equal(*a.data, *b.data, "absdiff", tolerance);
+}
+
+// relu(x W + b) -> softmax -> cross entropy, recorded on `graph`. Returns the
+// loss and the hidden activation.
+auto record_step(ExpressionGraph<double> &graph, const Tensor<double> &x,
+								 Tensor<double> &w1, Tensor<double> &b1, Tensor<double> &w2,
+								 const Tensor<double> &y)
+		-> std::pair<Tensor<double>, Tensor<double>> {
+	auto z1 = graph.add_operation<Binary::MatMulOp<double>>({x, w1});
+	auto a1 = graph.add_operation<Binary::AddBiasOp<double>>({z1, b1});
+	auto h = graph.add_operation<Unary::ReLUOp<double>>({a1});
+	auto z2 = graph.add_operation<Binary::MatMulOp<double>>({h, w2});
+	auto p = graph.add_operation<Unary::SoftmaxOp<double>>({z2});
+	return {graph.add_operation<Binary::CrossEntropyLoss<double>>({p, y}), h};
+}
+
+} // namespace
+
+TEST_CASE("LinearReLUOp matches MatMul, AddBias and ReLU") {
+	auto x = random_tensor(6, 5);
+	auto w = random_tensor(5, 4);
+	auto b = random_tensor(1, 4);
+	auto g = random_tensor(6, 4);
+
+	Binary::MatMulOp<double> matmul;
+	Binary::AddBiasOp<double> add_bias;
+	Unary::ReLUOp<double> relu;
+	auto z = matmul.forward({x, w});
+	auto a = add_bias.forward({z, b});
+	auto expected = relu.forward({a});
+
+	Fused::LinearReLUOp<double> fused;
+	CHECK(close(fused.forward({x, w, b}), expected));
+
+	std::vector<Tensor<double>> relu_grad(1), bias_grad(2), matmul_grad(2);
+	relu.backward(g, relu_grad);
+	add_bias.backward(relu_grad[0], bias_grad);
+	matmul.backward(bias_grad[0], matmul_grad);
+
+	std::vector<Tensor<double>> fused_grad(3);
+	fused.backward(g, fused_grad);
+	CHECK(close(fused_grad[0], matmul_grad[0]));
+	CHECK(close(fused_grad[1], matmul_grad[1]));
+	CHECK(close(fused_grad[2], bias_grad[1]));
+}
+
+TEST_CASE("SoftmaxCrossEntropyOp matches Softmax and CrossEntropyLoss") {
+	auto z = random_tensor(8, 5);
+	auto y = Tensor<double>(Testing::one_hot(8, 5, 7));
+	Tensor<double> seed(arma::Mat<double>(1, 1, arma::fill::ones));
+
+	Unary::SoftmaxOp<double> softmax;
+	Binary::CrossEntropyLoss<double> ce;
+	auto p = softmax.forward({z});
+	auto loss = ce.forward({p, y});
+	std::vector<Tensor<double>> ce_grad(2), softmax_grad(1);
+	ce.backward(seed, ce_grad);
+	softmax.backward(ce_grad[0], softmax_grad);
+
+	Fused::SoftmaxCrossEntropyOp<double> fused;
+	CHECK(close(fused.forward({z, y, p}), loss));
+	std::vector<Tensor<double>> fused_grad(3);
+	fused.backward(seed, fused_grad);
+	CHECK(close(fused_grad[0], softmax_grad[0]));
+	CHECK_FALSE(fused_grad[1].data);
+}
+
+TEST_CASE("fusion pass rewrites the captured tape without changing results") {
+	auto x = random_tensor(10, 6);
+	auto y = Tensor<double>(Testing::one_hot(10, 3, 7));
+	auto w1 = random_tensor(6, 8);
+	auto b1 = random_tensor(1, 8);
+	auto w2 = random_tensor(8, 3);
+	for (auto *p : {&w1, &b1, &w2})
+		p->zero_grad();
+
+	ExpressionGraph<double> graph;
+	graph.set_fusion_patterns(Fused::default_patterns<double>());
+
+	auto run = [&] {
+		for (auto *p : {&w1, &b1, &w2})
+			p->zero_grad();
+		auto [loss, hidden] = record_step(graph, x, w1, b1, w2, y);
+		graph.backward(loss);
+		auto result = std::tuple{Tensor<double>(*loss.data),
+														 Tensor<double>(*hidden.data),
+														 Tensor<double>(*w1.grad->data),
+														 Tensor<double>(*b1.grad->data),
+														 Tensor<double>(*w2.grad->data)};
+		graph.reset();
+		return result;
+	};
+
+	auto unfused = run();
+	CHECK_EQ(graph.fused_groups(), 2);
+	auto fused = run();
+	CHECK_EQ(graph.fused_groups(), 2);
+	CHECK(close(std::get<0>(fused), std::get<0>(unfused)));
+	CHECK(close(std::get<1>(fused), std::get<1>(unfused)));
+	CHECK(close(std::get<2>(fused), std::get<2>(unfused)));
+	CHECK(close(std::get<3>(fused), std::get<3>(unfused)));
+	CHECK(close(std::get<4>(fused), std::get<4>(unfused)));
+}
+
+TEST_CASE("fusion pass falls back when a step diverges from its groups") {
+	auto x = random_tensor(4, 3);
+	auto w = random_tensor(3, 5);
+	w.zero_grad();
+
+	ExpressionGraph<double> graph;
+	graph.set_fusion_patterns(Fused::default_patterns<double>());
+	auto z = graph.add_operation<Binary::MatMulOp<double>>({x, w});
+	graph.add_operation<Unary::ReLUOp<double>>({z});
+	graph.reset();
+	REQUIRE_EQ(graph.fused_groups(), 1);
+
+	// Same head, different consumer: the deferred product must be computed.
+	auto product = graph.add_operation<Binary::MatMulOp<double>>({x, w});
+	auto p = graph.add_operation<Unary::SoftmaxOp<double>>({product});
+	CHECK_EQ(graph.fused_groups(), 0);
+	arma::Mat<double> expected = *x.data * *w.data;
+	CHECK(arma::approx_equal(*product.data, expected, "absdiff", tolerance));
+	CHECK(arma::approx_equal(arma::sum(*p.data, 1),
+													 arma::Mat<double>(4, 1, arma::fill::ones), "absdiff",
+													 tolerance));
+}
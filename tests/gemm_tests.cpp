@@ -0,0 +1,203 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/binary_operation.hpp"
+#include "exgraf/gemm.hpp"
+#include "exgraf/gemm_kernels.hpp"
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+template <AllowedTypes T> constexpr T tolerance = T(1e-3);
+template <> constexpr double tolerance<double> = 1e-10;
+
+// Forwards to Armadillo and records the transpose flags of every call.
+template <AllowedTypes T> class RecordingGemm : public ArmadilloGemm<T> {
+public:
+	std::vector<std::pair<bool, bool>> calls;
+
+protected:
+	auto run(const Kernels::GemmArgs<T> &g, const arma::Mat<T> &a,
+					 const arma::Mat<T> &b, arma::Mat<T> &c) -> void override {
+		calls.emplace_back(g.trans_a, g.trans_b);
+		ArmadilloGemm<T>::run(g, a, b, c);
+	}
+};
+
+} // namespace
+
+TEST_CASE_TEMPLATE("the blocked kernel matches Armadillo on every level", T,
+									 float, double) {
+	arma::arma_rng::set_seed(7);
+	// Edge tiles, several depth blocks, several row blocks and a second
+	// column slab.
+	const std::array<std::tuple<std::size_t, std::size_t, std::size_t>, 4>
+			shapes{{{1, 1, 1}, {37, 29, 301}, {150, 13, 7}, {3, 3100, 2}}};
+	const std::array<std::pair<T, T>, 3> scalars{
+			{{T(1), T(0)}, {T(0.5), T(1)}, {T(-2), T(0.25)}}};
+	for (auto isa : {Isa::Scalar, Isa::AVX2}) {
+		if (!isa_supported(isa))
+			continue;
+		for (auto [m, n, k] : shapes)
+			for (bool ta : {false, true})
+				for (bool tb : {false, true})
+					for (auto [alpha, beta] : scalars) {
+						const arma::Mat<T> a = arma::randn<arma::Mat<T>>(ta ? k : m,
+																														ta ? m : k);
+						const arma::Mat<T> b = arma::randn<arma::Mat<T>>(tb ? n : k,
+																														tb ? k : n);
+						const arma::Mat<T> before = arma::randn<arma::Mat<T>>(m, n);
+						const arma::Mat<T> op_a = ta ? arma::Mat<T>(a.t()) : a;
+						const arma::Mat<T> op_b = tb ? arma::Mat<T>(b.t()) : b;
+						arma::Mat<T> expected = alpha * (op_a * op_b);
+						if (beta != T(0))
+							expected += beta * before;
+
+						// With beta zero the output must not be read at all.
+						arma::Mat<T> c = before;
+						if (beta == T(0))
+							c.fill(std::numeric_limits<T>::quiet_NaN());
+						Kernels::gemm_blocked<T>({.trans_a = ta,
+																			.trans_b = tb,
+																			.m = m,
+																			.n = n,
+																			.k = k,
+																			.alpha = alpha,
+																			.a = a.memptr(),
+																			.lda = a.n_rows,
+																			.b = b.memptr(),
+																			.ldb = b.n_rows,
+																			.beta = beta,
+																			.c = c.memptr(),
+																			.ldc = c.n_rows},
+																		 isa);
+						CHECK(arma::approx_equal(c, expected, "absdiff",
+																		 tolerance<T> * T(k)));
+					}
+	}
+}
+
+TEST_CASE("a threaded blocked product equals the serial one") {
+	arma::arma_rng::set_seed(8);
+	BlockedGemm<double> serial(1), threaded(4);
+	// Wide products split by columns, tall ones by rows.
+	for (auto [m, n, k] : {std::tuple{96, 300, 200}, std::tuple{301, 67, 250}}) {
+		const arma::mat a = arma::randn<arma::mat>(k, m);
+		const arma::mat b = arma::randn<arma::mat>(k, n);
+		REQUIRE(2 * m * n * k >= BlockedGemm<double>::parallel_flops);
+		arma::mat one, many;
+		serial.gemm(a, Transpose::Yes, b, Transpose::No, one);
+		threaded.gemm(a, Transpose::Yes, b, Transpose::No, many);
+		// Every element sums its depth in the same order either way.
+		CHECK(arma::approx_equal(one, many, "absdiff", 0.0));
+
+		serial.gemm(a, Transpose::Yes, b, Transpose::No, one, 1.0, 1.0);
+		threaded.gemm(a, Transpose::Yes, b, Transpose::No, many, 1.0, 1.0);
+		CHECK(arma::approx_equal(one, many, "absdiff", 0.0));
+	}
+}
+
+TEST_CASE("the backend checks shapes and aliasing") {
+	BlockedGemm<double> backend(1);
+	const arma::mat a(3, 4, arma::fill::ones), b(5, 4, arma::fill::ones);
+	arma::mat c;
+	CHECK_THROWS_AS(backend.gemm(a, Transpose::No, b, Transpose::No, c),
+									std::invalid_argument);
+	backend.gemm(a, Transpose::No, b, Transpose::Yes, c);
+	CHECK(c.n_rows == 3);
+	CHECK(c.n_cols == 5);
+	CHECK(c(2, 4) == doctest::Approx(4.0));
+
+	arma::mat wrong(2, 2, arma::fill::zeros);
+	CHECK_THROWS_AS(
+			backend.gemm(a, Transpose::No, b, Transpose::Yes, wrong, 1.0, 1.0),
+			std::invalid_argument);
+	arma::mat square(4, 4, arma::fill::ones);
+	CHECK_THROWS_AS(backend.gemm(square, Transpose::No, square, Transpose::No,
+															 square),
+									std::invalid_argument);
+}
+
+TEST_CASE_TEMPLATE("strided operands are read and written in place", T, float,
+									 double) {
+	arma::arma_rng::set_seed(10);
+	// A is rows [2, 7) of a 9-row matrix, B^T rows [1, 4) of a 6-row one and
+	// C rows [3, 8) of an 11-row one.
+	const arma::Mat<T> a_parent = arma::randn<arma::Mat<T>>(9, 4);
+	const arma::Mat<T> b_parent = arma::randn<arma::Mat<T>>(6, 4);
+	const arma::Mat<T> c_parent = arma::randn<arma::Mat<T>>(11, 3);
+	const arma::Mat<T> a = a_parent.rows(2, 6), b = b_parent.rows(1, 3);
+	const arma::Mat<T> expected =
+			T(2) * (a * b.t()) + T(0.5) * arma::Mat<T>(c_parent.rows(3, 7));
+	const std::vector<std::shared_ptr<GemmBackend<T>>> backends{
+			std::make_shared<ArmadilloGemm<T>>(),
+			std::make_shared<BlockedGemm<T>>(1)};
+	for (const auto &backend : backends) {
+		arma::Mat<T> c = c_parent;
+		backend->gemm({.trans_a = false,
+									 .trans_b = true,
+									 .m = 5,
+									 .n = 3,
+									 .k = 4,
+									 .alpha = T(2),
+									 .a = a_parent.memptr() + 2,
+									 .lda = a_parent.n_rows,
+									 .b = b_parent.memptr() + 1,
+									 .ldb = b_parent.n_rows,
+									 .beta = T(0.5),
+									 .c = c.memptr() + 3,
+									 .ldc = c.n_rows});
+		CHECK(arma::approx_equal(arma::Mat<T>(c.rows(3, 7)), expected, "absdiff",
+														 tolerance<T> * T(4)));
+		// Rows outside the window are left alone.
+		CHECK(arma::approx_equal(arma::Mat<T>(c.rows(0, 2)),
+														 arma::Mat<T>(c_parent.rows(0, 2)), "absdiff",
+														 T(0)));
+		CHECK(arma::approx_equal(arma::Mat<T>(c.rows(8, 10)),
+														 arma::Mat<T>(c_parent.rows(8, 10)), "absdiff",
+														 T(0)));
+		CHECK_THROWS_AS(backend->gemm({.m = 5,
+																	 .n = 3,
+																	 .k = 4,
+																	 .a = a_parent.memptr(),
+																	 .lda = 4,
+																	 .b = b_parent.memptr(),
+																	 .ldb = 6,
+																	 .c = c.memptr(),
+																	 .ldc = 11}),
+										std::invalid_argument);
+	}
+}
+
+TEST_CASE("MatMulOp runs on the selected backend without transposing") {
+	arma::arma_rng::set_seed(9);
+	auto recording = std::make_shared<RecordingGemm<double>>();
+	set_gemm_backend<double>(recording);
+	CHECK(gemm_backend<double>().name() == "armadillo");
+
+	const Tensor<double> a(arma::mat(arma::randn<arma::mat>(6, 4)));
+	const Tensor<double> b(arma::mat(arma::randn<arma::mat>(4, 3)));
+	const Tensor<double> grad(arma::mat(arma::randn<arma::mat>(6, 3)));
+	Binary::MatMulOp<double> op;
+	const auto out = op.forward({a, b});
+	std::vector<Tensor<double>> grads(2);
+	op.backward(grad, grads);
+	set_gemm_backend<double>(nullptr);
+
+	const std::vector<std::pair<bool, bool>> expected{
+			{false, false}, {false, true}, {true, false}};
+	CHECK(recording->calls == expected);
+	const auto &da = *grads[0].data, &db = *grads[1].data;
+	CHECK(arma::approx_equal(*out.data, *a.data * *b.data, "absdiff", 1e-12));
+	CHECK(arma::approx_equal(da, *grad.data * b.data->t(), "absdiff", 1e-12));
+	CHECK(arma::approx_equal(db, a.data->t() * *grad.data, "absdiff", 1e-12));
+	CHECK(&gemm_backend<double>() != recording.get());
+}
@@ -0,0 +1,156 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/half.hpp"
+#include "exgraf/loaders/data_loader.hpp"
+
+#include "batches.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+auto same_bits(float a, float b) -> bool {
+	if (std::isnan(a) || std::isnan(b))
+		return std::isnan(a) && std::isnan(b);
+	return std::bit_cast<std::uint32_t>(a) == std::bit_cast<std::uint32_t>(b);
+}
+
+// Specials, both rounding directions at each format's precision, halfway
+// cases, and values around the FP16 normal, subnormal and overflow limits.
+auto probe_values() -> std::vector<float> {
+	std::vector<float> values{0.0F,
+														-0.0F,
+														1.0F,
+														-2.5F,
+														1.0F / 3.0F,
+														65504.0F,
+														65519.0F,
+														65520.0F,
+														1e6F,
+														6.1035156e-05F,
+														5.9604645e-08F,
+														2.9802322e-08F,
+														1e-9F,
+														std::numeric_limits<float>::infinity(),
+														-std::numeric_limits<float>::infinity(),
+														std::numeric_limits<float>::quiet_NaN(),
+														-std::numeric_limits<float>::quiet_NaN(),
+														std::bit_cast<float>(0xffc12345U),
+														std::bit_cast<float>(0x7f800001U),
+														std::numeric_limits<float>::max(),
+														std::numeric_limits<float>::denorm_min()};
+	for (std::uint32_t bits = 0x3f800000U; bits < 0x3f800000U + 0x40000U;
+			 bits += 0x1001U)
+		values.push_back(std::bit_cast<float>(bits));
+	return values;
+}
+
+} // namespace
+
+TEST_CASE("bfloat16 rounds to nearest even") {
+	CHECK(to_bfloat16(1.0F).bits == 0x3f80);
+	// 1 + 2^-8 lies halfway between two bf16 values; the even one wins.
+	CHECK(to_bfloat16(std::bit_cast<float>(0x3f808000U)).bits == 0x3f80);
+	CHECK(to_bfloat16(std::bit_cast<float>(0x3f818000U)).bits == 0x3f82);
+	CHECK(to_bfloat16(std::bit_cast<float>(0x3f808001U)).bits == 0x3f81);
+	CHECK(std::isnan(to_float(to_bfloat16(std::nanf("")))));
+	// A negative NaN keeps its sign; a signaling one is quieted.
+	CHECK(to_bfloat16(std::bit_cast<float>(0xffc00000U)).bits == 0xffc0);
+	CHECK(to_bfloat16(std::bit_cast<float>(0x7f800001U)).bits == 0x7fc0);
+	CHECK(to_float(to_bfloat16(-3.0F)) == -3.0F);
+}
+
+TEST_CASE("half conversion handles subnormals, overflow and NaN") {
+	CHECK(to_half(1.0F).bits == 0x3c00);
+	CHECK(to_half(65504.0F).bits == 0x7bff);
+	CHECK(to_half(65520.0F).bits == 0x7c00);
+	CHECK(to_half(-1e9F).bits == 0xfc00);
+	CHECK(to_half(5.9604645e-08F).bits == 0x0001);
+	CHECK(to_half(2.9802322e-08F).bits == 0x0000);
+	CHECK(to_float(Half{0x0001}) == 5.9604645e-08F);
+	CHECK(to_float(Half{0x7c00}) == std::numeric_limits<float>::infinity());
+	CHECK(std::isnan(to_float(Half{0x7e00})));
+	// Every finite half survives the round trip exactly.
+	for (std::uint32_t bits = 0; bits < 0x10000U; ++bits) {
+		const Half h{static_cast<std::uint16_t>(bits)};
+		if ((bits & 0x7c00U) != 0x7c00U)
+			CHECK(to_half(to_float(h)).bits == h.bits);
+	}
+}
+
+TEST_CASE("vector conversion kernels match the scalar definitions") {
+	const auto values = probe_values();
+	for (auto format : {Storage::BF16, Storage::FP16}) {
+		std::vector<std::uint16_t> expected(values.size());
+		Kernels::pack(values.data(), values.size(), expected.data(), format,
+									Isa::Scalar);
+		std::vector<float> widened(values.size());
+		Kernels::unpack(expected.data(), expected.size(), widened.data(), format,
+										Isa::Scalar);
+		if (!isa_supported(Isa::AVX2))
+			continue;
+		std::vector<std::uint16_t> packed(values.size());
+		Kernels::pack(values.data(), values.size(), packed.data(), format,
+									Isa::AVX2);
+		// NaNs too: the bits must not depend on the ISA or on whether an
+		// element lands in the vector body or the scalar tail.
+		for (std::size_t i = 0; i < values.size(); ++i)
+			CHECK(packed[i] == expected[i]);
+		std::vector<float> back(values.size());
+		Kernels::unpack(expected.data(), expected.size(), back.data(), format,
+										Isa::AVX2);
+		for (std::size_t i = 0; i < values.size(); ++i)
+			CHECK(same_bits(back[i], widened[i]));
+	}
+}
+
+TEST_CASE("packed matrix keeps half the bytes and round-trips") {
+	arma::Mat<double> m(7, 5);
+	for (std::size_t i = 0; i < m.n_elem; ++i)
+		m[i] = double(i) / 8.0;
+	PackedMatrix<double> packed;
+	packed.store(m, Storage::FP16);
+	CHECK(packed.bytes() == m.n_elem * 2);
+	arma::Mat<double> back;
+	packed.load(back);
+	REQUIRE(back.n_rows == 7);
+	REQUIRE(back.n_cols == 5);
+	for (std::size_t i = 0; i < m.n_elem; ++i)
+		CHECK(back[i] == m[i]);
+	CHECK_THROWS_AS(packed.store(m, Storage::FP32), std::invalid_argument);
+}
+
+TEST_CASE("data loader serves batches from 16-bit storage") {
+	// Sample indices up to 256 are exact in both formats.
+	constexpr std::size_t samples = 200;
+	arma::Mat<float> x(samples, 9);
+	for (std::size_t i = 0; i < samples; ++i)
+		for (std::size_t c = 0; c < x.n_cols; ++c)
+			x(i, c) = float(i);
+	const arma::Mat<float> y = Testing::one_hot<float>(samples, 3);
+	for (auto format : {Storage::BF16, Storage::FP16}) {
+		DataLoader<float> loader(Tensor<float>(x), Tensor<float>(y),
+														 {.batch_size = 32, .seed = 9, .storage = format});
+		std::set<std::size_t> seen;
+		while (auto batch = loader.next()) {
+			auto &bx = *batch->inputs.data;
+			auto &by = *batch->targets.data;
+			for (std::size_t i = 0; i < bx.n_rows; ++i) {
+				const auto sample = static_cast<std::size_t>(bx(i, 0));
+				CHECK(bx(i, bx.n_cols - 1) == float(sample));
+				CHECK(by(i, sample % 3) == 1.0F);
+				seen.insert(sample);
+			}
+		}
+		CHECK(seen.size() == samples);
+	}
+}
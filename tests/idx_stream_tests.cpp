@@ -0,0 +1,136 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/loaders/idx_stream.hpp"
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+using namespace ExGraf;
+using namespace ExGraf::MNIST;
+
+namespace {
+
+auto put_be32(std::vector<unsigned char> &out, std::uint32_t v) -> void {
+	for (int shift = 24; shift >= 0; shift -= 8)
+		out.push_back(static_cast<unsigned char>(v >> shift));
+}
+
+auto idx_images(std::uint32_t count, std::uint32_t rows, std::uint32_t cols)
+		-> std::vector<unsigned char> {
+	std::vector<unsigned char> out;
+	put_be32(out, 2051);
+	put_be32(out, count);
+	put_be32(out, rows);
+	put_be32(out, cols);
+	for (std::uint32_t i = 0; i < count * rows * cols; ++i)
+		out.push_back(static_cast<unsigned char>((i * 37 + i / 7) & 0xff));
+	return out;
+}
+
+auto idx_labels(std::uint32_t count) -> std::vector<unsigned char> {
+	std::vector<unsigned char> out;
+	put_be32(out, 2049);
+	put_be32(out, count);
+	for (std::uint32_t i = 0; i < count; ++i)
+		out.push_back(static_cast<unsigned char>((i * 3) % 10));
+	return out;
+}
+
+auto gzip(const std::vector<unsigned char> &raw) -> std::vector<unsigned char> {
+	z_stream strm{};
+	deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+							 Z_DEFAULT_STRATEGY);
+	std::vector<unsigned char> out(deflateBound(&strm, raw.size()));
+	strm.next_in = const_cast<Bytef *>(raw.data());
+	strm.avail_in = static_cast<uInt>(raw.size());
+	strm.next_out = out.data();
+	strm.avail_out = static_cast<uInt>(out.size());
+	deflate(&strm, Z_FINISH);
+	out.resize(strm.total_out);
+	deflateEnd(&strm);
+	return out;
+}
+
+/// Feeds `compressed` in odd-sized pieces, the way a download arrives.
+template <typename Parser>
+auto stream(const std::vector<unsigned char> &compressed, Parser &parser)
+		-> void {
+	GzipInflater inflater;
+	std::size_t offset = 0;
+	for (std::size_t piece = 1; offset < compressed.size(); piece += 97) {
+		const auto n = std::min(piece % 4099, compressed.size() - offset);
+		inflater.feed(std::span(compressed).subspan(offset, n),
+									[&](std::span<const unsigned char> chunk) {
+										parser.consume(chunk);
+									});
+		offset += n;
+	}
+	CHECK(inflater.done());
+}
+
+} // namespace
+
+TEST_CASE("streamed IDX images match a whole-buffer decode") {
+	// 150 images is more than two tiles and leaves a partial one.
+	const auto raw = idx_images(150, 5, 7);
+	IdxImageParser<double> parser;
+	stream(gzip(raw), parser);
+	REQUIRE(parser.complete());
+
+	const auto images = parser.result();
+	REQUIRE(images.data->n_rows == 150);
+	REQUIRE(images.data->n_cols == 35);
+	for (std::size_t i = 0; i < 150; ++i)
+		for (std::size_t p = 0; p < 35; ++p)
+			CHECK((*images.data)(i, p) ==
+						doctest::Approx(raw[16 + i * 35 + p] / 255.0));
+}
+
+TEST_CASE("streamed IDX labels become one-hot rows") {
+	IdxLabelParser<float> parser;
+	stream(gzip(idx_labels(1000)), parser);
+	const auto labels = parser.result();
+	REQUIRE(labels.data->n_rows == 1000);
+	REQUIRE(labels.data->n_cols == 10);
+	for (std::size_t i = 0; i < 1000; ++i) {
+		float sum = 0.0F;
+		for (std::size_t c = 0; c < 10; ++c)
+			sum += (*labels.data)(i, c);
+		CHECK(sum == 1.0F);
+		CHECK((*labels.data)(i, (i * 3) % 10) == 1.0F);
+	}
+}
+
+TEST_CASE("IDX stream parsers reject bad input") {
+	const auto valid = idx_images(4, 2, 2);
+	SUBCASE("wrong magic") {
+		auto raw = valid;
+		raw[3] = 0x01;
+		IdxImageParser<double> parser;
+		CHECK_THROWS_AS(parser.consume(raw), std::runtime_error);
+	}
+	SUBCASE("truncated") {
+		auto raw = valid;
+		raw.pop_back();
+		IdxImageParser<double> parser;
+		parser.consume(raw);
+		CHECK_FALSE(parser.complete());
+		CHECK_THROWS_AS(parser.result(), std::runtime_error);
+	}
+	SUBCASE("trailing bytes") {
+		auto raw = valid;
+		raw.push_back(0);
+		IdxImageParser<double> parser;
+		CHECK_THROWS_AS(parser.consume(raw), std::runtime_error);
+	}
+	SUBCASE("label out of range") {
+		auto labels = idx_labels(3);
+		labels.back() = 10;
+		IdxLabelParser<double> parser;
+		CHECK_THROWS_AS(parser.consume(labels), std::runtime_error);
+	}
+}
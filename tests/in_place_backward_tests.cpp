@@ -0,0 +1,151 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/binary_operation.hpp"
+#include "exgraf/expression_graph.hpp"
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/unary_operation.hpp"
+
+#include "batches.hpp"
+
+#include <taskflow/taskflow.hpp>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+// The same operation with in-place accumulation switched off, so the graph
+// takes the allocate-then-add path.
+template <typename Op> class OutOfPlace : public Op {
+public:
+	auto accumulates_in_place() const -> bool override { return false; }
+	auto separable() const -> bool override { return false; }
+};
+
+template <typename Op, bool Legacy>
+using Pick = std::conditional_t<Legacy, OutOfPlace<Op>, Op>;
+
+struct Parameters {
+	Tensor<double> w1{arma::mat(arma::randn<arma::mat>(4, 5))};
+	Tensor<double> b{arma::mat(arma::randn<arma::mat>(1, 5))};
+	Tensor<double> w2{arma::mat(arma::randn<arma::mat>(5, 3))};
+};
+
+// Every gradient gets more than one contribution: hb feeds ReLU and Tanh,
+// a feeds an add and a product, and W2 is used twice.
+template <bool Legacy>
+auto backward_step(ExpressionGraph<double> &graph, Parameters &p,
+									 const Tensor<double> &x, const Tensor<double> &y) -> void {
+	using MatMul = Pick<Binary::MatMulOp<double>, Legacy>;
+	using Add = Pick<Binary::AddOp<double>, Legacy>;
+	for (auto *t : {&p.w1, &p.b, &p.w2})
+		t->zero_grad();
+	auto h = graph.add_operation<MatMul>({x, p.w1});
+	auto hb = graph.add_operation<Pick<Binary::AddBiasOp<double>, Legacy>>(
+			{h, p.b});
+	auto a = graph.add_operation<Pick<Unary::ReLUOp<double>, Legacy>>({hb});
+	auto t = graph.add_operation<Pick<Unary::TanhOp<double>, Legacy>>({hb});
+	auto s = graph.add_operation<Add>({a, t});
+	auto z1 = graph.add_operation<MatMul>({s, p.w2});
+	auto z2 = graph.add_operation<MatMul>({a, p.w2});
+	auto z = graph.add_operation<Add>({z1, z2});
+	auto q = graph.add_operation<Pick<Unary::SoftmaxOp<double>, Legacy>>({z});
+	auto loss =
+			graph.add_operation<Pick<Binary::CrossEntropyLoss<double>, Legacy>>(
+					{q, y});
+	graph.backward(loss);
+	graph.reset();
+}
+
+auto same_gradients(const Parameters &a, const Parameters &b) -> bool {
+	for (auto [x, y] : {std::pair{&a.w1, &b.w1}, std::pair{&a.b, &b.b},
+											std::pair{&a.w2, &b.w2}})
+		if (!arma::approx_equal(*x->grad->data, *y->grad->data, "absdiff", 1e-12))
+			return false;
+	return true;
+}
+
+} // namespace
+
+TEST_CASE("in-place accumulation matches allocating gradients and adding") {
+	arma::arma_rng::set_seed(41);
+	// Copies share the values but get gradients of their own.
+	Parameters legacy;
+	Parameters in_place = legacy;
+	Parameters parallel = legacy;
+	const Tensor<double> x(arma::mat(arma::randn<arma::mat>(6, 4)));
+	const Tensor<double> y(Testing::one_hot(6, 3));
+
+	ExpressionGraph<double> reference, serial, threaded;
+	tf::Executor executor(4);
+	threaded.set_executor(&executor);
+	for (int step = 0; step < 3; ++step) {
+		backward_step<true>(reference, legacy, x, y);
+		backward_step<false>(serial, in_place, x, y);
+		backward_step<false>(threaded, parallel, x, y);
+		CHECK(same_gradients(legacy, in_place));
+		CHECK(same_gradients(legacy, parallel));
+	}
+	CHECK(arma::accu(arma::abs(*legacy.w2.grad->data)) > 0.0);
+	// No per-input gradient buffers: the plan needs less memory.
+	CHECK(serial.memory_planner().unshared_bytes() <
+				reference.memory_planner().unshared_bytes());
+}
+
+TEST_CASE("a lazy zero_grad is overwritten by backward, not swept") {
+	Tensor<double> w(arma::mat(2, 2, arma::fill::ones));
+	w.zero_grad();
+	w.grad->data->fill(5.0);
+	w.zero_grad(true);
+	CHECK(w.grad->cleared);
+	CHECK((*w.grad->data)(0, 0) == 5.0);
+	w.settle_grad();
+	CHECK_FALSE(w.grad->cleared);
+	CHECK(arma::accu(arma::abs(*w.grad->data)) == 0.0);
+
+	// Gradients left as garbage from a previous step never leak into the
+	// next: backward writes over them.
+	arma::arma_rng::set_seed(42);
+	Sequential<double> net(4, std::make_unique<SgdOptimizer<double>>(0.1),
+												 Linear<double>(5), ReLU<double>(), Linear<double>(3),
+												 Softmax<double>());
+	const Tensor<double> x(arma::mat(arma::randn<arma::mat>(6, 4)));
+	const Tensor<double> y(Testing::one_hot(6, 3));
+
+	net.zero_grad();
+	net.compute_loss(net.forward(x), y);
+	net.backward();
+	std::vector<arma::mat> expected;
+	for (auto &p : net.params())
+		expected.push_back(*p.get().grad->data);
+	net.reset_graph();
+
+	for (auto &p : net.params())
+		p.get().grad->data->fill(std::numeric_limits<double>::quiet_NaN());
+	net.zero_grad();
+	net.compute_loss(net.forward(x), y);
+	net.backward();
+	for (std::size_t k = 0; k < expected.size(); ++k) {
+		CHECK_FALSE(net.params()[k].get().grad->cleared);
+		CHECK(arma::approx_equal(*net.params()[k].get().grad->data, expected[k],
+														 "absdiff", 1e-12));
+	}
+
+	// A second backward without clearing still accumulates.
+	net.reset_graph();
+	net.compute_loss(net.forward(x), y);
+	net.backward();
+	CHECK(arma::approx_equal(*net.params()[0].get().grad->data,
+													 2.0 * expected[0], "absdiff", 1e-12));
+	net.reset_graph();
+}
@@ -0,0 +1,104 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/serving/inference_server.hpp"
+#include "exgraf/serving/mpsc_queue.hpp"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+TEST_CASE("MPSC queue keeps every producer's order") {
+	constexpr int producers = 4, per_producer = 2000;
+	MpscQueue<int> queue;
+	{
+		std::vector<std::jthread> threads;
+		for (int p = 0; p < producers; ++p)
+			threads.emplace_back([&, p] {
+				for (int i = 0; i < per_producer; ++i)
+					queue.push(p * per_producer + i);
+			});
+	}
+	std::vector<int> last(producers, -1);
+	int popped = 0;
+	while (auto value = queue.pop()) {
+		const auto p = *value / per_producer;
+		CHECK(*value % per_producer == last[p] + 1);
+		last[p] = *value % per_producer;
+		++popped;
+	}
+	CHECK(popped == producers * per_producer);
+}
+
+TEST_CASE("the server coalesces concurrent requests into batches") {
+	arma::arma_rng::set_seed(61);
+	Sequential<double> model(6, std::make_unique<AdamOptimizer<double>>(),
+													 Linear<double>(8), ReLU<double>(),
+													 Linear<double>(3), Softmax<double>());
+	constexpr std::size_t clients = 4, per_client = 16;
+	const arma::Mat<double> samples =
+			arma::randn<arma::Mat<double>>(clients * per_client, 6);
+	const auto expected = *model.predict(Tensor<double>(samples)).data;
+
+	InferenceServerStats stats;
+	{
+		InferenceServer<double> server(
+				model, {.max_batch = 16,
+								.max_latency = std::chrono::milliseconds(5),
+								.workers = 2});
+		std::vector<std::future<arma::Mat<double>>> results(samples.n_rows);
+		{
+			std::vector<std::jthread> threads;
+			for (std::size_t c = 0; c < clients; ++c)
+				threads.emplace_back([&, c] {
+					for (std::size_t i = 0; i < per_client; ++i) {
+						const auto row = c * per_client + i;
+						results[row] = server.submit(samples.rows(row, row));
+					}
+				});
+		}
+		for (std::size_t row = 0; row < samples.n_rows; ++row) {
+			const auto out = results[row].get();
+			REQUIRE(out.n_rows == 1);
+			CHECK(arma::approx_equal(out, expected.rows(row, row), "absdiff",
+															 1e-12));
+		}
+		stats = server.stats();
+
+		// A multi-row request comes back whole.
+		const auto pair = server.submit(samples.rows(0, 1)).get();
+		CHECK(arma::approx_equal(pair, expected.rows(0, 1), "absdiff", 1e-12));
+		CHECK_THROWS_AS(server.submit(arma::Mat<double>(1, 5)),
+										std::invalid_argument);
+	}
+	CHECK(stats.requests == clients * per_client);
+	CHECK(stats.rows == clients * per_client);
+	CHECK(stats.batches < stats.requests);
+}
+
+TEST_CASE("shutting down completes requests still queued") {
+	arma::arma_rng::set_seed(62);
+	Sequential<double> model(4, std::make_unique<AdamOptimizer<double>>(),
+													 Linear<double>(2), Softmax<double>());
+	std::vector<std::future<arma::Mat<double>>> results;
+	{
+		InferenceServer<double> server(
+				model, {.max_batch = 64, .max_latency = std::chrono::seconds(10)});
+		for (int i = 0; i < 8; ++i)
+			results.push_back(
+					server.submit(arma::randn<arma::Mat<double>>(1, 4)));
+	}
+	for (auto &result : results) {
+		REQUIRE(result.wait_for(std::chrono::seconds(0)) ==
+						std::future_status::ready);
+		CHECK(arma::accu(result.get()) == doctest::Approx(1.0));
+	}
+}
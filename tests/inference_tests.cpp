@@ -0,0 +1,94 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "allocation_counter.hpp"
+#include "exgraf/inference_mode.hpp"
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <memory>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+auto make_mlp() -> Sequential<double> {
+	arma::arma_rng::set_seed(51);
+	return Sequential<double>(
+			12, std::make_unique<AdamOptimizer<double>>(), Linear<double>(16),
+			ReLU<double>(), Dropout<double>(0.5), Linear<double>(8), Tanh<double>(),
+			Linear<double>(4), Softmax<double>());
+}
+
+auto make_cnn() -> Sequential<double> {
+	arma::arma_rng::set_seed(52);
+	return Sequential<double>(
+			Shape{2, 6, 6}, std::make_unique<AdamOptimizer<double>>(),
+			Conv2D<double>(3, 3, 1, 1), ReLU<double>(), MaxPool2D<double>(2),
+			Conv2D<double>(4, 2, 1, 0, true, Spatial::ConvAlgorithm::Im2col),
+			AvgPool2D<double>(2), Linear<double>(5), Softmax<double>());
+}
+
+// The graph path with dropout off: what predict must reproduce.
+auto recorded(Sequential<double> &net, const Tensor<double> &x)
+		-> arma::Mat<double> {
+	net.set_training(false);
+	arma::Mat<double> out = *net.forward(x).data;
+	net.reset_graph();
+	net.set_training(true);
+	return out;
+}
+
+} // namespace
+
+TEST_CASE("predict matches the recorded forward pass") {
+	for (int model = 0; model < 2; ++model) {
+		auto net = model == 0 ? make_mlp() : make_cnn();
+		const auto features = model == 0 ? 12 : 72;
+		const Tensor<double> x(arma::randn<arma::Mat<double>>(10, features));
+		const auto expected = recorded(net, x);
+
+		const auto whole = net.predict(x);
+		CHECK(arma::approx_equal(*whole.data, expected, "absdiff", 1e-12));
+		// Chunks of three rows, the last one short.
+		const auto chunked = net.predict(x, 3);
+		CHECK(arma::approx_equal(*chunked.data, expected, "absdiff", 1e-12));
+		CHECK(net.expression_graph().size() == 0);
+	}
+}
+
+TEST_CASE("an inference guard keeps forward off the tape") {
+	auto net = make_mlp();
+	const Tensor<double> x(arma::randn<arma::Mat<double>>(6, 12));
+	const auto expected = recorded(net, x);
+	{
+		InferenceMode outer;
+		{
+			InferenceMode inner;
+			CHECK(InferenceMode::active());
+		}
+		CHECK(InferenceMode::active());
+		const auto out = net.forward(x);
+		CHECK(arma::approx_equal(*out.data, expected, "absdiff", 1e-12));
+		CHECK(net.expression_graph().size() == 0);
+	}
+	CHECK_FALSE(InferenceMode::active());
+	net.forward(x);
+	CHECK(net.expression_graph().size() > 0);
+	net.reset_graph();
+	CHECK_THROWS_AS(net.predict(Tensor<double>(arma::Mat<double>(2, 5))),
+									std::invalid_argument);
+}
+
+TEST_CASE("steady-state predict allocates only its result") {
+	auto net = make_mlp();
+	const Tensor<double> x(arma::randn<arma::Mat<double>>(32, 12));
+	net.predict(x);
+	const auto before = Testing::allocation_count();
+	for (int i = 0; i < 5; ++i)
+		net.predict(x);
+	// The result tensor: its control block and its matrix memory.
+	CHECK_LE(Testing::allocation_count() - before, 5 * 2);
+}
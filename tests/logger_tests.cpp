@@ -0,0 +1,88 @@
+#include <doctest/doctest.h>
+
+#include "exgraf/logger.hpp"
+
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+using namespace ExGraf;
+
+namespace {
+
+// Counts how often fmt formats it, to prove filtered calls never do.
+struct Counted {
+	int *formats;
+};
+
+auto count_lines(const std::string &text) -> std::size_t {
+	return static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+}
+
+} // namespace
+
+template <> struct fmt::formatter<Counted> : fmt::formatter<int> {
+	auto format(const Counted &c, fmt::format_context &ctx) const {
+		return fmt::formatter<int>::format(++*c.formats, ctx);
+	}
+};
+
+TEST_CASE("filtered log calls never format or allocate") {
+	std::ostringstream out;
+	Logger::configure(
+			{.level = LogLevel::Info,
+			 .sinks = {std::make_shared<spdlog::sinks::ostream_sink_mt>(out)}});
+	CHECK_FALSE(log_enabled<LogLevel::Trace>());
+	CHECK(log_enabled<LogLevel::Info>());
+
+	int formats = 0;
+	const auto before = Testing::allocation_count();
+	for (int i = 0; i < 100; ++i) {
+		trace("op {}", Counted{&formats});
+		debug("op {}", Counted{&formats});
+	}
+	CHECK_EQ(Testing::allocation_count() - before, 0);
+	CHECK(formats == 0);
+
+	info("batch {}", Counted{&formats});
+	CHECK(formats == 1);
+	CHECK(out.str().find("[INFO] batch 1") != std::string::npos);
+	Logger::configure();
+}
+
+TEST_CASE("the async sink delivers every message in order") {
+	std::ostringstream out;
+	Logger::configure(
+			{.async = true,
+			 .sinks = {std::make_shared<spdlog::sinks::ostream_sink_mt>(out)}});
+	for (int i = 0; i < 200; ++i)
+		info("[Batch {}/200] Loss: {}", i + 1, 1.0 / (i + 1));
+	CHECK(Logger::dropped_messages() == 0);
+	// Reconfiguring drains the old queue before returning.
+	Logger::configure();
+
+	const auto text = out.str();
+	CHECK(count_lines(text) == 200);
+	const auto first = text.find("[Batch 1/200]");
+	const auto last = text.find("[Batch 200/200]");
+	REQUIRE(first != std::string::npos);
+	REQUIRE(last != std::string::npos);
+	CHECK(first < last);
+}
+
+TEST_CASE("a full async ring drops the oldest messages") {
+	std::ostringstream out;
+	Logger::configure(
+			{.async = true,
+			 .queue_size = 4,
+			 .sinks = {std::make_shared<spdlog::sinks::ostream_sink_mt>(out)}});
+	for (int i = 0; i < 5000; ++i)
+		info("metric {}", i);
+	const auto dropped = Logger::dropped_messages();
+	Logger::configure();
+	CHECK(count_lines(out.str()) + dropped == 5000);
+	// The newest message always survives.
+	CHECK(out.str().find("metric 4999") != std::string::npos);
+}
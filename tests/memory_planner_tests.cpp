@@ -0,0 +1,117 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/binary_operation.hpp"
+#include "exgraf/expression_graph.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/unary_operation.hpp"
+
+#include "batches.hpp"
+
+#include <array>
+#include <span>
+#include <stdexcept>
+
+using namespace ExGraf;
+using Testing::make_batch;
+
+namespace {
+
+struct Step {
+	double loss;
+	arma::Mat<double> probabilities;
+	arma::Mat<double> grad_w1;
+};
+
+// One forward/backward over a fixed two-layer network, rewinding the graph
+// afterwards. Results are copied out because the graph reuses its buffers.
+auto run_step(ExpressionGraph<double> &graph, const Tensor<double> &x,
+							const Tensor<double> &y, Tensor<double> &w1,
+							const Tensor<double> &w2) -> Step {
+	w1.zero_grad();
+	auto h1 = graph.add_operation<Binary::MatMulOp<double>>({x, w1});
+	auto h2 = graph.add_operation<Unary::ReLUOp<double>>({h1});
+	auto h3 = graph.add_operation<Binary::MatMulOp<double>>({h2, w2});
+	auto p = graph.add_operation<Unary::SoftmaxOp<double>>({h3});
+	auto loss = graph.add_operation<Binary::CrossEntropyLoss<double>>({p, y});
+	graph.backward(loss);
+	Step result{loss.data->at(0), *p.data, *w1.grad->data};
+	graph.reset();
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("arena-backed steps match the heap-backed first step") {
+	auto [x, y] = make_batch(6, 5, 3);
+	Tensor<double> w1(arma::randn<arma::Mat<double>>(5, 7));
+	Tensor<double> w2(arma::randn<arma::Mat<double>>(7, 3));
+
+	ExpressionGraph<double> graph;
+	auto heap = run_step(graph, x, y, w1, w2);
+	CHECK_GT(graph.memory_planner().heap_fallbacks(), 0);
+	CHECK_EQ(graph.memory_planner().plan_count(), 1);
+
+	const auto fallbacks = graph.memory_planner().heap_fallbacks();
+	for (int i = 0; i < 3; ++i) {
+		auto planned = run_step(graph, x, y, w1, w2);
+		CHECK_EQ(planned.loss, doctest::Approx(heap.loss));
+		CHECK(arma::approx_equal(planned.probabilities, heap.probabilities,
+														 "absdiff", 1e-12));
+		CHECK(arma::approx_equal(planned.grad_w1, heap.grad_w1, "absdiff",
+														 1e-12));
+	}
+	CHECK_EQ(graph.memory_planner().heap_fallbacks(), fallbacks);
+	CHECK_EQ(graph.memory_planner().plan_count(), 1);
+}
+
+TEST_CASE("buffers with disjoint lifetimes share arena storage") {
+	Tensor<double> x(arma::randu<arma::Mat<double>>(32, 64));
+	Tensor<double> w1(arma::randn<arma::Mat<double>>(64, 64));
+	Tensor<double> w2(arma::randn<arma::Mat<double>>(64, 64));
+	Tensor<double> w3(arma::randn<arma::Mat<double>>(64, 64));
+	w1.zero_grad();
+	w2.zero_grad();
+	w3.zero_grad();
+
+	ExpressionGraph<double> graph;
+	auto h1 = graph.add_operation<Binary::MatMulOp<double>>({x, w1});
+	auto h2 = graph.add_operation<Binary::MatMulOp<double>>({h1, w2});
+	auto h3 = graph.add_operation<Binary::MatMulOp<double>>({h2, w3});
+	graph.backward(h3);
+	graph.reset();
+
+	const auto &planner = graph.memory_planner();
+	CHECK_GT(planner.arena_bytes(), 0);
+	CHECK_LT(planner.arena_bytes(), planner.unshared_bytes());
+}
+
+TEST_CASE("shapes beyond the inline rank are rejected") {
+	const std::array<std::size_t, 5> dims{2, 3, 4, 5, 6};
+	CHECK_THROWS_AS((Shape{2, 3, 4, 5, 6}), std::invalid_argument);
+	CHECK_THROWS_AS(Shape::from(dims), std::invalid_argument);
+	CHECK_EQ(Shape::from(std::span(dims).first(4)).total_elements(), 120);
+}
+
+TEST_CASE("steady-state training steps do not allocate") {
+	auto [x, y] = make_batch(16, 12, 4);
+	Model<double> model(12, 24, 4, std::make_unique<AdamOptimizer<double>>());
+
+	auto train_step = [&] {
+		auto output = model.forward(x);
+		model.compute_loss(output, y);
+		model.backward();
+		model.step();
+		model.zero_grad();
+	};
+
+	// The first step records the plan, the second is the first to replay it.
+	train_step();
+	train_step();
+
+	const auto before = Testing::allocation_count();
+	for (int i = 0; i < 5; ++i)
+		train_step();
+	CHECK_EQ(Testing::allocation_count() - before, 0);
+}
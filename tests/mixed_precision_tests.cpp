@@ -0,0 +1,247 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/data_parallel_trainer.hpp"
+#include "exgraf/expression_graph.hpp"
+#include "exgraf/fused_operation.hpp"
+#include "exgraf/gemm.hpp"
+#include "exgraf/half.hpp"
+#include "exgraf/loss_scaler.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+
+#include "batches.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+auto widened(const PackedMatrix<float> &m) -> arma::Mat<float> {
+	arma::Mat<float> out;
+	m.load(out);
+	return out;
+}
+
+auto representable(std::span<const float> values, Storage format) -> bool {
+	std::vector<float> rounded(values.size());
+	Kernels::round_to(values.data(), values.size(), rounded.data(), format);
+	return std::equal(values.begin(), values.end(), rounded.begin());
+}
+
+// Four classes, each lighting up its own block of inputs.
+auto make_batch(std::size_t rows) -> std::pair<Tensor<float>, Tensor<float>> {
+	auto batch = Testing::make_batch<float>(rows, 16, 4);
+	auto &x = *batch.first.data;
+	x *= 0.2F;
+	for (std::size_t i = 0; i < rows; ++i)
+		for (std::size_t p = 0; p < 4; ++p)
+			x(i, (i % 4) * 4 + p) += 1.0F;
+	return batch;
+}
+
+struct Footprint {
+	std::size_t plan, stashed;
+};
+
+constexpr std::size_t footprint_rows = 512, footprint_width = 256;
+
+// Trains three fused hidden layers on one batch until the planner replays
+// the fused step's plan, then measures that plan's arena and the 16-bit
+// copies kept beside it.
+auto training_footprint(Storage format) -> Footprint {
+	arma::arma_rng::set_seed(25);
+	const std::size_t widths[]{64, footprint_width, footprint_width,
+														 footprint_width, 4};
+	std::vector<Tensor<float>> weights, biases;
+	for (std::size_t k = 0; k + 1 < std::size(widths); ++k) {
+		weights.emplace_back(arma::Mat<float>(
+				0.05F * arma::randn<arma::Mat<float>>(widths[k], widths[k + 1])));
+		biases.emplace_back(arma::Mat<float>(1, widths[k + 1], arma::fill::zeros));
+	}
+	auto [x, y] =
+			Testing::make_batch<float>(footprint_rows, widths[0], widths[4]);
+
+	ExpressionGraph<float> graph;
+	graph.set_fusion_patterns(Fused::default_patterns<float>());
+	graph.set_operand_storage(format);
+	auto step = [&] {
+		Tensor<float> h = x;
+		for (std::size_t k = 0; k < weights.size(); ++k) {
+			auto z = graph.add_operation<Binary::MatMulOp<float>>({h, weights[k]});
+			h = graph.add_operation<Binary::AddBiasOp<float>>({z, biases[k]});
+			if (k + 1 < weights.size())
+				h = graph.add_operation<Unary::ReLUOp<float>>({h});
+		}
+		auto p = graph.add_operation<Unary::SoftmaxOp<float>>({h});
+		auto loss = graph.add_operation<Binary::CrossEntropyLoss<float>>({p, y});
+		graph.backward(loss);
+		graph.reset();
+	};
+	// Capture, the first fused step, then replays.
+	for (int i = 0; i < 3; ++i)
+		step();
+	const auto fallbacks = graph.memory_planner().heap_fallbacks();
+	step();
+	step();
+	CHECK(graph.memory_planner().heap_fallbacks() == fallbacks);
+	return {graph.memory_planner().plan_bytes(), graph.stashed_bytes()};
+}
+
+} // namespace
+
+TEST_CASE("GEMM widens 16-bit operands as it packs them") {
+	arma::arma_rng::set_seed(21);
+	const std::vector<std::shared_ptr<GemmBackend<float>>> backends{
+			std::make_shared<ArmadilloGemm<float>>(),
+			std::make_shared<BlockedGemm<float>>(1)};
+	for (const auto &backend : backends) {
+		set_gemm_backend<float>(backend);
+		for (auto format : {Storage::BF16, Storage::FP16})
+			for (bool ta : {false, true})
+				for (bool tb : {false, true}) {
+					// Deep enough for two depth blocks.
+					const std::size_t m = 19, n = 7, k = 300;
+					PackedMatrix<float> a, b;
+					a.store(arma::randn<arma::Mat<float>>(ta ? k : m, ta ? m : k),
+									format);
+					b.store(arma::randn<arma::Mat<float>>(tb ? n : k, tb ? k : n),
+									format);
+					const arma::Mat<float> wa = widened(a), wb = widened(b);
+					const arma::Mat<float> op_a = ta ? arma::Mat<float>(wa.t()) : wa;
+					const arma::Mat<float> op_b = tb ? arma::Mat<float>(wb.t()) : wb;
+					arma::Mat<float> c(m, n, arma::fill::ones);
+					gemm(a, ta ? Transpose::Yes : Transpose::No, b,
+							 tb ? Transpose::Yes : Transpose::No, c, 2.0F, 0.5F);
+					const arma::Mat<float> expected = 2.0F * (op_a * op_b) + 0.5F;
+					CHECK(arma::approx_equal(c, expected, "absdiff", 1e-3F));
+				}
+	}
+	set_gemm_backend<float>(nullptr);
+}
+
+TEST_CASE("master weights keep steps too small for the parameters") {
+	Tensor<float> p(arma::Mat<float>(1, 1, arma::fill::ones));
+	p.grad = std::make_shared<Tensor<float>>(p.shape);
+	p.grad->data->fill(1e-4F);
+	std::vector<std::reference_wrapper<Tensor<float>>> parameters{p};
+
+	SgdOptimizer<float> sgd(1.0F);
+	sgd.keep_master_weights(Storage::BF16);
+	sgd.step(parameters);
+	// 1 - 1e-4 rounds back to 1 in bfloat16, but the master moved.
+	CHECK(p.data->at(0) == 1.0F);
+	REQUIRE(sgd.export_state().values.size() == 1);
+	CHECK(sgd.export_state().values[0] < 1.0F);
+
+	for (int i = 1; i < 100; ++i)
+		sgd.step(parameters);
+	const float master = sgd.export_state().values[0];
+	CHECK(master == doctest::Approx(0.99F).epsilon(1e-4));
+	CHECK(p.data->at(0) == to_float(to_bfloat16(master)));
+	CHECK(p.data->at(0) < 1.0F);
+
+	// Dropping the masters steps the parameter itself again.
+	sgd.keep_master_weights(Storage::FP32);
+	const float before = p.data->at(0);
+	sgd.step(parameters);
+	CHECK(sgd.export_state().values.empty());
+	CHECK(p.data->at(0) == before - 1e-4F);
+}
+
+TEST_CASE("the loss scaler backs off on overflow and grows when stable") {
+	LossScaler<float> scaler(
+			{.initial = 8.0F, .growth = 2.0F, .backoff = 0.5F, .interval = 2});
+	std::vector<float> g{8.0F, -16.0F};
+	CHECK(scaler.unscale(g));
+	CHECK(g[0] == 1.0F);
+	CHECK(g[1] == -2.0F);
+	CHECK(scaler.scale() == 8.0F);
+	CHECK(scaler.unscale(g));
+	CHECK(scaler.scale() == 16.0F);
+
+	g = {1.0F, std::numeric_limits<float>::infinity()};
+	CHECK_FALSE(scaler.unscale(g));
+	g = {std::numeric_limits<float>::quiet_NaN(), 1.0F};
+	CHECK_FALSE(scaler.unscale(g));
+	CHECK(scaler.scale() == 4.0F);
+	CHECK(scaler.skipped_steps() == 2);
+}
+
+TEST_CASE("mixed-precision training converges in either 16-bit format") {
+	for (auto format : {Storage::BF16, Storage::FP16}) {
+		arma::arma_rng::set_seed(22);
+		Model<float> model(16, 32, 4,
+											 std::make_unique<AdamOptimizer<float>>(0.01F));
+		model.set_mixed_precision(format);
+		REQUIRE(model.loss_scaler() != nullptr);
+		auto [x, y] = make_batch(64);
+		float first = 0.0F, last = 0.0F;
+		for (int step = 0; step < 60; ++step) {
+			model.zero_grad();
+			last = model.compute_loss(model.forward(x), y);
+			model.backward();
+			model.step();
+			if (step == 0)
+				first = last;
+		}
+		CHECK(std::isfinite(last));
+		CHECK_LT(last, first * 0.5F);
+		CHECK(model.loss_scaler()->skipped_steps() == 0);
+		// The parameters are the masters rounded to the format.
+		CHECK(representable(model.parameter_values(), format));
+	}
+}
+
+TEST_CASE("an overflowing loss scale skips the step and backs off") {
+	arma::arma_rng::set_seed(23);
+	Model<float> model(16, 8, 4, std::make_unique<SgdOptimizer<float>>(0.1F));
+	model.set_mixed_precision(Storage::FP16, {.initial = 3e38F});
+	const std::vector<float> before(model.parameter_values().begin(),
+																	model.parameter_values().end());
+	auto [x, y] = make_batch(8);
+	model.zero_grad();
+	model.compute_loss(model.forward(x), y);
+	model.backward();
+	model.step();
+	CHECK(model.loss_scaler()->skipped_steps() == 1);
+	CHECK(model.loss_scaler()->scale() == doctest::Approx(1.5e38F));
+	CHECK(std::equal(before.begin(), before.end(),
+									 model.parameter_values().begin()));
+}
+
+TEST_CASE("data-parallel replicas share the loss scale") {
+	arma::arma_rng::set_seed(24);
+	Model<float> model(16, 32, 4, std::make_unique<AdamOptimizer<float>>(0.01F));
+	model.set_mixed_precision(Storage::BF16, {.initial = 1024.0F});
+	DataParallelTrainer<float> trainer(model, 3);
+	auto [x, y] = make_batch(48);
+	const float first = trainer.step(x, y);
+	float last = first;
+	for (int step = 0; step < 40; ++step)
+		last = trainer.step(x, y);
+	CHECK(std::isfinite(last));
+	CHECK_LT(last, first * 0.5F);
+	CHECK(model.loss_scaler()->skipped_steps() == 0);
+}
+
+TEST_CASE("16-bit operand storage shrinks what a training step keeps") {
+	const auto full = training_footprint(Storage::FP32);
+	const auto mixed = training_footprint(Storage::BF16);
+	CHECK(full.stashed == 0);
+	CHECK(mixed.stashed > 0);
+	// The float hidden activations are freed once the next layer has packed
+	// them, instead of living until the step ends.
+	const auto activation = footprint_rows * footprint_width * sizeof(float);
+	CHECK(full.plan - mixed.plan >= 3 * activation);
+	CHECK(mixed.plan + mixed.stashed < full.plan);
+}
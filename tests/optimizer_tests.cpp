@@ -0,0 +1,227 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/cpu_features.hpp"
+#include "exgraf/flat_buffer.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+#include "exgraf/optimizers/update_kernels.hpp"
+
+#include "batches.hpp"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+// Odd sizes leave a scalar tail after the vector loop.
+auto make_parameters(std::size_t count) -> std::vector<Tensor<double>> {
+	std::vector<Tensor<double>> tensors;
+	for (std::size_t i = 0; i < count; ++i) {
+		Tensor<double> p(arma::Mat<double>(arma::randn<arma::Mat<double>>(
+				37 + i, 13 + 2 * i)));
+		p.grad = std::make_shared<Tensor<double>>(p.shape);
+		tensors.push_back(std::move(p));
+	}
+	return tensors;
+}
+
+auto refs(std::vector<Tensor<double>> &tensors)
+		-> std::vector<std::reference_wrapper<Tensor<double>>> {
+	return {tensors.begin(), tensors.end()};
+}
+
+// The per-tensor Armadillo update the fused kernels replace.
+struct ReferenceAdam {
+	double lr, beta1, beta2, epsilon;
+	std::size_t t{0};
+	std::vector<arma::Mat<double>> m, v;
+
+	auto step(std::vector<Tensor<double>> &parameters) -> void {
+		++t;
+		const double bc1 = 1.0 - std::pow(beta1, double(t));
+		const double bc2 = 1.0 - std::pow(beta2, double(t));
+		for (std::size_t i = 0; i < parameters.size(); ++i) {
+			auto &g = *parameters[i].grad->data;
+			if (m.size() <= i) {
+				m.push_back(arma::zeros<arma::Mat<double>>(g.n_rows, g.n_cols));
+				v.push_back(arma::zeros<arma::Mat<double>>(g.n_rows, g.n_cols));
+			}
+			m[i] = beta1 * m[i] + (1.0 - beta1) * g;
+			v[i] = beta2 * v[i] + (1.0 - beta2) * (g % g);
+			arma::Mat<double> m_hat = m[i] / bc1;
+			arma::Mat<double> v_hat = v[i] / bc2;
+			*parameters[i].data -= lr * m_hat / (arma::sqrt(v_hat) + epsilon);
+		}
+	}
+};
+
+auto fill_gradients(std::vector<Tensor<double>> &tensors, int step) -> void {
+	for (auto &p : tensors) {
+		auto &g = *p.grad->data;
+		for (std::size_t i = 0; i < g.n_elem; ++i)
+			g[i] = std::sin(double(i * 7 + step * 13)) * 0.1;
+	}
+}
+
+} // namespace
+
+TEST_CASE("fused adam kernel matches the scalar kernel at every level") {
+	constexpr std::size_t n = 1027;
+	std::vector<double> g(n), p0(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		g[i] = std::cos(double(i)) * 0.3;
+		p0[i] = std::sin(double(i));
+	}
+	const Kernels::AdamStep<double> constants{0.9, 0.999, 0.01, 1.0 / 0.001,
+																						1e-8};
+	std::vector<double> p_ref = p0, m_ref(n, 0.1), v_ref(n, 0.2);
+	Kernels::adam_update(p_ref.data(), g.data(), m_ref.data(), v_ref.data(), n,
+											 constants, Isa::Scalar);
+	for (auto level : {Isa::SSE2, Isa::AVX2}) {
+		if (!isa_supported(level))
+			continue;
+		std::vector<double> p = p0, m(n, 0.1), v(n, 0.2);
+		Kernels::adam_update(p.data(), g.data(), m.data(), v.data(), n, constants,
+												 level);
+		for (std::size_t i = 0; i < n; ++i) {
+			CHECK(p[i] == doctest::Approx(p_ref[i]).epsilon(1e-12));
+			CHECK(m[i] == doctest::Approx(m_ref[i]).epsilon(1e-12));
+			CHECK(v[i] == doctest::Approx(v_ref[i]).epsilon(1e-12));
+		}
+	}
+}
+
+TEST_CASE("adam optimizer matches the per-tensor armadillo update") {
+	arma::arma_rng::set_seed(5);
+	auto fused = make_parameters(3);
+	auto reference = make_parameters(0);
+	for (const auto &p : fused) {
+		Tensor<double> copy(*p.data);
+		copy.grad = std::make_shared<Tensor<double>>(p.shape);
+		reference.push_back(std::move(copy));
+	}
+	AdamOptimizer<double> adam(0.01);
+	ReferenceAdam expected{0.01, 0.9, 0.999, 1e-8, 0, {}, {}};
+	auto params = refs(fused);
+	for (int step = 0; step < 5; ++step) {
+		fill_gradients(fused, step);
+		fill_gradients(reference, step);
+		adam.step(params);
+		expected.step(reference);
+	}
+	for (std::size_t i = 0; i < fused.size(); ++i)
+		CHECK(arma::approx_equal(*fused[i].data, *reference[i].data, "absdiff",
+														 1e-12));
+}
+
+TEST_CASE("optimizer state follows a parameter when the set changes") {
+	arma::arma_rng::set_seed(6);
+	auto tensors = make_parameters(2);
+	Tensor<double> alone(*tensors[1].data);
+	alone.grad = std::make_shared<Tensor<double>>(alone.shape);
+	fill_gradients(tensors, 0);
+	*alone.grad->data = *tensors[1].grad->data;
+
+	SgdOptimizer<double> sgd(0.1, 0.9), reference(0.1, 0.9);
+	auto both = refs(tensors);
+	std::vector<std::reference_wrapper<Tensor<double>>> second{tensors[1]};
+	std::vector<std::reference_wrapper<Tensor<double>>> only{alone};
+	// Dropping and re-adding the first tensor relayouts the state; the second
+	// tensor's velocity must carry over each time.
+	for (auto *set : {&both, &second, &both}) {
+		sgd.step(*set);
+		reference.step(only);
+	}
+	CHECK(arma::approx_equal(*tensors[1].data, *alone.data, "absdiff", 1e-12));
+}
+
+TEST_CASE("sgd momentum accumulates velocity") {
+	Tensor<double> p(arma::Mat<double>(3, 1, arma::fill::zeros));
+	p.grad = std::make_shared<Tensor<double>>(p.shape);
+	p.grad->data->fill(1.0);
+	std::vector<std::reference_wrapper<Tensor<double>>> params{p};
+	SgdOptimizer<double> sgd(0.5, 0.9);
+	sgd.step(params);
+	CHECK((*p.data)(0) == doctest::Approx(-0.5));
+	// velocity = 0.9 * 1 + 1 = 1.9
+	sgd.step(params);
+	CHECK((*p.data)(0) == doctest::Approx(-0.5 - 0.95));
+
+	SgdOptimizer<double> plain(0.5);
+	p.data->zeros();
+	plain.step(params);
+	plain.step(params);
+	CHECK((*p.data)(2) == doctest::Approx(-1.0));
+}
+
+TEST_CASE("flat buffer views are contiguous and share storage") {
+	const std::array<Shape, 2> shapes{Shape{3, 4}, Shape{4, 2}};
+	FlatBuffer<float> buffer(shapes);
+	CHECK(buffer.size() == 20);
+	auto a = buffer.view(0);
+	auto b = buffer.view(1);
+	CHECK(a->memptr() == buffer.data());
+	CHECK(b->memptr() == buffer.data() + 12);
+	CHECK(a->n_rows == 3);
+	CHECK(b->n_cols == 2);
+	b->fill(2.0F);
+	CHECK(buffer.data()[19] == 2.0F);
+	CHECK(buffer.data()[0] == 0.0F);
+}
+
+TEST_CASE("model parameters and gradients sit in flat buffers") {
+	arma::arma_rng::set_seed(7);
+	Model<float> model(6, 5, 3, std::make_unique<AdamOptimizer<float>>(0.01F));
+	auto &params = model.params();
+	auto &w1 = params[0].get();
+	auto &w2 = params[1].get();
+	CHECK(w1.data->memptr() + w1.data->n_elem == w2.data->memptr());
+	CHECK(w1.grad->data->memptr() + w1.grad->data->n_elem ==
+				w2.grad->data->memptr());
+
+	const auto [input, target] = Testing::make_batch<float>(4, 6, 3);
+	const arma::Mat<float> before = *w2.data;
+	auto out = model.forward(input);
+	model.compute_loss(out, target);
+	model.backward();
+	CHECK(arma::accu(arma::abs(*w2.grad->data)) > 0.0F);
+	model.step();
+	CHECK_FALSE(arma::approx_equal(before, *w2.data, "absdiff", 0.0F));
+}
+
+TEST_CASE("parallel optimizer step matches the inline step") {
+	arma::arma_rng::set_seed(8);
+	// Large enough to split into several chunks.
+	std::vector<Tensor<double>> serial;
+	for (std::size_t i = 0; i < 3; ++i) {
+		Tensor<double> p(arma::Mat<double>(arma::randn<arma::Mat<double>>(
+				200, 150 + i)));
+		p.grad = std::make_shared<Tensor<double>>(p.shape);
+		serial.push_back(std::move(p));
+	}
+	auto parallel = make_parameters(0);
+	for (const auto &p : serial) {
+		Tensor<double> c(*p.data);
+		c.grad = std::make_shared<Tensor<double>>(p.shape);
+		parallel.push_back(std::move(c));
+	}
+	tf::Executor executor(4);
+	AdamOptimizer<double> inline_adam(0.01), threaded_adam(0.01);
+	threaded_adam.set_executor(&executor);
+	auto serial_params = refs(serial);
+	auto parallel_params = refs(parallel);
+	for (int step = 0; step < 3; ++step) {
+		fill_gradients(serial, step);
+		fill_gradients(parallel, step);
+		inline_adam.step(serial_params);
+		threaded_adam.step(parallel_params);
+	}
+	for (std::size_t i = 0; i < serial.size(); ++i)
+		CHECK(arma::approx_equal(*serial[i].data, *parallel[i].data, "absdiff",
+														 0.0));
+}
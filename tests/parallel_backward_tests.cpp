@@ -0,0 +1,94 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+
+#include "batches.hpp"
+
+#include <taskflow/taskflow.hpp>
+
+using namespace ExGraf;
+
+namespace {
+
+struct Branches {
+	Tensor<double> x, y, shared, w1, w2, v;
+
+	Branches()
+			: x(arma::Mat<double>(arma::randn<arma::Mat<double>>(6, 5))),
+				y(Testing::one_hot(6, 3)),
+				shared(arma::Mat<double>(arma::randn<arma::Mat<double>>(5, 4))),
+				w1(arma::Mat<double>(arma::randn<arma::Mat<double>>(5, 4))),
+				w2(arma::Mat<double>(arma::randn<arma::Mat<double>>(5, 4))),
+				v(arma::Mat<double>(arma::randn<arma::Mat<double>>(4, 3))) {}
+
+	auto parameters() -> std::array<Tensor<double> *, 4> {
+		return {&shared, &w1, &w2, &v};
+	}
+
+	// Three branches summed, with `shared` used by two of them so two
+	// concurrent tasks contribute to the same leaf gradient.
+	auto step(ExpressionGraph<double> &graph) -> std::vector<arma::Mat<double>> {
+		for (auto *p : parameters())
+			p->zero_grad();
+		auto a = graph.add_operation<Binary::MatMulOp<double>>({x, shared});
+		auto b = graph.add_operation<Binary::MatMulOp<double>>({x, w1});
+		auto c = graph.add_operation<Binary::MatMulOp<double>>({x, w2});
+		auto d = graph.add_operation<Binary::MatMulOp<double>>({x, shared});
+		auto ra = graph.add_operation<Unary::ReLUOp<double>>({a});
+		auto rb = graph.add_operation<Unary::ReLUOp<double>>({b});
+		auto ab = graph.add_operation<Binary::AddOp<double>>({ra, rb});
+		auto cd = graph.add_operation<Binary::AddOp<double>>({c, d});
+		auto h = graph.add_operation<Binary::AddOp<double>>({ab, cd});
+		auto z = graph.add_operation<Binary::MatMulOp<double>>({h, v});
+		auto p = graph.add_operation<Unary::SoftmaxOp<double>>({z});
+		auto loss = graph.add_operation<Binary::CrossEntropyLoss<double>>({p, y});
+		graph.backward(loss);
+		std::vector<arma::Mat<double>> grads;
+		for (auto *param : parameters())
+			grads.push_back(*param->grad->data);
+		graph.reset();
+		return grads;
+	}
+};
+
+} // namespace
+
+TEST_CASE("parallel backward matches the serial walk") {
+	Branches branches;
+	ExpressionGraph<double> serial;
+	auto expected = branches.step(serial);
+
+	tf::Executor executor(4);
+	ExpressionGraph<double> parallel;
+	parallel.set_executor(&executor);
+	for (int step = 0; step < 3; ++step) {
+		auto grads = branches.step(parallel);
+		REQUIRE_EQ(grads.size(), expected.size());
+		for (std::size_t i = 0; i < grads.size(); ++i)
+			CHECK(arma::approx_equal(grads[i], expected[i], "absdiff", 1e-12));
+	}
+}
+
+TEST_CASE("model trains the same with and without an executor") {
+	auto [batch_x, batch_y] = Testing::make_batch(10, 8, 4);
+
+	auto train = [&](tf::Executor *executor) {
+		arma::arma_rng::set_seed(7);
+		Model<double> model(8, 16, 4, std::make_unique<SgdOptimizer<double>>(0.1));
+		model.set_executor(executor);
+		double loss = 0;
+		for (int step = 0; step < 5; ++step) {
+			auto output = model.forward(batch_x);
+			loss = model.compute_loss(output, batch_y);
+			model.backward();
+			model.step();
+			model.zero_grad();
+		}
+		return loss;
+	};
+
+	tf::Executor executor(2);
+	CHECK_EQ(train(&executor), doctest::Approx(train(nullptr)).epsilon(1e-12));
+}
@@ -0,0 +1,170 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/profiler.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <taskflow/taskflow.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <sstream>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+constexpr std::size_t batch = 5, features = 8, hidden = 4, classes = 3;
+
+auto make_model() -> Sequential<double> {
+	return Sequential<double>(
+			features, std::make_unique<AdamOptimizer<double>>(0.01),
+			Linear<double>(hidden), ReLU<double>(), Linear<double>(classes),
+			Softmax<double>());
+}
+
+auto train_step(Sequential<double> &model, const Tensor<double> &x,
+								const Tensor<double> &y) -> void {
+	model.zero_grad();
+	model.compute_loss(model.forward(x), y);
+	model.backward();
+	model.step();
+}
+
+auto find_row(const std::vector<OpProfile> &rows, const std::string &name,
+							ProfilePhase phase) -> const OpProfile * {
+	auto it = std::ranges::find_if(rows, [&](const OpProfile &r) {
+		return r.name == name && r.phase == phase;
+	});
+	return it == rows.end() ? nullptr : &*it;
+}
+
+} // namespace
+
+TEST_CASE("a profiled training step records every node and the optimizer") {
+	arma::arma_rng::set_seed(101);
+	auto model = make_model();
+	const Tensor<double> x(arma::randn<arma::Mat<double>>(batch, features));
+	arma::Col<std::size_t> labels{0, 1, 2, 0, 1};
+	const auto y = Sequential<double>::to_one_hot(labels, classes);
+
+	Profiler profiler;
+	model.set_profiler(&profiler);
+	model.zero_grad();
+	model.compute_loss(model.forward(x), y);
+	const auto nodes = model.expression_graph().size();
+	model.backward();
+	model.step();
+
+	const auto events = profiler.events();
+	const auto forward = std::ranges::count(events, ProfilePhase::Forward,
+																					&ProfileEvent::phase);
+	CHECK(static_cast<std::size_t>(forward) == nodes);
+	CHECK(std::ranges::is_sorted(events, {}, &ProfileEvent::start_ns));
+
+	const auto rows = profiler.summary();
+	const auto *matmul = find_row(rows, "MatMulOp", ProfilePhase::Forward);
+	REQUIRE(matmul != nullptr);
+	CHECK(matmul->calls == 2);
+	CHECK(matmul->flops == 2 * batch * (features * hidden + hidden * classes));
+	CHECK(matmul->bytes ==
+				batch * (hidden + classes) * sizeof(double));
+	REQUIRE(find_row(rows, "MatMulOp", ProfilePhase::Backward) != nullptr);
+	// Every operation here accumulates in place: no separate pass to time.
+	CHECK(find_row(rows, "update_gradient", ProfilePhase::Accumulate) ==
+				nullptr);
+	const auto *adam = find_row(rows, "AdamOptimizer", ProfilePhase::Optimizer);
+	REQUIRE(adam != nullptr);
+	CHECK(adam->calls == 1);
+	CHECK(adam->flops == 12 * model.parameter_values().size());
+	CHECK(profiler.summary_table().find("SoftmaxOp") != std::string::npos);
+
+	std::ostringstream trace;
+	profiler.write_chrome_trace(trace);
+	const auto json = trace.str();
+	CHECK(json.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	std::size_t spans = 0;
+	for (auto at = json.find("\"ph\":\"X\""); at != std::string::npos;
+			 at = json.find("\"ph\":\"X\"", at + 1))
+		++spans;
+	CHECK(spans == events.size());
+	CHECK(json.find("\"shape\":\"5x4\"") != std::string::npos);
+
+	std::ostringstream folded;
+	profiler.write_folded(folded);
+	CHECK(folded.str().find("forward;MatMulOp ") != std::string::npos);
+
+	// Detached, the next step records nothing.
+	model.set_profiler(nullptr);
+	profiler.clear();
+	train_step(model, x, y);
+	CHECK(profiler.events().empty());
+}
+
+TEST_CASE("profiling does not change what a step computes") {
+	arma::arma_rng::set_seed(102);
+	auto plain = make_model();
+	arma::arma_rng::set_seed(102);
+	auto profiled = make_model();
+	REQUIRE(std::ranges::equal(plain.parameter_values(),
+														 profiled.parameter_values()));
+	const Tensor<double> x(arma::randn<arma::Mat<double>>(batch, features));
+	arma::Col<std::size_t> labels{2, 1, 0, 2, 1};
+	const auto y = Sequential<double>::to_one_hot(labels, classes);
+
+	Profiler profiler;
+	profiled.set_profiler(&profiler);
+	for (int step = 0; step < 3; ++step) {
+		train_step(plain, x, y);
+		train_step(profiled, x, y);
+	}
+	CHECK(std::ranges::equal(plain.parameter_values(),
+													 profiled.parameter_values()));
+}
+
+TEST_CASE("parallel backward spans come from the executor's threads") {
+	arma::arma_rng::set_seed(103);
+	auto model = make_model();
+	const Tensor<double> x(arma::randn<arma::Mat<double>>(batch, features));
+	arma::Col<std::size_t> labels{0, 0, 1, 1, 2};
+	const auto y = Sequential<double>::to_one_hot(labels, classes);
+	tf::Executor executor(3);
+	model.set_executor(&executor);
+
+	Profiler profiler(256);
+	model.set_profiler(&profiler);
+	for (int step = 0; step < 4; ++step)
+		train_step(model, x, y);
+	model.set_executor(nullptr);
+
+	const auto events = profiler.events();
+	std::set<std::uint32_t> threads;
+	for (const auto &e : events) {
+		if (e.phase == ProfilePhase::Backward)
+			threads.insert(e.thread);
+	}
+	CHECK_FALSE(threads.empty());
+	CHECK(threads.count(0) == 0);
+	const auto *adam = find_row(profiler.summary(), "AdamOptimizer",
+															ProfilePhase::Optimizer);
+	REQUIRE(adam != nullptr);
+	CHECK(adam->calls == 4);
+}
+
+TEST_CASE("a full profiler ring keeps the newest spans") {
+	Profiler profiler(3);
+	for (std::uint64_t i = 0; i < 10; ++i)
+		profiler.record({.label = "span", .start_ns = i, .duration_ns = 1});
+	const auto events = profiler.events();
+	REQUIRE(events.size() == 4);
+	CHECK(events.front().start_ns == 6);
+	CHECK(events.back().start_ns == 9);
+	CHECK(profiler.dropped() == 6);
+	profiler.clear();
+	CHECK(profiler.events().empty());
+	CHECK(profiler.dropped() == 0);
+}
@@ -0,0 +1,117 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/quantization/int8_kernels.hpp"
+#include "exgraf/quantization/quantized_model.hpp"
+#include "exgraf/sequential.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+
+namespace {
+
+// Four classes of 64 features: class k lights up features [16k, 16k + 16).
+auto blobs(std::size_t n, arma::Col<std::size_t> &labels) -> Tensor<float> {
+	arma::Mat<float> x = arma::randu<arma::Mat<float>>(n, 64) * 0.4F;
+	labels.set_size(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		labels(i) = i % 4;
+		for (std::size_t f = 0; f < 16; ++f)
+			x(i, 16 * labels(i) + f) += 0.6F;
+	}
+	return Tensor<float>(x);
+}
+
+} // namespace
+
+TEST_CASE("every int8 dot kernel matches the scalar GEMM") {
+	constexpr std::size_t rows = 5, columns = 8, depth = 96;
+	std::vector<std::uint8_t> a(rows * depth);
+	std::vector<std::int8_t> b(columns * depth);
+	for (std::size_t i = 0; i < a.size(); ++i)
+		a[i] = static_cast<std::uint8_t>((i * 37 + 11) % 256);
+	// Extremes included: 255 x -128 sums overflow int16 pairs.
+	for (std::size_t i = 0; i < b.size(); ++i)
+		b[i] = static_cast<std::int8_t>(i % 7 == 0 ? -128 : (i * 53) % 255 - 127);
+	a[0] = 255;
+
+	const auto run = [&](Kernels::DotKernel kernel) {
+		std::vector<std::int32_t> out(rows * columns);
+		Kernels::gemm_u8s8(
+				a.data(), rows, b.data(), columns, depth,
+				[&](std::size_t r, std::size_t j, const std::int32_t *acc) {
+					std::copy_n(acc, 4, out.begin() + r * columns + j);
+				},
+				kernel);
+		return out;
+	};
+	const auto expected = run(Kernels::DotKernel::Scalar);
+	CHECK(expected[0] != 0);
+	for (auto kernel : {Kernels::DotKernel::AVX2, Kernels::DotKernel::VNNI}) {
+		if (!Kernels::dot_kernel_supported(kernel))
+			continue;
+		CHECK(run(kernel) == expected);
+	}
+}
+
+TEST_CASE("affine u8 parameters keep zero exact") {
+	const auto p = Kernels::affine_u8(-1.0F, 3.0F);
+	CHECK(p.scale == doctest::Approx(4.0F / 255.0F));
+	CHECK(Kernels::quantize_u8(0.0F, 1.0F / p.scale, p.zero_point) ==
+				p.zero_point);
+	// A non-negative range puts zero at code 0.
+	CHECK(Kernels::affine_u8(0.5F, 2.0F).zero_point == 0);
+	CHECK(Kernels::quantize_u8(10.0F, 1.0F, 0) == 10);
+	CHECK(Kernels::quantize_u8(300.0F, 1.0F, 0) == 255);
+}
+
+TEST_CASE("a quantized MLP tracks the float model") {
+	arma::arma_rng::set_seed(81);
+	arma::Col<std::size_t> labels, test_labels;
+	const auto x = blobs(256, labels);
+	const auto y = Sequential<float>::to_one_hot(labels, 4);
+	Sequential<float> model(64, std::make_unique<AdamOptimizer<float>>(0.01F),
+													Linear<float>(32), ReLU<float>(),
+													Dropout<float>(0.1F), Linear<float>(16),
+													ReLU<float>(), Linear<float>(4), Softmax<float>());
+	for (int step = 0; step < 60; ++step) {
+		model.zero_grad();
+		model.compute_loss(model.forward(x), y);
+		model.backward();
+		model.step();
+	}
+
+	auto quantized = QuantizedModel<float>::calibrate(model, x);
+	const auto test = blobs(200, test_labels);
+	const auto report = accuracy_report(model, quantized, test, test_labels);
+	CHECK(report.float_accuracy > 0.9);
+	CHECK(report.int8_accuracy >= report.float_accuracy - 0.02);
+	CHECK(report.agreement >= 0.97);
+	CHECK(report.max_abs_delta < 0.1);
+	CHECK(double(report.float_bytes) / double(report.int8_bytes) > 3.0);
+
+	// Every kernel produces the same codes, so the outputs are identical.
+	const auto reference =
+			*quantized.predict(test, Kernels::DotKernel::Scalar).data;
+	CHECK(arma::approx_equal(*quantized.predict(test).data, reference,
+													 "absdiff", 0.0F));
+}
+
+TEST_CASE("quantization rejects layers it cannot fuse") {
+	arma::arma_rng::set_seed(82);
+	const Tensor<float> x(arma::randu<arma::Mat<float>>(8, 4));
+	Sequential<float> tanh(4, std::make_unique<AdamOptimizer<float>>(),
+												 Linear<float>(3), Tanh<float>());
+	CHECK_THROWS_AS(QuantizedModel<float>::calibrate(tanh, x),
+									std::invalid_argument);
+	Sequential<float> leading(4, std::make_unique<AdamOptimizer<float>>(),
+														ReLU<float>(), Linear<float>(3));
+	CHECK_THROWS_AS(QuantizedModel<float>::calibrate(leading, x),
+									std::invalid_argument);
+}
@@ -0,0 +1,171 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/data_parallel_trainer.hpp"
+#include "exgraf/layers.hpp"
+#include "exgraf/model.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+
+#include "batches.hpp"
+
+#include <cmath>
+#include <memory>
+
+using namespace ExGraf;
+using namespace ExGraf::Layers;
+using Testing::make_batch;
+
+namespace {
+
+auto make_deep(double lr) -> Sequential<double> {
+	arma::arma_rng::set_seed(21);
+	return Sequential<double>(8, std::make_unique<SgdOptimizer<double>>(lr),
+														Linear<double>(16), ReLU<double>(),
+														Linear<double>(12), Tanh<double>(),
+														Linear<double>(4), Softmax<double>());
+}
+
+} // namespace
+
+TEST_CASE("summary counts parameters and flops per layer") {
+	Sequential<float> net(784, std::make_unique<AdamOptimizer<float>>(),
+												Linear<float>(256), ReLU<float>(),
+												Dropout<float>(0.2F), Linear<float>(10, false),
+												Softmax<float>());
+	const auto summary = net.summary();
+	REQUIRE(summary.layers.size() == 5);
+	CHECK(summary.layers[0].name == "Linear");
+	CHECK(summary.layers[0].output_features == 256);
+	CHECK(summary.layers[0].parameters == 784 * 256 + 256);
+	CHECK(summary.layers[0].flops == 2 * 784 * 256 + 256);
+	CHECK(summary.layers[1].flops == 256);
+	CHECK(summary.layers[3].parameters == 256 * 10);
+	CHECK(summary.layers[4].flops == 30);
+	CHECK(summary.parameters() == 784 * 256 + 256 + 2560);
+	CHECK(summary.parameter_bytes(sizeof(float)) == 4 * summary.parameters());
+	CHECK(summary.to_string().find("Total") != std::string::npos);
+
+	std::size_t registered = 0;
+	for (auto &p : net.params())
+		registered += p.get().data->n_elem;
+	CHECK(registered == summary.parameters());
+}
+
+TEST_CASE("model is the two-layer sequential it replaced") {
+	arma::arma_rng::set_seed(3);
+	Model<double> model(6, 5, 3, std::make_unique<SgdOptimizer<double>>(0.1));
+	auto [x, y] = make_batch(4, 6, 3, 3);
+	const auto &w1 = *model.params()[0].get().data;
+	const auto &w2 = *model.params()[1].get().data;
+	arma::Mat<double> logits = arma::clamp(*x.data * w1, 0.0, 1e300) * w2;
+	logits.each_col() -= arma::max(logits, 1);
+	arma::Mat<double> expected = arma::exp(logits);
+	expected.each_col() /= arma::sum(expected, 1);
+	auto output = model.forward(x);
+	CHECK(arma::approx_equal(*output.data, expected, "absdiff", 1e-12));
+	CHECK(model.params().size() == 2);
+}
+
+TEST_CASE("biased deep stack trains and rejects a mismatched input") {
+	auto net = make_deep(0.5);
+	auto [x, y] = make_batch(32, 8, 4, 3);
+	double first = 0.0, last = 0.0;
+	for (int step = 0; step < 60; ++step) {
+		auto output = net.forward(x);
+		last = net.compute_loss(output, y);
+		if (step == 0)
+			first = last;
+		net.backward();
+		net.step();
+		net.zero_grad();
+	}
+	CHECK(net.params().size() == 6);
+	CHECK_LT(last, first);
+
+	auto [wide, _] = make_batch(4, 9, 4, 3);
+	CHECK_THROWS_AS(net.forward(wide), std::invalid_argument);
+}
+
+TEST_CASE("linear bias gradient is the column sum") {
+	arma::arma_rng::set_seed(4);
+	Sequential<double> net(3, std::make_unique<SgdOptimizer<double>>(0.0),
+												 Linear<double>(2), Softmax<double>());
+	net.enable_fusion(false);
+	auto [x, y] = make_batch(5, 3, 2, 3);
+	auto output = net.forward(x);
+	net.compute_loss(output, y);
+	net.backward();
+	// d loss / d logits = (p - y) / n, summed over rows for the bias.
+	arma::Mat<double> dz = (*output.data - *y.data) / 5.0;
+	const auto &bias_grad = *net.params()[1].get().grad->data;
+	for (std::size_t c = 0; c < 2; ++c) {
+		double sum = 0.0;
+		for (std::size_t r = 0; r < 5; ++r)
+			sum += dz(r, c);
+		CHECK(bias_grad(0, c) == doctest::Approx(sum).epsilon(1e-10));
+	}
+}
+
+TEST_CASE("dropout masks while training and is the identity otherwise") {
+	arma::arma_rng::set_seed(5);
+	Sequential<double> net(64, std::make_unique<SgdOptimizer<double>>(0.0),
+												 Dropout<double>(0.5, 9));
+	Tensor<double> x(arma::Mat<double>(32, 64, arma::fill::ones));
+	auto dropped = net.forward(x);
+	std::size_t zeros = 0;
+	for (std::size_t i = 0; i < dropped.data->n_elem; ++i) {
+		const auto v = (*dropped.data)[i];
+		CHECK((v == 0.0 || v == 2.0));
+		zeros += v == 0.0;
+	}
+	CHECK(zeros > dropped.data->n_elem / 4);
+	CHECK(zeros < dropped.data->n_elem * 3 / 4);
+	net.reset_graph();
+
+	net.set_training(false);
+	auto kept = net.forward(x);
+	CHECK(arma::approx_equal(*kept.data, *x.data, "absdiff", 0.0));
+}
+
+TEST_CASE("replicas draw their own dropout masks") {
+	Sequential<double> net(64, std::make_unique<SgdOptimizer<double>>(0.0),
+												 Dropout<double>(0.5, 9));
+	const auto first = net.replicate(1), second = net.replicate(2);
+	const auto again = net.replicate(1);
+	Tensor<double> x(arma::Mat<double>(32, 64, arma::fill::ones));
+	const arma::Mat<double> a = *first->forward(x).data;
+	const arma::Mat<double> b = *second->forward(x).data;
+	const arma::Mat<double> c = *again->forward(x).data;
+	const arma::Mat<double> primary = *net.forward(x).data;
+	CHECK_FALSE(arma::approx_equal(a, b, "absdiff", 0.0));
+	CHECK_FALSE(arma::approx_equal(a, primary, "absdiff", 0.0));
+	// The same index still reproduces the same stream.
+	CHECK(arma::approx_equal(a, c, "absdiff", 0.0));
+	for (auto *model : {first.get(), second.get(), again.get(), &net})
+		model->reset_graph();
+}
+
+TEST_CASE("data parallel training handles a biased sequential") {
+	auto [x, y] = make_batch(12, 8, 4, 3);
+	auto reference = make_deep(0.2);
+	std::vector<double> expected;
+	for (int step = 0; step < 3; ++step) {
+		auto output = reference.forward(x);
+		expected.push_back(reference.compute_loss(output, y));
+		reference.backward();
+		reference.step();
+		reference.zero_grad();
+	}
+
+	auto net = make_deep(0.2);
+	DataParallelTrainer<double> trainer(net, 3);
+	for (int step = 0; step < 3; ++step)
+		CHECK_EQ(trainer.step(x, y),
+						 doctest::Approx(expected[step]).epsilon(1e-12));
+	for (std::size_t j = 0; j < net.params().size(); ++j)
+		CHECK(arma::approx_equal(*net.params()[j].get().data,
+														 *reference.params()[j].get().data, "absdiff",
+														 1e-12));
+}
@@ -0,0 +1,209 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/adam_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/spatial_operation.hpp"
+
+#include "batches.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace ExGraf;
+using namespace ExGraf::Spatial;
+
+namespace {
+
+// Textbook convolution straight from the definition, with the same layouts:
+// x is N x (C*H*W), W is (C*K*K) x OC, the output N x (OC*OH*OW).
+auto reference_conv(const arma::Mat<double> &x, const arma::Mat<double> &w,
+										const arma::Mat<double> &b, const Conv2DGeometry &g)
+		-> arma::Mat<double> {
+	const auto oh = g.out_height(), ow = g.out_width();
+	arma::Mat<double> out(x.n_rows, g.out_features(), arma::fill::zeros);
+	for (std::size_t n = 0; n < x.n_rows; ++n)
+		for (std::size_t oc = 0; oc < g.out_channels; ++oc)
+			for (std::size_t y = 0; y < oh; ++y)
+				for (std::size_t xo = 0; xo < ow; ++xo) {
+					double sum = b.n_elem ? b(0, oc) : 0.0;
+					for (std::size_t c = 0; c < g.channels; ++c)
+						for (std::size_t kh = 0; kh < g.kernel; ++kh)
+							for (std::size_t kw = 0; kw < g.kernel; ++kw) {
+								const auto iy = long(y * g.stride + kh) - long(g.padding);
+								const auto ix = long(xo * g.stride + kw) - long(g.padding);
+								if (iy < 0 || ix < 0 || iy >= long(g.height) ||
+										ix >= long(g.width))
+									continue;
+								sum += x(n, (c * g.height + iy) * g.width + ix) *
+											 w((c * g.kernel + kh) * g.kernel + kw, oc);
+							}
+					out(n, (oc * oh + y) * ow + xo) = sum;
+				}
+	return out;
+}
+
+struct ConvCase {
+	Conv2DGeometry geometry;
+	Tensor<double> x, w, b;
+};
+
+auto make_case() -> ConvCase {
+	arma::arma_rng::set_seed(31);
+	const Conv2DGeometry g{3, 7, 6, 4, 3, 2, 1};
+	return {g,
+					Tensor<double>(arma::randn<arma::Mat<double>>(5, g.in_features())),
+					Tensor<double>(arma::randn<arma::Mat<double>>(g.patch(), 4)),
+					Tensor<double>(arma::randn<arma::Mat<double>>(1, 4))};
+}
+
+// The loss sum(out % r) has gradient r with respect to the output, so the
+// input gradients follow from the reference by linearity.
+auto reference_gradients(const ConvCase &c, const arma::Mat<double> &r)
+		-> std::vector<arma::Mat<double>> {
+	const auto &g = c.geometry;
+	const arma::Mat<double> none;
+	arma::Mat<double> dx(arma::Mat<double>(c.x.data->n_rows, g.in_features(),
+																				 arma::fill::zeros));
+	arma::Mat<double> dw(g.patch(), g.out_channels, arma::fill::zeros);
+	for (std::size_t i = 0; i < dx.n_elem; ++i) {
+		arma::Mat<double> basis(dx.n_rows, dx.n_cols, arma::fill::zeros);
+		basis[i] = 1.0;
+		dx[i] = arma::accu(reference_conv(basis, *c.w.data, none, g) % r);
+	}
+	for (std::size_t i = 0; i < dw.n_elem; ++i) {
+		arma::Mat<double> basis(dw.n_rows, dw.n_cols, arma::fill::zeros);
+		basis[i] = 1.0;
+		dw[i] = arma::accu(reference_conv(*c.x.data, basis, none, g) % r);
+	}
+	arma::Mat<double> db(1, g.out_channels, arma::fill::zeros);
+	const auto p = g.positions();
+	for (std::size_t oc = 0; oc < g.out_channels; ++oc)
+		for (std::size_t n = 0; n < r.n_rows; ++n)
+			for (std::size_t k = 0; k < p; ++k)
+				db(0, oc) += r(n, oc * p + k);
+	return {dx, dw, db};
+}
+
+} // namespace
+
+TEST_CASE("shape stores N-D tensors as batch rows") {
+	const Shape s{2, 3, 4, 5};
+	CHECK(s.size() == 4);
+	CHECK(s[2] == 4);
+	CHECK(s.rows() == 2);
+	CHECK(s.cols() == 60);
+	Tensor<float> t(s);
+	CHECK(t.data->n_rows == 2);
+	CHECK(t.data->n_cols == 60);
+	CHECK(Shape{}.rows() == 1);
+	CHECK((Shape{0, 7}.cols() == 7));
+}
+
+TEST_CASE("both convolution algorithms match the reference") {
+	for (auto algorithm : {ConvAlgorithm::Im2col, ConvAlgorithm::Direct}) {
+		auto c = make_case();
+		const auto expected =
+				reference_conv(*c.x.data, *c.w.data, *c.b.data, c.geometry);
+		Conv2DOp<double> op(c.geometry, algorithm);
+		auto out = op.forward({c.x, c.w, c.b});
+		CHECK(op.algorithm() == algorithm);
+		CHECK((out.shape == Shape{5, 4, 4, 3}));
+		CHECK(arma::approx_equal(*out.data, expected, "absdiff", 1e-10));
+
+		const arma::Mat<double> r =
+				arma::randn<arma::Mat<double>>(out.data->n_rows, out.data->n_cols);
+		const auto want = reference_gradients(c, r);
+		std::vector<Tensor<double>> grads(3);
+		op.backward(Tensor<double>(r), grads);
+		for (std::size_t i = 0; i < 3; ++i)
+			CHECK(arma::approx_equal(*grads[i].data, want[i], "absdiff", 1e-9));
+	}
+}
+
+TEST_CASE("autotuned convolution picks a working algorithm") {
+	auto c = make_case();
+	Conv2DOp<double> op(c.geometry);
+	auto out = op.forward({c.x, c.w});
+	CHECK(op.algorithm() != ConvAlgorithm::Auto);
+	const arma::Mat<double> none;
+	CHECK(arma::approx_equal(
+			*out.data, reference_conv(*c.x.data, *c.w.data, none, c.geometry),
+			"absdiff", 1e-10));
+	// The choice is cached per geometry and batch.
+	Conv2DOp<double> again(c.geometry);
+	again.forward({c.x, c.w});
+	CHECK(again.algorithm() == op.algorithm());
+}
+
+TEST_CASE("max and average pooling route gradients through the window") {
+	// One sample, one 4x4 channel holding 0..15 row by row.
+	arma::Mat<double> image(1, 16);
+	for (std::size_t i = 0; i < 16; ++i)
+		image[i] = double(i);
+	const Tensor<double> x(image);
+	const Pool2DGeometry g{1, 4, 4, 2, 2};
+
+	MaxPool2DOp<double> max(g);
+	auto pooled = max.forward({x});
+	REQUIRE(pooled.data->n_cols == 4);
+	CHECK((*pooled.data)[0] == 5.0);
+	CHECK((*pooled.data)[3] == 15.0);
+	std::vector<Tensor<double>> grads(1);
+	max.backward(Tensor<double>(arma::Mat<double>(1, 4, arma::fill::ones)),
+							 grads);
+	CHECK(arma::accu(*grads[0].data) == 4.0);
+	CHECK((*grads[0].data)[5] == 1.0);
+	CHECK((*grads[0].data)[0] == 0.0);
+
+	AvgPool2DOp<double> avg(g);
+	auto averaged = avg.forward({x});
+	CHECK((*averaged.data)[0] == doctest::Approx(2.5));
+	avg.backward(Tensor<double>(arma::Mat<double>(1, 4, arma::fill::ones)),
+							 grads);
+	CHECK((*grads[0].data)[0] == doctest::Approx(0.25));
+	CHECK(arma::accu(*grads[0].data) == doctest::Approx(4.0));
+}
+
+TEST_CASE("a small CNN trains and reports its shapes") {
+	using namespace ExGraf::Layers;
+	arma::arma_rng::set_seed(32);
+	Sequential<double> net(Shape{1, 8, 8},
+												 std::make_unique<AdamOptimizer<double>>(0.01),
+												 Conv2D<double>(4, 3, 1, 1), ReLU<double>(),
+												 MaxPool2D<double>(2), Conv2D<double>(6, 3),
+												 AvgPool2D<double>(2), Linear<double>(3),
+												 Softmax<double>());
+	const auto summary = net.summary();
+	CHECK((summary.layers[0].output == Shape{4, 8, 8}));
+	CHECK(summary.layers[0].parameters == 9 * 4 + 4);
+	CHECK((summary.layers[2].output == Shape{4, 4, 4}));
+	CHECK((summary.layers[3].output == Shape{6, 2, 2}));
+	CHECK((summary.layers[4].output == Shape{6, 1, 1}));
+	CHECK(summary.layers[5].parameters == 6 * 3 + 3);
+
+	// Class k lights up column k of the image.
+	arma::Mat<double> x(24, 64, arma::fill::zeros);
+	const arma::Mat<double> y = Testing::one_hot(24, 3);
+	for (std::size_t i = 0; i < 24; ++i)
+		for (std::size_t row = 0; row < 8; ++row)
+			x(i, row * 8 + 2 * (i % 3) + 1) = 1.0;
+	const Tensor<double> inputs(x), targets(y);
+	double first = 0.0, last = 0.0;
+	for (int step = 0; step < 40; ++step) {
+		auto out = net.forward(inputs);
+		last = net.compute_loss(out, targets);
+		if (step == 0)
+			first = last;
+		net.backward();
+		net.step();
+		net.zero_grad();
+	}
+	CHECK_LT(last, first * 0.5);
+
+	CHECK_THROWS_AS(Sequential<double>(64,
+																		 std::make_unique<AdamOptimizer<double>>(),
+																		 Conv2D<double>(4, 3)),
+									std::invalid_argument);
+}
@@ -0,0 +1,109 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/layers.hpp"
+#include "exgraf/optimizers/sgd_optimizer.hpp"
+#include "exgraf/sequential.hpp"
+#include "exgraf/static_graph.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace ExGraf;
+
+namespace {
+
+constexpr std::size_t batch = 6, features = 16, classes = 5;
+using SmallNet = Static::Network<double, batch, features, Static::Linear<12>,
+																 Static::ReLU, Static::Linear<classes>,
+																 Static::Softmax>;
+
+// Column-major (Tensor) to row-major (Static) and back.
+auto row_major(const arma::Mat<double> &m) -> std::vector<double> {
+	std::vector<double> out(m.n_elem);
+	for (std::size_t r = 0; r < m.n_rows; ++r)
+		for (std::size_t c = 0; c < m.n_cols; ++c)
+			out[r * m.n_cols + c] = m(r, c);
+	return out;
+}
+
+} // namespace
+
+TEST_CASE("a static network computes what the dynamic graph computes") {
+	arma::arma_rng::set_seed(91);
+	Sequential<double> dynamic(
+			features, std::make_unique<SgdOptimizer<double>>(0.1),
+			Layers::Linear<double>(12), Layers::ReLU<double>(),
+			Layers::Linear<double>(classes), Layers::Softmax<double>());
+	auto net = std::make_unique<SmallNet>();
+	static_assert(SmallNet::parameter_count == 16 * 12 + 12 + 12 * 5 + 5);
+	net->import_parameters(dynamic.parameter_values());
+
+	const arma::Mat<double> x = arma::randn<arma::Mat<double>>(batch, features);
+	arma::Col<std::size_t> labels{0, 1, 2, 3, 4, 0};
+	const auto y = Sequential<double>::to_one_hot(labels, classes);
+	const auto xs = row_major(x), ys = row_major(*y.data);
+
+	for (int step = 0; step < 3; ++step) {
+		dynamic.zero_grad();
+		const auto expected = dynamic.forward(Tensor<double>(x));
+		const double expected_loss = dynamic.compute_loss(expected, y);
+		dynamic.backward();
+
+		const auto probabilities = net->forward(SmallNet::Input(xs));
+		const auto want = row_major(*expected.data);
+		for (std::size_t i = 0; i < want.size(); ++i)
+			CHECK(probabilities[i] == doctest::Approx(want[i]).epsilon(1e-12));
+		const auto target = SmallNet::Output(ys);
+		CHECK(net->loss(target) == doctest::Approx(expected_loss).epsilon(1e-12));
+		net->backward(target);
+
+		// Same gradients, parameter by parameter; Static keeps them row-major.
+		std::size_t tensor = 0;
+		net->for_each_parameter([&](std::span<double>,
+																std::span<const double> grad) {
+			REQUIRE(tensor < dynamic.params().size());
+			const auto want =
+					row_major(*dynamic.params()[tensor++].get().grad->data);
+			REQUIRE(want.size() == grad.size());
+			for (std::size_t i = 0; i < want.size(); ++i)
+				CHECK(grad[i] == doctest::Approx(want[i]).epsilon(1e-12));
+		});
+		CHECK(tensor == dynamic.params().size());
+
+		dynamic.step();
+		net->sgd_step(0.1);
+		std::vector<double> values(SmallNet::parameter_count);
+		net->export_parameters(values);
+		const auto reference = dynamic.parameter_values();
+		for (std::size_t i = 0; i < values.size(); ++i)
+			CHECK(values[i] == doctest::Approx(reference[i]).epsilon(1e-12));
+	}
+}
+
+TEST_CASE("a static training step does not allocate") {
+	auto net = std::make_unique<SmallNet>(7);
+	std::vector<double> xs(batch * features, 0.5), ys(batch * classes, 0.0);
+	for (std::size_t n = 0; n < batch; ++n)
+		ys[n * classes + n % classes] = 1.0;
+	const SmallNet::Input x(xs);
+	const SmallNet::Output y(ys);
+
+	net->forward(x);
+	const double first = net->loss(y);
+	const auto before = Testing::allocation_count();
+	for (int step = 0; step < 20; ++step) {
+		net->forward(x);
+		net->backward(y);
+		net->sgd_step(0.05);
+	}
+	CHECK_EQ(Testing::allocation_count() - before, 0);
+	net->forward(x);
+	CHECK(net->loss(y) < first);
+}
+
+TEST_CASE("static parameter import checks its size") {
+	auto net = std::make_unique<SmallNet>();
+	std::vector<double> wrong(SmallNet::parameter_count - 1);
+	CHECK_THROWS_AS(net->import_parameters(wrong), std::invalid_argument);
+}
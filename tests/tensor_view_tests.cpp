@@ -0,0 +1,124 @@
+#include <armadillo>
+#include <doctest/doctest.h>
+
+#include "exgraf/tensor_view.hpp"
+
+using namespace ExGraf;
+
+namespace {
+
+// A {2, 3, 4} tensor whose element (i, j, k) holds 100i + 10j + k.
+auto numbered() -> Tensor<double> {
+	Tensor<double> t(Shape{2, 3, 4});
+	for (std::size_t i = 0; i < 2; ++i)
+		for (std::size_t j = 0; j < 3; ++j)
+			for (std::size_t k = 0; k < 4; ++k)
+				(*t.data)(i, j * 4 + k) = double(100 * i + 10 * j + k);
+	return t;
+}
+
+} // namespace
+
+TEST_CASE("views follow the tensor layout and share its storage") {
+	auto t = numbered();
+	TensorView<double> v(t);
+	CHECK(v.is_canonical());
+	CHECK(v.at({1, 2, 3}) == 123.0);
+	v.at({0, 1, 1}) = -1.0;
+	CHECK((*t.data)(0, 5) == -1.0);
+	CHECK(v.data() == t.data->memptr());
+}
+
+TEST_CASE("slice, transpose and broadcast rewrite strides only") {
+	auto t = numbered();
+	TensorView<double> v(t);
+
+	auto s = v.slice(1, 1, 3).slice(2, 0, 4, 2);
+	CHECK((s.shape() == Shape{2, 2, 2}));
+	CHECK(s.at({1, 1, 1}) == 122.0);
+	CHECK(s.data() == t.data->memptr() + 2 * 4);
+
+	auto p = v.transpose(0, 2);
+	CHECK((p.shape() == Shape{4, 3, 2}));
+	CHECK(p.at({3, 0, 1}) == 103.0);
+	CHECK_FALSE(p.is_canonical());
+
+	Tensor<double> bias(arma::Mat<double>{{1.0, 2.0, 3.0}});
+	auto b = TensorView<double>(bias).broadcast_to(Shape{5, 3});
+	CHECK(b.strides()[0] == 0);
+	CHECK(b.at({4, 2}) == 3.0);
+	CHECK_THROWS_AS(b.broadcast_to(Shape{5, 4}), std::invalid_argument);
+
+	const auto m = p.materialize();
+	CHECK(m.data->n_rows == 4);
+	CHECK(TensorView<double>(m).at({3, 0, 1}) == 103.0);
+}
+
+TEST_CASE("reshape is a view only when the memory order agrees") {
+	auto t = numbered();
+	TensorView<double> v(t);
+	auto flat = v.reshape(Shape{2, 12});
+	CHECK(flat.at({1, 11}) == 123.0);
+	CHECK(v.reshape(Shape{2, 4, 3}).at({0, 3, 2}) == 23.0);
+	CHECK_THROWS_AS(v.reshape(Shape{4, 6}), std::invalid_argument);
+	CHECK_THROWS_AS(v.transpose(1, 2).reshape(Shape{2, 12}),
+									std::invalid_argument);
+	CHECK(v.transpose(1, 2).materialize().data->n_cols == 12);
+}
+
+TEST_CASE("matmul takes transposed and column-sliced views in place") {
+	arma::arma_rng::set_seed(41);
+	const Tensor<double> a(arma::randn<arma::Mat<double>>(6, 5));
+	const Tensor<double> b(arma::randn<arma::Mat<double>>(6, 4));
+	TensorView<double> va(a), vb(b);
+	arma::Mat<double> out;
+
+	matmul(va.transpose(), vb, out);
+	CHECK(va.transpose().is_transposed_matrix());
+	CHECK(arma::approx_equal(out, a.data->t() * *b.data, "absdiff", 1e-12));
+
+	matmul(vb.transpose(), va.slice(1, 1, 4), out);
+	CHECK(va.slice(1, 1, 4).is_canonical());
+	CHECK(arma::approx_equal(out, b.data->t() * a.data->cols(1, 3), "absdiff",
+													 1e-12));
+
+	// Row slices keep a unit stride down each column and go to GEMM in
+	// place, the parent's column height as their leading dimension.
+	const auto operand = Detail::gemm_operand(va.slice(0, 2, 6));
+	REQUIRE(operand.has_value());
+	CHECK(operand->ld == 6);
+	CHECK(operand->data == a.data->memptr() + 2);
+	matmul(va.slice(0, 2, 6).transpose(), vb.slice(0, 2, 6), out);
+	CHECK(arma::approx_equal(out, a.data->rows(2, 5).t() * b.data->rows(2, 5),
+													 "absdiff", 1e-12));
+	// Every other row has no unit stride and is gathered.
+	CHECK_FALSE(Detail::gemm_operand(va.slice(0, 0, 6, 2)).has_value());
+	matmul(vb.slice(0, 0, 6, 2).transpose(), va.slice(0, 0, 6, 2), out);
+	arma::Mat<double> even_a(3, 5), even_b(3, 4);
+	for (std::size_t i = 0; i < 3; ++i) {
+		even_a.row(i) = a.data->row(2 * i);
+		even_b.row(i) = b.data->row(2 * i);
+	}
+	CHECK(arma::approx_equal(out, even_b.t() * even_a, "absdiff", 1e-12));
+	CHECK_THROWS_AS(matmul(va, vb, out), std::invalid_argument);
+}
+
+TEST_CASE("row windows share the tensor's storage") {
+	const auto t = numbered();
+	const auto window = Tensor<double>::rows_of(t, 1, 1);
+	CHECK(window.data == t.data);
+	CHECK(window.shape == (Shape{1, 3, 4}));
+	CHECK(window.n_rows() == 1);
+	CHECK(window.origin() == t.data->memptr() + 1);
+
+	// Element (0, j, k) of the window is element (1, j, k) of the tensor.
+	const TensorView<double> v(window);
+	CHECK(v.shape() == (Shape{1, 3, 4}));
+	CHECK(v.at({0, 2, 3}) == 123.0);
+	CHECK(TensorView<double>::matrix_of(window).shape() == (Shape{1, 12}));
+	CHECK(v.materialize().data->at(0, 11) == 123.0);
+
+	const auto nested = Tensor<double>::rows_of(window, 0, 1);
+	CHECK(nested.origin() == window.origin());
+	CHECK_THROWS_AS(Tensor<double>::rows_of(window, 1, 1), std::out_of_range);
+}